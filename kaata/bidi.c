@@ -0,0 +1,380 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Bidirectional text, one paragraph at a time.
+ *
+ * The Unicode bidi algorithm never looks past a paragraph break, so each
+ * paragraph is resolved with fribidi on its own, the first time it is asked
+ * for, and kept: its embedding levels, its runs in visual order and the maps
+ * between logical and visual character positions. An edit invalidates the
+ * paragraphs it touched and nothing else, so typing resolves one paragraph
+ * again, not the document.
+ *
+ * Each resolved paragraph is a single allocation. The fribidi work buffers
+ * are kept between calls.
+ */
+#include "bidi.h"
+#include <core/heap.h>
+
+#include <fribidi.h>
+
+/*----------------------------------------------------------------------------*/
+struct _kt_bidi_t {
+    KtBidiPara **paras;
+    uint32_t count;
+    uint32_t capacity;
+    KtDirection direction;
+    uint32_t resolved;
+
+    uint32_t scratch;
+    FriBidiChar *chars;
+    FriBidiCharType *types;
+    FriBidiBracketType *brackets;
+    FriBidiLevel *levels;
+    FriBidiStrIndex *map;
+    uint32_t *offsets;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_para_size(uint32_t length, uint32_t runs) {
+    return (uint32_t)sizeof(KtBidiPara)
+        + (length + 1) * (uint32_t)sizeof(uint32_t)
+        + length * 2 * (uint32_t)sizeof(uint32_t)
+        + runs * (uint32_t)sizeof(KtBidiRun)
+        + length;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_para_free(KtBidiPara **para) {
+    if (*para != NULL) {
+        heap_free((byte_t**)para, i_para_size((*para)->length, (*para)->runCount), "KtBidiPara");
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_scratch_free(KtBidi *bidi) {
+    if (bidi->scratch == 0) {
+        return;
+    }
+
+    heap_delete_n(&bidi->chars, bidi->scratch, FriBidiChar);
+    heap_delete_n(&bidi->types, bidi->scratch, FriBidiCharType);
+    heap_delete_n(&bidi->brackets, bidi->scratch, FriBidiBracketType);
+    heap_delete_n(&bidi->levels, bidi->scratch, FriBidiLevel);
+    heap_delete_n(&bidi->map, bidi->scratch, FriBidiStrIndex);
+    heap_delete_n(&bidi->offsets, bidi->scratch + 1, uint32_t);
+    bidi->scratch = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_scratch_reserve(KtBidi *bidi, uint32_t size) {
+    if (size <= bidi->scratch) {
+        return;
+    }
+
+    uint32_t scratch = bidi->scratch > 0 ? bidi->scratch : 256;
+    while (scratch < size) {
+        scratch *= 2;
+    }
+
+    i_scratch_free(bidi);
+    bidi->chars = heap_new_n(scratch, FriBidiChar);
+    bidi->types = heap_new_n(scratch, FriBidiCharType);
+    bidi->brackets = heap_new_n(scratch, FriBidiBracketType);
+    bidi->levels = heap_new_n(scratch, FriBidiLevel);
+    bidi->map = heap_new_n(scratch, FriBidiStrIndex);
+    bidi->offsets = heap_new_n(scratch + 1, uint32_t);
+    bidi->scratch = scratch;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(KtBidi *bidi, uint32_t count) {
+    if (count <= bidi->capacity) {
+        return;
+    }
+
+    uint32_t capacity = bidi->capacity > 0 ? bidi->capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    KtBidiPara **paras = heap_new_n0(capacity, KtBidiPara*);
+    if (bidi->count > 0) {
+        memcpy(paras, bidi->paras, bidi->count * sizeof(KtBidiPara*));
+    }
+    if (bidi->capacity > 0) {
+        heap_delete_n(&bidi->paras, bidi->capacity, KtBidiPara*);
+    }
+    bidi->paras = paras;
+    bidi->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The text is valid UTF-8; lead bytes alone give the code point length. */
+static uint32_t i_decode(const char_t *text, uint32_t size, FriBidiChar *chars, uint32_t *offsets) {
+    uint32_t n = 0;
+    uint32_t i = 0;
+    while (i < size) {
+        byte_t c = (byte_t)text[i];
+        uint32_t k = c < 0xC0 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        FriBidiChar cp = k == 1 ? c : k == 2 ? (c & 0x1Fu) : k == 3 ? (c & 0x0Fu) : (c & 0x07u);
+        if (i + k > size) {
+            k = size - i;
+        }
+        for (uint32_t j = 1; j < k; ++j) {
+            cp = (cp << 6) | ((byte_t)text[i + j] & 0x3Fu);
+        }
+
+        offsets[n] = i;
+        chars[n] = cp;
+        n += 1;
+        i += k;
+    }
+    offsets[n] = size;
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs with no strong character follow `direction`; for an Urdu
+ * editor an undecided one is right-to-left. */
+static FriBidiParType i_par_type(KtDirection direction) {
+    switch (direction) {
+    case KDirLtr:
+        return FRIBIDI_PAR_LTR;
+    case KDirRtl:
+        return FRIBIDI_PAR_RTL;
+    default:
+        return FRIBIDI_PAR_WRTL;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static KtBidiPara *i_resolve(KtBidi *bidi, const char_t *text, uint32_t size) {
+    i_scratch_reserve(bidi, size + 1);
+    FriBidiStrIndex n = (FriBidiStrIndex)i_decode(text, size, bidi->chars, bidi->offsets);
+    FriBidiParType base = i_par_type(bidi->direction);
+
+    for (FriBidiStrIndex i = 0; i < n; ++i) {
+        bidi->map[i] = i;
+    }
+    if (n > 0) {
+        fribidi_get_bidi_types(bidi->chars, n, bidi->types);
+        fribidi_get_bracket_types(bidi->chars, n, bidi->types, bidi->brackets);
+        if (fribidi_get_par_embedding_levels_ex(bidi->types, bidi->brackets, n, &base, bidi->levels) != 0) {
+            fribidi_reorder_line(FRIBIDI_FLAGS_DEFAULT, bidi->types, n, 0, base, bidi->levels, NULL, bidi->map);
+        } else {
+            memset(bidi->levels, FRIBIDI_IS_RTL(base) ? 1 : 0, (size_t)n * sizeof(FriBidiLevel));
+        }
+    }
+
+    uint32_t runs = 0;
+    for (FriBidiStrIndex v = 0; v < n; ++v) {
+        FriBidiStrIndex l = bidi->map[v];
+        FriBidiStrIndex prev = v > 0 ? bidi->map[v - 1] : 0;
+        if (v == 0 || bidi->levels[l] != bidi->levels[prev] || (l != prev + 1 && l + 1 != prev)) {
+            runs += 1;
+        }
+    }
+
+    uint32_t length = (uint32_t)n;
+    KtBidiPara *para = (KtBidiPara*)heap_malloc(i_para_size(length, runs), "KtBidiPara");
+    para->length = length;
+    para->runCount = runs;
+    para->rtl = FRIBIDI_IS_RTL(base) ? TRUE : FALSE;
+    para->offsets = (uint32_t*)(para + 1);
+    para->toVisual = para->offsets + length + 1;
+    para->toLogical = para->toVisual + length;
+    para->runs = (KtBidiRun*)(para->toLogical + length);
+    para->levels = (uint8_t*)(para->runs + runs);
+
+    memcpy(para->offsets, bidi->offsets, (length + 1) * sizeof(uint32_t));
+    KtBidiRun *run = NULL;
+    for (uint32_t v = 0; v < length; ++v) {
+        uint32_t l = (uint32_t)bidi->map[v];
+        uint8_t level = (uint8_t)bidi->levels[l];
+        para->levels[l] = level;
+        para->toLogical[v] = l;
+        para->toVisual[l] = v;
+
+        uint32_t prev = v > 0 ? para->toLogical[v - 1] : 0;
+        if (run != NULL && run->level == level && (l == prev + 1 || l + 1 == prev)) {
+            run->start = l < run->start ? l : run->start;
+            run->length += 1;
+        } else {
+            run = run != NULL ? run + 1 : para->runs;
+            run->start = l;
+            run->length = 1;
+            run->level = level;
+        }
+    }
+
+    bidi->resolved += 1;
+    return para;
+}
+
+/*----------------------------------------------------------------------------*/
+KtBidi* ktBidiCreate(KtDirection direction) {
+    KtBidi *bidi = heap_new0(KtBidi);
+    bidi->direction = direction;
+    return bidi;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktBidiDestroy(KtBidi** bidi) {
+    if (bidi == NULL || *bidi == NULL) {
+        return;
+    }
+
+    KtBidi *b = *bidi;
+    ktBidiSplice(b, 0, b->count, 0);
+    if (b->capacity > 0) {
+        heap_delete_n(&b->paras, b->capacity, KtBidiPara*);
+    }
+    i_scratch_free(b);
+    heap_delete(bidi, KtBidi);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktBidiReset(KtBidi* bidi, uint32_t count) {
+    if (bidi == NULL) {
+        return;
+    }
+
+    ktBidiSplice(bidi, 0, bidi->count, count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces `removed` paragraphs from `first` on with `inserted` unresolved
+ * ones, after an edit joined or split paragraphs. */
+void ktBidiSplice(KtBidi* bidi, uint32_t first, uint32_t removed, uint32_t inserted) {
+    if (bidi == NULL || first > bidi->count) {
+        return;
+    }
+    if (removed > bidi->count - first) {
+        removed = bidi->count - first;
+    }
+
+    for (uint32_t i = first; i < first + removed; ++i) {
+        i_para_free(&bidi->paras[i]);
+    }
+
+    uint32_t count = bidi->count - removed + inserted;
+    uint32_t tail = bidi->count - first - removed;
+    i_reserve(bidi, count);
+    if (tail > 0 && removed != inserted) {
+        memmove(bidi->paras + first + inserted, bidi->paras + first + removed, tail * sizeof(KtBidiPara*));
+    }
+    for (uint32_t i = first; i < first + inserted; ++i) {
+        bidi->paras[i] = NULL;
+    }
+    bidi->count = count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs whose text changed. */
+void ktBidiInvalidate(KtBidi* bidi, uint32_t first, uint32_t count) {
+    if (bidi == NULL || first >= bidi->count) {
+        return;
+    }
+    if (count > bidi->count - first) {
+        count = bidi->count - first;
+    }
+
+    for (uint32_t i = first; i < first + count; ++i) {
+        i_para_free(&bidi->paras[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* How many paragraphs have been run through fribidi so far. */
+uint32_t ktBidiResolved(const KtBidi* bidi) {
+    return bidi != NULL ? bidi->resolved : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The resolved paragraph, from the cache when its text has not changed. */
+const KtBidiPara* ktBidiParagraph(KtBidi* bidi, uint32_t paragraph, const char_t *text, uint32_t size) {
+    if (bidi == NULL || paragraph >= bidi->count || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    KtBidiPara *para = bidi->paras[paragraph];
+    if (para != NULL && para->offsets[para->length] == size) {
+        return para;
+    }
+
+    /* a stale entry of another length was not invalidated */
+    i_para_free(&bidi->paras[paragraph]);
+    bidi->paras[paragraph] = i_resolve(bidi, text, size);
+    return bidi->paras[paragraph];
+}
+
+/*----------------------------------------------------------------------------*/
+/* The character that covers byte `offset`. */
+uint32_t ktBidiCharAt(const KtBidiPara* para, uint32_t offset) {
+    if (para == NULL || para->length == 0) {
+        return 0;
+    }
+
+    uint32_t lo = 0, hi = para->length;
+    while (lo + 1 < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (para->offsets[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Visual order of the characters [start, end) when they make up a line of
+ * their own: `order[v]` is the character shown at position v of the line. */
+void ktBidiLineOrder(const KtBidiPara* para, uint32_t start, uint32_t end, uint32_t *order) {
+    if (para == NULL || order == NULL || end > para->length || start >= end) {
+        return;
+    }
+
+    uint32_t n = end - start;
+    uint8_t high = 0, lowOdd = 0xFF;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint8_t level = para->levels[start + i];
+        order[i] = start + i;
+        high = level > high ? level : high;
+        if ((level & 1) != 0 && level < lowOdd) {
+            lowOdd = level;
+        }
+    }
+
+    /* rule L2: from the highest level down to the lowest odd one, reverse
+     * every run at that level or higher */
+    for (uint32_t level = high; level >= lowOdd && level > 0; --level) {
+        uint32_t i = 0;
+        while (i < n) {
+            if (para->levels[order[i]] < level) {
+                i += 1;
+                continue;
+            }
+            uint32_t j = i;
+            while (j < n && para->levels[order[j]] >= level) {
+                j += 1;
+            }
+            for (uint32_t a = i, b = j - 1; a < b; ++a, --b) {
+                uint32_t t = order[a];
+                order[a] = order[b];
+                order[b] = t;
+            }
+            i = j;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
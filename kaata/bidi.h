@@ -0,0 +1,36 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_BIDI_H__
+#define __KAATA_BIDI_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtBidi* ktBidiCreate(KtDirection direction);
+_kaata_api void ktBidiDestroy(KtBidi** bidi);
+_kaata_api void ktBidiReset(KtBidi* bidi, uint32_t count);
+_kaata_api void ktBidiSplice(KtBidi* bidi, uint32_t first, uint32_t removed, uint32_t inserted);
+_kaata_api void ktBidiInvalidate(KtBidi* bidi, uint32_t first, uint32_t count);
+_kaata_api uint32_t ktBidiResolved(const KtBidi* bidi);
+
+_kaata_api const KtBidiPara* ktBidiParagraph(KtBidi* bidi, uint32_t paragraph, const char_t *text, uint32_t size);
+_kaata_api uint32_t ktBidiCharAt(const KtBidiPara* para, uint32_t offset);
+_kaata_api void ktBidiLineOrder(const KtBidiPara* para, uint32_t start, uint32_t end, uint32_t *order);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_BIDI_H__ */
+/*----------------------------------------------------------------------------*/
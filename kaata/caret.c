@@ -0,0 +1,419 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Caret geometry, per paragraph.
+ *
+ * Clicking or dragging in a line means going from a pixel back to a byte
+ * offset, and drawing the caret the other way round; with ligatures, marks
+ * and mixed directions, only the glyph clusters of the shaped run tell. A
+ * paragraph's clusters are laid out along its lines once, the way the view
+ * draws them, into stops: the characters a cluster stands for and the span
+ * of the line it covers. Each line's stops are kept in visual order, to
+ * find the one under a pixel by bisection, and in logical order, to find
+ * the one holding an offset the same way. A cluster is never split, the
+ * caret stays out of ligatures and off marks.
+ *
+ * Paragraphs are indexed like the line cache, and an edit splices or
+ * invalidates them the same way. Each keeps the map of the last width it
+ * was asked for, as a single allocation. A map is also tagged with the
+ * caller's stamp of the document, so that while the document is unchanged
+ * it can be found again without the paragraph's text.
+ */
+#include "caret.h"
+#include "shapecache.h"
+#include "bidi.h"
+#include <core/heap.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------*/
+typedef struct _entry_t Entry;
+struct _entry_t {
+    uint64_t hash;
+    uint32_t size;
+    int32_t width;
+    uint32_t stamp;
+    uint32_t bytes;
+    KtCaretMap map;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _order_t Order;
+struct _order_t {
+    uint32_t start;
+    uint32_t stop;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _kt_caret_cache_t {
+    Entry **slots;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t bytes;
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_entry_size(uint32_t lines, uint32_t stops) {
+    return (uint32_t)sizeof(Entry) + stops * (uint32_t)sizeof(KtCaretStop)
+        + (3 * lines + 1 + stops) * (uint32_t)sizeof(uint32_t);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_entry_free(KtCaretCache *cache, Entry **entry) {
+    if (*entry != NULL) {
+        cache->bytes -= (*entry)->bytes;
+        heap_free((byte_t**)entry, (*entry)->bytes, "KtCaretMap");
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(KtCaretCache *cache, uint32_t count) {
+    if (count <= cache->capacity) {
+        return;
+    }
+
+    uint32_t capacity = cache->capacity > 0 ? cache->capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    Entry **slots = heap_new_n0(capacity, Entry*);
+    if (cache->count > 0) {
+        memcpy(slots, cache->slots, cache->count * sizeof(Entry*));
+    }
+    if (cache->capacity > 0) {
+        heap_delete_n(&cache->slots, cache->capacity, Entry*);
+    }
+    cache->slots = slots;
+    cache->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_line_of(const uint32_t *starts, uint32_t lines, uint32_t offset) {
+    uint32_t lo = 1, hi = lines;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (starts[mid] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static int i_order_cmp(const void *a, const void *b) {
+    const Order *oa = (const Order*)a;
+    const Order *ob = (const Order*)b;
+    if (oa->start != ob->start) {
+        return oa->start < ob->start ? -1 : 1;
+    }
+    return oa->stop < ob->stop ? -1 : (oa->stop > ob->stop ? 1 : 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Consecutive glyphs of a line with the same cluster make one stop. */
+static uint32_t i_count_stops(const KtGlyphRun *run, const uint32_t *starts, uint32_t lines, uint32_t *last, uint32_t *counts) {
+    uint32_t count = 0;
+    for (uint32_t l = 0; l < lines; ++l) {
+        last[l] = UINT32_MAX;
+        counts[l] = 0;
+    }
+    for (uint32_t i = 0; run != NULL && i < run->count; ++i) {
+        uint32_t l = i_line_of(starts, lines, run->clusters[i]);
+        if (last[l] != run->clusters[i]) {
+            last[l] = run->clusters[i];
+            counts[l] += 1;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+static Entry *i_build(const KtGlyphRun *run, const KtBidiPara *bidi, uint32_t size, const uint32_t *starts, uint32_t lines) {
+    uint32_t *last = heap_new_n(lines, uint32_t);
+    uint32_t *next = heap_new_n(lines, uint32_t);
+    uint32_t count = i_count_stops(run, starts, lines, last, next);
+    uint32_t bytes = i_entry_size(lines, count);
+    Entry *entry = (Entry*)heap_malloc(bytes, "KtCaretMap");
+    KtCaretMap *map = &entry->map;
+    entry->bytes = bytes;
+    map->lines = lines;
+    map->size = size;
+    map->stops = (KtCaretStop*)(entry + 1);
+    map->starts = (uint32_t*)(map->stops + count);
+    map->widths = (int32_t*)(map->starts + lines);
+    map->first = (uint32_t*)(map->widths + lines);
+    map->logical = map->first + lines + 1;
+    memcpy(map->starts, starts, lines * sizeof(uint32_t));
+
+    /* where each line's stops begin */
+    map->first[0] = 0;
+    for (uint32_t l = 0; l < lines; ++l) {
+        map->first[l + 1] = map->first[l] + next[l];
+        next[l] = map->first[l];
+        last[l] = UINT32_MAX;
+        map->widths[l] = 0;
+    }
+
+    /* each line's pen moves along the run as it does when drawn */
+    bool_t rtl = bidi == NULL || bidi->rtl;
+    map->rtl = rtl;
+    for (uint32_t i = 0; run != NULL && i < run->count; ++i) {
+        uint32_t cluster = run->clusters[i];
+        uint32_t l = i_line_of(starts, lines, cluster);
+        if (last[l] != cluster) {
+            KtCaretStop *stop = &map->stops[next[l]++];
+            stop->start = cluster;
+            stop->end = cluster;
+            stop->left = map->widths[l];
+            stop->right = map->widths[l];
+            stop->rtl = rtl;
+            if (bidi != NULL && bidi->length > 0) {
+                stop->rtl = (bidi->levels[ktBidiCharAt(bidi, cluster)] & 1) != 0;
+            }
+            last[l] = cluster;
+        }
+        map->widths[l] += run->advances[i];
+        map->stops[next[l] - 1].right = map->widths[l];
+    }
+
+    /* a stop ends where the next one in logical order starts */
+    Order *order = count > 0 ? heap_new_n(count, Order) : NULL;
+    for (uint32_t s = 0; s < count; ++s) {
+        order[s].start = map->stops[s].start;
+        order[s].stop = s;
+    }
+    for (uint32_t l = 0; l < lines; ++l) {
+        uint32_t a = map->first[l], b = map->first[l + 1];
+        if (b - a > 1) {
+            qsort(order + a, b - a, sizeof(Order), i_order_cmp);
+        }
+        for (uint32_t s = a; s < b; ++s) {
+            map->logical[s] = order[s].stop;
+            map->stops[order[s].stop].end = s + 1 < b ? order[s + 1].start : (l + 1 < lines ? starts[l + 1] : size);
+        }
+    }
+
+    if (order != NULL) {
+        heap_delete_n(&order, count, Order);
+    }
+    heap_delete_n(&next, lines, uint32_t);
+    heap_delete_n(&last, lines, uint32_t);
+    return entry;
+}
+
+/*----------------------------------------------------------------------------*/
+KtCaretCache* ktCaretCacheCreate(void) {
+    return heap_new0(KtCaretCache);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktCaretCacheDestroy(KtCaretCache** cache) {
+    if (cache == NULL || *cache == NULL) {
+        return;
+    }
+
+    KtCaretCache *c = *cache;
+    ktCaretCacheSplice(c, 0, c->count, 0);
+    if (c->capacity > 0) {
+        heap_delete_n(&c->slots, c->capacity, Entry*);
+    }
+    heap_delete(cache, KtCaretCache);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktCaretCacheReset(KtCaretCache* cache, uint32_t count) {
+    if (cache == NULL) {
+        return;
+    }
+
+    ktCaretCacheSplice(cache, 0, cache->count, count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces `removed` paragraphs from `first` on with `inserted` empty ones,
+ * after an edit joined or split paragraphs. */
+void ktCaretCacheSplice(KtCaretCache* cache, uint32_t first, uint32_t removed, uint32_t inserted) {
+    if (cache == NULL || first > cache->count) {
+        return;
+    }
+    if (removed > cache->count - first) {
+        removed = cache->count - first;
+    }
+
+    for (uint32_t i = first; i < first + removed; ++i) {
+        i_entry_free(cache, &cache->slots[i]);
+    }
+
+    uint32_t count = cache->count - removed + inserted;
+    uint32_t tail = cache->count - first - removed;
+    i_reserve(cache, count);
+    if (tail > 0 && removed != inserted) {
+        memmove(cache->slots + first + inserted, cache->slots + first + removed, tail * sizeof(Entry*));
+    }
+    if (inserted > 0) {
+        memset(cache->slots + first, 0, inserted * sizeof(Entry*));
+    }
+    cache->count = count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs whose text changed. */
+void ktCaretCacheInvalidate(KtCaretCache* cache, uint32_t first, uint32_t count) {
+    if (cache == NULL || first >= cache->count) {
+        return;
+    }
+    if (count > cache->count - first) {
+        count = cache->count - first;
+    }
+
+    for (uint32_t i = first; i < first + count; ++i) {
+        i_entry_free(cache, &cache->slots[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The caret map of a paragraph shaped into `run` and wrapped to `width` at
+ * `starts`, built unless it is cached, and tagged with `stamp`. It stays
+ * valid until the paragraph is asked for at another width, or changes. */
+const KtCaretMap* ktCaretCacheGet(KtCaretCache* cache, uint32_t paragraph, const KtGlyphRun* run, const KtBidiPara* bidi, const char_t *text, uint32_t size, int32_t width, uint32_t stamp, const uint32_t *starts, uint32_t lines) {
+    if (cache == NULL || paragraph >= cache->count || (text == NULL && size > 0) || starts == NULL || lines == 0) {
+        return NULL;
+    }
+
+    uint64_t hash = ktHash(text, size);
+    Entry **slot = &cache->slots[paragraph];
+    if (*slot != NULL && (*slot)->width == width && (*slot)->size == size && (*slot)->hash == hash) {
+        (*slot)->stamp = stamp;
+        cache->hits += 1;
+        return &(*slot)->map;
+    }
+
+    i_entry_free(cache, slot);
+    *slot = i_build(run, bidi, size, starts, lines);
+    (*slot)->hash = hash;
+    (*slot)->size = size;
+    (*slot)->width = width;
+    (*slot)->stamp = stamp;
+    cache->bytes += (*slot)->bytes;
+    cache->misses += 1;
+    return &(*slot)->map;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The cached map of a paragraph at `width`, if it was last got with the same
+ * `stamp`; NULL otherwise, and the paragraph has to be laid out for it. */
+const KtCaretMap* ktCaretCacheFind(KtCaretCache* cache, uint32_t paragraph, int32_t width, uint32_t stamp) {
+    if (cache == NULL || paragraph >= cache->count) {
+        return NULL;
+    }
+
+    Entry *entry = cache->slots[paragraph];
+    if (entry == NULL || entry->width != width || entry->stamp != stamp) {
+        return NULL;
+    }
+    cache->hits += 1;
+    return &entry->map;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktCaretCacheStats(const KtCaretCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *bytes) {
+    if (hits != NULL) {
+        *hits = cache != NULL ? cache->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = cache != NULL ? cache->misses : 0;
+    }
+    if (bytes != NULL) {
+        *bytes = cache != NULL ? cache->bytes : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The line an offset is on; at a break, the line it starts. */
+uint32_t ktCaretLine(const KtCaretMap* map, uint32_t offset) {
+    if (map == NULL || map->lines == 0) {
+        return 0;
+    }
+    return i_line_of(map->starts, map->lines, offset);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The offset a click at `x` on a line puts the caret at: the nearer edge of
+ * the stop under it, or of the stop at the end it is beyond. */
+uint32_t ktCaretHit(const KtCaretMap* map, uint32_t line, int32_t x) {
+    if (map == NULL || map->lines == 0) {
+        return 0;
+    }
+    if (line >= map->lines) {
+        line = map->lines - 1;
+    }
+
+    uint32_t a = map->first[line], b = map->first[line + 1];
+    if (a == b) {
+        return map->starts[line];
+    }
+
+    /* the last stop starting left of x */
+    uint32_t lo = a + 1, hi = b;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (map->stops[mid].left <= x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const KtCaretStop *stop = &map->stops[lo - 1];
+    bool_t leftHalf = x - stop->left < stop->right - x;
+    return leftHalf != stop->rtl ? stop->start : stop->end;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Where the caret at `offset` is drawn on a line, in 26.6 from its left
+ * end: the edge its stop is read from, or the far edge of the stop it ends.
+ * Offsets off the line go to its nearer logical end. */
+int32_t ktCaretX(const KtCaretMap* map, uint32_t line, uint32_t offset) {
+    if (map == NULL || map->lines == 0) {
+        return 0;
+    }
+    if (line >= map->lines) {
+        line = map->lines - 1;
+    }
+
+    uint32_t a = map->first[line], b = map->first[line + 1];
+    if (a == b) {
+        return 0;
+    }
+
+    /* the last stop starting at or before the offset, in logical order */
+    uint32_t lo = a + 1, hi = b;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (map->stops[map->logical[mid]].start <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const KtCaretStop *stop = &map->stops[map->logical[lo - 1]];
+    if (offset >= stop->end && stop->end > stop->start) {
+        return stop->rtl ? stop->left : stop->right;
+    }
+    return stop->rtl ? stop->right : stop->left;
+}
+
+/*----------------------------------------------------------------------------*/
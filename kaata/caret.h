@@ -0,0 +1,39 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_CARET_H__
+#define __KAATA_CARET_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtCaretCache* ktCaretCacheCreate(void);
+_kaata_api void ktCaretCacheDestroy(KtCaretCache** cache);
+_kaata_api void ktCaretCacheReset(KtCaretCache* cache, uint32_t count);
+_kaata_api void ktCaretCacheSplice(KtCaretCache* cache, uint32_t first, uint32_t removed, uint32_t inserted);
+_kaata_api void ktCaretCacheInvalidate(KtCaretCache* cache, uint32_t first, uint32_t count);
+
+_kaata_api const KtCaretMap* ktCaretCacheGet(KtCaretCache* cache, uint32_t paragraph, const KtGlyphRun* run, const KtBidiPara* bidi, const char_t *text, uint32_t size, int32_t width, uint32_t stamp, const uint32_t *starts, uint32_t lines);
+_kaata_api const KtCaretMap* ktCaretCacheFind(KtCaretCache* cache, uint32_t paragraph, int32_t width, uint32_t stamp);
+_kaata_api void ktCaretCacheStats(const KtCaretCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *bytes);
+
+_kaata_api uint32_t ktCaretLine(const KtCaretMap* map, uint32_t offset);
+_kaata_api uint32_t ktCaretHit(const KtCaretMap* map, uint32_t line, int32_t x);
+_kaata_api int32_t ktCaretX(const KtCaretMap* map, uint32_t line, uint32_t offset);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_CARET_H__ */
+/*----------------------------------------------------------------------------*/
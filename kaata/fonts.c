@@ -0,0 +1,453 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Font faces and fallback.
+ *
+ * Each face is loaded once, by path and face index, and kept until the
+ * manager goes; loading it again returns the same FT_Face, so one manager
+ * serves every window. Font files are mapped where the system allows and
+ * faces are opened from memory, so several faces of one collection share a
+ * mapping and FreeType reads the tables in place. Where mapping fails,
+ * FreeType opens the file itself.
+ *
+ * The fallback chain lists faces by preference, the primary first. Which
+ * face draws a code point is resolved for a whole block of 128 at a time,
+ * which is about the grain of Unicode's script blocks, and remembered: a
+ * block all of whose covered code points go to one face is a single byte,
+ * any other block a byte per code point. Lookups after the first in a block
+ * are then two reads. A code point no face covers, to be drawn as a missing
+ * glyph, goes with the rest of its block so as not to split a run, or to the
+ * primary.
+ *
+ * Not thread safe: the faces are used by the caller's thread only.
+ */
+#include "fonts.h"
+#include <core/heap.h>
+#include <core/strings.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+#define BLOCK_BITS 7
+#define BLOCK_SIZE (1 << BLOCK_BITS)
+#define BLOCKS (0x110000 >> BLOCK_BITS)
+#define UNRESOLVED 0
+#define MIXED 0xFF
+
+/*----------------------------------------------------------------------------*/
+typedef struct _file_t File;
+struct _file_t {
+    File *next;
+    String *path;
+    const byte_t *data;
+    uint32_t size;
+};
+
+typedef struct _face_t Face;
+struct _face_t {
+    Face *next;
+    File *file;
+    uint32_t index;
+    FT_Face face;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _kt_fonts_t {
+    FT_Library library;
+    File *files;
+    Face *faces;
+    FT_Face chain[FONT_FALLBACKS];
+    uint32_t nchain;
+    /* chain index + 1 for the whole block, or MIXED: see `blocks` */
+    uint8_t resolved[BLOCKS];
+    uint8_t *blocks[BLOCKS];
+    uint32_t nresolved;
+};
+
+/*----------------------------------------------------------------------------*/
+#if defined(_WIN32)
+
+static const byte_t *i_map(const char_t *filePath, uint32_t *size) {
+    WCHAR wpath[MAX_PATH];
+    if (MultiByteToWideChar(CP_UTF8, 0, filePath, -1, wpath, MAX_PATH) == 0) {
+        return NULL;
+    }
+
+    HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0 || fsize.QuadPart > 0xFFFFFFFE) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+
+    const byte_t *data = (const byte_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (uint32_t)fsize.QuadPart;
+    return data;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_unmap(const byte_t *data, uint32_t size) {
+    unref(size);
+    UnmapViewOfFile(data);
+}
+
+#else
+
+/*----------------------------------------------------------------------------*/
+static const byte_t *i_map(const char_t *filePath, uint32_t *size) {
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || st.st_size > 0xFFFFFFFE) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    *size = (uint32_t)st.st_size;
+    return (const byte_t*)data;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_unmap(const byte_t *data, uint32_t size) {
+    munmap((void*)data, size);
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Forgets every resolved block, e.g. when the chain changes. */
+static void i_reset(KtFonts *fonts) {
+    for (uint32_t b = 0; b < BLOCKS; ++b) {
+        if (fonts->blocks[b] != NULL) {
+            heap_delete_n(&fonts->blocks[b], BLOCK_SIZE, uint8_t);
+        }
+    }
+    memset(fonts->resolved, UNRESOLVED, sizeof(fonts->resolved));
+    fonts->nresolved = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_resolve(KtFonts *fonts, uint32_t block) {
+    uint8_t picks[BLOCK_SIZE];
+    uint8_t pick = UNRESOLVED;
+    bool_t uniform = TRUE;
+    for (uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+        uint32_t codepoint = (block << BLOCK_BITS) | i;
+        picks[i] = UNRESOLVED;
+        for (uint32_t f = 0; f < fonts->nchain; ++f) {
+            if (FT_Get_Char_Index(fonts->chain[f], codepoint) != 0) {
+                picks[i] = (uint8_t)(f + 1);
+                break;
+            }
+        }
+
+        /* code points nobody has do not split a block */
+        if (picks[i] != UNRESOLVED) {
+            uniform = uniform && (pick == UNRESOLVED || pick == picks[i]);
+            pick = picks[i];
+        }
+    }
+
+    if (uniform) {
+        fonts->resolved[block] = pick != UNRESOLVED ? pick : 1;
+    } else {
+        fonts->blocks[block] = heap_new_n(BLOCK_SIZE, uint8_t);
+        for (uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+            fonts->blocks[block][i] = picks[i] != UNRESOLVED ? picks[i] : 1;
+        }
+        fonts->resolved[block] = MIXED;
+    }
+    fonts->nresolved += 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Decodes one code point; a malformed byte reads as U+FFFD. */
+static uint32_t i_decode(const byte_t *text, uint32_t size, uint32_t *codepoint) {
+    byte_t c = text[0];
+    uint32_t n = c < 0x80 ? 1 : c < 0xC2 ? 0 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF5 ? 4 : 0;
+    if (n == 0 || n > size) {
+        *codepoint = 0xFFFD;
+        return 1;
+    }
+
+    uint32_t cp = n == 1 ? c : c & (0x7F >> n);
+    for (uint32_t i = 1; i < n; ++i) {
+        if ((text[i] & 0xC0) != 0x80) {
+            *codepoint = 0xFFFD;
+            return 1;
+        }
+        cp = (cp << 6) | (text[i] & 0x3F);
+    }
+    *codepoint = cp;
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Spaces, joiners, marks and ASCII punctuation: they stay in the run they
+ * are in when its face has them. */
+static bool_t i_common(uint32_t cp) {
+    if (cp < 0x80) {
+        return !((cp >= '0' && cp <= '9') || (cp >= 'A' && cp <= 'Z') || (cp >= 'a' && cp <= 'z'));
+    }
+    return cp == 0x00A0
+        || (cp >= 0x0300 && cp <= 0x036F)
+        || (cp >= 0x064B && cp <= 0x065F)
+        || cp == 0x0670
+        || (cp >= 0x06D6 && cp <= 0x06ED)
+        || (cp >= 0x200B && cp <= 0x200F);
+}
+
+/*----------------------------------------------------------------------------*/
+KtFonts* ktFontsCreate(void) {
+    KtFonts *fonts = heap_new0(KtFonts);
+    if (FT_Init_FreeType(&fonts->library) != 0) {
+        fonts->library = NULL;
+    }
+    return fonts;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Closes every face loaded through it. */
+void ktFontsDestroy(KtFonts** fonts) {
+    if (fonts == NULL || *fonts == NULL) {
+        return;
+    }
+
+    KtFonts *f = *fonts;
+    i_reset(f);
+    while (f->faces != NULL) {
+        Face *next = f->faces->next;
+        FT_Done_Face(f->faces->face);
+        heap_delete(&f->faces, Face);
+        f->faces = next;
+    }
+    while (f->files != NULL) {
+        File *next = f->files->next;
+        if (f->files->data != NULL) {
+            i_unmap(f->files->data, f->files->size);
+        }
+        str_destroy(&f->files->path);
+        heap_delete(&f->files, File);
+        f->files = next;
+    }
+    if (f->library != NULL) {
+        FT_Done_FreeType(f->library);
+    }
+    heap_delete(fonts, KtFonts);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The face at `faceIndex` of a font file, loaded on first use. NULL if
+ * FreeType cannot open it. */
+FT_Face ktFontsLoad(KtFonts* fonts, const char_t *fontPath, uint32_t faceIndex) {
+    if (fonts == NULL || fonts->library == NULL || fontPath == NULL) {
+        return NULL;
+    }
+
+    File *file = fonts->files;
+    while (file != NULL && str_cmp(file->path, fontPath) != 0) {
+        file = file->next;
+    }
+    for (Face *face = fonts->faces; face != NULL && file != NULL; face = face->next) {
+        if (face->file == file && face->index == faceIndex) {
+            return face->face;
+        }
+    }
+
+    bool_t opened = file == NULL;
+    if (opened) {
+        file = heap_new0(File);
+        file->path = str_c(fontPath);
+        file->data = i_map(fontPath, &file->size);
+    }
+
+    FT_Face ftface = NULL;
+    FT_Error error = file->data != NULL
+        ? FT_New_Memory_Face(fonts->library, file->data, (FT_Long)file->size, (FT_Long)faceIndex, &ftface)
+        : FT_New_Face(fonts->library, fontPath, (FT_Long)faceIndex, &ftface);
+    if (error != 0) {
+        if (opened) {
+            if (file->data != NULL) {
+                i_unmap(file->data, file->size);
+            }
+            str_destroy(&file->path);
+            heap_delete(&file, File);
+        }
+        return NULL;
+    }
+
+    if (opened) {
+        file->next = fonts->files;
+        fonts->files = file;
+    }
+
+    Face *face = heap_new0(Face);
+    face->file = file;
+    face->index = faceIndex;
+    face->face = ftface;
+    face->next = fonts->faces;
+    fonts->faces = face;
+    return ftface;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The file a face was loaded from, e.g. for other threads to open their own
+ * copy; its index is the face's face_index. */
+const char_t* ktFontsPath(const KtFonts* fonts, FT_Face face) {
+    if (fonts == NULL || face == NULL) {
+        return NULL;
+    }
+
+    for (const Face *f = fonts->faces; f != NULL; f = f->next) {
+        if (f->face == face) {
+            return tc(f->file->path);
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Appends a face of this manager to the fallback chain; the first is the
+ * primary. Shaped runs of the old chain are stale after this. */
+bool_t ktFontsFallback(KtFonts* fonts, FT_Face face) {
+    if (fonts == NULL || face == NULL || ktFontsPath(fonts, face) == NULL) {
+        return FALSE;
+    }
+
+    for (uint32_t f = 0; f < fonts->nchain; ++f) {
+        if (fonts->chain[f] == face) {
+            return TRUE;
+        }
+    }
+    if (fonts->nchain == FONT_FALLBACKS) {
+        return FALSE;
+    }
+
+    fonts->chain[fonts->nchain++] = face;
+    i_reset(fonts);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+FT_Face ktFontsPrimary(const KtFonts* fonts) {
+    return fonts != NULL && fonts->nchain > 0 ? fonts->chain[0] : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first face of the chain that has `codepoint`. */
+FT_Face ktFontsFace(KtFonts* fonts, uint32_t codepoint) {
+    if (fonts == NULL || fonts->nchain == 0) {
+        return NULL;
+    }
+    if (codepoint > 0x10FFFF) {
+        return fonts->chain[0];
+    }
+
+    uint32_t block = codepoint >> BLOCK_BITS;
+    if (fonts->resolved[block] == UNRESOLVED) {
+        i_resolve(fonts, block);
+    }
+
+    uint8_t pick = fonts->resolved[block];
+    if (pick == MIXED) {
+        pick = fonts->blocks[block][codepoint & (BLOCK_SIZE - 1)];
+    }
+    return fonts->chain[pick - 1];
+}
+
+/*----------------------------------------------------------------------------*/
+/* Splits UTF-8 text into runs of one face each. Returns the number of runs,
+ * of which at most `capacity` are written; with no `runs`, just counts. */
+uint32_t ktFontsRuns(KtFonts* fonts, const char_t *text, uint32_t size, KtFontRun *runs, uint32_t capacity) {
+    if (fonts == NULL || fonts->nchain == 0 || text == NULL) {
+        return 0;
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t count = 0;
+    FT_Face current = NULL;
+    uint32_t pos = 0;
+    while (pos < size) {
+        uint32_t codepoint = 0;
+        uint32_t n = i_decode(bytes + pos, size - pos, &codepoint);
+
+        FT_Face face = current;
+        if (current == NULL || !i_common(codepoint) || FT_Get_Char_Index(current, codepoint) == 0) {
+            face = ktFontsFace(fonts, codepoint);
+        }
+        if (face != current) {
+            if (runs != NULL && count < capacity) {
+                runs[count].start = pos;
+                runs[count].size = 0;
+                runs[count].face = face;
+            }
+            count += 1;
+            current = face;
+        }
+        if (runs != NULL && count <= capacity) {
+            runs[count - 1].size += n;
+        }
+        pos += n;
+    }
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktFontsStats(const KtFonts* fonts, uint32_t *faces, uint32_t *mapped, uint32_t *blocks) {
+    uint32_t nfaces = 0, nmapped = 0;
+    if (fonts != NULL) {
+        for (const Face *f = fonts->faces; f != NULL; f = f->next) {
+            nfaces += 1;
+        }
+        for (const File *f = fonts->files; f != NULL; f = f->next) {
+            nmapped += f->data != NULL ? 1 : 0;
+        }
+    }
+
+    if (faces != NULL) {
+        *faces = nfaces;
+    }
+    if (mapped != NULL) {
+        *mapped = nmapped;
+    }
+    if (blocks != NULL) {
+        *blocks = fonts != NULL ? fonts->nresolved : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
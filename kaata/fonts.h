@@ -0,0 +1,37 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_FONTS_H__
+#define __KAATA_FONTS_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtFonts* ktFontsCreate(void);
+_kaata_api void ktFontsDestroy(KtFonts** fonts);
+
+_kaata_api FT_Face ktFontsLoad(KtFonts* fonts, const char_t *fontPath, uint32_t faceIndex);
+_kaata_api const char_t* ktFontsPath(const KtFonts* fonts, FT_Face face);
+_kaata_api bool_t ktFontsFallback(KtFonts* fonts, FT_Face face);
+_kaata_api FT_Face ktFontsPrimary(const KtFonts* fonts);
+
+_kaata_api FT_Face ktFontsFace(KtFonts* fonts, uint32_t codepoint);
+_kaata_api uint32_t ktFontsRuns(KtFonts* fonts, const char_t *text, uint32_t size, KtFontRun *runs, uint32_t capacity);
+_kaata_api void ktFontsStats(const KtFonts* fonts, uint32_t *faces, uint32_t *mapped, uint32_t *blocks);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_FONTS_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,768 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Glyph cache over a shared atlas.
+ *
+ * Rasterizing a Nastaliq glyph costs far more than copying its coverage, and
+ * a repaint draws the same glyphs again. Glyphs are kept by font, size, glyph
+ * id and subpixel offset, a quarter pixel by default, with their coverage
+ * packed into atlas pages of GLYPH_ATLAS_SIZE squared bytes. Each page packs
+ * with a skyline: the top edge of what is placed so far, as a list of
+ * segments, and a glyph goes where it ends lowest.
+ *
+ * A skyline cannot give back single glyphs, so eviction is by page: once the
+ * byte limit allows no more pages, the page least recently drawn from is
+ * emptied, with all its glyphs. Pages used since the last frame started are
+ * never evicted, so everything a frame draws stays valid until the next.
+ *
+ * Fonts given with ktGlyphCacheFont are opened again by each worker, since a
+ * FreeType face is not to be shared between threads; ktGlyphCacheRequest
+ * queues a glyph for them. Their rasters are packed on the caller's thread,
+ * at the next frame or when the glyph is asked for. A glyph that is asked
+ * for before its worker is done is rasterized there and then.
+ */
+#include "glyphcache.h"
+#include <core/heap.h>
+#include <core/strings.h>
+#include <osbs/bmutex.h>
+#include <osbs/bthread.h>
+
+/*----------------------------------------------------------------------------*/
+#define FIRST_BUCKETS 1024
+#define NO_PAGE 0xFFFF
+#define PADDING 1
+
+/*----------------------------------------------------------------------------*/
+typedef struct _entry_t Entry;
+struct _entry_t {
+    Entry *chain;
+    Entry *sibling;
+    const void *font;
+    uint32_t ppem;
+    uint32_t id;
+    uint32_t subpixel;
+    bool_t ready;
+    KtGlyph glyph;
+};
+
+/*----------------------------------------------------------------------------*/
+/* A segment of the skyline: [x, x + width) is filled up to y. */
+typedef struct _node_t Node;
+struct _node_t {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+};
+
+typedef struct _page_t Page;
+struct _page_t {
+    byte_t *pixels;
+    Node *skyline;
+    uint32_t nodes;
+    Entry *entries;
+    uint32_t frame;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _raster_t Raster;
+struct _raster_t {
+    int16_t left;
+    int16_t top;
+    uint16_t width;
+    uint16_t height;
+    byte_t *pixels;
+};
+
+typedef struct _job_t Job;
+struct _job_t {
+    Job *next;
+    const void *face;
+    uint32_t font;
+    uint32_t ppem;
+    uint32_t id;
+    uint32_t subpixel;
+    bool_t ok;
+    Raster raster;
+};
+
+typedef struct _font_t Font;
+struct _font_t {
+    const void *face;
+    String *path;
+    uint32_t index;
+};
+
+typedef struct _worker_t Worker;
+struct _worker_t {
+    KtGlyphCache *cache;
+    Thread *thread;
+    bool_t running;
+    FT_Library library;
+    FT_Face faces[GLYPH_FONTS];
+};
+
+/*----------------------------------------------------------------------------*/
+struct _kt_glyph_cache_t {
+    Entry **buckets;
+    uint32_t nbuckets;
+    uint32_t entries;
+    Page *pages;
+    uint32_t npages;
+    uint32_t maxPages;
+    uint32_t frame;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t pending;
+    Font fonts[GLYPH_FONTS];
+    uint32_t nfonts;
+
+    /* shared with the workers */
+    Mutex *mutex;
+    Job *queue;
+    Job *tail;
+    Job *done;
+    uint32_t queued;
+    bool_t stop;
+    Worker *workers;
+    uint32_t nworkers;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_bucket(const KtGlyphCache *cache, const void *font, uint32_t ppem, uint32_t id, uint32_t subpixel) {
+    uint64_t h = (uint64_t)(uintptr_t)font ^ ((uint64_t)ppem << 40) ^ ((uint64_t)subpixel << 56) ^ ((uint64_t)id * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 29;
+    return (uint32_t)h & (cache->nbuckets - 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static Entry *i_find(const KtGlyphCache *cache, const void *font, uint32_t ppem, uint32_t id, uint32_t subpixel) {
+    Entry *entry = cache->buckets[i_bucket(cache, font, ppem, id, subpixel)];
+    while (entry != NULL) {
+        if (entry->id == id && entry->font == font && entry->ppem == ppem && entry->subpixel == subpixel) {
+            return entry;
+        }
+        entry = entry->chain;
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_rehash(KtGlyphCache *cache, uint32_t nbuckets) {
+    Entry **buckets = heap_new_n0(nbuckets, Entry*);
+    uint32_t old = cache->nbuckets;
+    Entry **oldBuckets = cache->buckets;
+    cache->buckets = buckets;
+    cache->nbuckets = nbuckets;
+
+    for (uint32_t i = 0; i < old; ++i) {
+        Entry *entry = oldBuckets[i];
+        while (entry != NULL) {
+            Entry *next = entry->chain;
+            uint32_t b = i_bucket(cache, entry->font, entry->ppem, entry->id, entry->subpixel);
+            entry->chain = buckets[b];
+            buckets[b] = entry;
+            entry = next;
+        }
+    }
+
+    if (oldBuckets != NULL) {
+        heap_delete_n(&oldBuckets, old, Entry*);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* A new entry starts out pending: it has no coverage yet. */
+static Entry *i_insert(KtGlyphCache *cache, const void *font, uint32_t ppem, uint32_t id, uint32_t subpixel) {
+    if (cache->entries >= cache->nbuckets) {
+        i_rehash(cache, cache->nbuckets * 2);
+    }
+
+    Entry *entry = heap_new0(Entry);
+    entry->font = font;
+    entry->ppem = ppem;
+    entry->id = id;
+    entry->subpixel = subpixel;
+    entry->glyph.page = NO_PAGE;
+
+    uint32_t b = i_bucket(cache, font, ppem, id, subpixel);
+    entry->chain = cache->buckets[b];
+    cache->buckets[b] = entry;
+    cache->entries += 1;
+    cache->pending += 1;
+    return entry;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Unlinks from the table only; a page drops its own list. */
+static void i_remove(KtGlyphCache *cache, Entry *entry) {
+    Entry **link = &cache->buckets[i_bucket(cache, entry->font, entry->ppem, entry->id, entry->subpixel)];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+
+    if (!entry->ready) {
+        cache->pending -= 1;
+    }
+    cache->entries -= 1;
+    heap_delete(&entry, Entry);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_page_reset(KtGlyphCache *cache, Page *page) {
+    while (page->entries != NULL) {
+        Entry *entry = page->entries;
+        page->entries = entry->sibling;
+        i_remove(cache, entry);
+    }
+
+    page->skyline[0].x = 0;
+    page->skyline[0].y = 0;
+    page->skyline[0].width = GLYPH_ATLAS_SIZE;
+    page->nodes = 1;
+    page->frame = 0;
+    memset(page->pixels, 0, GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Where a box placed at skyline node `i` would rest, if it fits at all. */
+static bool_t i_fit(const Page *page, uint32_t i, uint32_t width, uint32_t height, uint32_t *y) {
+    uint32_t x = page->skyline[i].x;
+    if (x + width > GLYPH_ATLAS_SIZE) {
+        return FALSE;
+    }
+
+    uint32_t top = 0;
+    uint32_t left = width;
+    while (left > 0) {
+        const Node *node = &page->skyline[i++];
+        top = node->y > top ? node->y : top;
+        if (top + height > GLYPH_ATLAS_SIZE) {
+            return FALSE;
+        }
+        left -= node->width < left ? node->width : left;
+    }
+
+    *y = top;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Bottom left: the lowest resting place, the leftmost of equals. */
+static bool_t i_pack(Page *page, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y) {
+    uint32_t best = UINT32_MAX, bestY = 0, bestBottom = UINT32_MAX;
+    for (uint32_t i = 0; i < page->nodes; ++i) {
+        uint32_t top = 0;
+        if (i_fit(page, i, width, height, &top) && top + height < bestBottom) {
+            best = i;
+            bestY = top;
+            bestBottom = top + height;
+        }
+    }
+    if (best == UINT32_MAX) {
+        return FALSE;
+    }
+
+    /* the box becomes a segment of its own, over those it covers */
+    Node *nodes = page->skyline;
+    memmove(&nodes[best + 1], &nodes[best], (page->nodes - best) * sizeof(Node));
+    page->nodes += 1;
+    nodes[best].y = bestBottom;
+    nodes[best].width = width;
+
+    uint32_t end = nodes[best].x + width;
+    uint32_t i = best + 1;
+    while (i < page->nodes && nodes[i].x < end) {
+        uint32_t cut = end - nodes[i].x;
+        if (cut >= nodes[i].width) {
+            memmove(&nodes[i], &nodes[i + 1], (page->nodes - i - 1) * sizeof(Node));
+            page->nodes -= 1;
+        } else {
+            nodes[i].x += cut;
+            nodes[i].width -= cut;
+            break;
+        }
+    }
+
+    *x = nodes[best].x;
+    *y = bestY;
+
+    /* neighbours at one height are one segment */
+    for (i = 0; i + 1 < page->nodes;) {
+        if (nodes[i].y == nodes[i + 1].y) {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(&nodes[i + 1], &nodes[i + 2], (page->nodes - i - 2) * sizeof(Node));
+            page->nodes -= 1;
+        } else {
+            i += 1;
+        }
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finds room in some page; may empty the page least recently drawn from. */
+static Page *i_place(KtGlyphCache *cache, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y) {
+    for (uint32_t p = 0; p < cache->npages; ++p) {
+        if (i_pack(&cache->pages[p], width, height, x, y)) {
+            return &cache->pages[p];
+        }
+    }
+
+    Page *page = NULL;
+    if (cache->npages < cache->maxPages) {
+        page = &cache->pages[cache->npages++];
+        page->pixels = heap_new_n(GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE, byte_t);
+        page->skyline = heap_new_n(GLYPH_ATLAS_SIZE + 1, Node);
+    } else {
+        page = &cache->pages[0];
+        for (uint32_t p = 1; p < cache->npages; ++p) {
+            if (cache->pages[p].frame < page->frame) {
+                page = &cache->pages[p];
+            }
+        }
+        if (cache->frame != 0 && page->frame == cache->frame) {
+            return NULL;
+        }
+    }
+
+    i_page_reset(cache, page);
+    return i_pack(page, width, height, x, y) ? page : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies a raster into the atlas; the entry is then ready. */
+static bool_t i_store(KtGlyphCache *cache, Entry *entry, const Raster *raster) {
+    KtGlyph *glyph = &entry->glyph;
+    glyph->left = raster->left;
+    glyph->top = raster->top;
+    glyph->width = raster->width;
+    glyph->height = raster->height;
+
+    if (raster->width > 0 && raster->height > 0) {
+        uint32_t x = 0, y = 0;
+        Page *page = i_place(cache, raster->width + PADDING, raster->height + PADDING, &x, &y);
+        if (page == NULL) {
+            return FALSE;
+        }
+
+        for (uint32_t row = 0; row < raster->height; ++row) {
+            memcpy(page->pixels + (y + row) * GLYPH_ATLAS_SIZE + x, raster->pixels + row * raster->width, raster->width);
+        }
+        glyph->pixels = page->pixels + y * GLYPH_ATLAS_SIZE + x;
+        glyph->pitch = GLYPH_ATLAS_SIZE;
+        glyph->page = (uint16_t)(page - cache->pages);
+        glyph->x = (uint16_t)x;
+        glyph->y = (uint16_t)y;
+        entry->sibling = page->entries;
+        page->entries = entry;
+        page->frame = cache->frame;
+    }
+
+    entry->ready = TRUE;
+    cache->pending -= 1;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Renders 8 bit coverage from the outline, moved right by the subpixel
+ * offset. Embedded bitmaps and colour glyphs are not cached. */
+static bool_t i_rasterize(FT_Face face, uint32_t ppem, uint32_t id, uint32_t subpixel, Raster *raster) {
+    FT_Vector delta;
+    delta.x = (FT_Pos)(subpixel * 64 / GLYPH_SUBPIXELS);
+    delta.y = 0;
+
+    bool_t ok = FT_Set_Pixel_Sizes(face, 0, ppem) == 0;
+    FT_Set_Transform(face, NULL, &delta);
+    ok = ok && FT_Load_Glyph(face, id, FT_LOAD_NO_BITMAP | FT_LOAD_RENDER) == 0;
+    FT_Set_Transform(face, NULL, NULL);
+    if (!ok) {
+        return FALSE;
+    }
+
+    const FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap *bitmap = &slot->bitmap;
+    if (bitmap->width > 0 && bitmap->pixel_mode != FT_PIXEL_MODE_GRAY) {
+        return FALSE;
+    }
+    if (bitmap->width + PADDING > GLYPH_ATLAS_SIZE || bitmap->rows + PADDING > GLYPH_ATLAS_SIZE) {
+        return FALSE;
+    }
+
+    raster->left = (int16_t)slot->bitmap_left;
+    raster->top = (int16_t)slot->bitmap_top;
+    raster->width = (uint16_t)bitmap->width;
+    raster->height = (uint16_t)bitmap->rows;
+    raster->pixels = NULL;
+    if (raster->width > 0 && raster->height > 0) {
+        raster->pixels = heap_new_n(raster->width * raster->height, byte_t);
+        for (uint32_t row = 0; row < raster->height; ++row) {
+            memcpy(raster->pixels + row * raster->width, bitmap->buffer + (int32_t)row * bitmap->pitch, raster->width);
+        }
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_raster_free(Raster *raster) {
+    if (raster->pixels != NULL) {
+        heap_delete_n(&raster->pixels, raster->width * raster->height, byte_t);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_job_destroy(Job **job) {
+    if ((*job)->ok) {
+        i_raster_free(&(*job)->raster);
+    }
+    heap_delete(job, Job);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The worker's own face for a font, opened on first use. */
+static FT_Face i_worker_face(Worker *worker, uint32_t font, const char_t *path, uint32_t index) {
+    if (worker->faces[font] != NULL) {
+        return worker->faces[font];
+    }
+    if (worker->library == NULL && FT_Init_FreeType(&worker->library) != 0) {
+        worker->library = NULL;
+        return NULL;
+    }
+    if (FT_New_Face(worker->library, path, (FT_Long)index, &worker->faces[font]) != 0) {
+        worker->faces[font] = NULL;
+    }
+    return worker->faces[font];
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_worker(Worker *worker) {
+    KtGlyphCache *cache = worker->cache;
+    for (;;) {
+        bmutex_lock(cache->mutex);
+        Job *job = cache->stop ? NULL : cache->queue;
+        if (job == NULL) {
+            worker->running = FALSE;
+            bmutex_unlock(cache->mutex);
+            return 0;
+        }
+        cache->queue = job->next;
+        if (cache->queue == NULL) {
+            cache->tail = NULL;
+        }
+        cache->queued -= 1;
+        const Font *font = &cache->fonts[job->font];
+        const char_t *path = tc(font->path);
+        uint32_t index = font->index;
+        bmutex_unlock(cache->mutex);
+
+        FT_Face face = i_worker_face(worker, job->font, path, index);
+        job->ok = face != NULL && i_rasterize(face, job->ppem, job->id, job->subpixel, &job->raster);
+
+        bmutex_lock(cache->mutex);
+        job->next = cache->done;
+        cache->done = job;
+        bmutex_unlock(cache->mutex);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Packs what the workers have finished. */
+static void i_collect(KtGlyphCache *cache) {
+    if (cache->mutex == NULL) {
+        return;
+    }
+
+    bmutex_lock(cache->mutex);
+    Job *job = cache->done;
+    cache->done = NULL;
+    bmutex_unlock(cache->mutex);
+
+    while (job != NULL) {
+        Job *next = job->next;
+        Entry *entry = i_find(cache, job->face, job->ppem, job->id, job->subpixel);
+        /* cleared, or rasterized here meanwhile */
+        if (entry != NULL && !entry->ready) {
+            if (!job->ok || !i_store(cache, entry, &job->raster)) {
+                i_remove(cache, entry);
+            }
+        }
+        i_job_destroy(&job);
+        job = next;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* `limit` is the byte budget of the atlas, a page being GLYPH_ATLAS_SIZE
+ * squared; at least one page is kept. With no `workers`, every glyph is
+ * rasterized when first asked for. */
+KtGlyphCache* ktGlyphCacheCreate(uint32_t limit, uint32_t workers) {
+    KtGlyphCache *cache = heap_new0(KtGlyphCache);
+    uint32_t pageBytes = GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE;
+    cache->maxPages = limit / pageBytes > 0 ? limit / pageBytes : 1;
+    cache->maxPages = cache->maxPages < NO_PAGE ? cache->maxPages : NO_PAGE - 1;
+    cache->pages = heap_new_n0(cache->maxPages, Page);
+    i_rehash(cache, FIRST_BUCKETS);
+
+    if (workers > 0) {
+        cache->mutex = bmutex_create();
+        cache->workers = heap_new_n0(workers, Worker);
+        cache->nworkers = workers;
+        for (uint32_t w = 0; w < workers; ++w) {
+            cache->workers[w].cache = cache;
+        }
+    }
+    return cache;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Waits for the workers; queued glyphs are dropped. */
+void ktGlyphCacheDestroy(KtGlyphCache** cache) {
+    if (cache == NULL || *cache == NULL) {
+        return;
+    }
+
+    KtGlyphCache *c = *cache;
+    if (c->mutex != NULL) {
+        bmutex_lock(c->mutex);
+        c->stop = TRUE;
+        bmutex_unlock(c->mutex);
+        for (uint32_t w = 0; w < c->nworkers; ++w) {
+            Worker *worker = &c->workers[w];
+            if (worker->thread != NULL) {
+                bthread_wait(worker->thread);
+                bthread_close(&worker->thread);
+            }
+            for (uint32_t f = 0; f < GLYPH_FONTS; ++f) {
+                if (worker->faces[f] != NULL) {
+                    FT_Done_Face(worker->faces[f]);
+                }
+            }
+            if (worker->library != NULL) {
+                FT_Done_FreeType(worker->library);
+            }
+        }
+
+        while (c->queue != NULL) {
+            Job *next = c->queue->next;
+            i_job_destroy(&c->queue);
+            c->queue = next;
+        }
+        while (c->done != NULL) {
+            Job *next = c->done->next;
+            i_job_destroy(&c->done);
+            c->done = next;
+        }
+        heap_delete_n(&c->workers, c->nworkers, Worker);
+        bmutex_close(&c->mutex);
+    }
+
+    ktGlyphCacheClear(c);
+    for (uint32_t p = 0; p < c->npages; ++p) {
+        heap_delete_n(&c->pages[p].pixels, GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE, byte_t);
+        heap_delete_n(&c->pages[p].skyline, GLYPH_ATLAS_SIZE + 1, Node);
+    }
+    heap_delete_n(&c->pages, c->maxPages, Page);
+    for (uint32_t f = 0; f < c->nfonts; ++f) {
+        str_destroy(&c->fonts[f].path);
+    }
+    heap_delete_n(&c->buckets, c->nbuckets, Entry*);
+    heap_delete(cache, KtGlyphCache);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Lets the workers rasterize the glyphs of `face`, from their own copy of
+ * the font at `fontPath`. Up to GLYPH_FONTS fonts. */
+bool_t ktGlyphCacheFont(KtGlyphCache* cache, FT_Face face, const char_t *fontPath, uint32_t faceIndex) {
+    if (cache == NULL || face == NULL || fontPath == NULL) {
+        return FALSE;
+    }
+
+    for (uint32_t f = 0; f < cache->nfonts; ++f) {
+        if (cache->fonts[f].face == face) {
+            return TRUE;
+        }
+    }
+    if (cache->nfonts == GLYPH_FONTS || cache->mutex == NULL) {
+        return FALSE;
+    }
+
+    bmutex_lock(cache->mutex);
+    Font *font = &cache->fonts[cache->nfonts++];
+    font->face = face;
+    font->path = str_c(fontPath);
+    font->index = faceIndex;
+    bmutex_unlock(cache->mutex);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Drops every glyph, in use or not, e.g. after a font is unloaded. The pages
+ * stay allocated. */
+void ktGlyphCacheClear(KtGlyphCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (uint32_t p = 0; p < cache->npages; ++p) {
+        i_page_reset(cache, &cache->pages[p]);
+    }
+    for (uint32_t b = 0; b < cache->nbuckets; ++b) {
+        while (cache->buckets[b] != NULL) {
+            i_remove(cache, cache->buckets[b]);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts a frame: packs the glyphs the workers are done with, and pages from
+ * earlier frames may be evicted again. */
+void ktGlyphCacheFrame(KtGlyphCache* cache) {
+    if (cache != NULL) {
+        cache->frame += 1;
+        i_collect(cache);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The glyph at `subpixel` of GLYPH_SUBPIXELS right of the pixel, rasterized
+ * now if it is not cached yet. NULL if FreeType cannot render it or no page
+ * can take it this frame; the caller then draws it itself. */
+const KtGlyph* ktGlyphCacheGet(KtGlyphCache* cache, FT_Face face, uint32_t ppem, uint32_t glyph, uint32_t subpixel) {
+    if (cache == NULL || face == NULL) {
+        return NULL;
+    }
+
+    subpixel %= GLYPH_SUBPIXELS;
+    Entry *entry = i_find(cache, face, ppem, glyph, subpixel);
+    if (entry != NULL && !entry->ready) {
+        i_collect(cache);
+        entry = i_find(cache, face, ppem, glyph, subpixel);
+    }
+
+    if (entry != NULL && entry->ready) {
+        cache->hits += 1;
+        if (entry->glyph.page != NO_PAGE) {
+            cache->pages[entry->glyph.page].frame = cache->frame;
+        }
+        return &entry->glyph;
+    }
+
+    cache->misses += 1;
+    Raster raster;
+    if (!i_rasterize(face, ppem, glyph, subpixel, &raster)) {
+        return NULL;
+    }
+
+    if (entry == NULL) {
+        entry = i_insert(cache, face, ppem, glyph, subpixel);
+    }
+    bool_t stored = i_store(cache, entry, &raster);
+    i_raster_free(&raster);
+    if (!stored) {
+        i_remove(cache, entry);
+        return NULL;
+    }
+    return &entry->glyph;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Queues a glyph for the workers, e.g. for text about to scroll into view.
+ * Does nothing for a glyph already cached or queued, or a font the workers
+ * were not given. */
+void ktGlyphCacheRequest(KtGlyphCache* cache, FT_Face face, uint32_t ppem, uint32_t glyph, uint32_t subpixel) {
+    if (cache == NULL || face == NULL || cache->nworkers == 0) {
+        return;
+    }
+
+    subpixel %= GLYPH_SUBPIXELS;
+    if (i_find(cache, face, ppem, glyph, subpixel) != NULL) {
+        return;
+    }
+
+    uint32_t font = 0;
+    while (font < cache->nfonts && cache->fonts[font].face != face) {
+        font += 1;
+    }
+    if (font == cache->nfonts) {
+        return;
+    }
+
+    i_insert(cache, face, ppem, glyph, subpixel);
+    Job *job = heap_new0(Job);
+    job->face = face;
+    job->font = font;
+    job->ppem = ppem;
+    job->id = glyph;
+    job->subpixel = subpixel;
+
+    Worker *start = NULL;
+    bmutex_lock(cache->mutex);
+    if (cache->tail != NULL) {
+        cache->tail->next = job;
+    } else {
+        cache->queue = job;
+    }
+    cache->tail = job;
+    cache->queued += 1;
+
+    uint32_t running = 0;
+    for (uint32_t w = 0; w < cache->nworkers; ++w) {
+        if (cache->workers[w].running) {
+            running += 1;
+        } else if (start == NULL) {
+            start = &cache->workers[w];
+        }
+    }
+    if (start != NULL && cache->queued > running) {
+        start->running = TRUE;
+    } else {
+        start = NULL;
+    }
+    bmutex_unlock(cache->mutex);
+
+    if (start != NULL) {
+        /* the worker that had this slot has drained the queue and is exiting */
+        if (start->thread != NULL) {
+            bthread_wait(start->thread);
+            bthread_close(&start->thread);
+        }
+        start->thread = bthread_create(i_worker, start, Worker);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Coverage of one atlas page, GLYPH_ATLAS_SIZE bytes a row, e.g. to upload
+ * as a texture. */
+const byte_t* ktGlyphCachePage(const KtGlyphCache* cache, uint32_t page) {
+    return cache != NULL && page < cache->npages ? cache->pages[page].pixels : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktGlyphCacheStats(const KtGlyphCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *glyphs, uint32_t *pages, uint32_t *pending) {
+    if (hits != NULL) {
+        *hits = cache != NULL ? cache->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = cache != NULL ? cache->misses : 0;
+    }
+    if (glyphs != NULL) {
+        *glyphs = cache != NULL ? cache->entries - cache->pending : 0;
+    }
+    if (pages != NULL) {
+        *pages = cache != NULL ? cache->npages : 0;
+    }
+    if (pending != NULL) {
+        *pending = cache != NULL ? cache->pending : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
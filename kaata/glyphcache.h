@@ -0,0 +1,36 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_GLYPHCACHE_H__
+#define __KAATA_GLYPHCACHE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtGlyphCache* ktGlyphCacheCreate(uint32_t limit, uint32_t workers);
+_kaata_api void ktGlyphCacheDestroy(KtGlyphCache** cache);
+_kaata_api bool_t ktGlyphCacheFont(KtGlyphCache* cache, FT_Face face, const char_t *fontPath, uint32_t faceIndex);
+_kaata_api void ktGlyphCacheClear(KtGlyphCache* cache);
+_kaata_api void ktGlyphCacheFrame(KtGlyphCache* cache);
+
+_kaata_api const KtGlyph* ktGlyphCacheGet(KtGlyphCache* cache, FT_Face face, uint32_t ppem, uint32_t glyph, uint32_t subpixel);
+_kaata_api void ktGlyphCacheRequest(KtGlyphCache* cache, FT_Face face, uint32_t ppem, uint32_t glyph, uint32_t subpixel);
+_kaata_api const byte_t* ktGlyphCachePage(const KtGlyphCache* cache, uint32_t page);
+_kaata_api void ktGlyphCacheStats(const KtGlyphCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *glyphs, uint32_t *pages, uint32_t *pending);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_GLYPHCACHE_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,142 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_HXX__
+#define __KAATA_HXX__
+
+#include "kaata.def"
+#include <core/core.hxx>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/*----------------------------------------------------------------------------*/
+typedef struct _kt_shape_cache_t KtShapeCache;
+typedef struct _kt_shaper_t KtShaper;
+typedef struct _kt_viewport_t KtViewport;
+typedef struct _kt_bidi_t KtBidi;
+typedef struct _kt_glyph_cache_t KtGlyphCache;
+typedef struct _kt_fonts_t KtFonts;
+typedef struct _kt_line_cache_t KtLineCache;
+typedef struct _kt_caret_cache_t KtCaretCache;
+
+/*----------------------------------------------------------------------------*/
+typedef enum _kt_direction_t KtDirection;
+enum _kt_direction_t {
+    KDirAuto = 0,
+    KDirRtl,
+    KDirLtr,
+};
+
+/*----------------------------------------------------------------------------*/
+/* Shaped glyphs of one paragraph, one array per attribute. Positions are in
+ * 26.6 fixed point; clusters are byte offsets into the paragraph text; each
+ * glyph is from its own face, which with font fallback may differ. */
+typedef struct _kt_glyph_run_t KtGlyphRun;
+struct _kt_glyph_run_t {
+    uint32_t count;
+    int32_t width;
+    FT_Face *faces;
+    uint32_t *glyphs;
+    uint32_t *clusters;
+    int32_t *advances;
+    int32_t *xOffsets;
+    int32_t *yOffsets;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Characters [start, start + length) at one embedding level. */
+typedef struct _kt_bidi_run_t KtBidiRun;
+struct _kt_bidi_run_t {
+    uint32_t start;
+    uint32_t length;
+    uint8_t level;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Resolved bidi of one paragraph, indexed by character. `offsets` holds the
+ * byte offset of each character and one past the last; runs are listed in
+ * visual order. */
+typedef struct _kt_bidi_para_t KtBidiPara;
+struct _kt_bidi_para_t {
+    uint32_t length;
+    uint32_t runCount;
+    bool_t rtl;
+    uint32_t *offsets;
+    uint32_t *toVisual;
+    uint32_t *toLogical;
+    KtBidiRun *runs;
+    uint8_t *levels;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Bytes [start, start + size) of a text, drawn from one face. */
+typedef struct _kt_font_run_t KtFontRun;
+struct _kt_font_run_t {
+    uint32_t start;
+    uint32_t size;
+    FT_Face face;
+};
+
+/*----------------------------------------------------------------------------*/
+/* A rasterized glyph in the atlas. `pixels` is its top left coverage byte,
+ * rows `pitch` bytes apart; `left` and `top` place it from the pen on the
+ * baseline, as FreeType's bitmap_left and bitmap_top. */
+typedef struct _kt_glyph_t KtGlyph;
+struct _kt_glyph_t {
+    const byte_t *pixels;
+    uint32_t pitch;
+    uint16_t width;
+    uint16_t height;
+    int16_t left;
+    int16_t top;
+    uint16_t page;
+    uint16_t x;
+    uint16_t y;
+};
+
+/*----------------------------------------------------------------------------*/
+/* A cluster of glyphs on a line, standing for the characters [start, end):
+ * drawn from `left` to `right`, in 26.6 from the left end of the line, and
+ * read from `right` to `left` if `rtl`. */
+typedef struct _kt_caret_stop_t KtCaretStop;
+struct _kt_caret_stop_t {
+    uint32_t start;
+    uint32_t end;
+    int32_t left;
+    int32_t right;
+    bool_t rtl;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Caret geometry of one wrapped paragraph. Line `l` begins at byte
+ * `starts[l]`, is `widths[l]` wide and has the stops from `first[l]` up to
+ * `first[l + 1]`, in visual order; `logical` lists the same stops by their
+ * start. `rtl` is the direction of the paragraph. */
+typedef struct _kt_caret_map_t KtCaretMap;
+struct _kt_caret_map_t {
+    uint32_t lines;
+    uint32_t size;
+    bool_t rtl;
+    uint32_t *starts;
+    int32_t *widths;
+    uint32_t *first;
+    KtCaretStop *stops;
+    uint32_t *logical;
+};
+
+#define SHAPE_CACHE_SIZE 16777216
+#define GLYPH_CACHE_SIZE 16777216
+#define GLYPH_ATLAS_SIZE 1024
+#define GLYPH_SUBPIXELS 4
+#define GLYPH_FONTS 8
+#define FONT_FALLBACKS 8
+
+/*----------------------------------------------------------------------------*/
+#endif /* __KAATA_HXX__ */
+/*----------------------------------------------------------------------------*/
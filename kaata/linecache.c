@@ -0,0 +1,277 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Line breaks, per paragraph and width.
+ *
+ * Optimal breaking looks at a paragraph as a whole, so it is worth keeping
+ * its result: a paragraph's breaks depend only on its text and the width
+ * of the column. Each paragraph keeps those of the last two widths it was
+ * wrapped to, so dragging a window edge back and forth, or toggling between
+ * two window sizes, wraps nothing again. Entries carry the hash of the text
+ * they were made from; one that no longer matches is simply a miss.
+ *
+ * Paragraphs are indexed like the bidi cache, and an edit splices or
+ * invalidates them the same way. Each entry is a single allocation, the
+ * header followed by the line starts.
+ */
+#include "linecache.h"
+#include "shapecache.h"
+#include "wrap.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define LINE_WIDTHS 2
+
+/*----------------------------------------------------------------------------*/
+typedef struct _lines_t Lines;
+struct _lines_t {
+    uint64_t hash;
+    uint32_t size;
+    int32_t width;
+    uint32_t count;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _slot_t Slot;
+struct _slot_t {
+    Lines *widths[LINE_WIDTHS];
+};
+
+/*----------------------------------------------------------------------------*/
+struct _kt_line_cache_t {
+    Slot *slots;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t bytes;
+    uint32_t *scratch;
+    uint32_t scratchSize;
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_lines_size(uint32_t count) {
+    return (uint32_t)sizeof(Lines) + count * (uint32_t)sizeof(uint32_t);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t *i_starts(Lines *lines) {
+    return (uint32_t*)(lines + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_lines_free(KtLineCache *cache, Lines **lines) {
+    if (*lines != NULL) {
+        uint32_t bytes = i_lines_size((*lines)->count);
+        cache->bytes -= bytes;
+        heap_free((byte_t**)lines, bytes, "KtLines");
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_slot_free(KtLineCache *cache, Slot *slot) {
+    for (uint32_t i = 0; i < LINE_WIDTHS; ++i) {
+        i_lines_free(cache, &slot->widths[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(KtLineCache *cache, uint32_t count) {
+    if (count <= cache->capacity) {
+        return;
+    }
+
+    uint32_t capacity = cache->capacity > 0 ? cache->capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    Slot *slots = heap_new_n0(capacity, Slot);
+    if (cache->count > 0) {
+        memcpy(slots, cache->slots, cache->count * sizeof(Slot));
+    }
+    if (cache->capacity > 0) {
+        heap_delete_n(&cache->slots, cache->capacity, Slot);
+    }
+    cache->slots = slots;
+    cache->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The slot's entry for `width`, moved to the front; NULL if it has none or
+ * the text has changed since. */
+static Lines *i_find(KtLineCache *cache, uint32_t paragraph, uint64_t hash, uint32_t size, int32_t width) {
+    Slot *slot = &cache->slots[paragraph];
+    for (uint32_t i = 0; i < LINE_WIDTHS; ++i) {
+        Lines *lines = slot->widths[i];
+        if (lines != NULL && lines->width == width && lines->size == size && lines->hash == hash) {
+            for (; i > 0; --i) {
+                slot->widths[i] = slot->widths[i - 1];
+            }
+            slot->widths[0] = lines;
+            cache->hits += 1;
+            return lines;
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+KtLineCache* ktLineCacheCreate(void) {
+    return heap_new0(KtLineCache);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktLineCacheDestroy(KtLineCache** cache) {
+    if (cache == NULL || *cache == NULL) {
+        return;
+    }
+
+    KtLineCache *c = *cache;
+    ktLineCacheSplice(c, 0, c->count, 0);
+    if (c->capacity > 0) {
+        heap_delete_n(&c->slots, c->capacity, Slot);
+    }
+    if (c->scratchSize > 0) {
+        heap_delete_n(&c->scratch, c->scratchSize, uint32_t);
+    }
+    heap_delete(cache, KtLineCache);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktLineCacheReset(KtLineCache* cache, uint32_t count) {
+    if (cache == NULL) {
+        return;
+    }
+
+    ktLineCacheSplice(cache, 0, cache->count, count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces `removed` paragraphs from `first` on with `inserted` empty ones,
+ * after an edit joined or split paragraphs. */
+void ktLineCacheSplice(KtLineCache* cache, uint32_t first, uint32_t removed, uint32_t inserted) {
+    if (cache == NULL || first > cache->count) {
+        return;
+    }
+    if (removed > cache->count - first) {
+        removed = cache->count - first;
+    }
+
+    for (uint32_t i = first; i < first + removed; ++i) {
+        i_slot_free(cache, &cache->slots[i]);
+    }
+
+    uint32_t count = cache->count - removed + inserted;
+    uint32_t tail = cache->count - first - removed;
+    i_reserve(cache, count);
+    if (tail > 0 && removed != inserted) {
+        memmove(cache->slots + first + inserted, cache->slots + first + removed, tail * sizeof(Slot));
+    }
+    if (inserted > 0) {
+        memset(cache->slots + first, 0, inserted * sizeof(Slot));
+    }
+    cache->count = count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs whose text changed. */
+void ktLineCacheInvalidate(KtLineCache* cache, uint32_t first, uint32_t count) {
+    if (cache == NULL || first >= cache->count) {
+        return;
+    }
+    if (count > cache->count - first) {
+        count = cache->count - first;
+    }
+
+    for (uint32_t i = first; i < first + count; ++i) {
+        i_slot_free(cache, &cache->slots[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The line starts of a paragraph wrapped to `width` before, without
+ * shaping it; NULL if it has to be wrapped. Only hits are counted, misses
+ * are the paragraphs actually wrapped. */
+const uint32_t* ktLineCacheGet(KtLineCache* cache, uint32_t paragraph, const char_t *text, uint32_t size, int32_t width, uint32_t *lines) {
+    if (cache == NULL || paragraph >= cache->count || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    Lines *found = i_find(cache, paragraph, ktHash(text, size), size, width);
+    if (found == NULL) {
+        return NULL;
+    }
+    if (lines != NULL) {
+        *lines = found->count;
+    }
+    return i_starts(found);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The line starts of the shaped paragraph at `width`, wrapped optimally
+ * unless they are cached. They stay valid until the paragraph is wrapped
+ * to two other widths, or changes. */
+const uint32_t* ktLineCacheWrap(KtLineCache* cache, uint32_t paragraph, const KtGlyphRun* run, const char_t *text, uint32_t size, int32_t width, uint32_t *lines) {
+    if (cache == NULL || paragraph >= cache->count || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    uint64_t hash = ktHash(text, size);
+    Lines *found = i_find(cache, paragraph, hash, size, width);
+    if (found == NULL) {
+        /* a paragraph has at most a line per byte */
+        if (cache->scratchSize < size + 1) {
+            if (cache->scratchSize > 0) {
+                heap_delete_n(&cache->scratch, cache->scratchSize, uint32_t);
+            }
+            cache->scratchSize = size + 1 > 256 ? size + 1 : 256;
+            cache->scratch = heap_new_n(cache->scratchSize, uint32_t);
+        }
+
+        uint32_t count = ktWrapOptimal(run, text, size, width, cache->scratch, cache->scratchSize);
+        uint32_t bytes = i_lines_size(count);
+        found = (Lines*)heap_malloc(bytes, "KtLines");
+        found->hash = hash;
+        found->size = size;
+        found->width = width;
+        found->count = count;
+        memcpy(i_starts(found), cache->scratch, count * sizeof(uint32_t));
+        cache->bytes += bytes;
+        cache->misses += 1;
+
+        Slot *slot = &cache->slots[paragraph];
+        i_lines_free(cache, &slot->widths[LINE_WIDTHS - 1]);
+        for (uint32_t i = LINE_WIDTHS - 1; i > 0; --i) {
+            slot->widths[i] = slot->widths[i - 1];
+        }
+        slot->widths[0] = found;
+    }
+
+    if (lines != NULL) {
+        *lines = found->count;
+    }
+    return i_starts(found);
+}
+
+/*----------------------------------------------------------------------------*/
+void ktLineCacheStats(const KtLineCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *bytes) {
+    if (hits != NULL) {
+        *hits = cache != NULL ? cache->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = cache != NULL ? cache->misses : 0;
+    }
+    if (bytes != NULL) {
+        *bytes = cache != NULL ? cache->bytes : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
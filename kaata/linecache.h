@@ -0,0 +1,35 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_LINECACHE_H__
+#define __KAATA_LINECACHE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtLineCache* ktLineCacheCreate(void);
+_kaata_api void ktLineCacheDestroy(KtLineCache** cache);
+_kaata_api void ktLineCacheReset(KtLineCache* cache, uint32_t count);
+_kaata_api void ktLineCacheSplice(KtLineCache* cache, uint32_t first, uint32_t removed, uint32_t inserted);
+_kaata_api void ktLineCacheInvalidate(KtLineCache* cache, uint32_t first, uint32_t count);
+
+_kaata_api const uint32_t* ktLineCacheGet(KtLineCache* cache, uint32_t paragraph, const char_t *text, uint32_t size, int32_t width, uint32_t *lines);
+_kaata_api const uint32_t* ktLineCacheWrap(KtLineCache* cache, uint32_t paragraph, const KtGlyphRun* run, const char_t *text, uint32_t size, int32_t width, uint32_t *lines);
+_kaata_api void ktLineCacheStats(const KtLineCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *bytes);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_LINECACHE_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,306 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Shaped run cache.
+ *
+ * Shaping is the costly step of drawing a paragraph, and its output depends
+ * only on the text, the font, the size and the direction; moving the view or
+ * re-wrapping lines does not change it. Runs are kept in a hash table keyed
+ * by those four, with a copy of the text to rule out hash collisions, and in
+ * a most recently used list that is evicted from the old end once the cache
+ * outgrows its byte limit.
+ *
+ * Each entry is a single allocation: the header, then the glyph attributes
+ * as parallel arrays, faces first, then the text. Runs used since the last
+ * frame started are never evicted, so everything a frame draws stays valid
+ * until the next.
+ */
+#include "shapecache.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define FIRST_BUCKETS 256
+
+/*----------------------------------------------------------------------------*/
+typedef struct _entry_t Entry;
+struct _entry_t {
+    Entry *chain;
+    Entry *newer;
+    Entry *older;
+    uint64_t hash;
+    const void *font;
+    uint32_t ppem;
+    KtDirection direction;
+    uint32_t frame;
+    uint32_t size;
+    uint32_t bytes;
+    KtGlyphRun run;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _kt_shape_cache_t {
+    Entry **buckets;
+    uint32_t nbuckets;
+    uint32_t entries;
+    Entry *newest;
+    Entry *oldest;
+    uint32_t bytes;
+    uint32_t limit;
+    uint32_t frame;
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_entry_size(uint32_t count, uint32_t size) {
+    return (uint32_t)sizeof(Entry) + count * (uint32_t)sizeof(FT_Face) + count * 5 * (uint32_t)sizeof(uint32_t) + size;
+}
+
+/*----------------------------------------------------------------------------*/
+static char_t *i_text(Entry *entry) {
+    return (char_t*)(entry->run.glyphs + entry->run.count * 5);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_bucket(const KtShapeCache *cache, uint64_t hash, const void *font, uint32_t ppem, KtDirection direction) {
+    uint64_t h = hash ^ (uint64_t)(uintptr_t)font ^ ((uint64_t)ppem << 40) ^ ((uint64_t)direction << 56);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 29;
+    return (uint32_t)h & (cache->nbuckets - 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_unlink(KtShapeCache *cache, Entry *entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_push(KtShapeCache *cache, Entry *entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest != NULL) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_evict(KtShapeCache *cache, Entry *entry) {
+    uint32_t b = i_bucket(cache, entry->hash, entry->font, entry->ppem, entry->direction);
+    Entry **link = &cache->buckets[b];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+
+    i_unlink(cache, entry);
+    cache->entries -= 1;
+    cache->bytes -= entry->bytes;
+    heap_free((byte_t**)&entry, entry->bytes, "KtShapeEntry");
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_rehash(KtShapeCache *cache, uint32_t nbuckets) {
+    Entry **buckets = heap_new_n0(nbuckets, Entry*);
+    uint32_t old = cache->nbuckets;
+    Entry **oldBuckets = cache->buckets;
+    cache->buckets = buckets;
+    cache->nbuckets = nbuckets;
+
+    for (uint32_t i = 0; i < old; ++i) {
+        Entry *entry = oldBuckets[i];
+        while (entry != NULL) {
+            Entry *next = entry->chain;
+            uint32_t b = i_bucket(cache, entry->hash, entry->font, entry->ppem, entry->direction);
+            entry->chain = buckets[b];
+            buckets[b] = entry;
+            entry = next;
+        }
+    }
+
+    if (oldBuckets != NULL) {
+        heap_delete_n(&oldBuckets, old, Entry*);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Reads the text a word at a time; only ever compared within one process. */
+uint64_t ktHash(const char_t *text, uint32_t size) {
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t h = K ^ size;
+    uint64_t w;
+    while (size >= 8) {
+        memcpy(&w, text, 8);
+        h = (h ^ w) * K;
+        h ^= h >> 32;
+        text += 8;
+        size -= 8;
+    }
+    if (size > 0) {
+        w = 0;
+        memcpy(&w, text, size);
+        h = (h ^ w) * K;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 32);
+}
+
+/*----------------------------------------------------------------------------*/
+KtShapeCache* ktShapeCacheCreate(uint32_t limit) {
+    KtShapeCache *cache = heap_new0(KtShapeCache);
+    cache->limit = limit;
+    i_rehash(cache, FIRST_BUCKETS);
+    return cache;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktShapeCacheDestroy(KtShapeCache** cache) {
+    if (cache == NULL || *cache == NULL) {
+        return;
+    }
+
+    ktShapeCacheClear(*cache);
+    heap_delete_n(&(*cache)->buckets, (*cache)->nbuckets, Entry*);
+    heap_delete(cache, KtShapeCache);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Drops every run, in use or not, e.g. after a font is unloaded. */
+void ktShapeCacheClear(KtShapeCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    while (cache->oldest != NULL) {
+        i_evict(cache, cache->oldest);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts a frame: runs from earlier frames may be evicted again. */
+void ktShapeCacheFrame(KtShapeCache* cache) {
+    if (cache != NULL) {
+        cache->frame += 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+const KtGlyphRun* ktShapeCacheGet(KtShapeCache* cache, const char_t *text, uint32_t size, const void *font, uint32_t ppem, KtDirection direction) {
+    if (cache == NULL || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    uint64_t hash = ktHash(text, size);
+    Entry *entry = cache->buckets[i_bucket(cache, hash, font, ppem, direction)];
+    while (entry != NULL) {
+        if (entry->hash == hash && entry->font == font && entry->ppem == ppem
+            && entry->direction == direction && entry->size == size
+            && memcmp(i_text(entry), text, size) == 0) {
+            break;
+        }
+        entry = entry->chain;
+    }
+
+    if (entry == NULL) {
+        cache->misses += 1;
+        return NULL;
+    }
+
+    cache->hits += 1;
+    entry->frame = cache->frame;
+    if (entry != cache->newest) {
+        i_unlink(cache, entry);
+        i_push(cache, entry);
+    }
+    return &entry->run;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Makes room for a run of `count` glyphs, which the caller then fills in.
+ * The key must not be in the cache already. */
+KtGlyphRun* ktShapeCacheAdd(KtShapeCache* cache, const char_t *text, uint32_t size, const void *font, uint32_t ppem, KtDirection direction, uint32_t count) {
+    if (cache == NULL || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    uint32_t bytes = i_entry_size(count, size);
+    while (cache->oldest != NULL && cache->bytes + bytes > cache->limit) {
+        Entry *oldest = cache->oldest;
+        if (cache->frame != 0 && oldest->frame == cache->frame) {
+            break;
+        }
+        i_evict(cache, oldest);
+    }
+
+    if (cache->entries >= cache->nbuckets) {
+        i_rehash(cache, cache->nbuckets * 2);
+    }
+
+    Entry *entry = (Entry*)heap_malloc(bytes, "KtShapeEntry");
+    entry->hash = ktHash(text, size);
+    entry->font = font;
+    entry->ppem = ppem;
+    entry->direction = direction;
+    entry->frame = cache->frame;
+    entry->size = size;
+    entry->bytes = bytes;
+
+    KtGlyphRun *run = &entry->run;
+    run->count = count;
+    run->width = 0;
+    run->faces = (FT_Face*)(entry + 1);
+    run->glyphs = (uint32_t*)(run->faces + count);
+    run->clusters = run->glyphs + count;
+    run->advances = (int32_t*)(run->clusters + count);
+    run->xOffsets = run->advances + count;
+    run->yOffsets = run->xOffsets + count;
+    if (size > 0) {
+        memcpy(i_text(entry), text, size);
+    }
+
+    uint32_t b = i_bucket(cache, entry->hash, font, ppem, direction);
+    entry->chain = cache->buckets[b];
+    cache->buckets[b] = entry;
+    i_push(cache, entry);
+    cache->entries += 1;
+    cache->bytes += bytes;
+    return run;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktShapeCacheStats(const KtShapeCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *entries, uint32_t *bytes) {
+    if (hits != NULL) {
+        *hits = cache != NULL ? cache->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = cache != NULL ? cache->misses : 0;
+    }
+    if (entries != NULL) {
+        *entries = cache != NULL ? cache->entries : 0;
+    }
+    if (bytes != NULL) {
+        *bytes = cache != NULL ? cache->bytes : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
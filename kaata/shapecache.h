@@ -0,0 +1,36 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_SHAPECACHE_H__
+#define __KAATA_SHAPECACHE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtShapeCache* ktShapeCacheCreate(uint32_t limit);
+_kaata_api void ktShapeCacheDestroy(KtShapeCache** cache);
+_kaata_api void ktShapeCacheClear(KtShapeCache* cache);
+_kaata_api void ktShapeCacheFrame(KtShapeCache* cache);
+
+_kaata_api const KtGlyphRun* ktShapeCacheGet(KtShapeCache* cache, const char_t *text, uint32_t size, const void *font, uint32_t ppem, KtDirection direction);
+_kaata_api KtGlyphRun* ktShapeCacheAdd(KtShapeCache* cache, const char_t *text, uint32_t size, const void *font, uint32_t ppem, KtDirection direction, uint32_t count);
+_kaata_api void ktShapeCacheStats(const KtShapeCache* cache, uint32_t *hits, uint32_t *misses, uint32_t *entries, uint32_t *bytes);
+
+_kaata_api uint64_t ktHash(const char_t *text, uint32_t size);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_SHAPECACHE_H__ */
+/*----------------------------------------------------------------------------*/
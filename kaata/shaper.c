@@ -0,0 +1,161 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Paragraph shaping through raqm, behind the shaped run cache. Only a miss
+ * reaches raqm, and one raqm object is reused for every miss. With a font
+ * manager, each run of one face is given to raqm as a face range, and the
+ * cache keys on the manager: its chain stands for the font.
+ */
+#include "shaper.h"
+#include "shapecache.h"
+#include "fonts.h"
+#include <core/heap.h>
+#include <osbs/log.h>
+
+#include <raqm.h>
+
+/*----------------------------------------------------------------------------*/
+struct _kt_shaper_t {
+    KtShapeCache *cache;
+    raqm_t *rq;
+    KtFontRun *runs;
+    uint32_t cruns;
+};
+
+/*----------------------------------------------------------------------------*/
+static raqm_direction_t i_direction(KtDirection direction) {
+    switch (direction) {
+    case KDirRtl:
+        return RAQM_DIRECTION_RTL;
+    case KDirLtr:
+        return RAQM_DIRECTION_LTR;
+    default:
+        return RAQM_DIRECTION_DEFAULT;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+KtShaper* ktShaperCreate(uint32_t cacheLimit) {
+    KtShaper *shaper = heap_new0(KtShaper);
+    shaper->cache = ktShapeCacheCreate(cacheLimit);
+    return shaper;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktShaperDestroy(KtShaper** shaper) {
+    if (shaper == NULL || *shaper == NULL) {
+        return;
+    }
+
+    if ((*shaper)->rq != NULL) {
+        raqm_destroy((*shaper)->rq);
+    }
+    if ((*shaper)->runs != NULL) {
+        heap_delete_n(&(*shaper)->runs, (*shaper)->cruns, KtFontRun);
+    }
+    ktShapeCacheDestroy(&(*shaper)->cache);
+    heap_delete(shaper, KtShaper);
+}
+
+/*----------------------------------------------------------------------------*/
+KtShapeCache* ktShaperCache(KtShaper* shaper) {
+    return shaper != NULL ? shaper->cache : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Shapes a miss and adds it to the cache under `font`; `runs` give the
+ * bytes drawn from a face other than `face`. */
+static const KtGlyphRun* i_shape(KtShaper* shaper, const void *font, FT_Face face, const KtFontRun *runs, uint32_t nruns, uint32_t ppem, KtDirection direction, const char_t *text, uint32_t size) {
+    if (shaper->rq == NULL) {
+        shaper->rq = raqm_create();
+    } else {
+        raqm_clear_contents(shaper->rq);
+    }
+
+    raqm_t *rq = shaper->rq;
+    size_t count = 0;
+    raqm_glyph_t *glyphs = NULL;
+    bool_t ok = rq != NULL && FT_Set_Pixel_Sizes(face, 0, ppem) == 0;
+    ok = ok && raqm_set_text_utf8(rq, text, size);
+    ok = ok && raqm_set_freetype_face(rq, face);
+    for (uint32_t r = 0; ok && r < nruns; ++r) {
+        if (runs[r].face != face) {
+            ok = FT_Set_Pixel_Sizes(runs[r].face, 0, ppem) == 0;
+            ok = ok && raqm_set_freetype_face_range(rq, runs[r].face, runs[r].start, runs[r].size);
+        }
+    }
+    ok = ok && raqm_set_par_direction(rq, i_direction(direction));
+    ok = ok && raqm_set_language(rq, "ur", 0, size);
+    ok = ok && raqm_layout(rq);
+    if (ok) {
+        glyphs = raqm_get_glyphs(rq, &count);
+    }
+    if (glyphs == NULL && size > 0) {
+        log_printf("ktShape: Failed to shape %u bytes", size);
+        return NULL;
+    }
+
+    KtGlyphRun *run = ktShapeCacheAdd(shaper->cache, text, size, font, ppem, direction, (uint32_t)count);
+    int32_t width = 0;
+    for (uint32_t i = 0; i < run->count; ++i) {
+        run->faces[i] = glyphs[i].ftface != NULL ? glyphs[i].ftface : face;
+        run->glyphs[i] = glyphs[i].index;
+        run->clusters[i] = glyphs[i].cluster;
+        run->advances[i] = glyphs[i].x_advance;
+        run->xOffsets[i] = glyphs[i].x_offset;
+        run->yOffsets[i] = glyphs[i].y_offset;
+        width += glyphs[i].x_advance;
+    }
+    run->width = width;
+    return run;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Shapes one paragraph of UTF-8 text at `ppem` pixels. The run stays valid
+ * until the cache's next frame, see ktShapeCacheFrame. */
+const KtGlyphRun* ktShape(KtShaper* shaper, FT_Face face, uint32_t ppem, KtDirection direction, const char_t *text, uint32_t size) {
+    if (shaper == NULL || face == NULL || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    const KtGlyphRun *cached = ktShapeCacheGet(shaper->cache, text, size, face, ppem, direction);
+    if (cached != NULL) {
+        return cached;
+    }
+    return i_shape(shaper, face, face, NULL, 0, ppem, direction, text, size);
+}
+
+/*----------------------------------------------------------------------------*/
+/* As ktShape, each character from the first face of the fallback chain that
+ * has it. */
+const KtGlyphRun* ktShapeFonts(KtShaper* shaper, KtFonts* fonts, uint32_t ppem, KtDirection direction, const char_t *text, uint32_t size) {
+    FT_Face primary = ktFontsPrimary(fonts);
+    if (shaper == NULL || primary == NULL || (text == NULL && size > 0)) {
+        return NULL;
+    }
+
+    const KtGlyphRun *cached = ktShapeCacheGet(shaper->cache, text, size, fonts, ppem, direction);
+    if (cached != NULL) {
+        return cached;
+    }
+
+    uint32_t nruns = ktFontsRuns(fonts, text, size, NULL, 0);
+    if (nruns > shaper->cruns) {
+        if (shaper->runs != NULL) {
+            heap_delete_n(&shaper->runs, shaper->cruns, KtFontRun);
+        }
+        shaper->cruns = nruns > 2 * shaper->cruns ? nruns : 2 * shaper->cruns;
+        shaper->runs = heap_new_n(shaper->cruns, KtFontRun);
+    }
+    ktFontsRuns(fonts, text, size, shaper->runs, nruns);
+    return i_shape(shaper, fonts, primary, shaper->runs, nruns, ppem, direction, text, size);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_SHAPER_H__
+#define __KAATA_SHAPER_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtShaper* ktShaperCreate(uint32_t cacheLimit);
+_kaata_api void ktShaperDestroy(KtShaper** shaper);
+_kaata_api KtShapeCache* ktShaperCache(KtShaper* shaper);
+
+_kaata_api const KtGlyphRun* ktShape(KtShaper* shaper, FT_Face face, uint32_t ppem, KtDirection direction, const char_t *text, uint32_t size);
+_kaata_api const KtGlyphRun* ktShapeFonts(KtShaper* shaper, KtFonts* fonts, uint32_t ppem, KtDirection direction, const char_t *text, uint32_t size);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_SHAPER_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,281 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Vertical extent of a document, paragraph by paragraph.
+ *
+ * Only paragraphs that have been on screen are ever shaped; every other one
+ * keeps an estimated height. Heights are summed in a Fenwick tree, so both
+ * the top of a paragraph and the paragraph under a given y are found in
+ * O(log n), and measuring one paragraph costs O(log n) too. The work done
+ * per frame thus depends on the window, not on the document.
+ *
+ * A paragraph that changes keeps its old height as an estimate until it is
+ * measured again, so the text below it does not jump meanwhile.
+ */
+#include "viewport.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+struct _kt_viewport_t {
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *heights;
+    byte_t *measured;
+    uint32_t *tree;
+    uint32_t estimate;
+};
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(KtViewport *viewport, uint32_t count) {
+    if (count <= viewport->capacity) {
+        return;
+    }
+
+    uint32_t capacity = viewport->capacity > 0 ? viewport->capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    uint32_t *heights = heap_new_n(capacity, uint32_t);
+    byte_t *measured = heap_new_n(capacity, byte_t);
+    if (viewport->count > 0) {
+        memcpy(heights, viewport->heights, viewport->count * sizeof(uint32_t));
+        memcpy(measured, viewport->measured, viewport->count);
+    }
+
+    if (viewport->capacity > 0) {
+        heap_delete_n(&viewport->heights, viewport->capacity, uint32_t);
+        heap_delete_n(&viewport->measured, viewport->capacity, byte_t);
+        heap_delete_n(&viewport->tree, viewport->capacity + 1, uint32_t);
+    }
+    viewport->heights = heights;
+    viewport->measured = measured;
+    viewport->tree = heap_new_n(capacity + 1, uint32_t);
+    viewport->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+/* O(n): every node adds itself to its parent once. */
+static void i_build(KtViewport *viewport) {
+    uint32_t n = viewport->count;
+    uint32_t *tree = viewport->tree;
+    if (tree == NULL) {
+        return;
+    }
+
+    tree[0] = 0;
+    for (uint32_t i = 1; i <= n; ++i) {
+        tree[i] = viewport->heights[i - 1];
+    }
+    for (uint32_t i = 1; i <= n; ++i) {
+        uint32_t parent = i + (i & (0 - i));
+        if (parent <= n) {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Sums wrap around, so a shrinking height is added as a negative delta. */
+static void i_add(KtViewport *viewport, uint32_t paragraph, uint32_t delta) {
+    for (uint32_t i = paragraph + 1; i <= viewport->count; i += i & (0 - i)) {
+        viewport->tree[i] += delta;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+KtViewport* ktViewportCreate(uint32_t estimate) {
+    KtViewport *viewport = heap_new0(KtViewport);
+    viewport->estimate = estimate;
+    return viewport;
+}
+
+/*----------------------------------------------------------------------------*/
+void ktViewportDestroy(KtViewport** viewport) {
+    if (viewport == NULL || *viewport == NULL) {
+        return;
+    }
+
+    KtViewport *v = *viewport;
+    if (v->capacity > 0) {
+        heap_delete_n(&v->heights, v->capacity, uint32_t);
+        heap_delete_n(&v->measured, v->capacity, byte_t);
+        heap_delete_n(&v->tree, v->capacity + 1, uint32_t);
+    }
+    heap_delete(viewport, KtViewport);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts over with `count` paragraphs of estimated height. */
+void ktViewportReset(KtViewport* viewport, uint32_t count) {
+    if (viewport == NULL) {
+        return;
+    }
+
+    viewport->count = 0;
+    ktViewportSplice(viewport, 0, 0, count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces `removed` paragraphs from `first` on with `inserted` new ones,
+ * after an edit joined or split paragraphs. */
+void ktViewportSplice(KtViewport* viewport, uint32_t first, uint32_t removed, uint32_t inserted) {
+    if (viewport == NULL || first > viewport->count) {
+        return;
+    }
+    if (removed > viewport->count - first) {
+        removed = viewport->count - first;
+    }
+
+    uint32_t count = viewport->count - removed + inserted;
+    uint32_t tail = viewport->count - first - removed;
+    i_reserve(viewport, count);
+    if (tail > 0 && removed != inserted) {
+        memmove(viewport->heights + first + inserted, viewport->heights + first + removed, tail * sizeof(uint32_t));
+        memmove(viewport->measured + first + inserted, viewport->measured + first + removed, tail);
+    }
+    for (uint32_t i = first; i < first + inserted; ++i) {
+        viewport->heights[i] = viewport->estimate;
+        viewport->measured[i] = FALSE;
+    }
+
+    viewport->count = count;
+    i_build(viewport);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs whose text or wrap width changed; they keep their height until
+ * they are measured again. */
+void ktViewportInvalidate(KtViewport* viewport, uint32_t first, uint32_t count) {
+    if (viewport == NULL || first >= viewport->count) {
+        return;
+    }
+    if (count > viewport->count - first) {
+        count = viewport->count - first;
+    }
+
+    memset(viewport->measured + first, FALSE, count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Applies to every paragraph not measured yet, e.g. after a font change. */
+void ktViewportSetEstimate(KtViewport* viewport, uint32_t estimate) {
+    if (viewport == NULL) {
+        return;
+    }
+
+    viewport->estimate = estimate;
+    for (uint32_t i = 0; i < viewport->count; ++i) {
+        if (!viewport->measured[i]) {
+            viewport->heights[i] = estimate;
+        }
+    }
+    i_build(viewport);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ktViewportCount(const KtViewport* viewport) {
+    return viewport != NULL ? viewport->count : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ktViewportHeight(const KtViewport* viewport) {
+    return ktViewportTop(viewport, viewport != NULL ? viewport->count : 0);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ktViewportParagraphHeight(const KtViewport* viewport, uint32_t paragraph) {
+    if (viewport == NULL || paragraph >= viewport->count) {
+        return 0;
+    }
+    return viewport->heights[paragraph];
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t ktViewportMeasured(const KtViewport* viewport, uint32_t paragraph) {
+    if (viewport == NULL || paragraph >= viewport->count) {
+        return FALSE;
+    }
+    return (bool_t)viewport->measured[paragraph];
+}
+
+/*----------------------------------------------------------------------------*/
+void ktViewportMeasure(KtViewport* viewport, uint32_t paragraph, uint32_t height) {
+    if (viewport == NULL || paragraph >= viewport->count) {
+        return;
+    }
+
+    i_add(viewport, paragraph, height - viewport->heights[paragraph]);
+    viewport->heights[paragraph] = height;
+    viewport->measured[paragraph] = TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Height of everything above `paragraph`. */
+uint32_t ktViewportTop(const KtViewport* viewport, uint32_t paragraph) {
+    if (viewport == NULL) {
+        return 0;
+    }
+    if (paragraph > viewport->count) {
+        paragraph = viewport->count;
+    }
+
+    uint32_t top = 0;
+    for (uint32_t i = paragraph; i > 0; i -= i & (0 - i)) {
+        top += viewport->tree[i];
+    }
+    return top;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The paragraph that covers `y`, or the last one below the end. */
+uint32_t ktViewportAt(const KtViewport* viewport, uint32_t y) {
+    if (viewport == NULL || viewport->count == 0) {
+        return 0;
+    }
+
+    uint32_t n = viewport->count;
+    uint32_t step = 1;
+    while (step * 2 <= n) {
+        step *= 2;
+    }
+
+    uint32_t pos = 0;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && viewport->tree[pos + step] <= y) {
+            pos += step;
+            y -= viewport->tree[pos];
+        }
+    }
+    return pos < n ? pos : n - 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs meeting [y, y + height), widened by `overscan` pixels on either
+ * side; returns how many and sets `first`. */
+uint32_t ktViewportVisible(const KtViewport* viewport, uint32_t y, uint32_t height, uint32_t overscan, uint32_t *first) {
+    if (first != NULL) {
+        *first = 0;
+    }
+    if (viewport == NULL || viewport->count == 0) {
+        return 0;
+    }
+
+    uint32_t top = y > overscan ? y - overscan : 0;
+    uint32_t bottom = y + height + overscan;
+    uint32_t from = ktViewportAt(viewport, top);
+    uint32_t to = ktViewportAt(viewport, bottom > top ? bottom - 1 : top);
+    if (first != NULL) {
+        *first = from;
+    }
+    return to - from + 1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,42 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_VIEWPORT_H__
+#define __KAATA_VIEWPORT_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api KtViewport* ktViewportCreate(uint32_t estimate);
+_kaata_api void ktViewportDestroy(KtViewport** viewport);
+_kaata_api void ktViewportReset(KtViewport* viewport, uint32_t count);
+_kaata_api void ktViewportSplice(KtViewport* viewport, uint32_t first, uint32_t removed, uint32_t inserted);
+_kaata_api void ktViewportInvalidate(KtViewport* viewport, uint32_t first, uint32_t count);
+_kaata_api void ktViewportSetEstimate(KtViewport* viewport, uint32_t estimate);
+
+_kaata_api uint32_t ktViewportCount(const KtViewport* viewport);
+_kaata_api uint32_t ktViewportHeight(const KtViewport* viewport);
+_kaata_api uint32_t ktViewportParagraphHeight(const KtViewport* viewport, uint32_t paragraph);
+_kaata_api bool_t ktViewportMeasured(const KtViewport* viewport, uint32_t paragraph);
+_kaata_api void ktViewportMeasure(KtViewport* viewport, uint32_t paragraph, uint32_t height);
+
+_kaata_api uint32_t ktViewportTop(const KtViewport* viewport, uint32_t paragraph);
+_kaata_api uint32_t ktViewportAt(const KtViewport* viewport, uint32_t y);
+_kaata_api uint32_t ktViewportVisible(const KtViewport* viewport, uint32_t y, uint32_t height, uint32_t overscan, uint32_t *first);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_VIEWPORT_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,416 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Line wrapping of a shaped paragraph.
+ *
+ * ktWrap is greedy: lines break after spaces, and a word wider than the line
+ * is cut between clusters. Spaces may hang past the end of a line. Glyphs
+ * are walked in logical order, so a right-to-left run is read from its end.
+ *
+ * ktWrapOptimal breaks at the opportunities of the Unicode line breaking
+ * algorithm and chooses among them for the whole paragraph at once, the way
+ * TeX does, so that no line is left much shorter than its neighbours. It
+ * costs more than the greedy pass, which is why its results are kept per
+ * paragraph and width by the line cache.
+ */
+#include "wrap.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define NO_BREAK 0xFFFFFFFF
+
+/* TeX's \linepenalty and \hyphenpenalty; breaking inside a word is only
+ * better than a line that overflows. */
+#define LINE_PENALTY 10.
+#define HYPHEN_PENALTY 50.
+#define EMERGENCY_PENALTY 20000.
+#define OVERFULL 1e12
+#define UNREACHED 1e30
+
+/*----------------------------------------------------------------------------*/
+/* Line breaking classes of UAX #14, those that matter to Urdu and Latin
+ * text; every other character is taken for a letter. */
+typedef enum _lb_t {
+    LB_AL, LB_BK, LB_CR, LB_LF, LB_SP, LB_ZW, LB_CM, LB_WJ, LB_GL,
+    LB_OP, LB_CL, LB_QU, LB_EX, LB_IS, LB_SY, LB_HY, LB_BA, LB_NU,
+    LB_PR, LB_PO, LB_ID
+} Lb;
+
+/*----------------------------------------------------------------------------*/
+typedef enum _break_t {
+    BREAK_NONE,
+    BREAK_ALLOWED,
+    BREAK_HYPHEN,
+    BREAK_EMERGENCY,
+    BREAK_MANDATORY
+} Break;
+
+/*----------------------------------------------------------------------------*/
+typedef struct _candidate_t Candidate;
+struct _candidate_t {
+    uint32_t offset;
+    int32_t before;
+    int32_t hang;
+    Break kind;
+    uint32_t from;
+    real64_t demerits;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_is_space(char_t c) {
+    return c == ' ' || c == '\t';
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wraps the run to `width` (26.6, like the advances) and returns the number
+ * of lines. The first `max` line starts, as byte offsets into `text`, go to
+ * `starts`. */
+uint32_t ktWrap(const KtGlyphRun* run, const char_t *text, int32_t width, uint32_t *starts, uint32_t max) {
+    if (starts != NULL && max > 0) {
+        starts[0] = 0;
+    }
+    if (run == NULL || run->count == 0 || text == NULL) {
+        return 1;
+    }
+
+    bool_t rtl = run->count > 1 && run->clusters[0] > run->clusters[run->count - 1];
+    uint32_t lines = 1;
+    int32_t lineWidth = 0;
+    int32_t sinceBreak = 0;
+    uint32_t breakAt = NO_BREAK;
+    uint32_t previous = NO_BREAK;
+    bool_t afterSpace = FALSE;
+
+    for (uint32_t k = 0; k < run->count; ++k) {
+        uint32_t i = rtl ? run->count - 1 - k : k;
+        uint32_t cluster = run->clusters[i];
+        int32_t advance = run->advances[i];
+        bool_t space = i_is_space(text[cluster]);
+
+        if (afterSpace && !space && cluster != previous) {
+            breakAt = cluster;
+            sinceBreak = 0;
+            afterSpace = FALSE;
+        }
+
+        if (!space && lineWidth > 0 && lineWidth + advance > width) {
+            uint32_t start = NO_BREAK;
+            if (breakAt != NO_BREAK) {
+                start = breakAt;
+                lineWidth = sinceBreak;
+            } else if (cluster != previous) {
+                start = cluster;
+                lineWidth = 0;
+            }
+
+            if (start != NO_BREAK) {
+                if (starts != NULL && lines < max) {
+                    starts[lines] = start;
+                }
+                lines += 1;
+                breakAt = NO_BREAK;
+                sinceBreak = 0;
+            }
+        }
+
+        lineWidth += advance;
+        sinceBreak += advance;
+        afterSpace = afterSpace || space;
+        previous = cluster;
+    }
+
+    return lines;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_decode(const byte_t *text, uint32_t size, uint32_t *codepoint) {
+    byte_t c = text[0];
+    uint32_t n = c < 0x80 ? 1 : c < 0xC2 ? 0 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF5 ? 4 : 0;
+    if (n == 0 || n > size) {
+        *codepoint = 0xFFFD;
+        return 1;
+    }
+
+    uint32_t cp = n == 1 ? c : c & (0x7F >> n);
+    for (uint32_t i = 1; i < n; ++i) {
+        if ((text[i] & 0xC0) != 0x80) {
+            *codepoint = 0xFFFD;
+            return 1;
+        }
+        cp = (cp << 6) | (text[i] & 0x3F);
+    }
+    *codepoint = cp;
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+static Lb i_class(uint32_t cp) {
+    if (cp < 0x80) {
+        switch (cp) {
+        case 0x0A: return LB_LF;
+        case 0x0D: return LB_CR;
+        case 0x0B: case 0x0C: return LB_BK;
+        case 0x09: return LB_BA;
+        case ' ': return LB_SP;
+        case '(': case '[': case '{': return LB_OP;
+        case ')': case ']': case '}': return LB_CL;
+        case '"': case '\'': return LB_QU;
+        case '!': case '?': return LB_EX;
+        case ',': case '.': case ':': case ';': return LB_IS;
+        case '/': return LB_SY;
+        case '-': return LB_HY;
+        case '$': case '+': case '\\': return LB_PR;
+        case '%': return LB_PO;
+        }
+        return cp >= '0' && cp <= '9' ? LB_NU : LB_AL;
+    }
+
+    if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x0610 && cp <= 0x061A) || cp == 0x061C
+        || (cp >= 0x064B && cp <= 0x065F) || cp == 0x0670 || (cp >= 0x06D6 && cp <= 0x06DC)
+        || (cp >= 0x06DF && cp <= 0x06E4) || cp == 0x06E7 || cp == 0x06E8
+        || (cp >= 0x06EA && cp <= 0x06ED) || cp == 0x200C || cp == 0x200D
+        || (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F)) {
+        return LB_CM;
+    }
+    if ((cp >= 0x0660 && cp <= 0x0669) || (cp >= 0x06F0 && cp <= 0x06F9) || cp == 0x066B || cp == 0x066C) {
+        return LB_NU;
+    }
+    if ((cp >= 0x2E80 && cp <= 0x9FFF) || (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x20000 && cp <= 0x3FFFD)) {
+        return LB_ID;
+    }
+
+    switch (cp) {
+    case 0x85: case 0x2028: case 0x2029: return LB_BK;
+    case 0x200B: return LB_ZW;
+    case 0x2060: case 0xFEFF: return LB_WJ;
+    case 0xA0: case 0x2007: case 0x2011: case 0x202F: return LB_GL;
+    case 0xAB: case 0xBB: case 0x2018: case 0x2019: case 0x201C: case 0x201D: return LB_QU;
+    case 0x060C: case 0x060D: return LB_IS;
+    case 0x061B: case 0x061D: case 0x061E: case 0x061F: case 0x06D4: return LB_EX;
+    case 0x0609: case 0x060A: case 0x066A: case 0x2030: return LB_PO;
+    case 0xA3: case 0xA5: case 0x20AC: case 0x20A8: return LB_PR;
+    case 0x2010: case 0x2012: case 0x2013: case 0x2014: return LB_BA;
+    }
+    if (cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A && cp != 0x2007)) {
+        return LB_BA;
+    }
+    return LB_AL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The pair rules, LB4 to LB31, between `a` and `b`; `last` is the class
+ * before the spaces that `a` may end. Rules on classes not listed above,
+ * and the numeric ones, are simplified. */
+static Break i_pair(Lb a, Lb last, Lb b) {
+    if (a == LB_BK || a == LB_LF || (a == LB_CR && b != LB_LF)) {
+        return BREAK_MANDATORY;
+    }
+    if (b == LB_BK || b == LB_CR || b == LB_LF || b == LB_SP || b == LB_ZW) {
+        return BREAK_NONE;
+    }
+    if (last == LB_ZW) {
+        return BREAK_ALLOWED;
+    }
+    if (a == LB_WJ || b == LB_WJ || a == LB_GL) {
+        return BREAK_NONE;
+    }
+    if (b == LB_GL && a != LB_SP && a != LB_BA && a != LB_HY) {
+        return BREAK_NONE;
+    }
+    if (b == LB_CL || b == LB_EX || b == LB_IS || b == LB_SY) {
+        return BREAK_NONE;
+    }
+    if (last == LB_OP || (last == LB_QU && b == LB_OP)) {
+        return BREAK_NONE;
+    }
+    if (a == LB_SP) {
+        return BREAK_ALLOWED;
+    }
+    if (a == LB_QU || b == LB_QU || b == LB_BA || b == LB_HY) {
+        return BREAK_NONE;
+    }
+    if (b == LB_NU && (a == LB_AL || a == LB_NU || a == LB_PR || a == LB_PO || a == LB_HY || a == LB_IS || a == LB_SY)) {
+        return BREAK_NONE;
+    }
+    if (a == LB_NU && (b == LB_AL || b == LB_PR || b == LB_PO)) {
+        return BREAK_NONE;
+    }
+    if ((a == LB_PR && (b == LB_AL || b == LB_ID)) || (a == LB_PO && b == LB_AL) || (a == LB_AL && (b == LB_PR || b == LB_PO))) {
+        return BREAK_NONE;
+    }
+    if ((a == LB_AL || a == LB_IS) && b == LB_AL) {
+        return BREAK_NONE;
+    }
+    if (((a == LB_AL || a == LB_NU) && b == LB_OP) || (a == LB_CL && (b == LB_AL || b == LB_NU))) {
+        return BREAK_NONE;
+    }
+    return a == LB_HY ? BREAK_HYPHEN : BREAK_ALLOWED;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Every place a line may start, with the width of the text before it and of
+ * the spaces that would hang at the end of the line it closes. Besides the
+ * break opportunities, words may be cut between clusters as a last resort. */
+static uint32_t i_candidates(const KtGlyphRun* run, const char_t *text, uint32_t size, Candidate *candidates) {
+    int32_t *widths = heap_new_n0(size + 1, int32_t);
+    byte_t *starts = heap_new_n0(size + 1, byte_t);
+    for (uint32_t i = 0; i < run->count; ++i) {
+        uint32_t cluster = run->clusters[i];
+        if (cluster < size) {
+            widths[cluster] += run->advances[i];
+            starts[cluster] = 1;
+        }
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t count = 0;
+    int32_t before = 0;
+    int32_t hang = 0;
+    Lb a = LB_AL, last = LB_AL;
+    uint32_t pos = 0;
+    while (pos < size) {
+        uint32_t cp = 0;
+        uint32_t n = i_decode(bytes + pos, size - pos, &cp);
+        Lb b = i_class(cp);
+
+        Break kind = BREAK_NONE;
+        if (pos == 0) {
+            kind = BREAK_MANDATORY;
+        } else if (b == LB_CM && a != LB_SP && a != LB_ZW && a != LB_BK && a != LB_CR && a != LB_LF) {
+            b = a;
+        } else {
+            if (b == LB_CM) {
+                b = LB_AL;
+            }
+            kind = i_pair(a, last, b);
+            if (kind == BREAK_NONE && b != LB_SP && a != LB_SP) {
+                kind = BREAK_EMERGENCY;
+            }
+        }
+
+        if (kind != BREAK_NONE && starts[pos]) {
+            candidates[count].offset = pos;
+            candidates[count].before = before;
+            candidates[count].hang = hang;
+            candidates[count].kind = kind;
+            count += 1;
+        }
+
+        for (uint32_t i = 0; i < n; ++i) {
+            before += widths[pos + i];
+            hang = b == LB_SP ? hang + widths[pos + i] : 0;
+        }
+        if (b != LB_SP) {
+            last = b;
+        }
+        a = b;
+        pos += n;
+    }
+
+    candidates[count].offset = size;
+    candidates[count].before = before;
+    candidates[count].hang = hang;
+    candidates[count].kind = BREAK_MANDATORY;
+    count += 1;
+
+    heap_delete_n(&widths, size + 1, int32_t);
+    heap_delete_n(&starts, size + 1, byte_t);
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Demerits of a line `width` wide in a column `column` wide, as in TeX with
+ * a ragged margin that may stretch by a quarter of the column. */
+static real64_t i_demerits(int32_t width, int32_t column, Break kind, bool_t last) {
+    if (width > column) {
+        return OVERFULL;
+    }
+
+    real64_t badness = 0;
+    if (!last) {
+        real64_t stretch = column > 4 ? (real64_t)column / 4. : 1.;
+        real64_t ratio = (real64_t)(column - width) / stretch;
+        badness = 100. * ratio * ratio * ratio;
+        if (badness > 10000.) {
+            badness = 10000.;
+        }
+    }
+
+    real64_t demerits = (LINE_PENALTY + badness) * (LINE_PENALTY + badness);
+    if (kind == BREAK_HYPHEN) {
+        demerits += HYPHEN_PENALTY * HYPHEN_PENALTY;
+    } else if (kind == BREAK_EMERGENCY) {
+        demerits += EMERGENCY_PENALTY * EMERGENCY_PENALTY;
+    }
+    return demerits;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wraps the run to `width` like ktWrap, but picks the breaks that minimize
+ * the demerits of the paragraph as a whole (Knuth and Plass), at the break
+ * opportunities of UAX #14 over the `size` bytes of `text`. A line only
+ * looks back as far as its width allows, so the cost stays linear in the
+ * length of the paragraph times the clusters a line holds. */
+uint32_t ktWrapOptimal(const KtGlyphRun* run, const char_t *text, uint32_t size, int32_t width, uint32_t *starts, uint32_t max) {
+    if (starts != NULL && max > 0) {
+        starts[0] = 0;
+    }
+    if (run == NULL || run->count == 0 || text == NULL || size == 0) {
+        return 1;
+    }
+
+    Candidate *candidates = heap_new_n(size + 1, Candidate);
+    uint32_t count = i_candidates(run, text, size, candidates);
+
+    uint32_t forced = 0;
+    candidates[0].demerits = 0;
+    candidates[0].from = 0;
+    for (uint32_t j = 1; j < count; ++j) {
+        Candidate *to = &candidates[j];
+        to->demerits = UNREACHED;
+        to->from = j - 1;
+        bool_t last = j == count - 1 || to->kind == BREAK_MANDATORY;
+        for (uint32_t i = j; i-- > forced;) {
+            const Candidate *from = &candidates[i];
+            int32_t line = to->before - from->before - to->hang;
+            if (line > width && i < j - 1) {
+                break;
+            }
+
+            real64_t demerits = from->demerits + i_demerits(line, width, to->kind, last);
+            if (demerits < to->demerits) {
+                to->demerits = demerits;
+                to->from = i;
+            }
+        }
+        if (to->kind == BREAK_MANDATORY) {
+            forced = j;
+        }
+    }
+
+    uint32_t lines = 0;
+    for (uint32_t j = count - 1; j > 0; j = candidates[j].from) {
+        lines += 1;
+    }
+
+    uint32_t line = lines;
+    for (uint32_t j = count - 1; j > 0; j = candidates[j].from) {
+        uint32_t start = candidates[j].from;
+        line -= 1;
+        if (starts != NULL && line < max) {
+            starts[line] = candidates[start].offset;
+        }
+    }
+
+    heap_delete_n(&candidates, size + 1, Candidate);
+    return lines;
+}
+
+/*----------------------------------------------------------------------------*/
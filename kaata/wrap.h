@@ -0,0 +1,28 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __KAATA_WRAP_H__
+#define __KAATA_WRAP_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaata.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_kaata_api uint32_t ktWrap(const KtGlyphRun* run, const char_t *text, int32_t width, uint32_t *starts, uint32_t max);
+_kaata_api uint32_t ktWrapOptimal(const KtGlyphRun* run, const char_t *text, uint32_t size, int32_t width, uint32_t *starts, uint32_t max);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __KAATA_WRAP_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,643 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Document view.
+ *
+ * Draws the document with raqm and FreeType instead of a TextView, and only
+ * the part of it that is on screen: the paragraphs meeting the viewport, plus
+ * a margin above and below, are shaped, wrapped and measured; every other
+ * paragraph keeps an estimated height. Scrolling through a long file thus
+ * costs the same per frame as scrolling through a short one.
+ *
+ * A frame first measures the visible paragraphs, which may move them, and
+ * then draws them into one bitmap the size of the viewport. Text is shaped
+ * with the font manager's fallback chain: characters the primary font lacks,
+ * Latin or symbols next to Urdu, come from the first face that has them.
+ * Glyphs are copied from the glyph cache's atlas; those of paragraphs
+ * measured in the margin are queued for its workers, to be ready by the time
+ * they scroll in.
+ *
+ * Lines are broken optimally and kept per paragraph and width. A new width
+ * re-wraps the visible paragraphs at once; the others are measured after,
+ * a few milliseconds at a time between frames, from the top of the view
+ * down and then from the top of the document, so the scroll bar settles
+ * without holding up the first frame.
+ *
+ * Clicks and drags are mapped to offsets through the caret maps of the
+ * paragraphs under them, built from their shaped runs the first time and
+ * kept with their lines; a drag across a long line searches a map and
+ * shapes nothing. The same maps place the caret and the selection.
+ */
+#include "docview.h"
+#include "shaper.h"
+#include "shapecache.h"
+#include "glyphcache.h"
+#include "fonts.h"
+#include "viewport.h"
+#include "linecache.h"
+#include "caret.h"
+#include "bidi.h"
+#include <osbs/bthread.h>
+#include <osbs/btime.h>
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+#if defined(_WIN32)
+static const char_t *FONT_PATH = "C:\\Windows\\Fonts\\segoeui.ttf";
+static const char_t *FALLBACK_PATHS[] = { "C:\\Windows\\Fonts\\arial.ttf", "C:\\Windows\\Fonts\\seguisym.ttf" };
+#elif defined(__APPLE__)
+static const char_t *FONT_PATH = "/System/Library/Fonts/GeezaPro.ttc";
+static const char_t *FALLBACK_PATHS[] = { "/System/Library/Fonts/Helvetica.ttc", "/System/Library/Fonts/Apple Symbols.ttf" };
+#else
+static const char_t *FONT_PATH = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+static const char_t *FALLBACK_PATHS[] = { "/usr/share/fonts/truetype/noto/NotoNaskhArabic-Regular.ttf", "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf" };
+#endif
+
+#define FONT_PPEM 32
+#define LINE_SPACING 1.2f
+#define MARGIN 8
+#define OVERSCAN 256
+#define GLYPH_WORKERS 2
+#define FILL_SLICE 4000
+#define FILL_PAUSE 10
+#define CARET_WIDTH 2
+
+/* -------------------------------------------------------------------------- */
+typedef struct _paragraph_t Paragraph;
+struct _paragraph_t {
+    uint32_t start;
+    uint32_t size;
+    String *text;
+    const KtBidiPara *bidi;
+    const KtGlyphRun *run;
+    uint32_t lines;
+    const uint32_t *starts;
+};
+
+/* -------------------------------------------------------------------------- */
+static int32_t i_wrap_width(const App *app) {
+    return ((int32_t)app->doc.width - 2 * MARGIN) * 64;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Lays out one paragraph. Unless `shape` is set, a paragraph whose lines are
+ * cached for this width is not shaped, and has no run. */
+static bool_t i_paragraph(App *app, uint32_t index, bool_t shape, Paragraph *paragraph) {
+    uint32_t start = 0, end = utxLength(app->utx);
+    if (utxLineToOffset(app->utx, index, &start) != ROkay) {
+        return FALSE;
+    }
+    if (utxLineToOffset(app->utx, index + 1, &end) == ROkay) {
+        end -= 1;
+    }
+
+    UTX_TRACE_BEGIN("layout");
+    paragraph->text = utxGetRange(app->utx, start, end - start);
+    const char_t *text = tc(paragraph->text);
+    uint32_t size = str_len(paragraph->text);
+    if (size > 0 && text[size - 1] == '\r') {
+        size -= 1;
+    }
+
+    int32_t width = i_wrap_width(app);
+    paragraph->start = start;
+    paragraph->size = size;
+    paragraph->bidi = NULL;
+    paragraph->run = NULL;
+    paragraph->starts = NULL;
+    if (!shape) {
+        paragraph->starts = ktLineCacheGet(app->doc.lines, index, text, size, width, &paragraph->lines);
+    }
+
+    if (paragraph->starts == NULL) {
+        paragraph->bidi = ktBidiParagraph(app->doc.bidi, index, text, size);
+        KtDirection direction = paragraph->bidi == NULL || paragraph->bidi->rtl ? KDirRtl : KDirLtr;
+        paragraph->run = ktShapeFonts(app->doc.shaper, app->doc.fonts, FONT_PPEM, direction, text, size);
+        paragraph->starts = ktLineCacheWrap(app->doc.lines, index, paragraph->run, text, size, width, &paragraph->lines);
+    }
+    UTX_TRACE_END("layout");
+
+    if (paragraph->starts == NULL) {
+        str_destroy(&paragraph->text);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* -------------------------------------------------------------------------- */
+static void i_paragraph_free(Paragraph *paragraph) {
+    str_destroy(&paragraph->text);
+}
+
+/* -------------------------------------------------------------------------- */
+/* The caret map of a paragraph laid out with its run. */
+static const KtCaretMap *i_carets(App *app, uint32_t index, const Paragraph *paragraph) {
+    if (paragraph->run == NULL) {
+        return NULL;
+    }
+    return ktCaretCacheGet(app->doc.carets, index, paragraph->run, paragraph->bidi, tc(paragraph->text), paragraph->size, i_wrap_width(app), utxGeneration(app->utx), paragraph->starts, paragraph->lines);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Where a line `lineWidth` wide starts, in 26.6: right-to-left paragraphs
+ * hang from the right margin. */
+static int32_t i_line_left(bool_t rtl, uint32_t width, int32_t lineWidth) {
+    return rtl ? ((int32_t)width - MARGIN) * 64 - lineWidth : MARGIN * 64;
+}
+
+/* -------------------------------------------------------------------------- */
+static uint32_t i_line_of(const Paragraph *paragraph, uint32_t cluster) {
+    uint32_t lo = 1, hi = paragraph->lines;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (paragraph->starts[mid] <= cluster) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Black text over white: darkens each channel by the glyph's coverage. */
+static void i_blit(byte_t *pixels, uint32_t width, uint32_t height, const byte_t *coverage, int32_t pitch, uint32_t cols, uint32_t rows, int32_t x, int32_t y) {
+    for (uint32_t row = 0; row < rows; ++row) {
+        int32_t py = y + (int32_t)row;
+        if (py < 0 || py >= (int32_t)height) {
+            continue;
+        }
+        const byte_t *src = coverage + (int32_t)row * pitch;
+        for (uint32_t col = 0; col < cols; ++col) {
+            int32_t px = x + (int32_t)col;
+            if (px < 0 || px >= (int32_t)width || src[col] == 0) {
+                continue;
+            }
+            byte_t *dst = pixels + ((uint32_t)py * width + (uint32_t)px) * 4;
+            uint32_t keep = 255u - src[col];
+            dst[0] = (byte_t)(dst[0] * keep / 255u);
+            dst[1] = (byte_t)(dst[1] * keep / 255u);
+            dst[2] = (byte_t)(dst[2] * keep / 255u);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static void i_fill(byte_t *pixels, uint32_t width, uint32_t height, int32_t x0, int32_t y0, int32_t x1, int32_t y1, const byte_t rgb[3]) {
+    x0 = x0 > 0 ? x0 : 0;
+    y0 = y0 > 0 ? y0 : 0;
+    x1 = x1 < (int32_t)width ? x1 : (int32_t)width;
+    y1 = y1 < (int32_t)height ? y1 : (int32_t)height;
+    for (int32_t y = y0; y < y1; ++y) {
+        byte_t *dst = pixels + ((uint32_t)y * width + (uint32_t)x0) * 4;
+        for (int32_t x = x0; x < x1; ++x, dst += 4) {
+            dst[0] = rgb[0];
+            dst[1] = rgb[1];
+            dst[2] = rgb[2];
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Shades the clusters of a paragraph that start in [from, to), from its
+ * start. */
+static void i_draw_selection(App *app, const Paragraph *paragraph, const KtCaretMap *map, int32_t top, byte_t *pixels, uint32_t width, uint32_t height, uint32_t from, uint32_t to) {
+    static const byte_t SELECTION[3] = { 0xB4, 0xD5, 0xFE };
+    for (uint32_t line = 0; line < map->lines; ++line) {
+        int32_t left = i_line_left(map->rtl, width, map->widths[line]);
+        int32_t y = top + (int32_t)(line * app->doc.lineHeight);
+        for (uint32_t i = map->first[line]; i < map->first[line + 1]; ++i) {
+            const KtCaretStop *stop = &map->stops[i];
+            if (stop->start >= from && stop->start < to) {
+                i_fill(pixels, width, height, (left + stop->left) >> 6, y, (left + stop->right) >> 6, y + (int32_t)app->doc.lineHeight, SELECTION);
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Keeps the line the caret was put on where an offset ends one line and
+ * starts the next; otherwise draws it on the line holding the offset. */
+static void i_draw_caret(App *app, const Paragraph *paragraph, const KtCaretMap *map, int32_t top, byte_t *pixels, uint32_t width, uint32_t height) {
+    static const byte_t CARET[3] = { 0, 0, 0 };
+    uint32_t offset = app->doc.select.focus - paragraph->start;
+    uint32_t line = app->doc.select.line;
+    if (line >= map->lines || map->starts[line] > offset || (line + 1 < map->lines && map->starts[line + 1] < offset)) {
+        line = ktCaretLine(map, offset);
+    }
+
+    int32_t x = (i_line_left(map->rtl, width, map->widths[line]) + ktCaretX(map, line, offset)) >> 6;
+    int32_t y = top + (int32_t)(line * app->doc.lineHeight);
+    i_fill(pixels, width, height, x - CARET_WIDTH / 2, y, x - CARET_WIDTH / 2 + CARET_WIDTH, y + (int32_t)app->doc.lineHeight, CARET);
+}
+
+/* -------------------------------------------------------------------------- */
+/* With no `pixels`, only queues the paragraph's glyphs for the workers. */
+static void i_draw_paragraph(App *app, const Paragraph *paragraph, int32_t top, byte_t *pixels, uint32_t width, uint32_t height) {
+    const KtGlyphRun *run = paragraph->run;
+    if (run == NULL || run->count == 0) {
+        return;
+    }
+
+    int32_t *pens = heap_new_n0(paragraph->lines, int32_t);
+    for (uint32_t i = 0; i < run->count; ++i) {
+        pens[i_line_of(paragraph, run->clusters[i])] += run->advances[i];
+    }
+
+    for (uint32_t line = 0; line < paragraph->lines; ++line) {
+        pens[line] = i_line_left(paragraph->bidi == NULL || paragraph->bidi->rtl, width, pens[line]);
+    }
+
+    int32_t lead = ((int32_t)app->doc.lineHeight - (int32_t)app->doc.fontHeight) / 2;
+    for (uint32_t i = 0; i < run->count; ++i) {
+        uint32_t line = i_line_of(paragraph, run->clusters[i]);
+        int32_t baseline = top + (int32_t)(line * app->doc.lineHeight) + lead + (int32_t)app->doc.ascender;
+        int32_t x = pens[line] + run->xOffsets[i];
+        uint32_t subpixel = (uint32_t)(x & 63) * GLYPH_SUBPIXELS / 64;
+        pens[line] += run->advances[i];
+
+        FT_Face face = run->faces[i];
+        if (pixels == NULL) {
+            ktGlyphCacheRequest(app->doc.glyphs, face, FONT_PPEM, run->glyphs[i], subpixel);
+            continue;
+        }
+        if (baseline + (int32_t)app->doc.lineHeight < 0 || baseline - (int32_t)app->doc.lineHeight > (int32_t)height) {
+            continue;
+        }
+
+        int32_t y = baseline - (run->yOffsets[i] >> 6);
+        const KtGlyph *glyph = ktGlyphCacheGet(app->doc.glyphs, face, FONT_PPEM, run->glyphs[i], subpixel);
+        if (glyph != NULL) {
+            i_blit(pixels, width, height, glyph->pixels, (int32_t)glyph->pitch, glyph->width, glyph->height, (x >> 6) + glyph->left, y - glyph->top);
+        } else if (FT_Set_Pixel_Sizes(face, 0, FONT_PPEM) == 0 && FT_Load_Glyph(face, run->glyphs[i], FT_LOAD_RENDER) == 0) {
+            const FT_Bitmap *bitmap = &face->glyph->bitmap;
+            i_blit(pixels, width, height, bitmap->buffer, bitmap->pitch, bitmap->width, bitmap->rows, (x >> 6) + face->glyph->bitmap_left, y - face->glyph->bitmap_top);
+        }
+    }
+
+    heap_delete_n(&pens, paragraph->lines, int32_t);
+}
+
+/* -------------------------------------------------------------------------- */
+static void i_content_size(App *app) {
+    uint32_t height = ktViewportHeight(app->doc.viewport) + 2 * MARGIN;
+    view_content_size(app->ui.view, s2df((real32_t)app->doc.width, (real32_t)height), s2df(10.f, (real32_t)app->doc.lineHeight));
+}
+
+/* -------------------------------------------------------------------------- */
+/* Shapes and wraps what is about to be shown; returns whether any of it
+ * turned out taller or shorter than assumed. Only the glyphs of paragraphs
+ * in the margin are queued: those on screen are drawn this frame, which
+ * rasterizes them anyway. */
+static bool_t i_measure(App *app, uint32_t y, uint32_t height) {
+    bool_t moved = FALSE;
+    uint32_t first = 0;
+    uint32_t count = ktViewportVisible(app->doc.viewport, y, height, OVERSCAN, &first);
+    for (uint32_t i = first; i < first + count; ++i) {
+        if (ktViewportMeasured(app->doc.viewport, i)) {
+            continue;
+        }
+
+        Paragraph paragraph;
+        if (i_paragraph(app, i, TRUE, &paragraph)) {
+            uint32_t h = paragraph.lines * app->doc.lineHeight;
+            moved = moved || h != ktViewportParagraphHeight(app->doc.viewport, i);
+            ktViewportMeasure(app->doc.viewport, i, h);
+            uint32_t top = ktViewportTop(app->doc.viewport, i);
+            if (top >= y + height || top + h <= y) {
+                i_draw_paragraph(app, &paragraph, 0, NULL, app->doc.width, 0);
+            }
+            i_paragraph_free(&paragraph);
+        }
+    }
+    return moved;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Runs on a task thread and only waits: the wrapping is done on the main
+ * thread, which owns the shaper, between frames. */
+static uint32_t onFillMain(App *app) {
+    unref(app);
+    bthread_sleep(FILL_PAUSE);
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static void onFillEnd(App *app, const uint32_t rvalue);
+
+/* -------------------------------------------------------------------------- */
+static void i_fill_start(App *app) {
+    if (!app->doc.fill.isRunning && app->doc.fill.left > 0) {
+        app->doc.fill.isRunning = TRUE;
+        osapp_task(app, FILL_PAUSE / 1000.f, onFillMain, NULL, onFillEnd, App);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Measures paragraphs off screen for one slice of time, keeping the text on
+ * screen where it is, and queues the next slice. */
+static void onFillEnd(App *app, const uint32_t rvalue) {
+    unref(rvalue);
+    app->doc.fill.isRunning = FALSE;
+    if (app->doc.face == NULL || app->utx == NULL || app->doc.width <= 2 * MARGIN) {
+        return;
+    }
+
+    KtViewport *viewport = app->doc.viewport;
+    uint32_t count = ktViewportCount(viewport);
+    uint32_t anchor = ktViewportAt(viewport, app->doc.scroll > MARGIN ? app->doc.scroll - MARGIN : 0);
+    uint32_t anchorTop = ktViewportTop(viewport, anchor);
+    bool_t moved = FALSE;
+
+    UTX_TRACE_BEGIN("fill");
+    uint64_t start = btime_now();
+    while (app->doc.fill.left > 0 && btime_now() - start < FILL_SLICE) {
+        uint32_t i = app->doc.fill.next;
+        app->doc.fill.next = i + 1 < count ? i + 1 : 0;
+        app->doc.fill.left -= 1;
+        if (i >= count || ktViewportMeasured(viewport, i)) {
+            continue;
+        }
+
+        Paragraph paragraph;
+        if (i_paragraph(app, i, FALSE, &paragraph)) {
+            uint32_t h = paragraph.lines * app->doc.lineHeight;
+            moved = moved || h != ktViewportParagraphHeight(viewport, i);
+            ktViewportMeasure(viewport, i, h);
+            i_paragraph_free(&paragraph);
+        }
+    }
+    UTX_TRACE_END("fill");
+
+    if (moved) {
+        i_content_size(app);
+        uint32_t top = ktViewportTop(viewport, anchor);
+        if (top != anchorTop) {
+            app->doc.scroll = app->doc.scroll + top - anchorTop;
+            view_scroll_y(app->ui.view, (real32_t)app->doc.scroll);
+        }
+    }
+    i_fill_start(app);
+}
+
+/* -------------------------------------------------------------------------- */
+static void onDocumentDraw(App *app, Event *e) {
+    const EvDraw *p = event_params(e, EvDraw);
+    draw_clear(p->ctx, kCOLOR_WHITE);
+
+    uint32_t width = (uint32_t)p->width;
+    uint32_t height = (uint32_t)p->height;
+    if (app->doc.face == NULL || app->utx == NULL || width <= 2 * MARGIN || height == 0) {
+        return;
+    }
+
+    /* a new width re-wraps, shaping stays cached; the visible paragraphs
+     * first, the rest in the background */
+    uint32_t y = p->y > MARGIN ? (uint32_t)p->y - MARGIN : 0;
+    app->doc.scroll = (uint32_t)p->y;
+    if (width != app->doc.width) {
+        app->doc.width = width;
+        ktViewportInvalidate(app->doc.viewport, 0, ktViewportCount(app->doc.viewport));
+        app->doc.fill.next = ktViewportAt(app->doc.viewport, y);
+        app->doc.fill.left = ktViewportCount(app->doc.viewport);
+    }
+
+    UTX_TRACE_BEGIN("draw");
+    KtShapeCache *cache = ktShaperCache(app->doc.shaper);
+    ktShapeCacheFrame(cache);
+    ktGlyphCacheFrame(app->doc.glyphs);
+
+    UTX_TRACE_BEGIN("measure");
+    if (i_measure(app, y, height)) {
+        i_content_size(app);
+    }
+    UTX_TRACE_END("measure");
+    i_fill_start(app);
+
+    uint32_t bytes = width * height * 4;
+    byte_t *pixels = heap_new_n(bytes, byte_t);
+    memset(pixels, 255, bytes);
+
+    uint32_t from = app->doc.select.anchor, to = app->doc.select.focus;
+    if (from > to) {
+        from = app->doc.select.focus;
+        to = app->doc.select.anchor;
+    }
+
+    uint32_t first = 0;
+    uint32_t count = ktViewportVisible(app->doc.viewport, y, height, 0, &first);
+    for (uint32_t i = first; i < first + count; ++i) {
+        Paragraph paragraph;
+        if (i_paragraph(app, i, TRUE, &paragraph)) {
+            int32_t top = MARGIN + (int32_t)ktViewportTop(app->doc.viewport, i) - (int32_t)p->y;
+            uint32_t end = paragraph.start + paragraph.size;
+            const KtCaretMap *map = NULL;
+            if (from <= end && to >= paragraph.start) {
+                map = i_carets(app, i, &paragraph);
+            }
+            if (map != NULL && from < to) {
+                i_draw_selection(app, &paragraph, map, top, pixels, width, height, from > paragraph.start ? from - paragraph.start : 0, to - paragraph.start);
+            }
+            i_draw_paragraph(app, &paragraph, top, pixels, width, height);
+            if (map != NULL && app->doc.select.focus >= paragraph.start && app->doc.select.focus <= end) {
+                i_draw_caret(app, &paragraph, map, top, pixels, width, height);
+            }
+            i_paragraph_free(&paragraph);
+        }
+    }
+
+    Image *image = image_from_pixels(width, height, ekRGBA32, pixels, NULL, 0);
+    draw_image(p->ctx, image, p->x, p->y);
+    image_destroy(&image);
+    heap_delete_n(&pixels, bytes, byte_t);
+
+#if defined(UTX_TRACE)
+    uint32_t hits = 0, misses = 0, entries = 0, cached = 0;
+    ktShapeCacheStats(cache, &hits, &misses, &entries, &cached);
+    UTX_TRACE_COUNTER("shape cache bytes", cached);
+    UTX_TRACE_COUNTER("shape cache misses", misses);
+    uint32_t pages = 0, pending = 0;
+    ktGlyphCacheStats(app->doc.glyphs, &hits, &misses, NULL, &pages, &pending);
+    UTX_TRACE_COUNTER("glyph atlas pages", pages);
+    UTX_TRACE_COUNTER("glyph cache misses", misses);
+    UTX_TRACE_COUNTER("glyphs pending", pending);
+    ktLineCacheStats(app->doc.lines, &hits, &misses, &cached);
+    UTX_TRACE_COUNTER("paragraphs wrapped", misses);
+    ktCaretCacheStats(app->doc.carets, &hits, &misses, &cached);
+    UTX_TRACE_COUNTER("caret maps built", misses);
+#endif
+    UTX_TRACE_END("draw");
+}
+
+/* -------------------------------------------------------------------------- */
+/* The offset at a point of the document, and the line of its paragraph it
+ * is on. While the document is unchanged, the paragraph's caret map is
+ * found without laying it out again. */
+static bool_t i_hit(App *app, real32_t x, real32_t y, uint32_t *offset, uint32_t *line) {
+    if (app->doc.face == NULL || app->utx == NULL || app->doc.width <= 2 * MARGIN) {
+        return FALSE;
+    }
+
+    uint32_t dy = y > MARGIN ? (uint32_t)y - MARGIN : 0;
+    uint32_t index = ktViewportAt(app->doc.viewport, dy);
+    uint32_t start = 0;
+    if (utxLineToOffset(app->utx, index, &start) != ROkay) {
+        return FALSE;
+    }
+
+    Paragraph paragraph;
+    paragraph.text = NULL;
+    const KtCaretMap *map = ktCaretCacheFind(app->doc.carets, index, i_wrap_width(app), utxGeneration(app->utx));
+    if (map == NULL) {
+        if (!i_paragraph(app, index, TRUE, &paragraph)) {
+            return FALSE;
+        }
+        map = i_carets(app, index, &paragraph);
+    }
+
+    UTX_TRACE_BEGIN("hit");
+    if (map != NULL) {
+        uint32_t top = ktViewportTop(app->doc.viewport, index);
+        uint32_t l = dy > top ? (dy - top) / app->doc.lineHeight : 0;
+        l = l < map->lines ? l : map->lines - 1;
+        int32_t px = (int32_t)(x * 64) - i_line_left(map->rtl, app->doc.width, map->widths[l]);
+        *offset = start + ktCaretHit(map, l, px);
+        *line = l;
+    }
+    UTX_TRACE_END("hit");
+
+    if (paragraph.text != NULL) {
+        i_paragraph_free(&paragraph);
+    }
+    return map != NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Puts the caret under the pointer; with shift held, the selection extends
+ * to it. */
+static void onDocumentDown(App *app, Event *e) {
+    const EvMouse *p = event_params(e, EvMouse);
+    uint32_t offset = 0, line = 0;
+    if (p->button != ekGUI_MOUSE_LEFT || !i_hit(app, p->x, p->y, &offset, &line)) {
+        return;
+    }
+
+    if ((p->modifiers & ekMKEY_SHIFT) == 0) {
+        app->doc.select.anchor = offset;
+    }
+    app->doc.select.focus = offset;
+    app->doc.select.line = line;
+    utxEditTraceCursor(app->trace, app->doc.select.focus, app->doc.select.anchor);
+    view_update(app->ui.view);
+}
+
+/* -------------------------------------------------------------------------- */
+static void onDocumentDrag(App *app, Event *e) {
+    const EvMouse *p = event_params(e, EvMouse);
+    uint32_t offset = 0, line = 0;
+    if (p->button != ekGUI_MOUSE_LEFT || !i_hit(app, p->x, p->y, &offset, &line)) {
+        return;
+    }
+
+    if (offset != app->doc.select.focus || line != app->doc.select.line) {
+        if (offset != app->doc.select.focus) {
+            utxEditTraceCursor(app->trace, offset, app->doc.select.anchor);
+        }
+        app->doc.select.focus = offset;
+        app->doc.select.line = line;
+        view_update(app->ui.view);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static bool_t i_load_font(App *app) {
+    const char_t *fontPath = getenv("KAATIB_FONT");
+    if (fontPath == NULL) {
+        fontPath = FONT_PATH;
+    }
+
+    app->doc.face = ktFontsLoad(app->doc.fonts, fontPath, 0);
+    if (app->doc.face == NULL) {
+        log_printf("Failed to load font (%s)", fontPath);
+        return FALSE;
+    }
+
+    FT_Set_Pixel_Sizes(app->doc.face, 0, FONT_PPEM);
+    const FT_Size_Metrics *metrics = &app->doc.face->size->metrics;
+    app->doc.ascender = (uint32_t)(metrics->ascender >> 6);
+    app->doc.fontHeight = (uint32_t)(metrics->height >> 6);
+    app->doc.lineHeight = (uint32_t)((real32_t)app->doc.fontHeight * LINE_SPACING);
+    ktFontsFallback(app->doc.fonts, app->doc.face);
+    ktGlyphCacheFont(app->doc.glyphs, app->doc.face, fontPath, 0);
+    log_printf("Loaded font (%s)", fontPath);
+
+    /* those missing on this system are skipped */
+    for (uint32_t i = 0; i < sizeof(FALLBACK_PATHS) / sizeof(FALLBACK_PATHS[0]); ++i) {
+        FT_Face face = ktFontsLoad(app->doc.fonts, FALLBACK_PATHS[i], 0);
+        if (face != NULL && face != app->doc.face) {
+            ktFontsFallback(app->doc.fonts, face);
+            ktGlyphCacheFont(app->doc.glyphs, face, FALLBACK_PATHS[i], 0);
+        }
+    }
+    return TRUE;
+}
+
+/* -------------------------------------------------------------------------- */
+View *createDocumentView(App *app) {
+    app->doc.lineHeight = FONT_PPEM;
+    app->doc.fonts = ktFontsCreate();
+    app->doc.glyphs = ktGlyphCacheCreate(GLYPH_CACHE_SIZE, GLYPH_WORKERS);
+    i_load_font(app);
+    app->doc.shaper = ktShaperCreate(SHAPE_CACHE_SIZE);
+    app->doc.viewport = ktViewportCreate(app->doc.lineHeight);
+    app->doc.bidi = ktBidiCreate(KDirAuto);
+    app->doc.lines = ktLineCacheCreate();
+    app->doc.carets = ktCaretCacheCreate();
+
+    View *view = view_scroll();
+    view_size(view, s2df(800, 450));
+    view_OnDraw(view, listener(app, onDocumentDraw, App));
+    view_OnDown(view, listener(app, onDocumentDown, App));
+    view_OnDrag(view, listener(app, onDocumentDrag, App));
+    app->ui.view = view;
+    return view;
+}
+
+/* -------------------------------------------------------------------------- */
+/* The document was replaced or changed as a whole. */
+void resetDocumentView(App *app) {
+    ktViewportReset(app->doc.viewport, utxLineCount(app->utx));
+    ktBidiReset(app->doc.bidi, utxLineCount(app->utx));
+    ktLineCacheReset(app->doc.lines, utxLineCount(app->utx));
+    ktCaretCacheReset(app->doc.carets, utxLineCount(app->utx));
+    app->doc.select.anchor = 0;
+    app->doc.select.focus = 0;
+    app->doc.select.line = 0;
+    app->doc.fill.next = 0;
+    app->doc.fill.left = utxLineCount(app->utx);
+    i_content_size(app);
+    view_update(app->ui.view);
+    i_fill_start(app);
+}
+
+/* -------------------------------------------------------------------------- */
+void destroyDocumentView(App *app) {
+    ktViewportDestroy(&app->doc.viewport);
+    ktBidiDestroy(&app->doc.bidi);
+    ktLineCacheDestroy(&app->doc.lines);
+    ktCaretCacheDestroy(&app->doc.carets);
+    ktShaperDestroy(&app->doc.shaper);
+    /* its workers hold faces of their own, the library is not shared */
+    ktGlyphCacheDestroy(&app->doc.glyphs);
+    ktFontsDestroy(&app->doc.fonts);
+    app->doc.face = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,23 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __DOCVIEW_H__
+#define __DOCVIEW_H__
+/*----------------------------------------------------------------------------*/
+
+#include "kaatib.h"
+
+/*----------------------------------------------------------------------------*/
+View *createDocumentView(App*);
+void resetDocumentView(App*);
+void destroyDocumentView(App*);
+
+/*----------------------------------------------------------------------------*/
+# endif /* __DOCVIEW_H__ */
+/*----------------------------------------------------------------------------*/
@@ -8,6 +8,7 @@
 * Author: roximn <roximn148@gmail.com>
 *******************************************************************************/
 #include "kaatib.h"
+#include "docview.h"
 
 /* -------------------------------------------------------------------------- */
 static void onWindowClose(App *app, Event *e) {
@@ -17,27 +18,59 @@ static void onWindowClose(App *app, Event *e) {
     osapp_finish();
 }
 
+/* -------------------------------------------------------------------------- */
+static void onLoadCancel(App *app, Event *e) {
+    unref(e);
+    bmutex_lock(app->load.mutex);
+    app->load.cancel = TRUE;
+    bmutex_unlock(app->load.mutex);
+    log_printf("onLoadCancel clicked");
+}
+
+/* -------------------------------------------------------------------------- */
+static Layout *createStatusLayout(App *app) {
+    Progress *progress = progress_create();
+    app->ui.progress = progress;
+
+    Button *btCancel = button_push();
+    button_text(btCancel, "Cancel");
+    button_OnClick(btCancel, listener(app, onLoadCancel, App));
+    app->ui.btCancel = btCancel;
+
+    Layout *layout = layout_create(2, 1);
+    layout_progress(layout, progress, 0, 0);
+    layout_button(layout, btCancel, 1, 0);
+    layout_hexpand(layout, 0);
+    layout_hmargin(layout, 0, 4);
+    return layout;
+}
+
 /* -------------------------------------------------------------------------- */
 static Panel *createCentralPanel(App *app) {
-    TextView *text = textview_create();
-    textview_family(text, "Calibri");
-    textview_fsize(text, 24);
-    textview_halign(text, ekRIGHT);
-    textview_lspacing(text, 1.2);
-    textview_editable(text, !app->isReadOnly);
-    app->ui.textview = text;
-    
+    View *view = createDocumentView(app);
+
     Panel *panel = panel_create();
-    Layout *layout = layout_create(1, 1);
-    layout_textview(layout, text, 0, 0);
+    Layout *layout = layout_create(1, 2);
+    layout_view(layout, view, 0, 0);
+    layout_layout(layout, createStatusLayout(app), 0, 1);
     layout_hsize(layout, 0, 800);
     layout_vsize(layout, 0, 450);
+    layout_vexpand(layout, 0);
     layout_margin(layout, 2);
+    layout_show_row(layout, 1, FALSE);
     panel_layout(panel, layout);
+    app->ui.layout = layout;
 
     return panel;
 }
 
+/* -------------------------------------------------------------------------- */
+void showKaatibProgress(App *app, bool_t show) {
+    progress_value(app->ui.progress, 0);
+    layout_show_row(app->ui.layout, 1, show);
+    layout_update(app->ui.layout);
+}
+
 
 
 /* -------------------------------------------------------------------------- */
@@ -11,13 +11,62 @@
 #define __KAATIB_H__
 /*----------------------------------------------------------------------------*/
 #include <nappgui.h>
+#include <osbs/bmutex.h>
 #include <utx.h>
+#include <edittrace.h>
+#include <trace.h>
+#include <kaata.hxx>
 
 /* -------------------------------------------------------------------------- */
 typedef struct _app_t App;
 struct _app_t {
     bool_t isReadOnly;
     UtxFile *utx;
+    UtxEditTrace *trace;
+    struct _load_t {
+        Mutex *mutex;
+        bool_t isActive;
+        bool_t isRunning;
+        bool_t cancel;
+        uint32_t loaded;
+        uint32_t total;
+        String *filePath;
+        UtxFile *utx;
+    } load;
+    struct _save_t {
+        Mutex *mutex;
+        bool_t isRunning;
+        uint32_t pending;
+        Result result;
+        UtxFile *utx;
+        uint32_t generation;
+        String *filePath;
+    } save;
+    struct _doc_t {
+        KtFonts *fonts;
+        FT_Face face;
+        KtShaper *shaper;
+        KtGlyphCache *glyphs;
+        KtViewport *viewport;
+        KtBidi *bidi;
+        KtLineCache *lines;
+        KtCaretCache *carets;
+        uint32_t width;
+        uint32_t scroll;
+        uint32_t lineHeight;
+        uint32_t fontHeight;
+        uint32_t ascender;
+        struct _fill_t {
+            bool_t isRunning;
+            uint32_t next;
+            uint32_t left;
+        } fill;
+        struct _select_t {
+            uint32_t anchor;
+            uint32_t focus;
+            uint32_t line;
+        } select;
+    } doc;
     struct _ui_t {
         Window *window;
         Menu *menu;
@@ -40,12 +89,16 @@ struct _app_t {
 
         MenuItem *miAbout;
 
-        TextView *textview;
+        View *view;
+        Layout *layout;
+        Progress *progress;
+        Button *btCancel;
     } ui;
 };
 
 /* -------------------------------------------------------------------------- */
 void createKaatibWindow(App*);
+void showKaatibProgress(App*, bool_t);
 
 /*----------------------------------------------------------------------------*/
 # endif /* __KAATIB_H__ */
@@ -9,7 +9,10 @@
 *******************************************************************************/
 #include "kaatib.h"
 #include "menus.h"
+#include "docview.h"
 #include "icons.h"
+#include <osbs/bthread.h>
+#include <stdlib.h>
 
 /* -------------------------------------------------------------------------- */
 static App *createApp(void) {
@@ -22,6 +25,17 @@ static App *createApp(void) {
 
     app->utx = utxCreateNew();
     app->isReadOnly = FALSE;
+    app->load.mutex = bmutex_create();
+    app->save.mutex = bmutex_create();
+    utx_start();
+
+    /* KAATIB_EDIT_TRACE names a file to record the session to, for replay.
+     * The view cannot be edited yet, so no text edits are recorded, only
+     * clicks, drags and menu commands. */
+    if (getenv("KAATIB_EDIT_TRACE") != NULL) {
+        app->trace = utxEditTraceCreate();
+        utxEditTraceStart(app->trace, app->utx);
+    }
 
     createKaatibMenubar(app);
     createKaatibWindow(app);
@@ -34,8 +48,56 @@ static App *createApp(void) {
 
 /* -------------------------------------------------------------------------- */
 static void destroyApp(App **app) {
+    /* a file may still be loading; stop the loader before tearing down */
+    bmutex_lock((*app)->load.mutex);
+    (*app)->load.cancel = TRUE;
+    bool_t isRunning = (*app)->load.isRunning;
+    bmutex_unlock((*app)->load.mutex);
+    while (isRunning) {
+        bthread_sleep(10);
+        bmutex_lock((*app)->load.mutex);
+        isRunning = (*app)->load.isRunning;
+        bmutex_unlock((*app)->load.mutex);
+    }
+    if ((*app)->load.utx != NULL) {
+        utxDestroy(&(*app)->load.utx);
+    }
+    if ((*app)->load.filePath != NULL) {
+        str_destroy(&(*app)->load.filePath);
+    }
+    bmutex_close(&(*app)->load.mutex);
+
+    /* KAATIB_TRACE names a file for the spans of a UTX_TRACE build */
+    if (getenv("KAATIB_TRACE") != NULL) {
+        uint32_t events = 0;
+        Result result = utxTraceWrite(getenv("KAATIB_TRACE"), &events);
+        log_printf("Trace: %u events [%d]", events, result);
+    }
+
+    /* let queued saves reach the disk, and the task waiting on them end */
+    utx_finish();
+    bmutex_lock((*app)->save.mutex);
+    isRunning = (*app)->save.isRunning;
+    bmutex_unlock((*app)->save.mutex);
+    while (isRunning) {
+        bthread_sleep(10);
+        bmutex_lock((*app)->save.mutex);
+        isRunning = (*app)->save.isRunning;
+        bmutex_unlock((*app)->save.mutex);
+    }
+    if ((*app)->save.filePath != NULL) {
+        str_destroy(&(*app)->save.filePath);
+    }
+    bmutex_close(&(*app)->save.mutex);
+
+    if ((*app)->trace != NULL) {
+        Result result = utxEditTraceWrite((*app)->trace, getenv("KAATIB_EDIT_TRACE"));
+        log_printf("Edit trace: %u events [%d]", utxEditTraceEvents((*app)->trace), result);
+        utxEditTraceDestroy(&(*app)->trace);
+    }
     utxDestroy(&(*app)->utx);
     window_destroy(&(*app)->ui.window);
+    destroyDocumentView(*app);
     menu_destroy(&(*app)->ui.menu);
     heap_delete(app, App);
 }
@@ -8,7 +8,9 @@
 * Author: roximn <roximn148@gmail.com>
 *******************************************************************************/
 #include "kaatib.h"
+#include "docview.h"
 #include "icons.h"
+#include <osbs/bthread.h>
 
 /* -------------------------------------------------------------------------- */
 static void onFileNew(App *app, Event *e) {
@@ -17,9 +19,101 @@ static void onFileNew(App *app, Event *e) {
     log_printf("onFileNew clicked");
 }
 
+/* -------------------------------------------------------------------------- */
+/* Runs on the loader thread: the new document is private to it until the
+ * task ends, only the progress counters and cancel flag are shared. */
+static bool_t onLoadProgress(App *app, const uint32_t loaded, const uint32_t total) {
+    bmutex_lock(app->load.mutex);
+    app->load.loaded = loaded;
+    app->load.total = total;
+    bool_t cancel = app->load.cancel;
+    bmutex_unlock(app->load.mutex);
+    return !cancel;
+}
+
+/* -------------------------------------------------------------------------- */
+static uint32_t onLoadMain(App *app) {
+    Result result = utxLoadContentsFromFile(
+        app->load.utx,
+        tc(app->load.filePath),
+        (FPtr_utxProgress)onLoadProgress,
+        app);
+    if (result == ROkay) {
+        utxSetFilePath(app->load.utx, tc(app->load.filePath));
+    }
+
+    bmutex_lock(app->load.mutex);
+    app->load.isRunning = FALSE;
+    bmutex_unlock(app->load.mutex);
+    return (uint32_t)result;
+}
+
+/* -------------------------------------------------------------------------- */
+static void onLoadUpdate(App *app) {
+    bmutex_lock(app->load.mutex);
+    uint32_t loaded = app->load.loaded;
+    uint32_t total = app->load.total;
+    bmutex_unlock(app->load.mutex);
+
+    if (total > 0) {
+        progress_value(app->ui.progress, (real32_t)loaded / (real32_t)total);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static void onLoadEnd(App *app, const uint32_t rvalue) {
+    Result result = (Result)rvalue;
+    if (result == ROkay) {
+        if (app->utx != NULL) {
+            utxDestroy(&app->utx);
+        }
+        app->utx = app->load.utx;
+        app->load.utx = NULL;
+        /* saves still queued are of the document just closed */
+        bmutex_lock(app->save.mutex);
+        app->save.utx = NULL;
+        bmutex_unlock(app->save.mutex);
+        if (app->trace != NULL) {
+            utxEditTraceStart(app->trace, app->utx);
+        }
+
+        resetDocumentView(app);
+        menuitem_enabled(app->ui.miUndo, FALSE);
+        menuitem_enabled(app->ui.miRedo, FALSE);
+        log_printf("Opened File: (%s)", tc(app->load.filePath));
+    } else {
+        utxDestroy(&app->load.utx);
+        log_printf("Failed to open file (%s) [%d]", tc(app->load.filePath), result);
+    }
+
+    str_destroy(&app->load.filePath);
+    app->load.isActive = FALSE;
+
+    showKaatibProgress(app, FALSE);
+    menuitem_enabled(app->ui.miOpen, TRUE);
+}
+
+/* -------------------------------------------------------------------------- */
+static void startFileLoad(App *app, const char_t *filePath) {
+    app->load.isActive = TRUE;
+    app->load.isRunning = TRUE;
+    app->load.cancel = FALSE;
+    app->load.loaded = 0;
+    app->load.total = 0;
+    app->load.filePath = str_c(filePath);
+    app->load.utx = utxCreateNew();
+
+    menuitem_enabled(app->ui.miOpen, FALSE);
+    showKaatibProgress(app, TRUE);
+    osapp_task(app, .1f, onLoadMain, onLoadUpdate, onLoadEnd, App);
+}
+
 /* -------------------------------------------------------------------------- */
 static void onFileOpen(App *app, Event *e) {
     unref(e);
+    if (app->load.isActive) {
+        return;
+    }
 
     String *homeDir = hfile_home_dir("");
     log_printf("Opening folder: (%s)", tc(homeDir));
@@ -30,27 +124,92 @@ static void onFileOpen(App *app, Event *e) {
         tc(homeDir));
     if (filePath != NULL) {
         log_printf("Selected File: (%s)", filePath);
-        UtxFile *utx = utxCreateFromFile(filePath);
-        if (utx != NULL) {
-            if (app->utx != NULL) {
-                utxDestroy(&app->utx);
-            }
-            app->utx = utx;
-            
-            textview_clear(app->ui.textview);
-            textview_writef(app->ui.textview, tc(utx->contents));
-        }
+        startFileLoad(app, filePath);
     } else {
         log_printf("No file selected");
     }
     str_destroy(&homeDir);
 }
 
+/* -------------------------------------------------------------------------- */
+/* Runs on the writer thread. */
+static void onSaveDone(App *app, const char_t *filePath, const Result result) {
+    bmutex_lock(app->save.mutex);
+    app->save.pending -= 1;
+    app->save.result = result;
+    str_upd(&app->save.filePath, filePath);
+    bmutex_unlock(app->save.mutex);
+
+    if (result == ROkay) {
+        log_printf("Saved File: (%s)", filePath);
+    } else {
+        log_printf("Failed to save file (%s) [%d]", filePath, result);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Runs on a task thread and only waits for the queued saves to be done. */
+static uint32_t onSaveMain(App *app) {
+    for (;;) {
+        bmutex_lock(app->save.mutex);
+        bool_t done = app->save.pending == 0;
+        if (done) {
+            app->save.isRunning = FALSE;
+        }
+        bmutex_unlock(app->save.mutex);
+        if (done) {
+            return 0;
+        }
+        bthread_sleep(10);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Back on the GUI thread: the last save queued was the last done, so its
+ * outcome stands for all of them. */
+static void onSaveEnd(App *app, const uint32_t rvalue) {
+    unref(rvalue);
+    bmutex_lock(app->save.mutex);
+    bool_t saved = app->save.pending == 0 && app->save.result == ROkay
+        && app->save.utx == app->utx && app->save.filePath != NULL;
+    uint32_t generation = app->save.generation;
+    String *filePath = saved ? str_copy(app->save.filePath) : NULL;
+    bmutex_unlock(app->save.mutex);
+
+    if (filePath != NULL) {
+        utxSaved(app->utx, generation, tc(filePath));
+        str_destroy(&filePath);
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 static void onFileSave(App *app, Event *e) {
-    unref(app);
     unref(e);
     log_printf("onFileSave clicked");
+    if (app->utx == NULL) {
+        return;
+    }
+
+    bmutex_lock(app->save.mutex);
+    app->save.pending += 1;
+    app->save.utx = app->utx;
+    app->save.generation = utxGeneration(app->utx);
+    bool_t start = !app->save.isRunning;
+    app->save.isRunning = TRUE;
+    bmutex_unlock(app->save.mutex);
+
+    Result result = utxWriteAsync(app->utx, NULL, (FPtr_utxSaved)onSaveDone, app);
+    if (result != ROkay) {
+        bmutex_lock(app->save.mutex);
+        app->save.pending -= 1;
+        app->save.result = result;
+        bmutex_unlock(app->save.mutex);
+        log_printf("Failed to start saving [%d]", result);
+    }
+
+    if (start) {
+        osapp_task(app, .1f, onSaveMain, NULL, onSaveEnd, App);
+    }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -136,18 +295,39 @@ static MenuItem *createFileMenu(App *app) {
     return miFile;
 }
 
+/* -------------------------------------------------------------------------- */
+static void updateEditMenu(App *app) {
+    menuitem_enabled(app->ui.miUndo, utxCanUndo(app->utx));
+    menuitem_enabled(app->ui.miRedo, utxCanRedo(app->utx));
+}
+
+/* -------------------------------------------------------------------------- */
+static void showDocument(App *app) {
+    resetDocumentView(app);
+}
+
 /* -------------------------------------------------------------------------- */
 static void onEditUndo(App *app, Event *e) {
-    unref(app);
     unref(e);
-    log_printf("onEditUndo clicked");
+    uint32_t offset = 0;
+    Result result = utxUndo(app->utx, &offset);
+    if (result == ROkay) {
+        showDocument(app);
+    }
+    updateEditMenu(app);
+    log_printf("onEditUndo clicked [%d], caret at %d", result, offset);
 }
 
 /* -------------------------------------------------------------------------- */
 static void onEditRedo(App *app, Event *e) {
-    unref(app);
     unref(e);
-    log_printf("onEditRedo clicked");
+    uint32_t offset = 0;
+    Result result = utxRedo(app->utx, &offset);
+    if (result == ROkay) {
+        showDocument(app);
+    }
+    updateEditMenu(app);
+    log_printf("onEditRedo clicked [%d], caret at %d", result, offset);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -181,7 +361,6 @@ static void onEditSelectAll(App *app, Event *e) {
 /* -------------------------------------------------------------------------- */
 static void onEditToggleReadOnly(App *app, Event *e) {
     app->isReadOnly = !app->isReadOnly;
-    textview_editable(app->ui.textview, !app->isReadOnly);
     menuitem_state(app->ui.miReadOnly, app->isReadOnly ? ekGUI_ON : ekGUI_OFF);
 
     unref(e);
@@ -214,6 +393,8 @@ static MenuItem *createEditMenu(App *app) {
         menuitem_OnClick(miRedo, listener(app, onEditRedo, App));
         menu_item(mnuEdit, miRedo);
         app->ui.miRedo = miRedo;
+        menuitem_enabled(miUndo, FALSE);
+        menuitem_enabled(miRedo, FALSE);
 
         menu_item(mnuEdit, menuitem_separator());
 
@@ -0,0 +1,166 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Replays an edit trace, recorded by kaatib with KAATIB_EDIT_TRACE set,
+ * against this build of utx and prints the latency of each kind of event as
+ * JSON: percentiles and a histogram in power of two microsecond buckets, to
+ * be compared between builds. Each round replays the whole trace into a new
+ * document; saves go to a temporary file.
+ *
+ * Usage: benchReplay trace [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <osbs/log.h>
+
+#include "utx.h"
+#include "edittrace.h"
+
+#define BUCKETS 24
+
+static const char_t *KIND_NAMES[] = {
+    "", "insert", "delete", "replace", "rewrite", "cursor", "undo", "redo",
+    "break", "save", "reset", "normalize", "group"
+};
+
+typedef struct _latency_t Latency;
+struct _latency_t {
+    uint64_t *samples;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t buckets[BUCKETS];
+};
+
+/*----------------------------------------------------------------------------*/
+static void onReplayed(Latency *latency, const UtxEditEvent *event, const uint64_t elapsed) {
+    Latency *kind = &latency[event->kind];
+    if (kind->count < kind->capacity) {
+        kind->samples[kind->count++] = elapsed;
+    }
+
+    uint32_t bucket = 0;
+    while (bucket + 1 < BUCKETS && ((uint64_t)1 << bucket) < elapsed) {
+        bucket += 1;
+    }
+    kind->buckets[bucket] += 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static int compareSamples(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t percentile(const Latency *kind, uint32_t percent) {
+    uint32_t rank = (kind->count * percent + 99) / 100;
+    return kind->samples[rank > 0 ? rank - 1 : 0];
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: benchReplay trace [rounds]\n");
+        return 1;
+    }
+    uint32_t rounds = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+    rounds = rounds > 0 ? rounds : 1;
+
+    utx_start();
+    /* utx logs every save; keep the output parseable */
+    log_output(FALSE, FALSE);
+
+    ferror_t error;
+    UtxEditTrace *trace = utxEditTraceOpen(argv[1], &error);
+    if (trace == NULL) {
+        fprintf(stderr, "benchReplay: cannot open trace %s [%d]\n", argv[1], error);
+        utx_finish();
+        return 1;
+    }
+
+    /* room for every sample of every kind */
+    Latency latency[EditGroup + 1];
+    memset(latency, 0, sizeof(latency));
+    UtxEditEvent event;
+    uint32_t position = 0;
+    while (utxEditTraceNext(trace, &position, &event)) {
+        latency[event.kind].capacity += rounds;
+    }
+    for (uint32_t k = EditInsert; k <= EditGroup; ++k) {
+        if (latency[k].capacity > 0) {
+            latency[k].samples = heap_new_n(latency[k].capacity, uint64_t);
+        }
+    }
+
+    String *savePath = hfile_tmp_path("benchReplay.txt");
+    Result result = ROkay;
+    for (uint32_t r = 0; r < rounds && result == ROkay; ++r) {
+        UtxFile *utx = utxCreateNew();
+        result = utxEditTraceReplay(trace, utx, tc(savePath), (FPtr_utxReplayed)onReplayed, latency);
+        utxDestroy(&utx);
+    }
+    if (result != ROkay) {
+        fprintf(stderr, "benchReplay: replay stopped [%d]; the trace does not match this build\n", result);
+    }
+
+    printf("{\"trace\": \"%s\", \"events\": %u, \"rounds\": %u, \"complete\": %s, \"kinds\": [",
+        argv[1], utxEditTraceEvents(trace), rounds, result == ROkay ? "true" : "false");
+    bool_t first = TRUE;
+    for (uint32_t k = EditInsert; k <= EditGroup; ++k) {
+        Latency *kind = &latency[k];
+        if (kind->count == 0) {
+            continue;
+        }
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < kind->count; ++i) {
+            total += kind->samples[i];
+        }
+        qsort(kind->samples, kind->count, sizeof(uint64_t), compareSamples);
+
+        printf("%s\n    {\"kind\": \"%s\", \"count\": %u, \"total_us\": %llu, \"p50_us\": %llu, "
+            "\"p90_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu, \"histogram\": [",
+            first ? "" : ",", KIND_NAMES[k], kind->count, (unsigned long long)total,
+            (unsigned long long)percentile(kind, 50), (unsigned long long)percentile(kind, 90),
+            (unsigned long long)percentile(kind, 99), (unsigned long long)kind->samples[kind->count - 1]);
+
+        /* [upper bound in microseconds, events], empty buckets left out */
+        bool_t firstBucket = TRUE;
+        for (uint32_t b = 0; b < BUCKETS; ++b) {
+            if (kind->buckets[b] > 0) {
+                printf("%s[%llu, %u]", firstBucket ? "" : ", ", (unsigned long long)1 << b, kind->buckets[b]);
+                firstBucket = FALSE;
+            }
+        }
+        printf("]}");
+        first = FALSE;
+    }
+    printf("\n]}\n");
+
+    for (uint32_t k = EditInsert; k <= EditGroup; ++k) {
+        if (latency[k].samples != NULL) {
+            heap_delete_n(&latency[k].samples, latency[k].capacity, uint64_t);
+        }
+    }
+    bfile_delete(tc(savePath), NULL);
+    str_destroy(&savePath);
+    utxEditTraceDestroy(&trace);
+    utx_finish();
+    return result == ROkay ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,86 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * UTF-8 scan throughput, in MB/s, for each SIMD level available on this
+ * machine, over mixed Urdu text with an occasional ASCII line.
+ *
+ * Usage: benchUtf8 [megabytes] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/heap.h>
+#include <osbs/btime.h>
+
+#include "utf8.h"
+
+static const char_t *SIMD_NAMES[] = { "scalar", "sse2", "avx2" };
+
+/*----------------------------------------------------------------------------*/
+static uint32_t createText(char_t *text, uint32_t size) {
+    /* "اردو زبان " and an ASCII line */
+    static const char_t WORD[] = "\xD8\xA7\xD8\xB1\xD8\xAF\xD9\x88 \xD8\xB2\xD8\xA8\xD8\xA7\xD9\x86 ";
+    static const char_t LINE[] = "kaatib 0123456789\n";
+    uint32_t n = 0;
+    uint32_t words = 0;
+    for (;;) {
+        const char_t *token = ++words % 8 == 0 ? LINE : WORD;
+        uint32_t len = (uint32_t)strlen(token);
+        if (n + len > size) {
+            break;
+        }
+        memcpy(text + n, token, len);
+        n += len;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char *argv[]) {
+    uint32_t megabytes = argc > 1 ? (uint32_t)atoi(argv[1]) : 256;
+    uint32_t rounds = argc > 2 ? (uint32_t)atoi(argv[2]) : 5;
+    uint32_t capacity = megabytes * 1024 * 1024;
+
+    char_t *text = heap_new_n(capacity, char_t);
+    uint32_t size = createText(text, capacity);
+    UtxSimd best = utxUtf8SetSimd(SimdAuto);
+    double scalar = 0;
+
+    printf("benchUtf8: %u bytes, %u rounds\n", size, rounds);
+    for (int32_t simd = SimdScalar; simd <= (int32_t)best; ++simd) {
+        utxUtf8SetSimd((UtxSimd)simd);
+        uint64_t fastest = UINT64_MAX;
+        uint32_t lines = 0;
+        uint32_t chars = 0;
+        bool_t valid = TRUE;
+
+        for (uint32_t r = 0; r < rounds; ++r) {
+            UtxUtf8 state;
+            utxUtf8Init(&state);
+            uint64_t start = btime_now();
+            valid = utxUtf8Scan(&state, text, size, &lines, &chars) && utxUtf8Complete(&state);
+            uint64_t elapsed = btime_now() - start;
+            fastest = elapsed < fastest ? elapsed : fastest;
+        }
+
+        double mbs = (double)size / (double)(fastest > 0 ? fastest : 1);
+        if (simd == SimdScalar) {
+            scalar = mbs;
+        }
+        printf("%-8s %10.1f MB/s %6.2fx  valid=%d lines=%u chars=%u\n",
+            SIMD_NAMES[simd], mbs, mbs / scalar, valid, lines, chars);
+    }
+
+    heap_delete_n(&text, capacity, char_t);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,526 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Timings of the utx file operations, and of kaata's shaper, over a generated
+ * corpus of Urdu text with Latin words, numbers and harakat mixed in. The
+ * corpus comes from the seeded bmath_randi, as generateUuid in test_utx.c
+ * does, so a seed and a size always give the same bytes.
+ *
+ * For each size it times set-contents, save, open (mapped and loaded), edits,
+ * search and, when there is a font, shaping with a cold and a warm cache. One
+ * record is printed per size and operation, as JSON or CSV, with throughput,
+ * latency percentiles per operation and the peak RSS of the process so far.
+ *
+ * Usage: benchUtx [-s sizes] [-r rounds] [-e seed] [-f json|csv] [-t font] [-o file]
+ *   sizes  comma separated with a K, M or G suffix, 1K to 1G (1K,64K,1M,16M)
+ *   font   a TrueType font path; KAATIB_TEST_FONT if not given, else no shaping
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <osbs/btime.h>
+#include <osbs/log.h>
+#include <sewer/bmath.h>
+
+#include "utx.h"
+#include "search.h"
+#include "shapecache.h"
+#include "shaper.h"
+
+#define MAX_SIZES 16
+#define MAX_SAMPLES 1024
+#define EDIT_BATCH 64
+#define SHAPE_LIMIT (1024 * 1024)
+#define SHAPE_PPEM 16
+
+/*----------------------------------------------------------------------------*/
+static const char_t *URDU_WORDS[] = {
+    "\xD8\xA7\xD9\x88\xD8\xB1",                                 /* اور */
+    "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8",                         /* کتاب */
+    "\xD9\xBE\xD8\xA7\xDA\xA9\xD8\xB3\xD8\xAA\xD8\xA7\xD9\x86", /* پاکستان */
+    "\xD8\xB2\xD8\xA8\xD8\xA7\xD9\x86",                         /* زبان */
+    "\xD8\xA7\xD8\xB1\xD8\xAF\xD9\x88",                         /* اردو */
+    "\xD9\x85\xDB\x8C\xDA\xBA",                                 /* میں */
+    "\xDB\x81\xDB\x92",                                         /* ہے */
+    "\xDA\xA9\xDB\x92",                                         /* کے */
+    "\xDA\xA9\xDB\x8C",                                         /* کی */
+    "\xD8\xB3\xDB\x92",                                         /* سے */
+    "\xDB\x8C\xDB\x81",                                         /* یہ */
+    "\xD8\xA7\xDB\x8C\xDA\xA9",                                 /* ایک */
+    "\xD9\x84\xDA\xA9\xDA\xBE\xD9\x86\xD8\xA7",                 /* لکھنا */
+    "\xD8\xAF\xD9\x86\xDB\x8C\xD8\xA7",                         /* دنیا */
+    "\xD8\xB4\xDB\x81\xD8\xB1",                                 /* شہر */
+    "\xD8\xAE\xD9\x88\xD8\xA8\xD8\xB5\xD9\x88\xD8\xB1\xD8\xAA", /* خوبصورت */
+    "\xDA\xAF\xDA\xBE\xD8\xB1",                                 /* گھر */
+    "\xD9\x88\xD9\x82\xD8\xAA",                                 /* وقت */
+    "\xDB\x81\xD9\x85",                                         /* ہم */
+    "\xD8\xA2\xD9\xBE",                                         /* آپ */
+};
+
+static const char_t *LATIN_WORDS[] = { "kaatib", "Unicode", "text", "editor", "Lahore", "font" };
+
+/* zabar, zer, pesh */
+static const char_t *HARAKAT[] = { "\xD9\x8E", "\xD9\x90", "\xD9\x8F" };
+
+/* "۔", "،", "؟" */
+static const char_t *PUNCTUATION[] = { "\xDB\x94", "\xD8\x8C", "\xD8\x9F" };
+
+/* "کتاب", searched for in every size */
+static const char_t SEARCH_WORD[] = "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8";
+
+#define COUNT(a) (uint32_t)(sizeof(a) / sizeof((a)[0]))
+
+typedef struct _bench_t Bench;
+struct _bench_t {
+    uint32_t sizes[MAX_SIZES];
+    uint32_t sizeCount;
+    uint32_t rounds;
+    uint32_t seed;
+    bool_t csv;
+    const char_t *font;
+    FILE *out;
+    uint32_t records;
+};
+
+typedef struct _timing_t Timing;
+struct _timing_t {
+    uint64_t samples[MAX_SAMPLES];
+    uint32_t count;
+    /* operations in each sample, and the bytes they cover in all */
+    uint32_t ops;
+    uint64_t bytes;
+};
+
+/*----------------------------------------------------------------------------*/
+static void i_put(char_t *text, uint32_t *n, const char_t *token) {
+    uint32_t len = (uint32_t)strlen(token);
+    memcpy(text + *n, token, len);
+    *n += len;
+}
+
+/*----------------------------------------------------------------------------*/
+/* A word is at most 16 bytes, plus a haraka, a number and punctuation. */
+#define MAX_TOKEN 48
+
+static uint32_t createCorpus(char_t *text, uint32_t size, uint32_t seed) {
+    uint32_t n = 0;
+    uint32_t left = 0;
+
+    bmath_rand_seed(seed);
+    while (n + MAX_TOKEN < size) {
+        if (left == 0) {
+            left = (uint32_t)bmath_randi(5, 120);
+        }
+
+        int32_t kind = bmath_randi(0, 99);
+        if (kind < 80) {
+            const char_t *word = URDU_WORDS[bmath_randi(0, COUNT(URDU_WORDS) - 1)];
+            if (bmath_randi(0, 9) == 0) {
+                /* a haraka after the first letter, all of which take 2 bytes */
+                memcpy(text + n, word, 2);
+                n += 2;
+                i_put(text, &n, HARAKAT[bmath_randi(0, COUNT(HARAKAT) - 1)]);
+                i_put(text, &n, word + 2);
+            }
+            else {
+                i_put(text, &n, word);
+            }
+        }
+        else if (kind < 90) {
+            i_put(text, &n, LATIN_WORDS[bmath_randi(0, COUNT(LATIN_WORDS) - 1)]);
+        }
+        else {
+            /* a number, in ASCII or Urdu digits */
+            int32_t digits = bmath_randi(1, 6);
+            bool_t urdu = bmath_randi(0, 1) == 1;
+            for (int32_t i = 0; i < digits; ++i) {
+                int32_t d = bmath_randi(0, 9);
+                if (urdu) {
+                    text[n++] = (char_t)0xDB;
+                    text[n++] = (char_t)(0xB0 + d);
+                }
+                else {
+                    text[n++] = (char_t)('0' + d);
+                }
+            }
+        }
+
+        if (--left == 0) {
+            i_put(text, &n, PUNCTUATION[0]);
+            text[n++] = '\n';
+        }
+        else if (bmath_randi(0, 11) == 0) {
+            i_put(text, &n, PUNCTUATION[bmath_randi(0, COUNT(PUNCTUATION) - 1)]);
+            text[n++] = ' ';
+        }
+        else {
+            text[n++] = ' ';
+        }
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* In KB. */
+static uint64_t i_peak_rss(void) {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (uint64_t)counters.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss / 1024;
+#else
+    return (uint64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+static int i_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Nearest rank, in microseconds per operation. */
+static double i_percentile(const Timing *timing, uint32_t percent) {
+    uint32_t rank = (timing->count * percent + 99) / 100;
+    rank = rank > 0 ? rank - 1 : 0;
+    return (double)timing->samples[rank] / (double)timing->ops;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_begin(Timing *timing, uint32_t ops) {
+    timing->count = 0;
+    timing->ops = ops > 0 ? ops : 1;
+    timing->bytes = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_sample(Timing *timing, uint64_t start, uint64_t bytes) {
+    if (timing->count < MAX_SAMPLES) {
+        timing->samples[timing->count++] = btime_now() - start;
+        timing->bytes += bytes;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_report(Bench *bench, uint32_t size, const char_t *op, Timing *timing) {
+    if (timing->count == 0) {
+        return;
+    }
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < timing->count; ++i) {
+        total += timing->samples[i];
+    }
+    qsort(timing->samples, timing->count, sizeof(uint64_t), i_compare);
+
+    /* bytes per microsecond is MB/s */
+    double mbs = (double)timing->bytes / (double)(total > 0 ? total : 1);
+    double p50 = i_percentile(timing, 50);
+    double p90 = i_percentile(timing, 90);
+    double p99 = i_percentile(timing, 99);
+    double max = (double)timing->samples[timing->count - 1] / (double)timing->ops;
+    uint64_t rss = i_peak_rss();
+
+    if (bench->csv) {
+        fprintf(bench->out, "%u,%s,%u,%u,%llu,%.2f,%.3f,%.3f,%.3f,%.3f,%llu\n",
+            size, op, timing->count, timing->ops, (unsigned long long)timing->bytes,
+            mbs, p50, p90, p99, max, (unsigned long long)rss);
+    }
+    else {
+        fprintf(bench->out, "%s\n    {\"size\": %u, \"op\": \"%s\", \"samples\": %u, \"ops_per_sample\": %u, "
+            "\"bytes\": %llu, \"mb_per_s\": %.2f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+            "\"p99_us\": %.3f, \"max_us\": %.3f, \"peak_rss_kb\": %llu}",
+            bench->records > 0 ? "," : "", size, op, timing->count, timing->ops,
+            (unsigned long long)timing->bytes, mbs, p50, p90, p99, max, (unsigned long long)rss);
+    }
+    bench->records += 1;
+    fflush(bench->out);
+}
+
+/*----------------------------------------------------------------------------*/
+static void benchFile(Bench *bench, Timing *timing, uint32_t size, const String *contents, const char_t *path) {
+    uint32_t length = str_len(contents);
+    UtxFile *utx = utxCreateNew();
+
+    i_begin(timing, 1);
+    for (uint32_t r = 0; r < bench->rounds; ++r) {
+        uint64_t start = btime_now();
+        utxSetContents(utx, contents);
+        i_sample(timing, start, length);
+    }
+    i_report(bench, size, "set-contents", timing);
+
+    i_begin(timing, 1);
+    for (uint32_t r = 0; r < bench->rounds; ++r) {
+        uint64_t start = btime_now();
+        utxWriteContentsToFile(utx, path);
+        i_sample(timing, start, length);
+    }
+    i_report(bench, size, "save", timing);
+
+    i_begin(timing, 1);
+    for (uint32_t r = 0; r < bench->rounds; ++r) {
+        uint64_t start = btime_now();
+        UtxFile *opened = utxCreateFromFile(path);
+        i_sample(timing, start, length);
+        utxDestroy(&opened);
+    }
+    i_report(bench, size, "open-mapped", timing);
+
+    i_begin(timing, 1);
+    for (uint32_t r = 0; r < bench->rounds; ++r) {
+        UtxFile *loaded = utxCreateNew();
+        uint64_t start = btime_now();
+        utxLoadContentsFromFile(loaded, path, NULL, NULL);
+        i_sample(timing, start, length);
+        utxDestroy(&loaded);
+    }
+    i_report(bench, size, "open-loaded", timing);
+
+    /* each insert is taken out again, so the length holds */
+    i_begin(timing, EDIT_BATCH);
+    for (uint32_t r = 0; r < bench->rounds; ++r) {
+        uint64_t start = btime_now();
+        uint64_t bytes = 0;
+        for (uint32_t e = 0; e < EDIT_BATCH; e += 2) {
+            const char_t *word = URDU_WORDS[bmath_randi(0, COUNT(URDU_WORDS) - 1)];
+            uint32_t len = (uint32_t)strlen(word);
+            uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length);
+            while (utxInsert(utx, offset, word, len) == RInvalidRange && offset < length) {
+                offset += 1;
+            }
+            utxDelete(utx, offset, len);
+            bytes += 2 * len;
+        }
+        i_sample(timing, start, bytes);
+    }
+    i_report(bench, size, "edit", timing);
+
+    UtxSearch *exact = utxSearchCreate(SEARCH_WORD, (uint32_t)strlen(SEARCH_WORD), SearchExact);
+    UtxSearch *loose = utxSearchCreate(SEARCH_WORD, (uint32_t)strlen(SEARCH_WORD), SearchNoHarakat);
+    for (uint32_t s = 0; s < 2; ++s) {
+        i_begin(timing, 1);
+        for (uint32_t r = 0; r < bench->rounds; ++r) {
+            uint32_t from = 0, offset = 0, found = 0;
+            uint64_t start = btime_now();
+            while (utxFind(utx, s == 0 ? exact : loose, from, &offset, &found) == ROkay) {
+                from = offset + found;
+            }
+            i_sample(timing, start, length);
+        }
+        i_report(bench, size, s == 0 ? "search" : "search-harakat", timing);
+    }
+    utxSearchDestroy(&exact);
+    utxSearchDestroy(&loose);
+
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraph by paragraph over at most SHAPE_LIMIT bytes of the corpus. */
+static void benchShape(Bench *bench, Timing *timing, uint32_t size, const char_t *text, uint32_t length, FT_Face face) {
+    KtShaper *shaper = ktShaperCreate(SHAPE_CACHE_SIZE);
+    uint32_t limit = length < SHAPE_LIMIT ? length : SHAPE_LIMIT;
+    uint32_t paragraphs = 0;
+    for (uint32_t i = 0; i < limit; ++i) {
+        paragraphs += text[i] == '\n' ? 1 : 0;
+    }
+
+    for (uint32_t warm = 0; warm < 2; ++warm) {
+        i_begin(timing, paragraphs);
+        for (uint32_t r = 0; r < bench->rounds; ++r) {
+            if (warm == 0) {
+                ktShapeCacheClear(ktShaperCache(shaper));
+            }
+
+            uint32_t begin = 0, shaped = 0;
+            uint64_t start = btime_now();
+            for (uint32_t i = 0; i < limit; ++i) {
+                if (text[i] == '\n') {
+                    ktShape(shaper, face, SHAPE_PPEM, KDirRtl, text + begin, i - begin);
+                    shaped += i - begin;
+                    begin = i + 1;
+                }
+            }
+            i_sample(timing, start, shaped);
+        }
+        i_report(bench, size, warm == 0 ? "shape" : "shape-cached", timing);
+    }
+
+    ktShaperDestroy(&shaper);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_parse_sizes(Bench *bench, const char_t *arg) {
+    bench->sizeCount = 0;
+    while (*arg != '\0') {
+        char_t *end = NULL;
+        uint64_t value = strtoull(arg, &end, 10);
+        switch (*end) {
+        case 'G': case 'g': value <<= 30; ++end; break;
+        case 'M': case 'm': value <<= 20; ++end; break;
+        case 'K': case 'k': value <<= 10; ++end; break;
+        default: break;
+        }
+        if (end == arg || value < 1024 || value > (1u << 30) || bench->sizeCount == MAX_SIZES) {
+            return FALSE;
+        }
+        bench->sizes[bench->sizeCount++] = (uint32_t)value;
+        arg = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return FALSE;
+        }
+    }
+    return bench->sizeCount > 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_parse(Bench *bench, int argc, char *argv[]) {
+    const char_t *out = NULL;
+
+    i_parse_sizes(bench, "1K,64K,1M,16M");
+    bench->rounds = 5;
+    bench->seed = 1;
+    bench->csv = FALSE;
+    bench->font = getenv("KAATIB_TEST_FONT");
+    bench->out = stdout;
+    bench->records = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char_t *arg = argv[i];
+        const char_t *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-' || value == NULL) {
+            return FALSE;
+        }
+        switch (arg[1]) {
+        case 's':
+            if (!i_parse_sizes(bench, value)) {
+                return FALSE;
+            }
+            break;
+        case 'r': bench->rounds = (uint32_t)atoi(value); break;
+        case 'e': bench->seed = (uint32_t)strtoul(value, NULL, 10); break;
+        case 'f': bench->csv = strcmp(value, "csv") == 0; break;
+        case 't': bench->font = value; break;
+        case 'o': out = value; break;
+        default: return FALSE;
+        }
+        ++i;
+    }
+
+    bench->rounds = bench->rounds < 1 ? 1 : (bench->rounds > MAX_SAMPLES ? MAX_SAMPLES : bench->rounds);
+    if (out != NULL) {
+        bench->out = fopen(out, "w");
+        if (bench->out == NULL) {
+            fprintf(stderr, "benchUtx: cannot write %s\n", out);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char *argv[]) {
+    Bench bench;
+    if (!i_parse(&bench, argc, argv)) {
+        fprintf(stderr, "Usage: benchUtx [-s sizes] [-r rounds] [-e seed] [-f json|csv] [-t font] [-o file]\n");
+        return 1;
+    }
+
+    utx_start();
+    if (bench.out == stdout) {
+        /* utx logs every save and load; keep the records parseable */
+        log_output(FALSE, FALSE);
+    }
+
+    FT_Library library = NULL;
+    FT_Face face = NULL;
+    if (bench.font != NULL) {
+        if (FT_Init_FreeType(&library) != 0 || FT_New_Face(library, bench.font, 0, &face) != 0) {
+            fprintf(stderr, "benchUtx: cannot open font %s, no shaping\n", bench.font);
+            face = NULL;
+        }
+        else {
+            FT_Set_Pixel_Sizes(face, 0, SHAPE_PPEM);
+        }
+    }
+
+    Timing *timing = heap_new(Timing);
+    String *path = hfile_tmp_path("benchUtx.txt");
+
+    if (bench.csv) {
+        fprintf(bench.out, "size,op,samples,ops_per_sample,bytes,mb_per_s,p50_us,p90_us,p99_us,max_us,peak_rss_kb\n");
+    }
+    else {
+        fprintf(bench.out, "{\"seed\": %u, \"rounds\": %u, \"shaping\": %s, \"results\": [",
+            bench.seed, bench.rounds, face != NULL ? "true" : "false");
+    }
+
+    for (uint32_t s = 0; s < bench.sizeCount; ++s) {
+        uint32_t capacity = bench.sizes[s];
+        char_t *text = heap_new_n(capacity, char_t);
+        uint32_t length = createCorpus(text, capacity, bench.seed);
+        String *contents = str_cn(text, length);
+
+        fprintf(stderr, "benchUtx: %u bytes, seed %u\n", length, bench.seed);
+        benchFile(&bench, timing, capacity, contents, tc(path));
+        if (face != NULL) {
+            benchShape(&bench, timing, capacity, text, length, face);
+        }
+
+        str_destroy(&contents);
+        heap_delete_n(&text, capacity, char_t);
+    }
+
+    if (!bench.csv) {
+        fprintf(bench.out, "\n]}\n");
+    }
+    if (bench.out != stdout) {
+        fclose(bench.out);
+    }
+
+    bfile_delete(tc(path), NULL);
+    str_destroy(&path);
+    heap_delete(&timing, Timing);
+    if (face != NULL) {
+        FT_Done_Face(face);
+    }
+    if (library != NULL) {
+        FT_Done_FreeType(library);
+    }
+    utx_finish();
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,331 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "buffer.h"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertBufferEquals(const UtxBuffer *buffer, const char_t *expected, uint32_t size) {
+    TEST_ASSERT_EQUAL(size, utxBufferLength(buffer));
+    String *text = utxBufferString(buffer, 0, size);
+    TEST_ASSERT_EQUAL(0, memcmp(tc(text), expected, size));
+    str_destroy(&text);
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _read_t ReadCtx;
+struct _read_t {
+    char_t *dest;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t readChunk(ReadCtx *ctx, const char_t *chunk, const uint32_t size) {
+    memcpy(ctx->dest + ctx->size, chunk, size);
+    ctx->size += size;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_Empty(void) {
+    UtxBuffer *buffer = utxBufferCreate();
+    TEST_ASSERT_EQUAL(0, utxBufferLength(buffer));
+    TEST_ASSERT_EQUAL(0, utxBufferPieces(buffer));
+    TEST_ASSERT_EQUAL(ROkay, utxBufferDelete(buffer, 0, 0));
+    TEST_ASSERT_EQUAL(RInvalidRange, utxBufferDelete(buffer, 0, 1));
+    TEST_ASSERT_NULL(utxBufferChunk(buffer, 0, NULL));
+    utxBufferDestroy(&buffer);
+    TEST_ASSERT_NULL(buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_TypingExtendsPiece(void) {
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, "0123456789", 10);
+    TEST_ASSERT_EQUAL(1, utxBufferPieces(buffer));
+
+    const char_t word[] = "typing";
+    for (uint32_t i = 0; i < 6; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxBufferInsert(buffer, 5 + i, word + i, 1));
+    }
+
+    /* split original + one growing piece for the typed text */
+    TEST_ASSERT_EQUAL(3, utxBufferPieces(buffer));
+    assertBufferEquals(buffer, "01234typing56789", 16);
+    utxBufferDestroy(&buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_LargeText(void) {
+    const uint32_t SIZE = 1000000;
+    char_t *text = heap_new_n(SIZE, char_t);
+    for (uint32_t i = 0; i < SIZE; ++i) {
+        text[i] = (char_t)('a' + i % 26);
+    }
+
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, text, SIZE);
+    TEST_ASSERT_EQUAL(SIZE, utxBufferLength(buffer));
+    TEST_ASSERT_GREATER_THAN_UINT32(1, utxBufferPieces(buffer));
+
+    uint32_t size = 0;
+    const char_t *chunk = utxBufferChunk(buffer, SIZE - 1, &size);
+    TEST_ASSERT_EQUAL(1, size);
+    TEST_ASSERT_EQUAL(text[SIZE - 1], chunk[0]);
+
+    TEST_ASSERT_EQUAL(ROkay, utxBufferDelete(buffer, 100, SIZE - 200));
+    TEST_ASSERT_EQUAL(200, utxBufferLength(buffer));
+
+    char_t dest[200];
+    TEST_ASSERT_EQUAL(200, utxBufferRead(buffer, 0, dest, 200));
+    TEST_ASSERT_EQUAL(0, memcmp(dest, text, 100));
+    TEST_ASSERT_EQUAL(0, memcmp(dest + 100, text + SIZE - 100, 100));
+
+    utxBufferDestroy(&buffer);
+    heap_delete_n(&text, SIZE, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_RandomEdits(void) {
+    const uint32_t CAPACITY = 65536;
+    char_t *model = heap_new_n(CAPACITY, char_t);
+    uint32_t size = 0;
+
+    UtxBuffer *buffer = utxBufferCreate();
+    bmath_rand_seed(148);
+
+    for (uint32_t i = 0; i < 5000; ++i) {
+        uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)size);
+        uint32_t count = (uint32_t)bmath_randi(0, (int32_t)(size - offset < 16 ? size - offset : 16));
+        char_t text[8];
+        uint32_t n = (uint32_t)bmath_randi(0, 7);
+        if (size - count + n >= CAPACITY) {
+            n = 0;
+        }
+        for (uint32_t j = 0; j < n; ++j) {
+            text[j] = (char_t)bmath_randi('a', 'z');
+        }
+
+        TEST_ASSERT_EQUAL(ROkay, utxBufferReplace(buffer, offset, count, text, n));
+        memmove(model + offset + n, model + offset + count, size - offset - count);
+        memcpy(model + offset, text, n);
+        size = size - count + n;
+    }
+
+    assertBufferEquals(buffer, model, size);
+    utxBufferDestroy(&buffer);
+    heap_delete_n(&model, CAPACITY, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t modelBoundary(const char_t *model, uint32_t offset) {
+    while (offset > 0 && ((byte_t)model[offset] & 0xC0) == 0x80) {
+        offset -= 1;
+    }
+    return offset;
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertLineIndex(const UtxBuffer *buffer, const char_t *model, uint32_t size) {
+    uint32_t lines = 0;
+    uint32_t chars = 0;
+    uint32_t lineStart = 0;
+
+    for (uint32_t i = 0; i <= size; ++i) {
+        if (i == size || ((byte_t)model[i] & 0xC0) != 0x80) {
+            TEST_ASSERT_EQUAL(lines, utxBufferLineOf(buffer, i));
+            TEST_ASSERT_EQUAL(chars, utxBufferOffsetToChar(buffer, i));
+            TEST_ASSERT_EQUAL(i, utxBufferCharToOffset(buffer, chars));
+            TEST_ASSERT_EQUAL(lineStart, utxBufferLineStart(buffer, lines));
+        }
+        if (i < size) {
+            chars += ((byte_t)model[i] & 0xC0) != 0x80;
+            if (model[i] == '\n') {
+                lines += 1;
+                lineStart = i + 1;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(lines + 1, utxBufferLines(buffer));
+    TEST_ASSERT_EQUAL(chars, utxBufferChars(buffer));
+    TEST_ASSERT_EQUAL(size, utxBufferLineStart(buffer, lines + 1));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_LineIndex(void) {
+    /* "ل", "\n", "a", "ہے" */
+    static const char_t *TOKENS[] = { "\xD9\x84", "\n", "a", "\xDB\x81\xDB\x92" };
+    const uint32_t CAPACITY = 16384;
+    char_t *model = heap_new_n(CAPACITY, char_t);
+    uint32_t size = 0;
+
+    UtxBuffer *buffer = utxBufferCreate();
+    bmath_rand_seed(5);
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t offset = modelBoundary(model, (uint32_t)bmath_randi(0, (int32_t)size));
+        uint32_t end = modelBoundary(model, offset + (uint32_t)bmath_randi(0, (int32_t)(size - offset < 6 ? size - offset : 6)));
+        const char_t *text = TOKENS[bmath_randi(0, 3)];
+        uint32_t n = (uint32_t)strlen(text);
+        if (size + n >= CAPACITY || bmath_randi(0, 2) == 0) {
+            n = 0;
+        }
+
+        TEST_ASSERT_EQUAL(ROkay, utxBufferReplace(buffer, offset, end - offset, text, n));
+        memmove(model + offset + n, model + end, size - end);
+        memcpy(model + offset, text, n);
+        size = size - (end - offset) + n;
+
+        if (i % 250 == 0) {
+            assertLineIndex(buffer, model, size);
+        }
+    }
+
+    assertBufferEquals(buffer, model, size);
+    assertLineIndex(buffer, model, size);
+    utxBufferDestroy(&buffer);
+    heap_delete_n(&model, CAPACITY, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_Snapshot(void) {
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, "0123456789", 10);
+    TEST_ASSERT_EQUAL(ROkay, utxBufferInsert(buffer, 5, "abc", 3));
+
+    /* the snapshot outlives edits, a reset and the buffer itself */
+    UtxSnapshot *snapshot = utxBufferSnapshot(buffer);
+    TEST_ASSERT_EQUAL(13, utxSnapshotLength(snapshot));
+    TEST_ASSERT_EQUAL(ROkay, utxBufferDelete(buffer, 0, 8));
+    utxBufferSetText(buffer, "new", 3);
+    utxBufferDestroy(&buffer);
+
+    char_t dest[16];
+    ReadCtx ctx = { dest, 0 };
+    TEST_ASSERT_TRUE(utxSnapshotForEach(snapshot, (FPtr_utxChunk)readChunk, &ctx));
+    TEST_ASSERT_EQUAL(13, ctx.size);
+    TEST_ASSERT_EQUAL(0, memcmp(dest, "01234abc56789", 13));
+    utxSnapshotDestroy(&snapshot);
+    TEST_ASSERT_NULL(snapshot);
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _edited_t Edited;
+struct _edited_t {
+    uint32_t calls;
+    uint32_t offset;
+    uint32_t removed;
+    uint32_t inserted;
+};
+
+/*----------------------------------------------------------------------------*/
+static void onEdited(Edited *edited, const uint32_t offset, const uint32_t removed, const uint32_t inserted) {
+    edited->calls += 1;
+    edited->offset = offset;
+    edited->removed = removed;
+    edited->inserted = inserted;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_ReplaceRanges(void) {
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, "a\nbb\na\nbb\xD9\x84", 11);
+    Edited edited;
+    memset(&edited, 0, sizeof(edited));
+    TEST_ASSERT_TRUE(utxBufferAddObserver(buffer, (FPtr_utxEdited)onEdited, &edited));
+
+    /* out of order, overlapping or inside a code point, nothing changes */
+    UtxRange bad[] = { { 2, 2 }, { 3, 2 } };
+    TEST_ASSERT_EQUAL(RInvalidRange, utxBufferReplaceRanges(buffer, bad, 2, "x", 1));
+    bad[1].offset = 10;
+    bad[1].size = 0;
+    TEST_ASSERT_EQUAL(RInvalidRange, utxBufferReplaceRanges(buffer, bad, 2, "x", 1));
+    TEST_ASSERT_EQUAL(0, edited.calls);
+
+    /* "bb" twice, as two lines */
+    UtxRange ranges[] = { { 2, 2 }, { 7, 2 } };
+    TEST_ASSERT_EQUAL(ROkay, utxBufferReplaceRanges(buffer, ranges, 2, "\xD9\x84\n", 3));
+    assertBufferEquals(buffer, "a\n\xD9\x84\n\na\n\xD9\x84\n\xD9\x84", 13);
+    TEST_ASSERT_EQUAL(6, utxBufferLines(buffer));
+    TEST_ASSERT_EQUAL(10, utxBufferChars(buffer));
+    TEST_ASSERT_EQUAL(1, edited.calls);
+    TEST_ASSERT_EQUAL(2, edited.offset);
+    TEST_ASSERT_EQUAL(7, edited.removed);
+    TEST_ASSERT_EQUAL(9, edited.inserted);
+
+    /* removed outright */
+    UtxRange lines[] = { { 0, 2 }, { 5, 1 }, { 6, 2 } };
+    TEST_ASSERT_EQUAL(ROkay, utxBufferReplaceRanges(buffer, lines, 3, NULL, 0));
+    assertBufferEquals(buffer, "\xD9\x84\n\xD9\x84\n\xD9\x84", 8);
+    TEST_ASSERT_EQUAL(2, edited.calls);
+    utxBufferDestroy(&buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxBuffer_Swap(void) {
+    UtxBuffer *buffer = utxBufferCreate();
+    UtxBuffer *spare = utxBufferCreate();
+    utxBufferSetText(buffer, "old\ntext", 8);
+    utxBufferSetText(spare, "new", 3);
+    Edited edited;
+    memset(&edited, 0, sizeof(edited));
+    TEST_ASSERT_TRUE(utxBufferAddObserver(buffer, (FPtr_utxEdited)onEdited, &edited));
+
+    /* the observer stays with its buffer and hears of all of it changing */
+    utxBufferSwap(buffer, spare);
+    assertBufferEquals(buffer, "new", 3);
+    assertBufferEquals(spare, "old\ntext", 8);
+    TEST_ASSERT_EQUAL(1, utxBufferLines(buffer));
+    TEST_ASSERT_EQUAL(2, utxBufferLines(spare));
+    TEST_ASSERT_EQUAL(1, edited.calls);
+    TEST_ASSERT_EQUAL(0, edited.offset);
+    TEST_ASSERT_EQUAL(8, edited.removed);
+    TEST_ASSERT_EQUAL(3, edited.inserted);
+
+    utxBufferDestroy(&spare);
+    TEST_ASSERT_EQUAL(ROkay, utxBufferInsert(buffer, 3, "er", 2));
+    assertBufferEquals(buffer, "newer", 5);
+    TEST_ASSERT_EQUAL(2, edited.calls);
+    utxBufferDestroy(&buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxBuffer_Empty);
+    RUN_TEST(test_utxBuffer_TypingExtendsPiece);
+    RUN_TEST(test_utxBuffer_LargeText);
+    RUN_TEST(test_utxBuffer_RandomEdits);
+    RUN_TEST(test_utxBuffer_LineIndex);
+    RUN_TEST(test_utxBuffer_Snapshot);
+    RUN_TEST(test_utxBuffer_ReplaceRanges);
+    RUN_TEST(test_utxBuffer_Swap);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
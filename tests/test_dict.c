@@ -0,0 +1,337 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "dict.h"
+
+/* کاتب, کتاب, کتابیں, کتب */
+#define KAATIB "\xDA\xA9\xD8\xA7\xD8\xAA\xD8\xA8"
+#define KITAAB "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8"
+#define KITAABEN "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8\xDB\x8C\xDA\xBA"
+#define KUTUB "\xDA\xA9\xD8\xAA\xD8\xA8"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static String* tempPath(const char_t *extension) {
+    String *name = str_printf("kaatib-%d-%d.%s", bmath_randi(0, 999999), bmath_randi(0, 999999), extension);
+    String *path = hfile_tmp_path(tc(name));
+    str_destroy(&name);
+    return path;
+}
+
+/*----------------------------------------------------------------------------*/
+static void removeFile(String **path) {
+    ferror_t error;
+    bfile_delete(tc(*path), &error);
+    str_destroy(path);
+}
+
+/*----------------------------------------------------------------------------*/
+static int compareWords(const void *a, const void *b) {
+    return strcmp(*(const char_t* const*)a, *(const char_t* const*)b);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Builds a dictionary file from words in any order. */
+static UtxDict* createDict(const char_t **words, uint32_t count, String **path) {
+    const char_t **sorted = (const char_t**)malloc(count * sizeof(char_t*));
+    memcpy(sorted, words, count * sizeof(char_t*));
+    qsort(sorted, count, sizeof(char_t*), compareWords);
+
+    UtxDictBuilder *builder = utxDictBuilderCreate();
+    for (uint32_t i = 0; i < count; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, sorted[i], (uint32_t)strlen(sorted[i])));
+    }
+    *path = tempPath("dawg");
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderWrite(builder, tc(*path)));
+    utxDictBuilderDestroy(&builder);
+    free(sorted);
+
+    ferror_t error;
+    UtxDict *dict = utxDictOpen(tc(*path), &error);
+    TEST_ASSERT_NOT_NULL(dict);
+    return dict;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t codepoints(const char_t *word, uint32_t *cps) {
+    uint32_t n = 0;
+    for (const byte_t *s = (const byte_t*)word; *s != 0;) {
+        uint32_t c = *s++;
+        if (c >= 0xC0) {
+            c = ((c & 0x1F) << 6) | (*s++ & 0x3F);
+        }
+        cps[n++] = c;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Edit distance with swaps of neighbours, by the table. */
+static uint32_t referenceDistance(const char_t *a, const char_t *b) {
+    uint32_t x[64], y[64], d[65][65];
+    uint32_t n = codepoints(a, x), m = codepoints(b, y);
+    for (uint32_t i = 0; i <= n; ++i) {
+        for (uint32_t j = 0; j <= m; ++j) {
+            if (i == 0 || j == 0) {
+                d[i][j] = i + j;
+                continue;
+            }
+            uint32_t v = d[i - 1][j - 1] + (x[i - 1] != y[j - 1] ? 1 : 0);
+            v = d[i - 1][j] + 1 < v ? d[i - 1][j] + 1 : v;
+            v = d[i][j - 1] + 1 < v ? d[i][j - 1] + 1 : v;
+            if (i > 1 && j > 1 && x[i - 1] == y[j - 2] && x[i - 2] == y[j - 1]) {
+                v = d[i - 2][j - 2] + 1 < v ? d[i - 2][j - 2] + 1 : v;
+            }
+            d[i][j] = v;
+        }
+    }
+    return d[n][m];
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _found_t Found;
+struct _found_t {
+    char_t words[64][64];
+    uint32_t distances[64];
+    uint32_t count;
+    uint32_t limit;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t onWord(Found *found, const char_t *word, const uint32_t size, const uint32_t distance) {
+    TEST_ASSERT_TRUE(size < 64 && found->count < 64);
+    memcpy(found->words[found->count], word, size);
+    found->words[found->count][size] = 0;
+    found->distances[found->count] = distance;
+    found->count += 1;
+    return found->count < found->limit;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxDictBuilder_Order(void) {
+    UtxDictBuilder *builder = utxDictBuilderCreate();
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "bat", 3));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "bat", 3));
+    TEST_ASSERT_EQUAL(RInvalidContents, utxDictBuilderAdd(builder, "ba", 2));
+    TEST_ASSERT_EQUAL(RInvalidContents, utxDictBuilderAdd(builder, "at", 2));
+    TEST_ASSERT_EQUAL(RInvalidContents, utxDictBuilderAdd(builder, "", 0));
+    TEST_ASSERT_EQUAL(RInvalidEncoding, utxDictBuilderAdd(builder, "c\xD8", 2));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "bats", 4));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "cat", 3));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "cats", 4));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "rat", 3));
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, "rats", 4));
+
+    /* the root, then one state after each of a, t and s, shared by all */
+    TEST_ASSERT_EQUAL_UINT32(5, utxDictBuilderStates(builder));
+    TEST_ASSERT_EQUAL(RInvalidContents, utxDictBuilderAdd(builder, "sat", 3));
+    utxDictBuilderDestroy(&builder);
+    TEST_ASSERT_NULL(builder);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxDict_Lookup(void) {
+    const char_t *words[] = { KITAAB, KAATIB, KITAABEN, KUTUB, "kaatib" };
+    String *path = NULL;
+    UtxDict *dict = createDict(words, 5, &path);
+
+    TEST_ASSERT_EQUAL_UINT32(5, utxDictWords(dict));
+    for (uint32_t i = 0; i < 5; ++i) {
+        TEST_ASSERT_TRUE(utxDictContains(dict, words[i], (uint32_t)strlen(words[i])));
+    }
+    /* a prefix of a word, a word with more after it, bad text */
+    TEST_ASSERT_FALSE(utxDictContains(dict, KITAAB, 4));
+    TEST_ASSERT_FALSE(utxDictContains(dict, "kaatibs", 7));
+    TEST_ASSERT_FALSE(utxDictContains(dict, KITAAB, 7));
+    TEST_ASSERT_FALSE(utxDictContains(dict, "", 0));
+    TEST_ASSERT_FALSE(utxDictContains(NULL, "kaatib", 6));
+
+    utxDictClose(&dict);
+    TEST_ASSERT_NULL(dict);
+
+    /* not a dictionary */
+    String *text = str_c("kaatib\n");
+    ferror_t error;
+    hfile_from_string(tc(path), text, &error);
+    TEST_ASSERT_NULL(utxDictOpen(tc(path), &error));
+    str_destroy(&text);
+    removeFile(&path);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxDict_Suggest(void) {
+    const char_t *words[] = { KITAAB, KAATIB, KITAABEN, KUTUB };
+    String *path = NULL;
+    UtxDict *dict = createDict(words, 4, &path);
+    Found found;
+
+    /* کاتب with its last two letters swapped */
+    memset(&found, 0, sizeof(found));
+    found.limit = 64;
+    TEST_ASSERT_EQUAL_UINT32(1, utxDictSuggest(dict, "\xDA\xA9\xD8\xA7\xD8\xA8\xD8\xAA", 8, 1, (FPtr_utxWord)onWord, &found));
+    TEST_ASSERT_EQUAL_STRING(KAATIB, found.words[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, found.distances[0]);
+
+    /* closest first */
+    memset(&found, 0, sizeof(found));
+    found.limit = 64;
+    TEST_ASSERT_EQUAL_UINT32(4, utxDictSuggest(dict, KITAAB, 8, 2, (FPtr_utxWord)onWord, &found));
+    TEST_ASSERT_EQUAL_STRING(KITAAB, found.words[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, found.distances[0]);
+    for (uint32_t i = 1; i < found.count; ++i) {
+        TEST_ASSERT_TRUE(found.distances[i - 1] <= found.distances[i]);
+    }
+
+    /* the callback can stop the search */
+    memset(&found, 0, sizeof(found));
+    found.limit = 1;
+    TEST_ASSERT_EQUAL_UINT32(1, utxDictSuggest(dict, KITAAB, 8, 2, (FPtr_utxWord)onWord, &found));
+
+    utxDictClose(&dict);
+    removeFile(&path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A state claiming more edges than the file holds has none. */
+void test_utxDict_Damaged(void) {
+    const char_t *words[] = { KITAAB, KAATIB, "kaatib" };
+    String *path = NULL;
+    UtxDict *dict = createDict(words, 3, &path);
+    utxDictClose(&dict);
+
+    uint32_t header[6];
+    FILE *file = fopen(tc(path), "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(6, fread(header, sizeof(uint32_t), 6, file));
+    uint32_t count = 0xFFFFFFFE;
+    fseek(file, (long)(header[4] * sizeof(uint32_t)), SEEK_SET);
+    TEST_ASSERT_EQUAL(1, fwrite(&count, sizeof(uint32_t), 1, file));
+    fclose(file);
+
+    ferror_t error;
+    Found found;
+    memset(&found, 0, sizeof(found));
+    found.limit = 64;
+    dict = utxDictOpen(tc(path), &error);
+    TEST_ASSERT_NOT_NULL(dict);
+    TEST_ASSERT_FALSE(utxDictContains(dict, "kaatib", 6));
+    TEST_ASSERT_EQUAL_UINT32(0, utxDictSuggest(dict, "kaatib", 6, 2, (FPtr_utxWord)onWord, &found));
+
+    utxDictClose(&dict);
+    removeFile(&path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Random words over a few letters, against the distance table. */
+void test_utxDict_RandomAgreement(void) {
+    static const char_t *LETTERS[] = { "a", "b", "\xD8\xA7", "\xD8\xA8", "\xDA\xA9" };
+    enum { WORDS = 200 };
+    char_t *words[WORDS];
+    uint32_t count = 0;
+    String *list = str_c("");
+
+    for (uint32_t i = 0; i < WORDS; ++i) {
+        char_t word[32] = { 0 };
+        uint32_t n = (uint32_t)bmath_randi(1, 6);
+        for (uint32_t j = 0; j < n; ++j) {
+            strcat(word, LETTERS[bmath_randi(0, 4)]);
+        }
+        words[count++] = strdup(word);
+        String *next = str_printf("%s%s%s", tc(list), word, i % 3 == 0 ? "\r\n" : "\n");
+        str_destroy(&list);
+        list = next;
+    }
+
+    /* from an unsorted list with repeats */
+    String *listPath = tempPath("txt");
+    String *path = tempPath("dawg");
+    ferror_t error;
+    uint32_t unique = 0;
+    hfile_from_string(tc(listPath), list, &error);
+    TEST_ASSERT_EQUAL(ROkay, utxDictCompile(tc(listPath), tc(path), &unique));
+    UtxDict *dict = utxDictOpen(tc(path), &error);
+    TEST_ASSERT_NOT_NULL(dict);
+    TEST_ASSERT_EQUAL_UINT32(unique, utxDictWords(dict));
+
+    for (uint32_t round = 0; round < 50; ++round) {
+        char_t query[32] = { 0 };
+        uint32_t n = (uint32_t)bmath_randi(1, 6);
+        for (uint32_t j = 0; j < n; ++j) {
+            strcat(query, LETTERS[bmath_randi(0, 4)]);
+        }
+
+        Found found;
+        memset(&found, 0, sizeof(found));
+        found.limit = 64;
+        utxDictSuggest(dict, query, (uint32_t)strlen(query), 1, (FPtr_utxWord)onWord, &found);
+
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            bool_t seen = FALSE;
+            for (uint32_t k = 0; k < i; ++k) {
+                seen = seen || strcmp(words[k], words[i]) == 0;
+            }
+            uint32_t d = referenceDistance(query, words[i]);
+            if (seen || d > 1) {
+                continue;
+            }
+            expected += 1;
+            bool_t listed = FALSE;
+            for (uint32_t k = 0; k < found.count; ++k) {
+                listed = listed || (strcmp(found.words[k], words[i]) == 0 && found.distances[k] == d);
+            }
+            TEST_ASSERT_TRUE(listed);
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected, found.count);
+        TEST_ASSERT_EQUAL(found.count > 0 && found.distances[0] == 0, utxDictContains(dict, query, (uint32_t)strlen(query)));
+    }
+
+    utxDictClose(&dict);
+    removeFile(&path);
+    removeFile(&listPath);
+    str_destroy(&list);
+    for (uint32_t i = 0; i < count; ++i) {
+        free(words[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxDictBuilder_Order);
+    RUN_TEST(test_utxDict_Lookup);
+    RUN_TEST(test_utxDict_Suggest);
+    RUN_TEST(test_utxDict_Damaged);
+    RUN_TEST(test_utxDict_RandomAgreement);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,330 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "edittrace.h"
+#include "search.h"
+
+/* "اردو زبان" and Arabic ي, which NormUrdu folds to ی */
+#define URDU "\xD8\xA7\xD8\xB1\xD8\xAF\xD9\x88 \xD8\xB2\xD8\xA8\xD8\xA7\xD9\x86"
+#define ARABIC_YEH "\xD9\x8A"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static String* tempPath(const char_t *extension) {
+    String *name = str_printf("kaatib-%d-%d.%s", bmath_randi(0, 999999), bmath_randi(0, 999999), extension);
+    String *path = hfile_tmp_path(tc(name));
+    str_destroy(&name);
+    return path;
+}
+
+/*----------------------------------------------------------------------------*/
+static void removeFile(String **path) {
+    ferror_t error;
+    bfile_delete(tc(*path), &error);
+    str_destroy(path);
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertSameText(const UtxFile *expected, const UtxFile *actual) {
+    String *a = utxGetContents(expected);
+    String *b = utxGetContents(actual);
+    TEST_ASSERT_EQUAL(str_len(a), str_len(b));
+    TEST_ASSERT_EQUAL_STRING(tc(a), tc(b));
+    str_destroy(&a);
+    str_destroy(&b);
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _replayed_t Replayed;
+struct _replayed_t {
+    uint32_t events;
+    uint32_t kinds[EditGroup + 1];
+    uint64_t time;
+    bool_t ordered;
+};
+
+/*----------------------------------------------------------------------------*/
+static void onReplayed(Replayed *replayed, const UtxEditEvent *event, const uint64_t elapsed) {
+    unref(elapsed);
+    replayed->events += 1;
+    replayed->kinds[event->kind] += 1;
+    replayed->ordered = replayed->ordered && event->time >= replayed->time;
+    replayed->time = event->time;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Every kind of event, through a file and back. */
+void test_utxEditTrace_RoundTrip(void) {
+    String *initial = str_c(URDU "\nkaatib\n");
+    UtxFile *utx = utxCreateFromString(initial);
+    UtxEditTrace *trace = utxEditTraceCreate();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, utx));
+    TEST_ASSERT_EQUAL(2, utxEditTraceEvents(trace));
+
+    String *savePath = tempPath("txt");
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "abc ", 4));
+    utxEditTraceCursor(trace, 4, 4);
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 1, 1));
+    TEST_ASSERT_EQUAL(ROkay, utxReplace(utx, 0, 1, "x", 1));
+    utxUndoBreak(utx);
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 3, "def", 3));
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    TEST_ASSERT_EQUAL(ROkay, utxRedo(utx, NULL));
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsToFile(utx, tc(savePath)));
+
+    UtxSearch *search = utxSearchCreate("kaatib", 6, SearchExact);
+    uint32_t count = 0;
+    TEST_ASSERT_EQUAL(ROkay, utxReplaceAll(utx, search, "Kaatib", 6, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    utxSearchDestroy(&search);
+
+    /* typed with an Arabic yeh, kept folded */
+    utxSetNormalize(utx, NormUrdu);
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, ARABIC_YEH, 2));
+    utxEditTraceStop(trace);
+    TEST_ASSERT_EQUAL(16, utxEditTraceEvents(trace));
+
+    String *tracePath = tempPath("utxe");
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceWrite(trace, tc(tracePath)));
+    utxEditTraceDestroy(&trace);
+
+    ferror_t error;
+    UtxEditTrace *opened = utxEditTraceOpen(tc(tracePath), &error);
+    TEST_ASSERT_NOT_NULL(opened);
+    TEST_ASSERT_EQUAL(16, utxEditTraceEvents(opened));
+
+    static const UtxEditKind KINDS[] = {
+        EditNormalize, EditReset, EditInsert, EditCursor, EditDelete, EditReplace, EditBreak,
+        EditInsert, EditUndo, EditRedo, EditSave, EditGroup, EditRewrite, EditBreak, EditNormalize,
+        EditInsert,
+    };
+    UtxEditEvent event;
+    uint32_t position = 0, n = 0;
+    while (utxEditTraceNext(opened, &position, &event)) {
+        TEST_ASSERT_EQUAL(KINDS[n], event.kind);
+        n += 1;
+    }
+    TEST_ASSERT_EQUAL(16, n);
+
+    Replayed replayed;
+    memset(&replayed, 0, sizeof(replayed));
+    replayed.ordered = TRUE;
+    UtxFile *copy = utxCreateNew();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceReplay(opened, copy, NULL, (FPtr_utxReplayed)onReplayed, &replayed));
+    TEST_ASSERT_EQUAL(16, replayed.events);
+    TEST_ASSERT_EQUAL(3, replayed.kinds[EditInsert]);
+    TEST_ASSERT_EQUAL(1, replayed.kinds[EditRewrite]);
+    TEST_ASSERT_TRUE(replayed.ordered);
+    assertSameText(utx, copy);
+
+    /* undo reaches back as far as it did in the recorded document */
+    while (utxCanUndo(utx)) {
+        TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+        TEST_ASSERT_EQUAL(ROkay, utxUndo(copy, NULL));
+        assertSameText(utx, copy);
+    }
+    TEST_ASSERT_FALSE(utxCanUndo(copy));
+
+    utxDestroy(&copy);
+    utxEditTraceDestroy(&opened);
+    utxDestroy(&utx);
+    str_destroy(&initial);
+    removeFile(&tracePath);
+    removeFile(&savePath);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A seeded random session, with undo and redo, replays to the same text. */
+void test_utxEditTrace_RandomSession(void) {
+    static const char_t *WORDS[] = { URDU, " ", "\n", "kaatib", "\xDB\x94" };
+    bmath_rand_seed(19);
+
+    UtxFile *utx = utxCreateNew();
+    UtxEditTrace *trace = utxEditTraceCreate();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, utx));
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t length = utxLength(utx);
+        int32_t action = bmath_randi(0, 9);
+        if (action < 6 || length == 0) {
+            const char_t *word = WORDS[bmath_randi(0, 4)];
+            uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length);
+            while (utxInsert(utx, offset, word, (uint32_t)strlen(word)) == RInvalidRange) {
+                offset += 1;
+            }
+        } else if (action < 8) {
+            uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length - 1);
+            uint32_t size = (uint32_t)bmath_randi(1, 8);
+            size = size < length - offset ? size : length - offset;
+            if (utxDelete(utx, offset, size) != ROkay) {
+                utxEditTraceCursor(trace, offset, offset + size);
+            }
+        } else if (action == 8) {
+            utxUndo(utx, NULL);
+        } else {
+            utxRedo(utx, NULL);
+        }
+        if (i % 37 == 0) {
+            utxUndoBreak(utx);
+        }
+    }
+
+    UtxFile *copy = utxCreateNew();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceReplay(trace, copy, NULL, NULL, NULL));
+    assertSameText(utx, copy);
+
+    utxDestroy(&copy);
+    utxEditTraceDestroy(&trace);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+/* New contents and a new document carry on the same trace. */
+void test_utxEditTrace_Reset(void) {
+    UtxFile *first = utxCreateNew();
+    UtxEditTrace *trace = utxEditTraceCreate();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, first));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(first, 0, "one", 3));
+
+    String *contents = str_c(URDU);
+    TEST_ASSERT_EQUAL(ROkay, utxSetContents(first, contents));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(first, 0, "two ", 4));
+    str_destroy(&contents);
+
+    contents = str_c("three");
+    UtxFile *second = utxCreateFromString(contents);
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, second));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(first, 0, "after the switch ", 17));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(second, 5, "!", 1));
+    str_destroy(&contents);
+
+    /* the trace goes with the document that is destroyed */
+    utxDestroy(&second);
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(first, 0, "x", 1));
+
+    UtxFile *copy = utxCreateNew();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceReplay(trace, copy, NULL, NULL, NULL));
+    String *text = utxGetContents(copy);
+    TEST_ASSERT_EQUAL_STRING("three!", tc(text));
+    str_destroy(&text);
+
+    utxDestroy(&copy);
+    utxEditTraceDestroy(&trace);
+    utxDestroy(&first);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Saves are replayed to a path when one is given. */
+void test_utxEditTrace_Save(void) {
+    String *initial = str_c(URDU);
+    UtxFile *utx = utxCreateFromString(initial);
+    UtxEditTrace *trace = utxEditTraceCreate();
+    String *savePath = tempPath("txt");
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, utx));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "saved ", 6));
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsToFile(utx, tc(savePath)));
+    removeFile(&savePath);
+
+    savePath = tempPath("txt");
+    UtxFile *copy = utxCreateNew();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceReplay(trace, copy, tc(savePath), NULL, NULL));
+    UtxFile *saved = utxCreateFromFile(tc(savePath));
+    TEST_ASSERT_NOT_NULL(saved);
+    assertSameText(utx, saved);
+
+    utxDestroy(&saved);
+    utxDestroy(&copy);
+    utxEditTraceDestroy(&trace);
+    utxDestroy(&utx);
+    str_destroy(&initial);
+    removeFile(&savePath);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Files that are not whole traces are refused. */
+void test_utxEditTrace_Invalid(void) {
+    UtxFile *utx = utxCreateNew();
+    UtxEditTrace *trace = utxEditTraceCreate();
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceStart(trace, utx));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, URDU, (uint32_t)strlen(URDU)));
+    String *path = tempPath("utxe");
+    TEST_ASSERT_EQUAL(ROkay, utxEditTraceWrite(trace, tc(path)));
+    utxEditTraceDestroy(&trace);
+    utxDestroy(&utx);
+
+    ferror_t error;
+    trace = utxEditTraceOpen(tc(path), &error);
+    TEST_ASSERT_NOT_NULL(trace);
+    TEST_ASSERT_EQUAL(3, utxEditTraceEvents(trace));
+    /* an opened trace is for replay only */
+    utx = utxCreateNew();
+    TEST_ASSERT_EQUAL(RInvalidContents, utxEditTraceStart(trace, utx));
+    utxDestroy(&utx);
+    utxEditTraceDestroy(&trace);
+
+    byte_t data[256];
+    FILE *file = fopen(tc(path), "rb");
+    uint32_t size = (uint32_t)fread(data, 1, sizeof(data), file);
+    fclose(file);
+    TEST_ASSERT_TRUE(size > 12);
+
+    /* cut short in the last event's text */
+    file = fopen(tc(path), "wb");
+    fwrite(data, 1, size - 3, file);
+    fclose(file);
+    TEST_ASSERT_NULL(utxEditTraceOpen(tc(path), &error));
+    TEST_ASSERT_EQUAL(ekFUNDEF, error);
+
+    /* another magic */
+    data[0] ^= 0xFF;
+    file = fopen(tc(path), "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    TEST_ASSERT_NULL(utxEditTraceOpen(tc(path), &error));
+    TEST_ASSERT_EQUAL(ekFUNDEF, error);
+
+    removeFile(&path);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxEditTrace_RoundTrip);
+    RUN_TEST(test_utxEditTrace_RandomSession);
+    RUN_TEST(test_utxEditTrace_Reset);
+    RUN_TEST(test_utxEditTrace_Save);
+    RUN_TEST(test_utxEditTrace_Invalid);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -14,13 +14,24 @@
 #include <core/heap.h>
 #include <osbs/osbs.h>
 #include <osbs/bfile.h>
+#include <osbs/bthread.h>
 #include <core/hfile.h>
 #include <sewer/bmath.h>
 
+#include <stdlib.h>
 #include <raqm.h>
 
 #include "unity.h"
 #include "utx.h"
+#include "shapecache.h"
+#include "shaper.h"
+#include "glyphcache.h"
+#include "fonts.h"
+#include "viewport.h"
+#include "wrap.h"
+#include "linecache.h"
+#include "bidi.h"
+#include "caret.h"
 
 /*----------------------------------------------------------------------------*/
 void setUp(void) {
@@ -106,7 +117,905 @@ void test_StringTrim(void) {
     str_destroy(&trimmedPath);
 }
 
+/*----------------------------------------------------------------------------*/
+static KtGlyphRun* addRun(KtShapeCache *cache, const char_t *text, const void *font, uint32_t ppem, uint32_t count) {
+    KtGlyphRun *run = ktShapeCacheAdd(cache, text, str_len_c(text), font, ppem, KDirRtl, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        run->glyphs[i] = i + 1;
+        run->clusters[i] = i;
+        run->advances[i] = 64;
+        run->xOffsets[i] = 0;
+        run->yOffsets[i] = 0;
+    }
+    run->width = (int32_t)count * 64;
+    return run;
+}
+
+/*----------------------------------------------------------------------------*/
+static const KtGlyphRun* getRun(KtShapeCache *cache, const char_t *text, const void *font, uint32_t ppem) {
+    return ktShapeCacheGet(cache, text, str_len_c(text), font, ppem, KDirRtl);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktShapeCache_Key(void) {
+    static int FONT_A, FONT_B;
+    KtShapeCache *cache = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+
+    TEST_ASSERT_NULL(getRun(cache, "kaatib", &FONT_A, 16));
+    KtGlyphRun *run = addRun(cache, "kaatib", &FONT_A, 16, 6);
+    TEST_ASSERT_EQUAL_PTR(run, getRun(cache, "kaatib", &FONT_A, 16));
+    TEST_ASSERT_EQUAL_INT32(6 * 64, getRun(cache, "kaatib", &FONT_A, 16)->width);
+
+    TEST_ASSERT_NULL(getRun(cache, "kaatib", &FONT_B, 16));
+    TEST_ASSERT_NULL(getRun(cache, "kaatib", &FONT_A, 17));
+    TEST_ASSERT_NULL(getRun(cache, "kaatiB", &FONT_A, 16));
+    TEST_ASSERT_NULL(getRun(cache, "kaati", &FONT_A, 16));
+    TEST_ASSERT_NULL(ktShapeCacheGet(cache, "kaatib", 6, &FONT_A, 16, KDirLtr));
+
+    /* enough entries to grow the table */
+    char_t text[16];
+    for (uint32_t i = 0; i < 1000; ++i) {
+        snprintf(text, sizeof(text), "p%u", i);
+        addRun(cache, text, &FONT_B, 12, i % 7);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        snprintf(text, sizeof(text), "p%u", i);
+        const KtGlyphRun *r = getRun(cache, text, &FONT_B, 12);
+        TEST_ASSERT_NOT_NULL(r);
+        TEST_ASSERT_EQUAL_UINT32(i % 7, r->count);
+    }
+
+    uint32_t hits, misses, entries;
+    ktShapeCacheStats(cache, &hits, &misses, &entries, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1002, hits);
+    TEST_ASSERT_EQUAL_UINT32(6, misses);
+    TEST_ASSERT_EQUAL_UINT32(1001, entries);
+
+    ktShapeCacheDestroy(&cache);
+    TEST_ASSERT_NULL(cache);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktShapeCache_Evict(void) {
+    static int FONT;
+    KtShapeCache *cache = ktShapeCacheCreate(0);
+    addRun(cache, "a", &FONT, 16, 10);
+    uint32_t one;
+    ktShapeCacheStats(cache, NULL, NULL, NULL, &one);
+    ktShapeCacheDestroy(&cache);
+
+    /* room for three runs, least recently used goes first */
+    cache = ktShapeCacheCreate(one * 3);
+    addRun(cache, "a", &FONT, 16, 10);
+    addRun(cache, "b", &FONT, 16, 10);
+    addRun(cache, "c", &FONT, 16, 10);
+    TEST_ASSERT_NOT_NULL(getRun(cache, "a", &FONT, 16));
+    addRun(cache, "d", &FONT, 16, 10);
+    TEST_ASSERT_NULL(getRun(cache, "b", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "a", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "c", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "d", &FONT, 16));
+
+    uint32_t entries, bytes;
+    ktShapeCacheStats(cache, NULL, NULL, &entries, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(3, entries);
+    TEST_ASSERT_EQUAL_UINT32(one * 3, bytes);
+
+    /* runs of the current frame stay, even over the limit */
+    ktShapeCacheFrame(cache);
+    TEST_ASSERT_NOT_NULL(getRun(cache, "a", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "c", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "d", &FONT, 16));
+    addRun(cache, "e", &FONT, 16, 10);
+    ktShapeCacheStats(cache, NULL, NULL, &entries, NULL);
+    TEST_ASSERT_EQUAL_UINT32(4, entries);
+
+    ktShapeCacheFrame(cache);
+    addRun(cache, "f", &FONT, 16, 10);
+    ktShapeCacheStats(cache, NULL, NULL, &entries, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(3, entries);
+    TEST_ASSERT_NULL(getRun(cache, "a", &FONT, 16));
+    TEST_ASSERT_NOT_NULL(getRun(cache, "f", &FONT, 16));
+
+    ktShapeCacheClear(cache);
+    ktShapeCacheStats(cache, NULL, NULL, &entries, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, entries);
+    TEST_ASSERT_EQUAL_UINT32(0, bytes);
+    ktShapeCacheDestroy(&cache);
+}
 
+/*----------------------------------------------------------------------------*/
+/* Needs a font: set KAATIB_TEST_FONT to its path. */
+void test_ktShape_Cached(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    FT_Library library;
+    FT_Face face;
+    TEST_ASSERT_EQUAL(0, FT_Init_FreeType(&library));
+    TEST_ASSERT_EQUAL(0, FT_New_Face(library, fontPath, 0, &face));
+
+    KtShaper *shaper = ktShaperCreate(SHAPE_CACHE_SIZE);
+    const char_t *text = "Kaatib";
+    const KtGlyphRun *run = ktShape(shaper, face, 16, KDirLtr, text, 6);
+    TEST_ASSERT_NOT_NULL(run);
+    TEST_ASSERT_EQUAL_UINT32(6, run->count);
+    TEST_ASSERT_GREATER_THAN_INT32(0, run->width);
+    TEST_ASSERT_EQUAL_UINT32(0, run->clusters[0]);
+
+    TEST_ASSERT_EQUAL_PTR(run, ktShape(shaper, face, 16, KDirLtr, text, 6));
+    const KtGlyphRun *large = ktShape(shaper, face, 32, KDirLtr, text, 6);
+    TEST_ASSERT_TRUE(run != large);
+    TEST_ASSERT_GREATER_THAN_INT32(run->width, large->width);
+
+    uint32_t hits, misses;
+    ktShapeCacheStats(ktShaperCache(shaper), &hits, &misses, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, hits);
+    TEST_ASSERT_EQUAL_UINT32(2, misses);
+
+    ktShaperDestroy(&shaper);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t overlaps(const KtGlyph *a, const KtGlyph *b) {
+    return a->page == b->page
+        && a->x < b->x + b->width && b->x < a->x + a->width
+        && a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Needs a font: set KAATIB_TEST_FONT to its path. */
+void test_ktGlyphCache_Atlas(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    FT_Library library;
+    FT_Face face;
+    TEST_ASSERT_EQUAL(0, FT_Init_FreeType(&library));
+    TEST_ASSERT_EQUAL(0, FT_New_Face(library, fontPath, 0, &face));
+
+    KtGlyphCache *cache = ktGlyphCacheCreate(GLYPH_CACHE_SIZE, 0);
+    ktGlyphCacheFrame(cache);
+    uint32_t id = FT_Get_Char_Index(face, 'k');
+    const KtGlyph *glyph = ktGlyphCacheGet(cache, face, 32, id, 0);
+    TEST_ASSERT_NOT_NULL(glyph);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, glyph->width);
+    TEST_ASSERT_EQUAL_PTR(glyph, ktGlyphCacheGet(cache, face, 32, id, 0));
+    TEST_ASSERT_TRUE(glyph != ktGlyphCacheGet(cache, face, 32, id, 2));
+    TEST_ASSERT_TRUE(glyph != ktGlyphCacheGet(cache, face, 16, id, 0));
+    TEST_ASSERT_EQUAL_PTR(ktGlyphCachePage(cache, glyph->page) + glyph->y * glyph->pitch + glyph->x, glyph->pixels);
+
+    /* the atlas holds what FreeType renders */
+    TEST_ASSERT_EQUAL(0, FT_Set_Pixel_Sizes(face, 0, 32));
+    TEST_ASSERT_EQUAL(0, FT_Load_Glyph(face, id, FT_LOAD_NO_BITMAP | FT_LOAD_RENDER));
+    const FT_Bitmap *bitmap = &face->glyph->bitmap;
+    TEST_ASSERT_EQUAL_UINT32(bitmap->width, glyph->width);
+    TEST_ASSERT_EQUAL_UINT32(bitmap->rows, glyph->height);
+    TEST_ASSERT_EQUAL_INT32(face->glyph->bitmap_left, glyph->left);
+    TEST_ASSERT_EQUAL_INT32(face->glyph->bitmap_top, glyph->top);
+    for (uint32_t row = 0; row < glyph->height; ++row) {
+        TEST_ASSERT_EQUAL_MEMORY(bitmap->buffer + row * bitmap->pitch, glyph->pixels + row * glyph->pitch, glyph->width);
+    }
+
+    uint32_t hits, misses, glyphs, pages;
+    ktGlyphCacheStats(cache, &hits, &misses, &glyphs, &pages, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, hits);
+    TEST_ASSERT_EQUAL_UINT32(3, misses);
+    TEST_ASSERT_EQUAL_UINT32(3, glyphs);
+    TEST_ASSERT_EQUAL_UINT32(1, pages);
+
+    /* packed glyphs never share atlas pixels */
+    const KtGlyph *packed[200];
+    uint32_t n = 0;
+    for (uint32_t g = 1; g < 200 && g < (uint32_t)face->num_glyphs; ++g) {
+        const KtGlyph *p = ktGlyphCacheGet(cache, face, 48, g, g % GLYPH_SUBPIXELS);
+        if (p != NULL && p->width > 0) {
+            packed[n++] = p;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN_UINT32(100, n);
+    for (uint32_t i = 0; i < n; ++i) {
+        TEST_ASSERT_TRUE(packed[i]->x + packed[i]->width <= GLYPH_ATLAS_SIZE);
+        TEST_ASSERT_TRUE(packed[i]->y + packed[i]->height <= GLYPH_ATLAS_SIZE);
+        for (uint32_t j = i + 1; j < n; ++j) {
+            TEST_ASSERT_FALSE(overlaps(packed[i], packed[j]));
+        }
+    }
+
+    ktGlyphCacheDestroy(&cache);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A page is emptied for new glyphs, but not while this frame uses it. */
+void test_ktGlyphCache_Evict(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    FT_Library library;
+    FT_Face face;
+    TEST_ASSERT_EQUAL(0, FT_Init_FreeType(&library));
+    TEST_ASSERT_EQUAL(0, FT_New_Face(library, fontPath, 0, &face));
+
+    /* one page; about a dozen glyphs that large fill it */
+    KtGlyphCache *cache = ktGlyphCacheCreate(GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE, 0);
+    uint32_t id = FT_Get_Char_Index(face, 'W');
+    ktGlyphCacheFrame(cache);
+    TEST_ASSERT_NOT_NULL(ktGlyphCacheGet(cache, face, 400, id, 0));
+
+    uint32_t subpixel = 1, size = 400;
+    while (ktGlyphCacheGet(cache, face, size, id, subpixel) != NULL) {
+        subpixel = (subpixel + 1) % GLYPH_SUBPIXELS;
+        size += subpixel == 0 ? 1 : 0;
+        TEST_ASSERT_LESS_THAN_UINT32(500, size);
+    }
+
+    uint32_t glyphs, pages;
+    ktGlyphCacheStats(cache, NULL, NULL, &glyphs, &pages, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, pages);
+    TEST_ASSERT_GREATER_THAN_UINT32(4, glyphs);
+
+    /* the next frame may take the page back */
+    ktGlyphCacheFrame(cache);
+    TEST_ASSERT_NOT_NULL(ktGlyphCacheGet(cache, face, size, id, subpixel));
+    ktGlyphCacheStats(cache, NULL, NULL, &glyphs, &pages, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, pages);
+    TEST_ASSERT_EQUAL_UINT32(1, glyphs);
+
+    uint32_t misses, after;
+    ktGlyphCacheStats(cache, NULL, &misses, NULL, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(ktGlyphCacheGet(cache, face, 400, id, 0));
+    ktGlyphCacheStats(cache, NULL, &after, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, after);
+
+    ktGlyphCacheDestroy(&cache);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Requested glyphs are rasterized by the workers and packed at a frame. */
+void test_ktGlyphCache_Workers(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    FT_Library library;
+    FT_Face face;
+    TEST_ASSERT_EQUAL(0, FT_Init_FreeType(&library));
+    TEST_ASSERT_EQUAL(0, FT_New_Face(library, fontPath, 0, &face));
+
+    KtGlyphCache *cache = ktGlyphCacheCreate(GLYPH_CACHE_SIZE, 3);
+    KtGlyphCache *direct = ktGlyphCacheCreate(GLYPH_CACHE_SIZE, 0);
+    TEST_ASSERT_TRUE(ktGlyphCacheFont(cache, face, fontPath, 0));
+    uint32_t count = face->num_glyphs < 300 ? (uint32_t)face->num_glyphs : 300;
+    for (uint32_t g = 0; g < count; ++g) {
+        ktGlyphCacheRequest(cache, face, 24, g, g % GLYPH_SUBPIXELS);
+        ktGlyphCacheRequest(cache, face, 24, g, g % GLYPH_SUBPIXELS);
+    }
+
+    uint32_t pending = count;
+    for (uint32_t wait = 0; pending > 0 && wait < 2000; ++wait) {
+        bthread_sleep(5);
+        ktGlyphCacheFrame(cache);
+        ktGlyphCacheStats(cache, NULL, NULL, NULL, NULL, &pending);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, pending);
+
+    uint32_t misses = 0;
+    for (uint32_t g = 0; g < count; ++g) {
+        const KtGlyph *glyph = ktGlyphCacheGet(cache, face, 24, g, g % GLYPH_SUBPIXELS);
+        const KtGlyph *expected = ktGlyphCacheGet(direct, face, 24, g, g % GLYPH_SUBPIXELS);
+        TEST_ASSERT_EQUAL(expected == NULL, glyph == NULL);
+        if (glyph == NULL) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected->width, glyph->width);
+        TEST_ASSERT_EQUAL_UINT32(expected->height, glyph->height);
+        TEST_ASSERT_EQUAL_INT32(expected->left, glyph->left);
+        for (uint32_t row = 0; row < glyph->height; ++row) {
+            TEST_ASSERT_EQUAL_MEMORY(expected->pixels + row * expected->pitch, glyph->pixels + row * glyph->pitch, glyph->width);
+        }
+    }
+    ktGlyphCacheStats(cache, NULL, &misses, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(0, misses);
+
+    /* destroying with work queued drops it */
+    for (uint32_t g = 0; g < count; ++g) {
+        ktGlyphCacheRequest(cache, face, 64, g, 0);
+    }
+    ktGlyphCacheDestroy(&cache);
+    ktGlyphCacheDestroy(&direct);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Needs a font: set KAATIB_TEST_FONT to its path. */
+void test_ktFonts_Load(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    KtFonts *fonts = ktFontsCreate();
+    FT_Face face = ktFontsLoad(fonts, fontPath, 0);
+    TEST_ASSERT_NOT_NULL(face);
+    TEST_ASSERT_EQUAL_PTR(face, ktFontsLoad(fonts, fontPath, 0));
+    TEST_ASSERT_EQUAL_STRING(fontPath, ktFontsPath(fonts, face));
+    TEST_ASSERT_NULL(ktFontsLoad(fonts, fontPath, 99));
+    TEST_ASSERT_NULL(ktFontsLoad(fonts, "/no/such/font.ttf", 0));
+    TEST_ASSERT_NULL(ktFontsPrimary(fonts));
+    TEST_ASSERT_NULL(ktFontsFace(fonts, 'a'));
+
+    uint32_t faces, mapped;
+    ktFontsStats(fonts, &faces, &mapped, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, faces);
+    TEST_ASSERT_EQUAL_UINT32(1, mapped);
+
+    /* a face of this manager only, once */
+    static int OTHER;
+    TEST_ASSERT_FALSE(ktFontsFallback(fonts, (FT_Face)&OTHER));
+    TEST_ASSERT_TRUE(ktFontsFallback(fonts, face));
+    TEST_ASSERT_TRUE(ktFontsFallback(fonts, face));
+    TEST_ASSERT_EQUAL_PTR(face, ktFontsPrimary(fonts));
+
+    ktFontsDestroy(&fonts);
+    TEST_ASSERT_NULL(fonts);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set KAATIB_TEST_FALLBACK_FONT too, to a font with other coverage, for the
+ * chain to have two faces. */
+void test_ktFonts_Fallback(void) {
+    const char *fontPath = getenv("KAATIB_TEST_FONT");
+    if (fontPath == NULL) {
+        TEST_IGNORE_MESSAGE("KAATIB_TEST_FONT is not set");
+    }
+
+    KtFonts *fonts = ktFontsCreate();
+    FT_Face chain[2];
+    uint32_t nchain = 0;
+    chain[nchain++] = ktFontsLoad(fonts, fontPath, 0);
+    const char *fallbackPath = getenv("KAATIB_TEST_FALLBACK_FONT");
+    if (fallbackPath != NULL) {
+        chain[nchain] = ktFontsLoad(fonts, fallbackPath, 0);
+        TEST_ASSERT_NOT_NULL(chain[nchain]);
+        nchain += 1;
+    }
+    for (uint32_t f = 0; f < nchain; ++f) {
+        TEST_ASSERT_TRUE(ktFontsFallback(fonts, chain[f]));
+    }
+
+    /* the first face that has it; any face draws a missing glyph */
+    for (uint32_t cp = 0; cp < 0x3000; cp += 7) {
+        FT_Face expected = NULL;
+        for (uint32_t f = 0; f < nchain && expected == NULL; ++f) {
+            if (FT_Get_Char_Index(chain[f], cp) != 0) {
+                expected = chain[f];
+            }
+        }
+        FT_Face face = ktFontsFace(fonts, cp);
+        TEST_ASSERT_NOT_NULL(face);
+        if (expected != NULL) {
+            TEST_ASSERT_EQUAL_PTR(expected, face);
+        }
+    }
+    TEST_ASSERT_EQUAL_PTR(chain[0], ktFontsFace(fonts, 0x10FFFF));
+    TEST_ASSERT_EQUAL_PTR(chain[0], ktFontsFace(fonts, 0x110000));
+
+    /* a block is resolved once */
+    uint32_t blocks, again;
+    ktFontsStats(fonts, NULL, NULL, &blocks);
+    TEST_ASSERT_EQUAL_UINT32(0x3000 / 128 + 1, blocks);
+    ktFontsFace(fonts, 0x0627);
+    ktFontsFace(fonts, 0x0628);
+    ktFontsStats(fonts, NULL, NULL, &again);
+    TEST_ASSERT_EQUAL_UINT32(blocks, again);
+
+    /* runs cover the text, each of one face */
+    const char_t *text = "\xDA\xA9\xD8\xA7\xD8\xAA\xD8\xA8 Kaatib 2024, \xE2\x86\x92 \xD9\x84\xDA\xA9\xDA\xBE\xD9\x86\xD8\xA7\xFF!";
+    uint32_t size = (uint32_t)strlen(text);
+    uint32_t count = ktFontsRuns(fonts, text, size, NULL, 0);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, count);
+    KtFontRun runs[64];
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(64, count);
+    TEST_ASSERT_EQUAL_UINT32(count, ktFontsRuns(fonts, text, size, runs, 64));
+    uint32_t end = 0;
+    for (uint32_t r = 0; r < count; ++r) {
+        TEST_ASSERT_EQUAL_UINT32(end, runs[r].start);
+        TEST_ASSERT_GREATER_THAN_UINT32(0, runs[r].size);
+        TEST_ASSERT_NOT_NULL(runs[r].face);
+        if (r > 0) {
+            TEST_ASSERT_TRUE(runs[r].face != runs[r - 1].face);
+        }
+        end += runs[r].size;
+    }
+    TEST_ASSERT_EQUAL_UINT32(size, end);
+    if (nchain == 1) {
+        TEST_ASSERT_EQUAL_UINT32(1, count);
+    }
+
+    /* shaped with the chain, each glyph from the face of its run */
+    KtShaper *shaper = ktShaperCreate(SHAPE_CACHE_SIZE);
+    const KtGlyphRun *run = ktShapeFonts(shaper, fonts, 16, KDirAuto, text, size);
+    TEST_ASSERT_NOT_NULL(run);
+    TEST_ASSERT_EQUAL_PTR(run, ktShapeFonts(shaper, fonts, 16, KDirAuto, text, size));
+    for (uint32_t i = 0; i < run->count; ++i) {
+        uint32_t r = 0;
+        while (r + 1 < count && runs[r + 1].start <= run->clusters[i]) {
+            r += 1;
+        }
+        TEST_ASSERT_EQUAL_PTR(runs[r].face, run->faces[i]);
+    }
+    ktShaperDestroy(&shaper);
+
+    ktFontsDestroy(&fonts);
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertViewport(const KtViewport *viewport, const uint32_t *heights, uint32_t count) {
+    uint32_t top = 0;
+    TEST_ASSERT_EQUAL_UINT32(count, ktViewportCount(viewport));
+    for (uint32_t i = 0; i < count; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(top, ktViewportTop(viewport, i));
+        TEST_ASSERT_EQUAL_UINT32(heights[i], ktViewportParagraphHeight(viewport, i));
+        if (heights[i] > 0) {
+            TEST_ASSERT_EQUAL_UINT32(i, ktViewportAt(viewport, top));
+            TEST_ASSERT_EQUAL_UINT32(i, ktViewportAt(viewport, top + heights[i] - 1));
+        }
+        top += heights[i];
+    }
+    TEST_ASSERT_EQUAL_UINT32(top, ktViewportHeight(viewport));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktViewport_Visible(void) {
+    KtViewport *viewport = ktViewportCreate(20);
+    uint32_t first;
+    TEST_ASSERT_EQUAL_UINT32(0, ktViewportVisible(viewport, 0, 100, 0, &first));
+
+    ktViewportReset(viewport, 100000);
+    TEST_ASSERT_EQUAL_UINT32(2000000, ktViewportHeight(viewport));
+    TEST_ASSERT_EQUAL_UINT32(5, ktViewportVisible(viewport, 0, 100, 0, &first));
+    TEST_ASSERT_EQUAL_UINT32(0, first);
+    TEST_ASSERT_EQUAL_UINT32(6, ktViewportVisible(viewport, 1010, 100, 0, &first));
+    TEST_ASSERT_EQUAL_UINT32(50, first);
+    TEST_ASSERT_EQUAL_UINT32(7, ktViewportVisible(viewport, 1000, 100, 20, &first));
+    TEST_ASSERT_EQUAL_UINT32(49, first);
+    TEST_ASSERT_EQUAL_UINT32(1, ktViewportVisible(viewport, 2000000, 100, 0, &first));
+    TEST_ASSERT_EQUAL_UINT32(99999, first);
+
+    /* measuring moves everything below, nothing above */
+    TEST_ASSERT_FALSE(ktViewportMeasured(viewport, 50));
+    ktViewportMeasure(viewport, 50, 100);
+    TEST_ASSERT_TRUE(ktViewportMeasured(viewport, 50));
+    TEST_ASSERT_EQUAL_UINT32(1000, ktViewportTop(viewport, 50));
+    TEST_ASSERT_EQUAL_UINT32(1100, ktViewportTop(viewport, 51));
+    TEST_ASSERT_EQUAL_UINT32(2000080, ktViewportHeight(viewport));
+    TEST_ASSERT_EQUAL_UINT32(50, ktViewportAt(viewport, 1099));
+
+    ktViewportInvalidate(viewport, 50, 1);
+    TEST_ASSERT_FALSE(ktViewportMeasured(viewport, 50));
+    TEST_ASSERT_EQUAL_UINT32(100, ktViewportParagraphHeight(viewport, 50));
+
+    ktViewportDestroy(&viewport);
+    TEST_ASSERT_NULL(viewport);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktViewport_RandomEdits(void) {
+    const uint32_t CAPACITY = 4096;
+    uint32_t *heights = heap_new_n(CAPACITY, uint32_t);
+    uint32_t count = 0;
+    KtViewport *viewport = ktViewportCreate(16);
+    bmath_rand_seed(148);
+
+    for (uint32_t round = 0; round < 2000; ++round) {
+        uint32_t op = (uint32_t)bmath_randi(0, 3);
+        if (op < 2 && count > 0) {
+            uint32_t p = (uint32_t)bmath_randi(0, (int32_t)count - 1);
+            uint32_t h = (uint32_t)bmath_randi(0, 200);
+            ktViewportMeasure(viewport, p, h);
+            heights[p] = h;
+        } else {
+            uint32_t first = count > 0 ? (uint32_t)bmath_randi(0, (int32_t)count) : 0;
+            uint32_t removed = (uint32_t)bmath_randi(0, (int32_t)(count - first < 8 ? count - first : 8));
+            uint32_t inserted = (uint32_t)bmath_randi(0, 8);
+            if (count - removed + inserted > CAPACITY) {
+                inserted = 0;
+            }
+            ktViewportSplice(viewport, first, removed, inserted);
+            memmove(heights + first + inserted, heights + first + removed, (count - first - removed) * sizeof(uint32_t));
+            for (uint32_t i = first; i < first + inserted; ++i) {
+                heights[i] = 16;
+            }
+            count = count - removed + inserted;
+        }
+
+        if (round % 100 == 0) {
+            assertViewport(viewport, heights, count);
+        }
+    }
+
+    assertViewport(viewport, heights, count);
+    ktViewportDestroy(&viewport);
+    heap_delete_n(&heights, CAPACITY, uint32_t);
+}
+
+/*----------------------------------------------------------------------------*/
+static KtGlyphRun* textRun(KtShapeCache *cache, const char_t *text, bool_t rtl) {
+    static int FONT;
+    uint32_t n = str_len_c(text);
+    KtGlyphRun *run = ktShapeCacheAdd(cache, text, n, &FONT, 16, rtl ? KDirRtl : KDirLtr, n);
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t g = rtl ? n - 1 - i : i;
+        run->glyphs[g] = (uint32_t)text[i];
+        run->clusters[g] = i;
+        run->advances[g] = 64;
+        run->xOffsets[g] = 0;
+        run->yOffsets[g] = 0;
+    }
+    return run;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktWrap_Greedy(void) {
+    KtShapeCache *cache = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+    uint32_t starts[4];
+
+    for (uint32_t rtl = 0; rtl < 2; ++rtl) {
+        const char_t *words = "aa bb cc";
+        KtGlyphRun *run = textRun(cache, words, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(2, ktWrap(run, words, 5 * 64, starts, 4));
+        TEST_ASSERT_EQUAL_UINT32(0, starts[0]);
+        TEST_ASSERT_EQUAL_UINT32(6, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(1, ktWrap(run, words, 8 * 64, starts, 4));
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrap(run, words, 3 * 64, starts, 4));
+        TEST_ASSERT_EQUAL_UINT32(3, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(6, starts[2]);
+
+        const char_t *word = "abcdefgh";
+        run = textRun(cache, word, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrap(run, word, 3 * 64, starts, 2));
+        TEST_ASSERT_EQUAL_UINT32(3, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(8, ktWrap(run, word, 1, NULL, 0));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1, ktWrap(NULL, NULL, 100, starts, 4));
+    ktShapeCacheDestroy(&cache);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktWrap_Optimal(void) {
+    KtShapeCache *cache = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+    uint32_t starts[8];
+
+    for (uint32_t rtl = 0; rtl < 2; ++rtl) {
+        /* greedy leaves "cc" alone on the middle line */
+        const char_t *words = "aaa bb cc ddddd";
+        KtGlyphRun *run = textRun(cache, words, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrap(run, words, 6 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(7, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrapOptimal(run, words, 15, 6 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(0, starts[0]);
+        TEST_ASSERT_EQUAL_UINT32(4, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(10, starts[2]);
+        TEST_ASSERT_EQUAL_UINT32(1, ktWrapOptimal(run, words, 15, 15 * 64, starts, 8));
+
+        const char_t *hyphen = "aaaa-bbbb";
+        run = textRun(cache, hyphen, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(2, ktWrapOptimal(run, hyphen, 9, 6 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(5, starts[1]);
+
+        /* no break inside the parentheses, nor before a closing one */
+        const char_t *paren = "aa (bb) cc";
+        run = textRun(cache, paren, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(2, ktWrapOptimal(run, paren, 10, 7 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(8, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrapOptimal(run, paren, 10, 5 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(3, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(8, starts[2]);
+
+        /* the Arabic comma stays with its word */
+        const char_t *urdu = "\xD8\xA7\xD8\xA7\xD8\x8C \xD8\xA8";
+        run = textRun(cache, urdu, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(2, ktWrapOptimal(run, urdu, 9, 6 * 64, starts, 8));
+        TEST_ASSERT_EQUAL_UINT32(7, starts[1]);
+
+        const char_t *word = "abcdefgh";
+        run = textRun(cache, word, (bool_t)rtl);
+        TEST_ASSERT_EQUAL_UINT32(3, ktWrapOptimal(run, word, 8, 3 * 64, starts, 2));
+        TEST_ASSERT_EQUAL_UINT32(3, starts[1]);
+        TEST_ASSERT_EQUAL_UINT32(8, ktWrapOptimal(run, word, 8, 1, NULL, 0));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1, ktWrapOptimal(NULL, NULL, 0, 100, starts, 8));
+    ktShapeCacheDestroy(&cache);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktLineCache_Widths(void) {
+    KtShapeCache *shapes = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+    KtLineCache *cache = ktLineCacheCreate();
+    const char_t *words = "aaa bb cc ddddd";
+    KtGlyphRun *run = textRun(shapes, words, FALSE);
+    uint32_t lines = 0, hits = 0, misses = 0, bytes = 0;
+
+    ktLineCacheReset(cache, 3);
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 1, words, 15, 6 * 64, &lines));
+    const uint32_t *starts = ktLineCacheWrap(cache, 1, run, words, 15, 6 * 64, &lines);
+    TEST_ASSERT_EQUAL_UINT32(3, lines);
+    TEST_ASSERT_EQUAL_UINT32(4, starts[1]);
+    TEST_ASSERT_EQUAL_PTR(starts, ktLineCacheGet(cache, 1, words, 15, 6 * 64, &lines));
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 0, words, 15, 6 * 64, &lines));
+
+    /* two widths are kept, a third drops the older */
+    ktLineCacheWrap(cache, 1, run, words, 15, 15 * 64, &lines);
+    TEST_ASSERT_EQUAL_UINT32(1, lines);
+    TEST_ASSERT_EQUAL_PTR(starts, ktLineCacheGet(cache, 1, words, 15, 6 * 64, &lines));
+    ktLineCacheWrap(cache, 1, run, words, 15, 10 * 64, &lines);
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 1, words, 15, 15 * 64, &lines));
+    TEST_ASSERT_NOT_NULL(ktLineCacheGet(cache, 1, words, 15, 6 * 64, &lines));
+
+    /* other text misses */
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 1, "aaa bb cc eeeee", 15, 6 * 64, &lines));
+
+    ktLineCacheSplice(cache, 0, 0, 2);
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 1, words, 15, 6 * 64, &lines));
+    TEST_ASSERT_NOT_NULL(ktLineCacheGet(cache, 3, words, 15, 6 * 64, &lines));
+    ktLineCacheInvalidate(cache, 3, 1);
+    TEST_ASSERT_NULL(ktLineCacheGet(cache, 3, words, 15, 6 * 64, &lines));
+
+    ktLineCacheStats(cache, &hits, &misses, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(4, hits);
+    TEST_ASSERT_EQUAL_UINT32(3, misses);
+    TEST_ASSERT_EQUAL_UINT32(0, bytes);
+
+    ktLineCacheDestroy(&cache);
+    ktShapeCacheDestroy(&shapes);
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertBidiMaps(const KtBidiPara *para) {
+    for (uint32_t i = 0; i < para->length; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(i, para->toLogical[para->toVisual[i]]);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktBidi_Mixed(void) {
+    /* "اردو abc" */
+    static const char_t MIXED[] = "\xD8\xA7\xD8\xB1\xD8\xAF\xD9\x88 abc";
+    static const uint32_t VISUAL[] = { 5, 6, 7, 4, 3, 2, 1, 0 };
+    static const uint32_t OFFSETS[] = { 0, 2, 4, 6, 8, 9, 10, 11, 12 };
+    KtBidi *bidi = ktBidiCreate(KDirAuto);
+    ktBidiReset(bidi, 3);
+
+    const KtBidiPara *para = ktBidiParagraph(bidi, 0, MIXED, 12);
+    TEST_ASSERT_NOT_NULL(para);
+    TEST_ASSERT_TRUE(para->rtl);
+    TEST_ASSERT_EQUAL_UINT32(8, para->length);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(OFFSETS, para->offsets, 9);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(VISUAL, para->toLogical, 8);
+    assertBidiMaps(para);
+
+    TEST_ASSERT_EQUAL_UINT32(2, para->runCount);
+    TEST_ASSERT_EQUAL_UINT32(5, para->runs[0].start);
+    TEST_ASSERT_EQUAL_UINT32(3, para->runs[0].length);
+    TEST_ASSERT_EQUAL_UINT8(2, para->runs[0].level);
+    TEST_ASSERT_EQUAL_UINT32(0, para->runs[1].start);
+    TEST_ASSERT_EQUAL_UINT32(5, para->runs[1].length);
+    TEST_ASSERT_EQUAL_UINT8(1, para->runs[1].level);
+
+    TEST_ASSERT_EQUAL_UINT32(1, ktBidiCharAt(para, 3));
+    TEST_ASSERT_EQUAL_UINT32(5, ktBidiCharAt(para, 9));
+
+    uint32_t order[8];
+    ktBidiLineOrder(para, 0, 8, order);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(VISUAL, order, 8);
+    ktBidiLineOrder(para, 4, 8, order);
+    TEST_ASSERT_EQUAL_UINT32(5, order[0]);
+    TEST_ASSERT_EQUAL_UINT32(4, order[3]);
+
+    para = ktBidiParagraph(bidi, 1, "abc", 3);
+    TEST_ASSERT_FALSE(para->rtl);
+    TEST_ASSERT_EQUAL_UINT32(1, para->runCount);
+    TEST_ASSERT_EQUAL_UINT32(2, para->toVisual[2]);
+
+    para = ktBidiParagraph(bidi, 2, "", 0);
+    TEST_ASSERT_TRUE(para->rtl);
+    TEST_ASSERT_EQUAL_UINT32(0, para->length);
+    TEST_ASSERT_EQUAL_UINT32(0, para->runCount);
+
+    TEST_ASSERT_NULL(ktBidiParagraph(bidi, 3, "abc", 3));
+    ktBidiDestroy(&bidi);
+    TEST_ASSERT_NULL(bidi);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktBidi_Invalidate(void) {
+    static const char_t *TEXTS[] = { "abc", "\xD8\xA7\xD8\xB1 12", "x \xD9\x84 y" };
+    KtBidi *bidi = ktBidiCreate(KDirAuto);
+    ktBidiReset(bidi, 100);
+
+    for (uint32_t round = 0; round < 2; ++round) {
+        for (uint32_t i = 0; i < 100; ++i) {
+            const char_t *text = TEXTS[i % 3];
+            assertBidiMaps(ktBidiParagraph(bidi, i, text, str_len_c(text)));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, ktBidiResolved(bidi));
+
+    /* only what an edit touched is resolved again */
+    ktBidiInvalidate(bidi, 10, 1);
+    const KtBidiPara *kept = ktBidiParagraph(bidi, 51, TEXTS[0], 3);
+    ktBidiSplice(bidi, 50, 1, 2);
+    for (uint32_t i = 0; i < 101; ++i) {
+        const char_t *text = TEXTS[(i > 50 ? i - 1 : i) % 3];
+        ktBidiParagraph(bidi, i, text, str_len_c(text));
+    }
+    TEST_ASSERT_EQUAL_UINT32(103, ktBidiResolved(bidi));
+    TEST_ASSERT_EQUAL_PTR(kept, ktBidiParagraph(bidi, 52, TEXTS[0], 3));
+
+    /* a paragraph edited without being invalidated is caught by its size */
+    ktBidiParagraph(bidi, 0, "abcd", 4);
+    TEST_ASSERT_EQUAL_UINT32(104, ktBidiResolved(bidi));
+
+    ktBidiDestroy(&bidi);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A run of `n` glyphs in visual order, each 64 wide unless `advances` says. */
+static KtGlyphRun* clusterRun(KtShapeCache *cache, const char_t *text, const uint32_t *clusters, const int32_t *advances, uint32_t n) {
+    static int FONT;
+    KtGlyphRun *run = ktShapeCacheAdd(cache, text, str_len_c(text), &FONT, 16, KDirAuto, n);
+    for (uint32_t i = 0; i < n; ++i) {
+        run->glyphs[i] = i + 1;
+        run->clusters[i] = clusters[i];
+        run->advances[i] = advances != NULL ? advances[i] : 64;
+        run->xOffsets[i] = 0;
+        run->yOffsets[i] = 0;
+    }
+    return run;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktCaret_Hit(void) {
+    KtShapeCache *shapes = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+    KtCaretCache *cache = ktCaretCacheCreate();
+    KtBidi *bidi = ktBidiCreate(KDirAuto);
+    ktCaretCacheReset(cache, 4);
+    ktBidiReset(bidi, 4);
+
+    /* "ab cd" on two lines */
+    static const uint32_t LATIN[] = { 0, 1, 2, 3, 4 };
+    static const uint32_t LATIN_STARTS[] = { 0, 3 };
+    KtGlyphRun *run = clusterRun(shapes, "ab cd", LATIN, NULL, 5);
+    const KtBidiPara *para = ktBidiParagraph(bidi, 0, "ab cd", 5);
+    const KtCaretMap *map = ktCaretCacheGet(cache, 0, run, para, "ab cd", 5, 640, 1, LATIN_STARTS, 2);
+    TEST_ASSERT_NOT_NULL(map);
+    TEST_ASSERT_EQUAL_UINT32(2, map->lines);
+    TEST_ASSERT_EQUAL_INT32(192, map->widths[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, ktCaretHit(map, 0, 10));
+    TEST_ASSERT_EQUAL_UINT32(1, ktCaretHit(map, 0, 40));
+    TEST_ASSERT_EQUAL_UINT32(3, ktCaretHit(map, 0, 1000));
+    TEST_ASSERT_EQUAL_UINT32(3, ktCaretHit(map, 1, -20));
+    TEST_ASSERT_EQUAL_UINT32(5, ktCaretHit(map, 7, 1000));
+    TEST_ASSERT_EQUAL_INT32(64, ktCaretX(map, 0, 1));
+    TEST_ASSERT_EQUAL_INT32(192, ktCaretX(map, 0, 3));
+    TEST_ASSERT_EQUAL_INT32(0, ktCaretX(map, 1, 3));
+    TEST_ASSERT_EQUAL_INT32(128, ktCaretX(map, 1, 5));
+    TEST_ASSERT_EQUAL_UINT32(1, ktCaretLine(map, 3));
+    TEST_ASSERT_EQUAL_UINT32(0, ktCaretLine(map, 2));
+
+    /* "اب جد", read from the right */
+    static const char_t URDU[] = "\xD8\xA7\xD8\xA8 \xD8\xAC\xD8\xAF";
+    static const uint32_t URDU_CLUSTERS[] = { 7, 5, 4, 2, 0 };
+    static const uint32_t ONE_LINE[] = { 0 };
+    run = clusterRun(shapes, URDU, URDU_CLUSTERS, NULL, 5);
+    para = ktBidiParagraph(bidi, 1, URDU, 9);
+    map = ktCaretCacheGet(cache, 1, run, para, URDU, 9, 640, 1, ONE_LINE, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, ktCaretHit(map, 0, 300));
+    TEST_ASSERT_EQUAL_UINT32(2, ktCaretHit(map, 0, 270));
+    TEST_ASSERT_EQUAL_UINT32(9, ktCaretHit(map, 0, -5));
+    TEST_ASSERT_EQUAL_UINT32(0, ktCaretHit(map, 0, 400));
+    TEST_ASSERT_EQUAL_INT32(320, ktCaretX(map, 0, 0));
+    TEST_ASSERT_EQUAL_INT32(256, ktCaretX(map, 0, 2));
+    TEST_ASSERT_EQUAL_INT32(128, ktCaretX(map, 0, 5));
+    TEST_ASSERT_EQUAL_INT32(0, ktCaretX(map, 0, 9));
+
+    /* "اب abc": the Latin run reads from the left inside the Urdu line */
+    static const char_t MIXED[] = "\xD8\xA7\xD8\xA8 abc";
+    static const uint32_t MIXED_CLUSTERS[] = { 5, 6, 7, 4, 2, 0 };
+    run = clusterRun(shapes, MIXED, MIXED_CLUSTERS, NULL, 6);
+    para = ktBidiParagraph(bidi, 2, MIXED, 8);
+    map = ktCaretCacheGet(cache, 2, run, para, MIXED, 8, 640, 1, ONE_LINE, 1);
+    TEST_ASSERT_FALSE(map->stops[0].rtl);
+    TEST_ASSERT_TRUE(map->stops[4].rtl);
+    TEST_ASSERT_EQUAL_UINT32(8, ktCaretHit(map, 0, 180));
+    TEST_ASSERT_EQUAL_UINT32(5, ktCaretHit(map, 0, 200));
+    TEST_ASSERT_EQUAL_UINT32(4, ktCaretHit(map, 0, 240));
+    TEST_ASSERT_EQUAL_INT32(192, ktCaretX(map, 0, 8));
+    TEST_ASSERT_EQUAL_INT32(0, ktCaretX(map, 0, 5));
+    TEST_ASSERT_EQUAL_INT32(256, ktCaretX(map, 0, 4));
+    TEST_ASSERT_EQUAL_INT32(384, ktCaretX(map, 0, 0));
+
+    /* an "fi" ligature and a mark on "b" are never split */
+    static const char_t LIGATURE[] = "fib\xCC\x81";
+    static const uint32_t LIGATURE_CLUSTERS[] = { 0, 2, 2 };
+    static const int32_t LIGATURE_ADVANCES[] = { 128, 64, 0 };
+    run = clusterRun(shapes, LIGATURE, LIGATURE_CLUSTERS, LIGATURE_ADVANCES, 3);
+    para = ktBidiParagraph(bidi, 3, LIGATURE, 5);
+    map = ktCaretCacheGet(cache, 3, run, para, LIGATURE, 5, 640, 1, ONE_LINE, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, map->first[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, ktCaretHit(map, 0, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, ktCaretHit(map, 0, 60));
+    TEST_ASSERT_EQUAL_UINT32(5, ktCaretHit(map, 0, 170));
+    TEST_ASSERT_EQUAL_INT32(0, ktCaretX(map, 0, 1));
+    TEST_ASSERT_EQUAL_INT32(128, ktCaretX(map, 0, 3));
+    TEST_ASSERT_EQUAL_INT32(192, ktCaretX(map, 0, 5));
+
+    ktCaretCacheDestroy(&cache);
+    ktBidiDestroy(&bidi);
+    ktShapeCacheDestroy(&shapes);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_ktCaret_Cache(void) {
+    KtShapeCache *shapes = ktShapeCacheCreate(SHAPE_CACHE_SIZE);
+    KtCaretCache *cache = ktCaretCacheCreate();
+    const char_t *words = "aaa bb cc ddddd";
+    KtGlyphRun *run = textRun(shapes, words, FALSE);
+    static const uint32_t NARROW[] = { 0, 4, 10 };
+    static const uint32_t WIDE[] = { 0 };
+    uint32_t hits = 0, misses = 0, bytes = 0;
+
+    TEST_ASSERT_NULL(ktCaretCacheGet(cache, 0, run, NULL, words, 15, 6 * 64, 1, NARROW, 3));
+    ktCaretCacheReset(cache, 3);
+    const KtCaretMap *map = ktCaretCacheGet(cache, 1, run, NULL, words, 15, 6 * 64, 1, NARROW, 3);
+    TEST_ASSERT_EQUAL_UINT32(15, map->first[3]);
+    TEST_ASSERT_EQUAL_PTR(map, ktCaretCacheGet(cache, 1, run, NULL, words, 15, 6 * 64, 1, NARROW, 3));
+
+    /* another width or text builds it again */
+    map = ktCaretCacheGet(cache, 1, run, NULL, words, 15, 15 * 64, 1, WIDE, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, map->lines);
+    ktCaretCacheGet(cache, 1, run, NULL, "aaa bb cc eeeee", 15, 15 * 64, 1, WIDE, 1);
+
+    ktCaretCacheSplice(cache, 0, 0, 2);
+    map = ktCaretCacheGet(cache, 3, run, NULL, "aaa bb cc eeeee", 15, 15 * 64, 1, WIDE, 1);
+    ktCaretCacheInvalidate(cache, 3, 1);
+    map = ktCaretCacheGet(cache, 3, run, NULL, words, 15, 15 * 64, 1, WIDE, 1);
+    TEST_ASSERT_NOT_NULL(map);
+
+    /* found again by its stamp alone, while the document is unchanged */
+    TEST_ASSERT_EQUAL_PTR(map, ktCaretCacheFind(cache, 3, 15 * 64, 1));
+    TEST_ASSERT_NULL(ktCaretCacheFind(cache, 3, 15 * 64, 2));
+    TEST_ASSERT_NULL(ktCaretCacheFind(cache, 3, 6 * 64, 1));
+    TEST_ASSERT_NULL(ktCaretCacheFind(cache, 2, 15 * 64, 1));
+
+    ktCaretCacheStats(cache, &hits, &misses, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(3, hits);
+    TEST_ASSERT_EQUAL_UINT32(4, misses);
+    TEST_ASSERT_NOT_EQUAL(0, bytes);
+    ktCaretCacheReset(cache, 0);
+    ktCaretCacheStats(cache, NULL, NULL, &bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, bytes);
+
+    ktCaretCacheDestroy(&cache);
+    TEST_ASSERT_NULL(cache);
+    ktShapeCacheDestroy(&shapes);
+}
 
 /*----------------------------------------------------------------------------*/
 int main(void) {
@@ -117,6 +1026,23 @@ int main(void) {
     RUN_TEST(test_WorkingDirectory_Suffix);
 
     RUN_TEST(test_RaqmLink);
+    RUN_TEST(test_ktShapeCache_Key);
+    RUN_TEST(test_ktShapeCache_Evict);
+    RUN_TEST(test_ktShape_Cached);
+    RUN_TEST(test_ktGlyphCache_Atlas);
+    RUN_TEST(test_ktGlyphCache_Evict);
+    RUN_TEST(test_ktGlyphCache_Workers);
+    RUN_TEST(test_ktFonts_Load);
+    RUN_TEST(test_ktFonts_Fallback);
+    RUN_TEST(test_ktViewport_Visible);
+    RUN_TEST(test_ktViewport_RandomEdits);
+    RUN_TEST(test_ktWrap_Greedy);
+    RUN_TEST(test_ktWrap_Optimal);
+    RUN_TEST(test_ktLineCache_Widths);
+    RUN_TEST(test_ktBidi_Mixed);
+    RUN_TEST(test_ktBidi_Invalidate);
+    RUN_TEST(test_ktCaret_Hit);
+    RUN_TEST(test_ktCaret_Cache);
     return UNITY_END();
 }
 
@@ -0,0 +1,293 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "normalize.h"
+#include "utf8.h"
+
+/* Arabic ي ى ك, Urdu ی ک */
+#define ARABIC_YEH "\xD9\x8A"
+#define MAKSURA "\xD9\x89"
+#define ARABIC_KAF "\xD9\x83"
+#define YEH "\xDB\x8C"
+#define KEHEH "\xDA\xA9"
+/* ا ٓ ٔ ٕ آ أ إ ئ */
+#define ALEF "\xD8\xA7"
+#define MADDAH "\xD9\x93"
+#define HAMZA "\xD9\x94"
+#define HAMZA_BELOW "\xD9\x95"
+#define ALEF_MADDA "\xD8\xA2"
+#define ALEF_HAMZA "\xD8\xA3"
+#define ALEF_HAMZA_BELOW "\xD8\xA5"
+#define YEH_HAMZA "\xD8\xA6"
+/* ہ ۂ ے ۓ و ؤ */
+#define HEH_GOAL "\xDB\x81"
+#define HEH_GOAL_HAMZA "\xDB\x82"
+#define BARREE "\xDB\x92"
+#define BARREE_HAMZA "\xDB\x93"
+#define WAW "\xD9\x88"
+#define WAW_HAMZA "\xD8\xA4"
+/* fatha, kasra, shadda */
+#define FATHA "\xD9\x8E"
+#define KASRA "\xD9\x90"
+#define SHADDA "\xD9\x91"
+/* ک ت ا ب */
+#define KITAAB KEHEH "\xD8\xAA" ALEF "\xD8\xA8"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utxUtf8SetSimd(SimdAuto);
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertNormal(UtxNormalize profile, const char_t *text, const char_t *expected) {
+    char_t out[256];
+    uint32_t size = (uint32_t)strlen(text);
+    uint32_t n = utxNormalizeText(profile, text, size, out);
+    TEST_ASSERT_EQUAL(strlen(expected), n);
+    TEST_ASSERT_EQUAL_STRING_LEN(expected, out, n);
+    if (n == size && memcmp(text, expected, n) == 0) {
+        TEST_ASSERT_EQUAL(size, utxNormalizeClean(profile, text, size));
+    } else {
+        TEST_ASSERT_TRUE(utxNormalizeClean(profile, text, size) < size);
+    }
+    TEST_ASSERT_EQUAL(n, utxNormalizeClean(profile, out, n));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxNormalize_Fold(void) {
+    assertNormal(NormFoldYeh, "x" ARABIC_YEH MAKSURA ARABIC_KAF, "x" YEH YEH ARABIC_KAF);
+    assertNormal(NormFoldKaf, ARABIC_YEH ARABIC_KAF "\xD8\xAA" ALEF "\xD8\xA8", ARABIC_YEH KITAAB);
+    assertNormal(NormFoldDigits, "\xD9\xA0\xD9\xA4\xD9\xA9 12", "\xDB\xB0\xDB\xB4\xDB\xB9 12");
+    assertNormal(NormFoldHamza, YEH HAMZA, YEH_HAMZA);
+    assertNormal(NormNone, ARABIC_YEH, ARABIC_YEH);
+
+    /* harakat stay on the folded letter */
+    assertNormal(NormUrdu, ARABIC_KAF FATHA "\xD8\xAA" ALEF "\xD8\xA8", KEHEH FATHA "\xD8\xAA" ALEF "\xD8\xA8");
+    assertNormal(NormUrdu, "abc " KITAAB " \xDB\xB1\xDB\xB2", "abc " KITAAB " \xDB\xB1\xDB\xB2");
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxNormalize_Nfc(void) {
+    assertNormal(NormNfc, ALEF MADDAH, ALEF_MADDA);
+    assertNormal(NormNfc, ALEF HAMZA ALEF HAMZA_BELOW, ALEF_HAMZA ALEF_HAMZA_BELOW);
+    assertNormal(NormNfc, HEH_GOAL HAMZA " " BARREE HAMZA " " WAW HAMZA, HEH_GOAL_HAMZA " " BARREE_HAMZA " " WAW_HAMZA);
+    assertNormal(NormNfc, ARABIC_YEH HAMZA, YEH_HAMZA);
+    assertNormal(NormNfc, ALEF_MADDA, ALEF_MADDA);
+
+    /* Urdu Yeh has no canonical hamza form: that is a folding */
+    assertNormal(NormNfc, YEH HAMZA, YEH HAMZA);
+    assertNormal(NormUrdu, YEH HAMZA, YEH_HAMZA);
+
+    /* composed before folding, so ي + ٔ does not stop at ی + ٔ */
+    assertNormal((UtxNormalize)(NormNfc | NormFoldYeh), ARABIC_YEH HAMZA ARABIC_YEH, YEH_HAMZA YEH);
+
+    /* marks in canonical order, and a lower class does not block */
+    assertNormal(NormNfc, "\xD8\xA8" SHADDA FATHA, "\xD8\xA8" FATHA SHADDA);
+    assertNormal(NormNfc, "\xD8\xA8" FATHA SHADDA, "\xD8\xA8" FATHA SHADDA);
+    assertNormal(NormNfc, WAW SHADDA HAMZA, WAW_HAMZA SHADDA);
+    assertNormal(NormNfc, ALEF HAMZA MADDAH, ALEF_HAMZA MADDAH);
+    assertNormal(NormNfc, SHADDA KASRA, KASRA SHADDA);
+
+    /* broken bytes go through as they are */
+    assertNormal(NormUrdu, "\xD9" ALEF MADDAH "\x80", "\xD9" ALEF_MADDA "\x80");
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxNormalize_Clean(void) {
+    String *text = str_c("");
+    for (uint32_t i = 0; i < 1000; ++i) {
+        str_cat(&text, i % 2 == 0 ? "plain ascii text, " : KITAAB " " YEH_HAMZA " " ALEF_MADDA "\n");
+    }
+    uint32_t size = str_len(text);
+    char_t *out = (char_t*)malloc(size);
+
+    for (int32_t simd = SimdScalar; simd <= SimdAvx2; ++simd) {
+        utxUtf8SetSimd((UtxSimd)simd);
+        TEST_ASSERT_EQUAL(size, utxNormalizeClean(NormUrdu, tc(text), size));
+        TEST_ASSERT_EQUAL(size, utxNormalizeText(NormUrdu, tc(text), size, out));
+        TEST_ASSERT_EQUAL_MEMORY(tc(text), out, size);
+    }
+
+    /* the first change is found wherever it is, and the cluster it is in */
+    for (uint32_t at = size - 100; at < size; ++at) {
+        if ((tc(text)[at] & 0xC0) == 0x80) {
+            continue;
+        }
+        String *dirty = str_cn(tc(text), at);
+        str_cat(&dirty, ALEF HAMZA);
+        str_cat(&dirty, tc(text) + at);
+        for (int32_t simd = SimdScalar; simd <= SimdAvx2; ++simd) {
+            utxUtf8SetSimd((UtxSimd)simd);
+            TEST_ASSERT_EQUAL(at, utxNormalizeClean(NormNfc, tc(dirty), str_len(dirty)));
+        }
+        str_destroy(&dirty);
+    }
+
+    free(out);
+    str_destroy(&text);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Every SIMD level agrees with the scalar path; normalizing twice changes
+ * nothing more, in place or not. */
+void test_utxNormalize_RandomAgreement(void) {
+    const char_t *pieces[] = {
+        ALEF, MADDAH, HAMZA, HAMZA_BELOW, ARABIC_YEH, MAKSURA, ARABIC_KAF, YEH, KEHEH, HEH_GOAL, WAW,
+        FATHA, KASRA, SHADDA, "\xD9\xB0", "\xDB\x96", "\xD8\x90", "\xD9\xA5", "\xDB\xB5",
+        " ", "a", "\n", "\xD9", "\x80", "\xE2\x80\x8C"
+    };
+    const UtxNormalize profiles[] = { NormNfc, NormFoldYeh, NormFoldHamza, NormUrdu, (UtxNormalize)(NormFoldKaf | NormFoldDigits) };
+    char_t text[512], expected[512], out[512];
+
+    for (uint32_t i = 0; i < 3000; ++i) {
+        uint32_t size = 0;
+        uint32_t count = (uint32_t)bmath_randi(0, 60);
+        for (uint32_t j = 0; j < count; ++j) {
+            const char_t *piece = pieces[bmath_randi(0, 24)];
+            uint32_t n = (uint32_t)strlen(piece);
+            memcpy(text + size, piece, n);
+            size += n;
+        }
+        UtxNormalize profile = profiles[bmath_randi(0, 4)];
+
+        utxUtf8SetSimd(SimdScalar);
+        uint32_t n = utxNormalizeText(profile, text, size, expected);
+        uint32_t clean = utxNormalizeClean(profile, text, size);
+        TEST_ASSERT_TRUE(n <= size);
+        TEST_ASSERT_TRUE(clean <= n);
+        TEST_ASSERT_EQUAL_MEMORY(text, expected, clean);
+        if (clean == size) {
+            TEST_ASSERT_EQUAL(size, n);
+        }
+
+        for (int32_t simd = SimdSse2; simd <= SimdAvx2; ++simd) {
+            utxUtf8SetSimd((UtxSimd)simd);
+            TEST_ASSERT_EQUAL(clean, utxNormalizeClean(profile, text, size));
+            TEST_ASSERT_EQUAL(n, utxNormalizeText(profile, text, size, out));
+            TEST_ASSERT_EQUAL_MEMORY(expected, out, n);
+        }
+
+        memcpy(out, text, size);
+        TEST_ASSERT_EQUAL(n, utxNormalizeText(profile, out, size, out));
+        TEST_ASSERT_EQUAL_MEMORY(expected, out, n);
+        TEST_ASSERT_EQUAL(n, utxNormalizeClean(profile, out, n));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxNormalize_File(void) {
+    const char_t *words[] = { "some text ", KITAAB " " };
+    char_t *text = (char_t*)malloc(150000 * 10);
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < 150000; ++i) {
+        uint32_t n = (uint32_t)strlen(words[i % 2]);
+        memcpy(text + size, words[i % 2], n);
+        size += n;
+    }
+    String *contents = str_cn(text, size);
+    free(text);
+    UtxFile *utx = utxCreateFromString(contents);
+    uint32_t normalized;
+
+    /* clean text is not touched */
+    TEST_ASSERT_EQUAL(ROkay, utxNormalize(utx, NormUrdu, 0, utxLength(utx), &normalized));
+    TEST_ASSERT_EQUAL(size, normalized);
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+
+    /* changes far apart, more than a window, undo as one */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 10, ARABIC_KAF, 2));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, size - 5, ALEF MADDAH, 4));
+    utxUndoBreak(utx);
+    TEST_ASSERT_EQUAL(ROkay, utxNormalize(utx, NormUrdu, 0, utxLength(utx), &normalized));
+    TEST_ASSERT_EQUAL(size + 4, normalized);
+    TEST_ASSERT_EQUAL(size + 4, utxLength(utx));
+    String *range = utxGetRange(utx, 10, 2);
+    TEST_ASSERT_EQUAL_STRING(KEHEH, tc(range));
+    str_destroy(&range);
+    range = utxGetRange(utx, size - 5, 2);
+    TEST_ASSERT_EQUAL_STRING(ALEF_MADDA, tc(range));
+    str_destroy(&range);
+
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    TEST_ASSERT_EQUAL(size + 6, utxLength(utx));
+    range = utxGetRange(utx, 10, 2);
+    TEST_ASSERT_EQUAL_STRING(ARABIC_KAF, tc(range));
+    str_destroy(&range);
+
+    /* a range is only that range */
+    TEST_ASSERT_EQUAL(ROkay, utxNormalize(utx, NormUrdu, 0, 12, &normalized));
+    TEST_ASSERT_EQUAL(12, normalized);
+    TEST_ASSERT_EQUAL(size + 6, utxLength(utx));
+    TEST_ASSERT_EQUAL(RInvalidRange, utxNormalize(utx, NormUrdu, 0, size + 7, NULL));
+
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxNormalize_OnInput(void) {
+    String *contents = str_c(ARABIC_YEH " " ALEF MADDAH);
+    UtxFile *utx = utxCreateNew();
+    utxSetNormalize(utx, NormUrdu);
+
+    TEST_ASSERT_EQUAL(ROkay, utxSetContents(utx, contents));
+    String *text = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(YEH " " ALEF_MADDA, tc(text));
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+    str_destroy(&text);
+
+    /* pasted text is normalized, the text around it is not */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, ALEF, 2));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 2, ARABIC_KAF HAMZA " ", 5));
+    text = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(ALEF KEHEH HAMZA " " YEH " " ALEF_MADDA, tc(text));
+    str_destroy(&text);
+
+    utxSetNormalize(utx, NormNone);
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, ARABIC_YEH, 2));
+    text = utxGetRange(utx, 0, 2);
+    TEST_ASSERT_EQUAL_STRING(ARABIC_YEH, tc(text));
+    str_destroy(&text);
+
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxNormalize_Fold);
+    RUN_TEST(test_utxNormalize_Nfc);
+    RUN_TEST(test_utxNormalize_Clean);
+    RUN_TEST(test_utxNormalize_RandomAgreement);
+    RUN_TEST(test_utxNormalize_File);
+    RUN_TEST(test_utxNormalize_OnInput);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
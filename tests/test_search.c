@@ -0,0 +1,274 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "buffer.h"
+#include "search.h"
+#include "utf8.h"
+
+/* "بِسْمِ اللّٰهِ" and "بسم" */
+static const char_t BISMILLAH[] = "\xD8\xA8\xD9\x90\xD8\xB3\xD9\x92\xD9\x85\xD9\x90 \xD8\xA7\xD9\x84\xD9\x84\xD9\x91\xD9\xB0\xD9\x87\xD9\x90";
+static const char_t BSM[] = "\xD8\xA8\xD8\xB3\xD9\x85";
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utxUtf8SetSimd(SimdAuto);
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+/* Splits the text into pieces of `piece` bytes, so that matches cross them. */
+static UtxBuffer* pieceBuffer(const char_t *text, uint32_t size, uint32_t piece) {
+    UtxBuffer *buffer = utxBufferCreate();
+    for (uint32_t i = 0; i < size; i += piece) {
+        uint32_t n = size - i < piece ? size - i : piece;
+        utxBufferInsert(buffer, i, text + i, n);
+    }
+    return buffer;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t isHaraka(const char_t *s, uint32_t n) {
+    return n >= 2 && (byte_t)s[0] == 0xD9 && (((byte_t)s[1] >= 0x8B && (byte_t)s[1] <= 0x9F) || (byte_t)s[1] == 0xB0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Byte by byte, no prefilter: what every SIMD level has to agree with. */
+static uint32_t referenceMatch(const char_t *text, uint32_t size, uint32_t at, const char_t *pattern, uint32_t psize, UtxSearchMode mode) {
+    uint32_t t = at;
+    for (uint32_t j = 0; j < psize;) {
+        if (mode == SearchNoHarakat && isHaraka(pattern + j, psize - j)) {
+            j += 2;
+            continue;
+        }
+        if (t >= size || text[t] != pattern[j]) {
+            return 0;
+        }
+        t += 1;
+        j += 1;
+        bool_t boundary = j == psize || ((byte_t)pattern[j] & 0xC0) != 0x80;
+        if (mode == SearchNoHarakat && boundary) {
+            while (isHaraka(text + t, size - t)) {
+                t += 2;
+            }
+        }
+    }
+    return t - at;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSearch_Create(void) {
+    TEST_ASSERT_NULL(utxSearchCreate(NULL, 3, SearchExact));
+    TEST_ASSERT_NULL(utxSearchCreate("abc", 0, SearchExact));
+    /* only harakat: nothing left */
+    TEST_ASSERT_NULL(utxSearchCreate("\xD9\x90\xD9\x92", 4, SearchNoHarakat));
+    /* not UTF-8: a stray continuation byte, a broken or a cut off sequence */
+    TEST_ASSERT_NULL(utxSearchCreate("\xA8", 1, SearchExact));
+    TEST_ASSERT_NULL(utxSearchCreate("\xA8\xD8\xA8", 3, SearchNoHarakat));
+    TEST_ASSERT_NULL(utxSearchCreate("a\xD8z", 3, SearchExact));
+    TEST_ASSERT_NULL(utxSearchCreate("\xD8\xA7\xD8", 3, SearchExact));
+
+    UtxSearch *search = utxSearchCreate("\xD9\x90\xD9\x92", 4, SearchExact);
+    TEST_ASSERT_NOT_NULL(search);
+    utxSearchDestroy(&search);
+    TEST_ASSERT_NULL(search);
+
+    TEST_ASSERT_TRUE(utxIsHaraka("\xD9\xB0", 2));
+    TEST_ASSERT_FALSE(utxIsHaraka("\xD9\x85", 2));
+    TEST_ASSERT_FALSE(utxIsHaraka("\xD9", 1));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSearch_Harakat(void) {
+    uint32_t size = (uint32_t)strlen(BISMILLAH);
+    UtxBuffer *buffer = pieceBuffer(BISMILLAH, size, 3);
+    uint32_t offset = 0, msize = 0;
+
+    UtxSearch *exact = utxSearchCreate(BSM, 6, SearchExact);
+    TEST_ASSERT_FALSE(utxSearchNext(exact, buffer, 0, &offset, &msize));
+
+    /* the match takes in the harakat of its last letter too */
+    UtxSearch *loose = utxSearchCreate(BSM, 6, SearchNoHarakat);
+    TEST_ASSERT_TRUE(utxSearchNext(loose, buffer, 0, &offset, &msize));
+    TEST_ASSERT_EQUAL_UINT32(0, offset);
+    TEST_ASSERT_EQUAL_UINT32(12, msize);
+    TEST_ASSERT_FALSE(utxSearchNext(loose, buffer, 1, &offset, &msize));
+
+    /* a pattern with harakat finds the bare word as well */
+    UtxSearch *marked = utxSearchCreate("\xD9\x84\xD9\x84\xD9\x91\xD9\x87", 8, SearchNoHarakat);
+    TEST_ASSERT_TRUE(utxSearchNext(marked, buffer, 0, &offset, &msize));
+    TEST_ASSERT_EQUAL_UINT32(15, offset);
+    TEST_ASSERT_EQUAL_UINT32(size - 15, msize);
+
+    utxSearchDestroy(&exact);
+    utxSearchDestroy(&loose);
+    utxSearchDestroy(&marked);
+    utxBufferDestroy(&buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSearch_RandomAgreement(void) {
+    /* ASCII, "ب", "س", "م", kasra, sukun, "ل" */
+    static const char_t *TOKENS[] = {
+        "a", " ", "\xD8\xA8", "\xD8\xB3", "\xD9\x85", "\xD9\x90", "\xD9\x92", "\xD9\x84"
+    };
+    const uint32_t CAPACITY = 2048;
+    char_t *text = heap_new_n(CAPACITY, char_t);
+    bmath_rand_seed(148);
+
+    for (uint32_t round = 0; round < 200; ++round) {
+        uint32_t size = 0;
+        uint32_t target = (uint32_t)bmath_randi(64, (int32_t)CAPACITY - 8);
+        while (size < target) {
+            const char_t *token = TOKENS[bmath_randi(0, 7)];
+            uint32_t n = (uint32_t)strlen(token);
+            memcpy(text + size, token, n);
+            size += n;
+        }
+
+        /* a pattern taken from the text, starting at a character */
+        uint32_t at = (uint32_t)bmath_randi(0, (int32_t)size - 8);
+        while (((byte_t)text[at] & 0xC0) == 0x80) {
+            at -= 1;
+        }
+        uint32_t psize = (uint32_t)bmath_randi(1, 8);
+        while (at + psize < size && ((byte_t)text[at + psize] & 0xC0) == 0x80) {
+            psize += 1;
+        }
+
+        UtxSearchMode mode = round % 2 == 0 ? SearchExact : SearchNoHarakat;
+        UtxSearch *search = utxSearchCreate(text + at, psize, mode);
+        UtxBuffer *buffer = pieceBuffer(text, size, (uint32_t)bmath_randi(1, 64));
+
+        for (int32_t simd = SimdScalar; simd <= SimdAvx2; ++simd) {
+            utxUtf8SetSimd((UtxSimd)simd);
+            uint32_t from = 0, offset = 0, msize = 0;
+            for (uint32_t i = 0; i < size; ++i) {
+                uint32_t m = search != NULL ? referenceMatch(text, size, i, text + at, psize, mode) : 0;
+                if (m == 0 || i < from || (mode == SearchNoHarakat && isHaraka(text + i, size - i))) {
+                    continue;
+                }
+                TEST_ASSERT_TRUE(utxSearchNext(search, buffer, from, &offset, &msize));
+                TEST_ASSERT_EQUAL_UINT32(i, offset);
+                TEST_ASSERT_EQUAL_UINT32(m, msize);
+                from = i + 1;
+            }
+            TEST_ASSERT_FALSE(utxSearchNext(search, buffer, from, &offset, &msize));
+        }
+
+        utxSearchDestroy(&search);
+        utxBufferDestroy(&buffer);
+    }
+
+    heap_delete_n(&text, CAPACITY, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxReplaceAll(void) {
+    String *contents = str_c("one two one three one");
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxSearch *search = utxSearchCreate("one", 3, SearchExact);
+    uint32_t count = 0;
+
+    TEST_ASSERT_EQUAL_UINT32(3, utxSearchCount(search, utx->buffer));
+    TEST_ASSERT_EQUAL_UINT32(0, utxSearchCount(search, NULL));
+    TEST_ASSERT_EQUAL(ROkay, utxReplaceAll(utx, search, "1", 1, &count));
+    TEST_ASSERT_EQUAL_UINT32(3, count);
+    String *replaced = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING("1 two 1 three 1", tc(replaced));
+    str_destroy(&replaced);
+
+    TEST_ASSERT_EQUAL(RNotFound, utxReplaceAll(utx, search, "1", 1, &count));
+    TEST_ASSERT_EQUAL_UINT32(0, count);
+
+    /* one undo step restores every match */
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    String *restored = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(tc(contents), tc(restored));
+    str_destroy(&restored);
+    TEST_ASSERT_EQUAL(ROkay, utxRedo(utx, NULL));
+    replaced = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING("1 two 1 three 1", tc(replaced));
+    str_destroy(&replaced);
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+
+    uint32_t offset = 0, size = 0;
+    TEST_ASSERT_EQUAL(ROkay, utxFind(utx, search, 1, &offset, &size));
+    TEST_ASSERT_EQUAL_UINT32(8, offset);
+    TEST_ASSERT_EQUAL(RNotFound, utxFind(utx, search, 19, &offset, &size));
+
+    TEST_ASSERT_EQUAL(ROkay, utxReplaceAll(utx, search, NULL, 0, &count));
+    String *removed = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(" two  three ", tc(removed));
+    str_destroy(&removed);
+
+    utxSearchDestroy(&search);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+/* "اب x": a pattern of the second byte of "ب" would match inside it; it is
+ * refused, and replacing with no search changes nothing. */
+void test_utxReplaceAll_MidCharacter(void) {
+    String *contents = str_c("\xD8\xA7\xD8\xA8 x");
+    UtxFile *utx = utxCreateFromString(contents);
+    utxSetFilePath(utx, "/tmp/replace.txt");
+    uint32_t generation = utxGeneration(utx);
+    UtxSearch *search = utxSearchCreate("\xA8", 1, SearchExact);
+    uint32_t count = 7;
+
+    TEST_ASSERT_NULL(search);
+    TEST_ASSERT_EQUAL(RInvalidContents, utxReplaceAll(utx, search, "b", 1, &count));
+    TEST_ASSERT_EQUAL_UINT32(0, count);
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+    TEST_ASSERT_FALSE(utx->isModified);
+    TEST_ASSERT_EQUAL_UINT32(generation, utxGeneration(utx));
+    String *unchanged = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(tc(contents), tc(unchanged));
+    str_destroy(&unchanged);
+
+    /* a whole character still matches */
+    search = utxSearchCreate("\xD8\xA8", 2, SearchExact);
+    TEST_ASSERT_EQUAL(ROkay, utxReplaceAll(utx, search, "b", 1, &count));
+    TEST_ASSERT_EQUAL_UINT32(1, count);
+    TEST_ASSERT_TRUE(utxCanUndo(utx));
+    TEST_ASSERT_TRUE(utx->isModified);
+
+    utxSearchDestroy(&search);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxSearch_Create);
+    RUN_TEST(test_utxSearch_Harakat);
+    RUN_TEST(test_utxSearch_RandomAgreement);
+    RUN_TEST(test_utxReplaceAll);
+    RUN_TEST(test_utxReplaceAll_MidCharacter);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,213 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "segment.h"
+
+/* ب ا ک ت پ ڑ ھ و ی گ, fatha, kasra, shadda, ZWNJ */
+#define BEH "\xD8\xA8"
+#define ALEF "\xD8\xA7"
+#define KEHEH "\xDA\xA9"
+#define TEH "\xD8\xAA"
+#define PEH "\xD9\xBE"
+#define RREH "\xDA\x91"
+#define DO_CHASHMI "\xDA\xBE"
+#define WAW "\xD9\x88"
+#define YEH "\xDB\x8C"
+#define GAF "\xDA\xAF"
+#define FATHA "\xD9\x8E"
+#define KASRA "\xD9\x90"
+#define SHADDA "\xD9\x91"
+#define ZWNJ "\xE2\x80\x8C"
+/* ۱ ۲ ۳ ۴, Arabic comma, number sign */
+#define ONE "\xDB\xB1"
+#define TWO "\xDB\xB2"
+#define THREE "\xDB\xB3"
+#define FOUR "\xDB\xB4"
+#define COMMA "\xD8\x8C"
+#define NUMBER_SIGN "\xD8\x80"
+/* man, woman, regional indicators P K U S, ZWJ */
+#define MAN "\xF0\x9F\x91\xA8"
+#define WOMAN "\xF0\x9F\x91\xA9"
+#define RI_P "\xF0\x9F\x87\xB5"
+#define RI_K "\xF0\x9F\x87\xB0"
+#define RI_U "\xF0\x9F\x87\xBA"
+#define RI_S "\xF0\x9F\x87\xB8"
+#define ZWJ "\xE2\x80\x8D"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t graphemeNext(const char_t *text, uint32_t offset) {
+    return utxGraphemeNext(text, (uint32_t)strlen(text), offset);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t wordNext(const char_t *text, uint32_t offset) {
+    return utxWordNext(text, (uint32_t)strlen(text), offset);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSegment_Graphemes(void) {
+    const char_t *harakat = BEH FATHA SHADDA ALEF;
+    TEST_ASSERT_EQUAL_UINT32(6, graphemeNext(harakat, 0));
+    TEST_ASSERT_EQUAL_UINT32(6, graphemeNext(harakat, 3));
+    TEST_ASSERT_EQUAL_UINT32(8, graphemeNext(harakat, 6));
+    TEST_ASSERT_EQUAL_UINT32(0, utxGraphemePrev(harakat, 8, 6));
+    TEST_ASSERT_EQUAL_UINT32(6, utxGraphemePrev(harakat, 8, 8));
+    TEST_ASSERT_EQUAL_UINT32(0, utxGraphemePrev(harakat, 8, 4));
+
+    TEST_ASSERT_EQUAL_UINT32(2, graphemeNext("\r\nx", 0));
+    TEST_ASSERT_EQUAL_UINT32(1, graphemeNext("\n\rx", 0));
+    TEST_ASSERT_EQUAL_UINT32(11, graphemeNext(MAN ZWJ WOMAN, 0));
+    TEST_ASSERT_EQUAL_UINT32(4, graphemeNext(MAN WOMAN, 0));
+
+    /* flags pair up from the first indicator, wherever the caret is */
+    const char_t *flags = RI_P RI_K RI_U RI_S;
+    TEST_ASSERT_EQUAL_UINT32(8, graphemeNext(flags, 0));
+    TEST_ASSERT_EQUAL_UINT32(16, graphemeNext(flags, 12));
+    TEST_ASSERT_EQUAL_UINT32(8, utxGraphemePrev(flags, 16, 16));
+    TEST_ASSERT_EQUAL_UINT32(8, utxGraphemePrev(flags, 16, 12));
+
+    /* Hangul jamo, a Devanagari vowel sign, a prepended number sign */
+    TEST_ASSERT_EQUAL_UINT32(9, graphemeNext("\xE1\x84\x92\xE1\x85\xA1\xE1\x86\xAB", 0));
+    TEST_ASSERT_EQUAL_UINT32(6, graphemeNext("\xE0\xA4\x95\xE0\xA4\xBF", 0));
+    TEST_ASSERT_EQUAL_UINT32(4, graphemeNext(NUMBER_SIGN ONE, 0));
+
+    TEST_ASSERT_EQUAL_UINT32(0, utxGraphemeNext(NULL, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, utxGraphemePrev("", 0, 0));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSegment_Words(void) {
+    uint32_t start = 0, end = 0;
+    const char_t *latin = "can't stop";
+    TEST_ASSERT_TRUE(utxWordAt(latin, 10, 1, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(0, start);
+    TEST_ASSERT_EQUAL_UINT32(5, end);
+    TEST_ASSERT_FALSE(utxWordAt(latin, 10, 5, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(6, end);
+    TEST_ASSERT_TRUE(utxWordAt(latin, 10, 10, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(6, start);
+    TEST_ASSERT_EQUAL_UINT32(5, utxWordPrev(latin, 10, 6));
+
+    TEST_ASSERT_EQUAL_UINT32(1, wordNext("a. b", 0));
+    TEST_ASSERT_EQUAL_UINT32(2, wordNext("a. b", 1));
+    TEST_ASSERT_EQUAL_UINT32(1, wordNext("a.", 0));
+    TEST_ASSERT_EQUAL_UINT32(4, wordNext("3.14", 0));
+    TEST_ASSERT_EQUAL_UINT32(1, wordNext("3.a", 0));
+    TEST_ASSERT_EQUAL_UINT32(3, wordNext("a  b", 1));
+
+    /* harakat and a ZWNJ stay inside the word */
+    const char_t *urdu = KEHEH KASRA TEH ALEF BEH " " PEH RREH DO_CHASHMI WAW;
+    uint32_t size = (uint32_t)strlen(urdu);
+    TEST_ASSERT_TRUE(utxWordAt(urdu, size, 2, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(0, start);
+    TEST_ASSERT_EQUAL_UINT32(10, end);
+    TEST_ASSERT_TRUE(utxWordAt(urdu, size, 12, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(11, start);
+    TEST_ASSERT_EQUAL_UINT32(size, end);
+    TEST_ASSERT_EQUAL_UINT32(11, utxWordPrev(urdu, size, size));
+    TEST_ASSERT_EQUAL_UINT32(10, utxWordPrev(urdu, size, 11));
+    TEST_ASSERT_EQUAL_UINT32(9, wordNext(YEH ZWNJ GAF ALEF, 0));
+
+    /* ۱۲،۳۴ is one number */
+    TEST_ASSERT_EQUAL_UINT32(10, wordNext(ONE TWO COMMA THREE FOUR, 0));
+    TEST_ASSERT_EQUAL_UINT32(4, wordNext(ONE TWO COMMA " ", 0));
+
+    TEST_ASSERT_FALSE(utxWordAt(NULL, 0, 0, &start, &end));
+    TEST_ASSERT_EQUAL_UINT32(0, end);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The boundaries around any offset agree with those found walking the text
+ * from its start, whatever point the scan goes back to. */
+void test_utxSegment_RandomAgreement(void) {
+    const char_t *pieces[] = {
+        BEH, ALEF, KEHEH, FATHA, SHADDA, ZWNJ, ZWJ, ONE, COMMA, NUMBER_SIGN,
+        MAN, RI_P, RI_K, " ", ".", "'", "3", "a", "\r", "\n", "\xE1\x84\x92", "\xE1\x85\xA1", "\xD9"
+    };
+    char_t text[512];
+    bool_t graphemes[513], words[513];
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t size = 0;
+        uint32_t count = (uint32_t)bmath_randi(0, 40);
+        for (uint32_t j = 0; j < count; ++j) {
+            const char_t *piece = pieces[bmath_randi(0, 22)];
+            uint32_t n = (uint32_t)strlen(piece);
+            memcpy(text + size, piece, n);
+            size += n;
+        }
+
+        memset(graphemes, 0, sizeof(graphemes));
+        memset(words, 0, sizeof(words));
+        graphemes[0] = words[0] = TRUE;
+        for (uint32_t b = 0; b < size; b = utxGraphemeNext(text, size, b)) {
+            graphemes[utxGraphemeNext(text, size, b)] = TRUE;
+        }
+        for (uint32_t b = 0; b < size; b = utxWordNext(text, size, b)) {
+            words[utxWordNext(text, size, b)] = TRUE;
+        }
+
+        for (uint32_t offset = 0; offset <= size; ++offset) {
+            uint32_t next = offset < size ? offset + 1 : size;
+            uint32_t nextWord = next;
+            while (next < size && !graphemes[next]) {
+                next += 1;
+            }
+            while (nextWord < size && !words[nextWord]) {
+                nextWord += 1;
+            }
+            uint32_t prev = offset > 0 ? offset - 1 : 0;
+            uint32_t prevWord = prev;
+            while (prev > 0 && !graphemes[prev]) {
+                prev -= 1;
+            }
+            while (prevWord > 0 && !words[prevWord]) {
+                prevWord -= 1;
+            }
+
+            TEST_ASSERT_EQUAL_UINT32(next, utxGraphemeNext(text, size, offset));
+            TEST_ASSERT_EQUAL_UINT32(prev, utxGraphemePrev(text, size, offset));
+            TEST_ASSERT_EQUAL_UINT32(nextWord, utxWordNext(text, size, offset));
+            TEST_ASSERT_EQUAL_UINT32(prevWord, utxWordPrev(text, size, offset));
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxSegment_Graphemes);
+    RUN_TEST(test_utxSegment_Words);
+    RUN_TEST(test_utxSegment_RandomAgreement);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,334 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <osbs/bthread.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "dict.h"
+#include "spell.h"
+
+/* اور, کتاب, دار, قلم; قلمم is misspelled */
+#define AUR "\xD8\xA7\xD9\x88\xD8\xB1"
+#define KITAAB "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8"
+#define DAAR "\xD8\xAF\xD8\xA7\xD8\xB1"
+#define QALAM "\xD9\x82\xD9\x84\xD9\x85"
+#define WRONG "\xD9\x82\xD9\x84\xD9\x85\xD9\x85"
+#define ZWNJ "\xE2\x80\x8C"
+#define ZABAR "\xD9\x8E"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static UtxDict* createDict(String **path) {
+    /* in sorted order */
+    const char_t *words[] = { AUR, DAAR, QALAM, KITAAB };
+    UtxDictBuilder *builder = utxDictBuilderCreate();
+    for (uint32_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, words[i], (uint32_t)strlen(words[i])));
+    }
+
+    String *name = str_printf("kaatib-%d-%d.dawg", bmath_randi(0, 999999), bmath_randi(0, 999999));
+    *path = hfile_tmp_path(tc(name));
+    str_destroy(&name);
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderWrite(builder, tc(*path)));
+    utxDictBuilderDestroy(&builder);
+
+    ferror_t error;
+    UtxDict *dict = utxDictOpen(tc(*path), &error);
+    TEST_ASSERT_NOT_NULL(dict);
+    return dict;
+}
+
+/*----------------------------------------------------------------------------*/
+static void destroyDict(UtxDict **dict, String **path) {
+    ferror_t error;
+    utxDictClose(dict);
+    bfile_delete(tc(*path), &error);
+    str_destroy(path);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t isWord(const UtxDict *dict, const char_t *word) {
+    return utxSpellWord(dict, word, (uint32_t)strlen(word));
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t offsetOf(const char_t *text, const char_t *word) {
+    return (uint32_t)(strstr(text, word) - text);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Runs checks until nothing is left dirty. */
+static void checkAll(UtxSpell *spell) {
+    while (utxSpellCheck(spell)) {
+        utxSpellWait(spell);
+    }
+    TEST_ASSERT_FALSE(utxSpellBusy(spell));
+    TEST_ASSERT_EQUAL(0, utxSpellDirty(spell));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSpellWord(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+
+    TEST_ASSERT_TRUE(isWord(dict, KITAAB));
+    TEST_ASSERT_FALSE(isWord(dict, WRONG));
+
+    /* harakat and tatweel are not spelling */
+    TEST_ASSERT_TRUE(isWord(dict, "\xDA\xA9" ZABAR "\xD8\xAA\xD8\xA7\xD8\xA8"));
+    TEST_ASSERT_TRUE(isWord(dict, "\xDA\xA9\xD9\x80\xD8\xAA\xD8\xA7\xD8\xA8"));
+
+    /* the space may be left out after a letter that does not join */
+    TEST_ASSERT_TRUE(isWord(dict, AUR KITAAB));
+    TEST_ASSERT_TRUE(isWord(dict, AUR AUR QALAM));
+    TEST_ASSERT_FALSE(isWord(dict, AUR WRONG));
+
+    /* after a joining letter it takes a ZWNJ */
+    TEST_ASSERT_TRUE(isWord(dict, KITAAB ZWNJ DAAR));
+    TEST_ASSERT_FALSE(isWord(dict, KITAAB DAAR));
+    TEST_ASSERT_FALSE(isWord(dict, KITAAB ZWNJ WRONG));
+
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSpell_Check(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    const char_t *text = AUR " " KITAAB " " WRONG ", dog " AUR KITAAB " " KITAAB ZWNJ DAAR "\n" KITAAB DAAR;
+    String *contents = str_c(text);
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxSpell *spell = utxSpellCreate(dict);
+    uint32_t spans[8];
+
+    utxSpellWatch(spell, utx);
+    TEST_ASSERT_EQUAL(1, utxSpellDirty(spell));
+    TEST_ASSERT_TRUE(utxSpellCheck(spell));
+    TEST_ASSERT_TRUE(utxSpellBusy(spell));
+    TEST_ASSERT_FALSE(utxSpellCheck(spell));
+    while (!utxSpellUpdate(spell)) {
+        bthread_sleep(1);
+    }
+    TEST_ASSERT_FALSE(utxSpellBusy(spell));
+
+    TEST_ASSERT_EQUAL(2, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(2, utxSpellQuery(spell, 0, utxLength(utx), spans, 4));
+    TEST_ASSERT_EQUAL(offsetOf(text, WRONG), spans[0]);
+    TEST_ASSERT_EQUAL(strlen(WRONG), spans[1]);
+    TEST_ASSERT_EQUAL(offsetOf(text, "\n") + 1, spans[2]);
+    TEST_ASSERT_EQUAL(strlen(KITAAB DAAR), spans[3]);
+
+    /* only what overlaps the range asked for */
+    TEST_ASSERT_EQUAL(1, utxSpellQuery(spell, spans[0] + spans[1], utxLength(utx), spans + 4, 2));
+    TEST_ASSERT_EQUAL(spans[2], spans[4]);
+    TEST_ASSERT_EQUAL(1, utxSpellQuery(spell, 0, spans[0] + 1, spans + 4, 2));
+    TEST_ASSERT_EQUAL(0, utxSpellQuery(spell, 0, spans[0], spans + 4, 2));
+    TEST_ASSERT_EQUAL(1, utxSpellQuery(spell, 0, utxLength(utx), spans + 4, 1));
+
+    utxSpellDestroy(&spell);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSpell_Edit(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *contents = str_c(AUR " " WRONG " " KITAAB DAAR);
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxSpell *spell = utxSpellCreate(dict);
+    uint32_t spans[4];
+    uint32_t wrong = (uint32_t)strlen(AUR " ");
+    uint32_t joined = (uint32_t)strlen(AUR " " WRONG " ");
+
+    utxSpellWatch(spell, utx);
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(2, utxSpellCount(spell));
+
+    /* fixing the word drops its span at once and moves the next one */
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, wrong + (uint32_t)strlen(QALAM), 2));
+    TEST_ASSERT_EQUAL(1, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(1, utxSpellQuery(spell, 0, utxLength(utx), spans, 2));
+    TEST_ASSERT_EQUAL(joined - 2, spans[0]);
+    TEST_ASSERT_EQUAL(1, utxSpellDirty(spell));
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(1, utxSpellCount(spell));
+
+    /* a ZWNJ typed into the joined words makes them two */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, joined - 2 + (uint32_t)strlen(KITAAB), ZWNJ, 3));
+    TEST_ASSERT_EQUAL(0, utxSpellCount(spell));
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(0, utxSpellCount(spell));
+
+    /* undo goes through the same path */
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(1, utxSpellCount(spell));
+
+    /* text typed against a correct word joins it */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, KITAAB, (uint32_t)strlen(KITAAB)));
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(2, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(2, utxSpellQuery(spell, 0, utxLength(utx), spans, 2));
+    TEST_ASSERT_EQUAL(0, spans[0]);
+    TEST_ASSERT_EQUAL(strlen(KITAAB AUR), spans[1]);
+
+    utxSpellDestroy(&spell);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Spans past a slice boundary, and a check cancelled halfway. */
+void test_utxSpell_Large(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *contents = str_c("");
+    for (uint32_t i = 0; i < 20000; ++i) {
+        str_cat(&contents, i % 3 == 0 ? WRONG " " : KITAAB "\n");
+    }
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxSpell *spell = utxSpellCreate(dict);
+    uint32_t spans[6];
+
+    utxSpellWatch(spell, utx);
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(6667, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(3, utxSpellQuery(spell, 100000, utxLength(utx), spans, 3));
+    for (uint32_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_STRING_LEN(WRONG, tc(contents) + spans[2 * i], spans[2 * i + 1]);
+        TEST_ASSERT_EQUAL(strlen(WRONG), spans[2 * i + 1]);
+    }
+
+    /* the spans survive an edit made while the check runs */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, WRONG " ", (uint32_t)strlen(WRONG " ")));
+    TEST_ASSERT_TRUE(utxSpellCheck(spell));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "x", 1));
+    utxSpellWait(spell);
+    TEST_ASSERT_EQUAL(6667, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(1, utxSpellDirty(spell));
+    checkAll(spell);
+    TEST_ASSERT_EQUAL(6668, utxSpellCount(spell));
+    TEST_ASSERT_EQUAL(1, utxSpellQuery(spell, 0, 2, spans, 1));
+    TEST_ASSERT_EQUAL(1, spans[0]);
+
+    /* destroying a checker mid-check cancels it */
+    utxSpellWatch(spell, utx);
+    TEST_ASSERT_TRUE(utxSpellCheck(spell));
+    utxSpellDestroy(&spell);
+
+    utxDestroy(&utx);
+    str_destroy(&contents);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Checks made while editing agree with a check of the final text. */
+void test_utxSpell_RandomAgreement(void) {
+    const char_t *pieces[] = { AUR, KITAAB, DAAR, QALAM, WRONG, ZWNJ, ZABAR, " ", "\n", "x", "," };
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *empty = str_c("");
+    UtxFile *utx = utxCreateFromString(empty);
+    UtxSpell *spell = utxSpellCreate(dict);
+    utxSpellWatch(spell, utx);
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t length = utxLength(utx);
+        String *contents = utxGetContents(utx);
+        uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length);
+        while (offset < length && (tc(contents)[offset] & 0xC0) == 0x80) {
+            offset += 1;
+        }
+
+        if (length > 0 && bmath_randi(0, 2) == 0) {
+            uint32_t end = offset + (uint32_t)bmath_randi(1, 12);
+            end = end < length ? end : length;
+            while (end < length && (tc(contents)[end] & 0xC0) == 0x80) {
+                end += 1;
+            }
+            TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, offset, end - offset));
+        } else {
+            const char_t *piece = pieces[bmath_randi(0, 10)];
+            TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, offset, piece, (uint32_t)strlen(piece)));
+        }
+        str_destroy(&contents);
+
+        if (i % 5 == 0) {
+            utxSpellCheck(spell);
+        }
+        if (i % 3 == 0) {
+            utxSpellUpdate(spell);
+        }
+    }
+
+    utxSpellWait(spell);
+    checkAll(spell);
+
+    String *contents = utxGetContents(utx);
+    UtxFile *fresh = utxCreateFromString(contents);
+    UtxSpell *check = utxSpellCreate(dict);
+    utxSpellWatch(check, fresh);
+    checkAll(check);
+
+    uint32_t count = utxSpellCount(check);
+    TEST_ASSERT_EQUAL(count, utxSpellCount(spell));
+    uint32_t *expected = (uint32_t*)malloc((count + 1) * 2 * sizeof(uint32_t));
+    uint32_t *actual = (uint32_t*)malloc((count + 1) * 2 * sizeof(uint32_t));
+    TEST_ASSERT_EQUAL(count, utxSpellQuery(check, 0, utxLength(fresh), expected, count));
+    TEST_ASSERT_EQUAL(count, utxSpellQuery(spell, 0, utxLength(utx), actual, count));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, actual, 2 * count);
+    free(expected);
+    free(actual);
+
+    utxSpellDestroy(&check);
+    utxDestroy(&fresh);
+    str_destroy(&contents);
+    utxSpellDestroy(&spell);
+    utxDestroy(&utx);
+    str_destroy(&empty);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxSpellWord);
+    RUN_TEST(test_utxSpell_Check);
+    RUN_TEST(test_utxSpell_Edit);
+    RUN_TEST(test_utxSpell_Large);
+    RUN_TEST(test_utxSpell_RandomAgreement);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
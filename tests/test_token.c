@@ -0,0 +1,441 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "dict.h"
+#include "search.h"
+#include "token.h"
+
+/* اور, کتاب, دار, قلم; قلمم is not a word */
+#define AUR "\xD8\xA7\xD9\x88\xD8\xB1"
+#define KITAAB "\xDA\xA9\xD8\xAA\xD8\xA7\xD8\xA8"
+#define DAAR "\xD8\xAF\xD8\xA7\xD8\xB1"
+#define QALAM "\xD9\x82\xD9\x84\xD9\x85"
+#define WRONG "\xD9\x82\xD9\x84\xD9\x85\xD9\x85"
+#define ZWNJ "\xE2\x80\x8C"
+#define ZABAR "\xD9\x8E"
+#define COMMA "\xD8\x8C"
+#define NBSP "\xC2\xA0"
+/* ۱۲۳٫۴ */
+#define NUMBER "\xDB\xB1\xDB\xB2\xDB\xB3\xD9\xAB\xDB\xB4"
+
+#define MAX_TOKENS 64
+
+/*----------------------------------------------------------------------------*/
+typedef struct _tokens_t Tokens;
+struct _tokens_t {
+    UtxToken items[MAX_TOKENS];
+    uint32_t count;
+    uint32_t stop;
+};
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static UtxDict* createDict(String **path) {
+    /* in sorted order */
+    const char_t *words[] = { AUR, DAAR, QALAM, KITAAB };
+    UtxDictBuilder *builder = utxDictBuilderCreate();
+    for (uint32_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxDictBuilderAdd(builder, words[i], (uint32_t)strlen(words[i])));
+    }
+
+    String *name = str_printf("kaatib-%d-%d.dawg", bmath_randi(0, 999999), bmath_randi(0, 999999));
+    *path = hfile_tmp_path(tc(name));
+    str_destroy(&name);
+    TEST_ASSERT_EQUAL(ROkay, utxDictBuilderWrite(builder, tc(*path)));
+    utxDictBuilderDestroy(&builder);
+
+    ferror_t error;
+    UtxDict *dict = utxDictOpen(tc(*path), &error);
+    TEST_ASSERT_NOT_NULL(dict);
+    return dict;
+}
+
+/*----------------------------------------------------------------------------*/
+static void destroyDict(UtxDict **dict, String **path) {
+    ferror_t error;
+    utxDictClose(dict);
+    bfile_delete(tc(*path), &error);
+    str_destroy(path);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t collect(Tokens *tokens, const UtxToken *token) {
+    TEST_ASSERT_TRUE(tokens->count < MAX_TOKENS);
+    tokens->items[tokens->count++] = *token;
+    return tokens->count != tokens->stop;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t tokenize(const char_t *text, const UtxDict *dict, Tokens *tokens) {
+    tokens->count = 0;
+    tokens->stop = 0;
+    return utxTokenize(text, (uint32_t)strlen(text), dict, (FPtr_utxToken)collect, tokens);
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertToken(const char_t *text, const UtxToken *token, const char_t *expected, UtxTokenKind kind) {
+    TEST_ASSERT_EQUAL(kind, token->kind);
+    TEST_ASSERT_EQUAL(strlen(expected), token->size);
+    TEST_ASSERT_EQUAL_STRING_LEN(expected, text + token->offset, token->size);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t countWord(uint32_t *words, const UtxToken *token) {
+    if (token->kind != TokenPunct) {
+        *words += 1;
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t countWords(const String *contents, const UtxDict *dict) {
+    uint32_t words = 0;
+    utxTokenize(tc(contents), str_len(contents), dict, (FPtr_utxToken)countWord, &words);
+    return words;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTokenize_Kinds(void) {
+    const char_t *text = KITAAB COMMA " abc123 " NUMBER " 3.14, x.y" NBSP "\xDA\xA9" ZABAR "\xD8\xAA\xD8\xA7\xD8\xA8\n" ZABAR " 5.";
+    Tokens tokens;
+
+    TEST_ASSERT_EQUAL(13, tokenize(text, NULL, &tokens));
+    TEST_ASSERT_EQUAL(13, tokens.count);
+    assertToken(text, &tokens.items[0], KITAAB, TokenWord);
+    assertToken(text, &tokens.items[1], COMMA, TokenPunct);
+    assertToken(text, &tokens.items[2], "abc123", TokenLatin);
+    assertToken(text, &tokens.items[3], NUMBER, TokenNumber);
+    assertToken(text, &tokens.items[4], "3.14", TokenNumber);
+    assertToken(text, &tokens.items[5], ",", TokenPunct);
+    assertToken(text, &tokens.items[6], "x", TokenLatin);
+    assertToken(text, &tokens.items[7], ".", TokenPunct);
+    assertToken(text, &tokens.items[8], "y", TokenLatin);
+    assertToken(text, &tokens.items[9], "\xDA\xA9" ZABAR "\xD8\xAA\xD8\xA7\xD8\xA8", TokenWord);
+    /* a haraka with no letter, and a separator with no digit after it */
+    assertToken(text, &tokens.items[10], ZABAR, TokenPunct);
+    assertToken(text, &tokens.items[11], "5", TokenNumber);
+    assertToken(text, &tokens.items[12], ".", TokenPunct);
+
+    /* the callback stops it */
+    tokens.count = 0;
+    tokens.stop = 2;
+    TEST_ASSERT_EQUAL(2, utxTokenize(text, (uint32_t)strlen(text), NULL, (FPtr_utxToken)collect, &tokens));
+    TEST_ASSERT_EQUAL(0, tokenize(" \n\t" NBSP, NULL, &tokens));
+
+    uint32_t length;
+    TEST_ASSERT_EQUAL(TokenWord, utxTokenChar(ZWNJ, 3, &length));
+    TEST_ASSERT_EQUAL(3, length);
+    TEST_ASSERT_EQUAL(TokenSpace, utxTokenChar(NBSP, 2, &length));
+    TEST_ASSERT_EQUAL(2, length);
+    TEST_ASSERT_EQUAL(TokenNumber, utxTokenChar(NUMBER, 2, &length));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTokenize_Split(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    const char_t *joined = AUR KITAAB " " KITAAB ZWNJ DAAR " " AUR WRONG " " KITAAB DAAR;
+    Tokens tokens;
+
+    /* without a dictionary, runs stay whole */
+    TEST_ASSERT_EQUAL(4, tokenize(joined, NULL, &tokens));
+
+    TEST_ASSERT_EQUAL(6, tokenize(joined, dict, &tokens));
+    assertToken(joined, &tokens.items[0], AUR, TokenWord);
+    assertToken(joined, &tokens.items[1], KITAAB, TokenWord);
+    assertToken(joined, &tokens.items[2], KITAAB, TokenWord);
+    assertToken(joined, &tokens.items[3], DAAR, TokenWord);
+    assertToken(joined, &tokens.items[4], AUR WRONG, TokenWord);
+    assertToken(joined, &tokens.items[5], KITAAB DAAR, TokenWord);
+
+    /* harakat stay with the letter before them */
+    const char_t *marked = AUR ZABAR QALAM;
+    TEST_ASSERT_EQUAL(2, tokenize(marked, dict, &tokens));
+    assertToken(marked, &tokens.items[0], AUR ZABAR, TokenWord);
+    assertToken(marked, &tokens.items[1], QALAM, TokenWord);
+
+    /* a known word is never split */
+    tokens.count = 0;
+    tokens.stop = 0;
+    TEST_ASSERT_TRUE(utxTokenSplit(dict, KITAAB, (uint32_t)strlen(KITAAB), (FPtr_utxToken)collect, &tokens));
+    TEST_ASSERT_EQUAL(1, tokens.count);
+    TEST_ASSERT_FALSE(utxTokenSplit(dict, AUR WRONG, (uint32_t)strlen(AUR WRONG), (FPtr_utxToken)collect, &tokens));
+    TEST_ASSERT_EQUAL(1, tokens.count);
+    TEST_ASSERT_FALSE(utxTokenSplit(NULL, KITAAB, (uint32_t)strlen(KITAAB), NULL, NULL));
+
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTokens_Edit(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *contents = str_c(AUR KITAAB "\n" QALAM ", 12\n\nabc " DAAR);
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxTokens *tokens = utxTokensCreate(dict);
+    UtxToken line[8];
+    UtxToken token;
+
+    utxTokensWatch(tokens, utx);
+    TEST_ASSERT_EQUAL(4, utxTokensPending(tokens));
+    TEST_ASSERT_EQUAL(6, utxTokensWords(tokens));
+    TEST_ASSERT_EQUAL(0, utxTokensPending(tokens));
+
+    /* offsets are into the whole text */
+    uint32_t second = (uint32_t)strlen(AUR KITAAB "\n");
+    TEST_ASSERT_EQUAL(3, utxTokensLine(tokens, 1, line, 8));
+    TEST_ASSERT_EQUAL(second, line[0].offset);
+    TEST_ASSERT_EQUAL(TokenPunct, line[1].kind);
+    TEST_ASSERT_EQUAL(TokenNumber, line[2].kind);
+    TEST_ASSERT_EQUAL(0, utxTokensLine(tokens, 2, line, 8));
+    TEST_ASSERT_EQUAL(1, utxTokensLine(tokens, 1, line, 1));
+    TEST_ASSERT_EQUAL(0, utxTokensLine(tokens, 4, line, 8));
+
+    TEST_ASSERT_TRUE(utxTokensAt(tokens, second + 2, &token));
+    TEST_ASSERT_EQUAL(second, token.offset);
+    TEST_ASSERT_EQUAL(strlen(QALAM), token.size);
+    TEST_ASSERT_TRUE(utxTokensAt(tokens, (uint32_t)strlen(AUR), &token));
+    TEST_ASSERT_EQUAL(strlen(AUR), token.offset);
+    TEST_ASSERT_FALSE(utxTokensAt(tokens, second - 1, &token));
+    TEST_ASSERT_FALSE(utxTokensAt(tokens, utxLength(utx), &token));
+
+    /* an edit inside a paragraph leaves the others alone */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, second, "x ", 2));
+    TEST_ASSERT_EQUAL(1, utxTokensPending(tokens));
+    TEST_ASSERT_EQUAL(7, utxTokensWords(tokens));
+
+    /* a break typed into a paragraph makes it two */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, (uint32_t)strlen(AUR), "\n", 1));
+    TEST_ASSERT_EQUAL(2, utxTokensPending(tokens));
+    TEST_ASSERT_EQUAL(7, utxTokensWords(tokens));
+    TEST_ASSERT_EQUAL(1, utxTokensLine(tokens, 1, line, 8));
+    TEST_ASSERT_EQUAL(strlen(AUR "\n"), line[0].offset);
+
+    /* and deleting breaks joins paragraphs back */
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, (uint32_t)strlen(AUR), 1));
+    TEST_ASSERT_EQUAL(7, utxTokensWords(tokens));
+    uint32_t end = utxLength(utx) - (uint32_t)strlen("abc " DAAR);
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, second, end - second));
+    TEST_ASSERT_EQUAL(1, utxTokensPending(tokens));
+    TEST_ASSERT_EQUAL(2, utxLineCount(utx));
+    TEST_ASSERT_EQUAL(4, utxTokensWords(tokens));
+
+    /* undo goes through the same path */
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    TEST_ASSERT_EQUAL(7, utxTokensWords(tokens));
+
+    utxTokensDestroy(&tokens);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs kept through random edits agree with the whole text tokenized
+ * at once. */
+void test_utxTokens_RandomAgreement(void) {
+    const char_t *pieces[] = { AUR, KITAAB, DAAR, QALAM, WRONG, ZWNJ, ZABAR, " ", "\n", "x", ",", "7" };
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *empty = str_c("");
+    UtxFile *utx = utxCreateFromString(empty);
+    UtxTokens *tokens = utxTokensCreate(dict);
+    UtxToken line[MAX_TOKENS];
+    utxTokensWatch(tokens, utx);
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t length = utxLength(utx);
+        String *contents = utxGetContents(utx);
+        uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length);
+        while (offset < length && (tc(contents)[offset] & 0xC0) == 0x80) {
+            offset += 1;
+        }
+
+        if (length > 0 && bmath_randi(0, 2) == 0) {
+            uint32_t end = offset + (uint32_t)bmath_randi(1, 12);
+            end = end < length ? end : length;
+            while (end < length && (tc(contents)[end] & 0xC0) == 0x80) {
+                end += 1;
+            }
+            TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, offset, end - offset));
+        } else {
+            const char_t *piece = pieces[bmath_randi(0, 11)];
+            TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, offset, piece, (uint32_t)strlen(piece)));
+        }
+        str_destroy(&contents);
+        TEST_ASSERT_TRUE(utxTokensPending(tokens) <= utxLineCount(utx));
+
+        if (i % 7 == 0) {
+            contents = utxGetContents(utx);
+            TEST_ASSERT_EQUAL(countWords(contents, dict), utxTokensWords(tokens));
+            str_destroy(&contents);
+        }
+
+        /* one line, as the editor asks for it */
+        if (i % 5 == 0) {
+            uint32_t l = (uint32_t)bmath_randi(0, (int32_t)utxLineCount(utx) - 1);
+            uint32_t start, stop = utxLength(utx);
+            Tokens expected;
+            TEST_ASSERT_EQUAL(ROkay, utxLineToOffset(utx, l, &start));
+            if (l + 1 < utxLineCount(utx)) {
+                TEST_ASSERT_EQUAL(ROkay, utxLineToOffset(utx, l + 1, &stop));
+            }
+            String *text = utxGetRange(utx, start, stop - start);
+            expected.count = 0;
+            expected.stop = 0;
+            utxTokenize(tc(text), str_len(text), dict, (FPtr_utxToken)collect, &expected);
+            str_destroy(&text);
+
+            uint32_t n = utxTokensLine(tokens, l, line, MAX_TOKENS);
+            TEST_ASSERT_EQUAL(expected.count < MAX_TOKENS ? expected.count : MAX_TOKENS, n);
+            for (uint32_t k = 0; k < n; ++k) {
+                TEST_ASSERT_EQUAL(start + expected.items[k].offset, line[k].offset);
+                TEST_ASSERT_EQUAL(expected.items[k].size, line[k].size);
+                TEST_ASSERT_EQUAL(expected.items[k].kind, line[k].kind);
+            }
+        }
+    }
+
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(countWords(contents, dict), utxTokensWords(tokens));
+    str_destroy(&contents);
+
+    utxTokensDestroy(&tokens);
+    utxDestroy(&utx);
+    str_destroy(&empty);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Many threads, one thread, and one line at a time agree; parts are cut
+ * inside long runs of paragraphs, never inside one. */
+void test_utxTokens_Parallel(void) {
+    String *path;
+    UtxDict *dict = createDict(&path);
+    String *contents = str_c("");
+    for (uint32_t i = 0; i < 40000; ++i) {
+        str_cat(&contents, i % 5 == 0 ? AUR KITAAB ", 12.5 " : KITAAB ZWNJ DAAR " x ");
+        if (i % 3 == 0 && i < 30000) {
+            str_cat(&contents, "\n");
+        }
+    }
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxTokens *many = utxTokensCreate(dict);
+    UtxTokens *one = utxTokensCreate(dict);
+    UtxToken a[MAX_TOKENS], b[MAX_TOKENS];
+    uint32_t words = countWords(contents, dict);
+
+    utxTokensWatch(many, utx);
+    utxTokensWatch(one, utx);
+    utxTokensUpdate(many, 4);
+    utxTokensUpdate(one, 1);
+    TEST_ASSERT_EQUAL(0, utxTokensPending(many));
+    TEST_ASSERT_EQUAL(words, utxTokensWords(many));
+    TEST_ASSERT_EQUAL(words, utxTokensWords(one));
+
+    uint32_t lines = utxLineCount(utx);
+    for (uint32_t l = 0; l + 1 < lines; ++l) {
+        uint32_t n = utxTokensLine(many, l, a, MAX_TOKENS);
+        TEST_ASSERT_EQUAL(n, utxTokensLine(one, l, b, MAX_TOKENS));
+        TEST_ASSERT_EQUAL_MEMORY(a, b, n * sizeof(UtxToken));
+    }
+
+    /* the last paragraph is long, and whole */
+    TEST_ASSERT_EQUAL(MAX_TOKENS, utxTokensLine(many, lines - 1, a, MAX_TOKENS));
+
+    /* edits at both ends, then an update of just those */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, QALAM " ", (uint32_t)strlen(QALAM " ")));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, utxLength(utx), "\n9", 2));
+    TEST_ASSERT_EQUAL(3, utxTokensPending(many));
+    utxTokensUpdate(many, 0);
+    TEST_ASSERT_EQUAL(words + 2, utxTokensWords(many));
+    TEST_ASSERT_EQUAL(words + 2, utxTokensWords(one));
+
+    utxTokensDestroy(&many);
+    utxTokensDestroy(&one);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+    destroyDict(&dict, &path);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSearch_WholeWord(void) {
+    const char_t *text = KITAAB " " KITAAB DAAR " " KITAAB ZWNJ DAAR " " KITAAB ZABAR ", x" KITAAB " " AUR KITAAB;
+    String *contents = str_c(text);
+    UtxFile *utx = utxCreateFromString(contents);
+    UtxSearch *search = utxSearchCreate(KITAAB, (uint32_t)strlen(KITAAB), SearchExact);
+    uint32_t expected[] = {
+        0,
+        (uint32_t)strlen(KITAAB " " KITAAB DAAR " "),
+        (uint32_t)strlen(KITAAB " " KITAAB DAAR " " KITAAB ZWNJ DAAR " "),
+        (uint32_t)strlen(KITAAB " " KITAAB DAAR " " KITAAB ZWNJ DAAR " " KITAAB ZABAR ", x"),
+    };
+    uint32_t from = 0, offset, size, count = 0;
+
+    /* inside a longer word, no; next to a ZWNJ, a haraka or Latin, yes */
+    utxSearchSetWholeWord(search, TRUE);
+    while (utxFind(utx, search, from, &offset, &size) == ROkay) {
+        TEST_ASSERT_TRUE(count < 4);
+        TEST_ASSERT_EQUAL(expected[count], offset);
+        from = offset + size;
+        count += 1;
+    }
+    TEST_ASSERT_EQUAL(4, count);
+
+    utxSearchSetWholeWord(search, FALSE);
+    from = 0;
+    count = 0;
+    while (utxFind(utx, search, from, &offset, &size) == ROkay) {
+        from = offset + size;
+        count += 1;
+    }
+    TEST_ASSERT_EQUAL(6, count);
+
+    utxSearchDestroy(&search);
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxTokenize_Kinds);
+    RUN_TEST(test_utxTokenize_Split);
+    RUN_TEST(test_utxTokens_Edit);
+    RUN_TEST(test_utxTokens_RandomAgreement);
+    RUN_TEST(test_utxTokens_Parallel);
+    RUN_TEST(test_utxSearch_WholeWord);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,201 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <core/hfile.h>
+#include <osbs/bfile.h>
+#include <osbs/bthread.h>
+#include <sewer/bmath.h>
+
+/* the macros record here whatever the library was built with */
+#if !defined(UTX_TRACE)
+    #define UTX_TRACE
+#endif
+#include "unity.h"
+#include "utx.h"
+#include "trace.h"
+
+#define RING_EVENTS 16384
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static String* tempPath(const char_t *extension) {
+    String *name = str_printf("kaatib-%d-%d.%s", bmath_randi(0, 999999), bmath_randi(0, 999999), extension);
+    String *path = hfile_tmp_path(tc(name));
+    str_destroy(&name);
+    return path;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Writes the trace and reads it back; free() the text. */
+static char_t* writeTrace(uint32_t *events) {
+    String *path = tempPath("json");
+    TEST_ASSERT_EQUAL(ROkay, utxTraceWrite(tc(path), events));
+
+    FILE *file = fopen(tc(path), "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char_t *text = (char_t*)malloc((size_t)size + 1);
+    TEST_ASSERT_EQUAL(size, (long)fread(text, 1, (size_t)size, file));
+    text[size] = '\0';
+    fclose(file);
+
+    ferror_t error;
+    bfile_delete(tc(path), &error);
+    str_destroy(&path);
+    return text;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t countOf(const char_t *text, const char_t *pattern) {
+    uint32_t n = 0;
+    for (const char_t *p = strstr(text, pattern); p != NULL; p = strstr(p + 1, pattern)) {
+        n += 1;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTrace_Spans(void) {
+    UTX_TRACE_BEGIN("load");
+    UTX_TRACE_COUNTER("bytes", 42);
+    UTX_TRACE_BEGIN("quote \" and \\");
+    UTX_TRACE_END("quote \" and \\");
+    UTX_TRACE_END("load");
+    TEST_ASSERT_EQUAL(5, utxTraceCount());
+
+    uint32_t events = 0;
+    char_t *text = writeTrace(&events);
+    TEST_ASSERT_EQUAL(5, events);
+    TEST_ASSERT_EQUAL(0, strncmp(text, "{\"traceEvents\":[", 16));
+    TEST_ASSERT_EQUAL(2, countOf(text, "\"name\":\"load\""));
+    TEST_ASSERT_EQUAL(2, countOf(text, "\"ph\":\"B\""));
+    TEST_ASSERT_EQUAL(2, countOf(text, "\"ph\":\"E\""));
+    TEST_ASSERT_EQUAL(1, countOf(text, "\"ph\":\"C\""));
+    TEST_ASSERT_EQUAL(1, countOf(text, "\"args\":{\"value\":42}"));
+    TEST_ASSERT_EQUAL(2, countOf(text, "\"name\":\"quote \\\" and \\\\\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\n]}\n"));
+    free(text);
+
+    /* a write leaves the events; saving it adds a span of its own */
+    TEST_ASSERT_TRUE(utxTraceCount() >= 5);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_spans(void *unused) {
+    unref(unused);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        UTX_TRACE_BEGIN("work");
+        UTX_TRACE_END("work");
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Each thread has a ring of its own; none of their events are lost. */
+void test_utxTrace_Threads(void) {
+    Thread *threads[4];
+    for (uint32_t t = 0; t < 4; ++t) {
+        threads[t] = bthread_create(i_spans, NULL, void);
+    }
+    for (uint32_t t = 0; t < 4; ++t) {
+        bthread_wait(threads[t]);
+        bthread_close(&threads[t]);
+    }
+    TEST_ASSERT_EQUAL(8000, utxTraceCount());
+
+    uint32_t events = 0;
+    char_t *text = writeTrace(&events);
+    TEST_ASSERT_EQUAL(8000, events);
+    TEST_ASSERT_EQUAL(4000, countOf(text, "\"ph\":\"B\""));
+    free(text);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A full ring keeps the newest events. A reader leaves out the oldest slot
+ * of a full ring, which may be the one being written. */
+void test_utxTrace_Wrap(void) {
+    for (uint32_t i = 0; i < 3 * RING_EVENTS + 5; ++i) {
+        UTX_TRACE_COUNTER("n", i);
+    }
+    TEST_ASSERT_EQUAL(RING_EVENTS, utxTraceCount());
+
+    uint32_t events = 0;
+    char_t *text = writeTrace(&events);
+    TEST_ASSERT_EQUAL(RING_EVENTS - 1, events);
+    char_t last[64];
+    sprintf(last, "\"args\":{\"value\":%u}", 3 * RING_EVENTS + 4);
+    TEST_ASSERT_NOT_NULL(strstr(text, last));
+    sprintf(last, "\"args\":{\"value\":%u}", 2 * RING_EVENTS + 4);
+    TEST_ASSERT_NULL(strstr(text, last));
+    free(text);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTrace_Clear(void) {
+    UTX_TRACE_BEGIN("a");
+    UTX_TRACE_END("a");
+    utxTraceClear();
+    TEST_ASSERT_EQUAL(0, utxTraceCount());
+
+    UTX_TRACE_BEGIN("b");
+    TEST_ASSERT_EQUAL(1, utxTraceCount());
+    uint32_t events = 0;
+    char_t *text = writeTrace(&events);
+    TEST_ASSERT_EQUAL(1, events);
+    TEST_ASSERT_NULL(strstr(text, "\"name\":\"a\""));
+    free(text);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Nothing is kept outside utx_start and utx_finish, and a new start begins
+ * with fresh rings. */
+void test_utxTrace_Restart(void) {
+    UTX_TRACE_BEGIN("before");
+    utx_finish();
+    UTX_TRACE_BEGIN("stopped");
+    TEST_ASSERT_EQUAL(0, utxTraceCount());
+
+    utx_start();
+    TEST_ASSERT_EQUAL(0, utxTraceCount());
+    UTX_TRACE_BEGIN("after");
+    TEST_ASSERT_EQUAL(1, utxTraceCount());
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxTrace_Spans);
+    RUN_TEST(test_utxTrace_Threads);
+    RUN_TEST(test_utxTrace_Wrap);
+    RUN_TEST(test_utxTrace_Clear);
+    RUN_TEST(test_utxTrace_Restart);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
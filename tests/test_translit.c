@@ -0,0 +1,187 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+
+#include <core/core.h>
+#include <core/strings.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utx.h"
+#include "translit.h"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+    utx_start();
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utx_finish();
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertConverts(UtxTranslitDir dir, const char_t *text, const char_t *expected) {
+    char_t out[256];
+    uint32_t size = (uint32_t)strlen(text);
+    TEST_ASSERT_TRUE(utxTranslitBound(dir, size) <= sizeof(out));
+    uint32_t n = utxTranslitText(dir, text, size, out);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)strlen(expected), n);
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, n);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTranslit_RomanToUrdu(void) {
+    /* کھانا, کیتاب */
+    assertConverts(TranslitRomanToUrdu, "Khana", "\xDA\xA9\xDA\xBE\xD8\xA7\xD9\x86\xD8\xA7");
+    assertConverts(TranslitRomanToUrdu, "kitaab", "\xDA\xA9\xDB\x8C\xD8\xAA\xD8\xA7\xD8\xA8");
+    /* the longest rule wins, and text no rule starts with is kept */
+    assertConverts(TranslitRomanToUrdu, "chhx", "\xDA\x86\xDA\xBE" "x");
+    assertConverts(TranslitRomanToUrdu, "cx", "cx");
+    assertConverts(TranslitRomanToUrdu, "2.", "\xDB\xB2\xDB\x94");
+    assertConverts(TranslitRomanToUrdu, "", "");
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTranslit_UrduToRoman(void) {
+    /* بھائی, بِسْم, ۲۰۲۴ */
+    assertConverts(TranslitUrduToRoman, "\xD8\xA8\xDA\xBE\xD8\xA7\xD8\xA6\xDB\x8C", "bha'i");
+    assertConverts(TranslitUrduToRoman, "\xD8\xA8\xD9\x90\xD8\xB3\xD9\x92\xD9\x85", "bism");
+    assertConverts(TranslitUrduToRoman, "\xDB\xB2\xDB\xB0\xDB\xB2\xDB\xB4", "2024");
+    assertConverts(TranslitUrduToRoman, "kaatib \xE2\x80\x94", "kaatib \xE2\x80\x94");
+}
+
+/*----------------------------------------------------------------------------*/
+/* Typing "kha" one key at a time. */
+void test_utxTranslit_Preview(void) {
+    char_t out[64];
+    UtxTranslit *translit = utxTranslitCreate(TranslitRomanToUrdu);
+    TEST_ASSERT_NOT_NULL(translit);
+
+    TEST_ASSERT_EQUAL_UINT32(0, utxTranslitFeed(translit, "k", 1, out));
+    TEST_ASSERT_EQUAL_UINT32(1, utxTranslitPending(translit));
+    TEST_ASSERT_EQUAL_UINT32(2, utxTranslitPreview(translit, out));
+    TEST_ASSERT_EQUAL_MEMORY("\xDA\xA9", out, 2);
+
+    TEST_ASSERT_EQUAL_UINT32(0, utxTranslitFeed(translit, "h", 1, out));
+    TEST_ASSERT_EQUAL_UINT32(2, utxTranslitPreview(translit, out));
+    TEST_ASSERT_EQUAL_MEMORY("\xD8\xAE", out, 2);
+    TEST_ASSERT_EQUAL_UINT32(2, utxTranslitPending(translit));
+
+    TEST_ASSERT_EQUAL_UINT32(2, utxTranslitFeed(translit, "a", 1, out));
+    TEST_ASSERT_EQUAL_MEMORY("\xD8\xAE", out, 2);
+    TEST_ASSERT_EQUAL_UINT32(1, utxTranslitPending(translit));
+    TEST_ASSERT_EQUAL_UINT32(2, utxTranslitFlush(translit, out));
+    TEST_ASSERT_EQUAL_MEMORY("\xD8\xA7", out, 2);
+    TEST_ASSERT_EQUAL_UINT32(0, utxTranslitPending(translit));
+
+    utxTranslitFeed(translit, "s", 1, out);
+    utxTranslitReset(translit);
+    TEST_ASSERT_EQUAL_UINT32(0, utxTranslitFlush(translit, out));
+
+    utxTranslitDestroy(&translit);
+    TEST_ASSERT_NULL(translit);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Fed in random pieces, a stream converts as the whole text does. */
+void test_utxTranslit_Streaming(void) {
+    static const char_t *ROMAN[] = { "a", "h", "k", "K", "c", "s", "z", "Z", "T", "t", "x", " ", ".", "7" };
+    /* ب ھ ا ک ِ ۲ and two bytes cut from a letter */
+    static const char_t *URDU[] = { "\xD8\xA8", "\xDA\xBE", "\xD8\xA7", "\xDA\xA9", "\xD9\x90", "\xDB\xB2", " ", "q", "\xD8", "\xBE" };
+    enum { CAPACITY = 4096 };
+    char_t *text = heap_new_n(CAPACITY, char_t);
+    char_t *whole = heap_new_n(CAPACITY * 8, char_t);
+    char_t *streamed = heap_new_n(CAPACITY * 8, char_t);
+
+    for (uint32_t round = 0; round < 100; ++round) {
+        UtxTranslitDir dir = round % 2 == 0 ? TranslitRomanToUrdu : TranslitUrduToRoman;
+        const char_t **tokens = dir == TranslitRomanToUrdu ? ROMAN : URDU;
+        int32_t count = dir == TranslitRomanToUrdu ? (int32_t)(sizeof(ROMAN) / sizeof(ROMAN[0])) : (int32_t)(sizeof(URDU) / sizeof(URDU[0]));
+        uint32_t size = 0;
+        while (size + 2 <= CAPACITY) {
+            const char_t *token = tokens[bmath_randi(0, count - 1)];
+            uint32_t n = (uint32_t)strlen(token);
+            memcpy(text + size, token, n);
+            size += n;
+        }
+
+        TEST_ASSERT_TRUE(utxTranslitBound(dir, size) <= CAPACITY * 8);
+        uint32_t expected = utxTranslitText(dir, text, size, whole);
+
+        UtxTranslit *translit = utxTranslitCreate(dir);
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < size;) {
+            uint32_t piece = (uint32_t)bmath_randi(1, 9);
+            piece = piece < size - i ? piece : size - i;
+            n += utxTranslitFeed(translit, text + i, piece, streamed + n);
+            TEST_ASSERT_TRUE(utxTranslitPending(translit) <= 16);
+            i += piece;
+        }
+        n += utxTranslitFlush(translit, streamed + n);
+        utxTranslitDestroy(&translit);
+
+        TEST_ASSERT_EQUAL_UINT32(expected, n);
+        TEST_ASSERT_EQUAL_MEMORY(whole, streamed, n);
+    }
+
+    heap_delete_n(&streamed, CAPACITY * 8, char_t);
+    heap_delete_n(&whole, CAPACITY * 8, char_t);
+    heap_delete_n(&text, CAPACITY, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxTransliterate(void) {
+    String *contents = str_c("<slaam>");
+    UtxFile *utx = utxCreateFromString(contents);
+    uint32_t converted = 0;
+
+    TEST_ASSERT_EQUAL(RInvalidUtxPointer, utxTransliterate(NULL, TranslitRomanToUrdu, 0, 1, NULL));
+    TEST_ASSERT_EQUAL(RInvalidRange, utxTransliterate(utx, TranslitRomanToUrdu, 4, 10, NULL));
+
+    /* سلام */
+    TEST_ASSERT_EQUAL(ROkay, utxTransliterate(utx, TranslitRomanToUrdu, 1, 5, &converted));
+    TEST_ASSERT_EQUAL_UINT32(8, converted);
+    String *urdu = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING("<\xD8\xB3\xD9\x84\xD8\xA7\xD9\x85>", tc(urdu));
+    str_destroy(&urdu);
+
+    TEST_ASSERT_EQUAL(ROkay, utxTransliterate(utx, TranslitUrduToRoman, 0, utxLength(utx), &converted));
+    String *roman = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING("<slam>", tc(roman));
+    str_destroy(&roman);
+
+    /* each conversion undoes in one step */
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    String *restored = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(tc(contents), tc(restored));
+    str_destroy(&restored);
+
+    utxDestroy(&utx);
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxTranslit_RomanToUrdu);
+    RUN_TEST(test_utxTranslit_UrduToRoman);
+    RUN_TEST(test_utxTranslit_Preview);
+    RUN_TEST(test_utxTranslit_Streaming);
+    RUN_TEST(test_utxTransliterate);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,186 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#include <stdio.h>
+
+#include <core/core.h>
+#include <core/heap.h>
+#include <sewer/bmath.h>
+
+#include "unity.h"
+#include "utf8.h"
+
+/*----------------------------------------------------------------------------*/
+void setUp(void) {
+    heap_verbose(TRUE);
+    heap_stats(TRUE);
+}
+
+/*----------------------------------------------------------------------------*/
+void tearDown(void) {
+    utxUtf8SetSimd(SimdAuto);
+    TEST_ASSERT_FALSE(heap_leaks());
+}
+
+/*----------------------------------------------------------------------------*/
+/* Byte at a time through the scalar path: the reference every SIMD level
+ * has to agree with. Counts cover the whole text, valid or not. */
+static bool_t referenceScan(const char_t *data, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    UtxSimd simd = utxUtf8Simd();
+    utxUtf8SetSimd(SimdScalar);
+
+    UtxUtf8 state;
+    utxUtf8Init(&state);
+    bool_t valid = TRUE;
+    *lines = 0;
+    *chars = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        *lines += data[i] == '\n';
+        *chars += ((byte_t)data[i] & 0xC0) != 0x80;
+        if (valid) {
+            valid = utxUtf8Validate(&state, data + i, 1);
+        }
+    }
+
+    utxUtf8SetSimd(simd);
+    return valid && utxUtf8Complete(&state);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t splitScan(const char_t *data, uint32_t size, uint32_t split, uint32_t *lines, uint32_t *chars) {
+    UtxUtf8 state;
+    uint32_t l, c;
+    utxUtf8Init(&state);
+    if (!utxUtf8Scan(&state, data, split, lines, chars)) {
+        return FALSE;
+    }
+    if (!utxUtf8Scan(&state, data + split, size - split, &l, &c)) {
+        return FALSE;
+    }
+    *lines += l;
+    *chars += c;
+    return utxUtf8Complete(&state);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t randomText(char_t *text, uint32_t capacity) {
+    /* ASCII, "\n", "ل", "ہ", "€", "😀" */
+    static const char_t *TOKENS[] = {
+        "a", "\n", "\xD9\x84", "\xDB\x81", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"
+    };
+    uint32_t size = 0;
+    for (;;) {
+        const char_t *token = TOKENS[bmath_randi(0, 5)];
+        uint32_t n = (uint32_t)strlen(token);
+        if (size + n > capacity) {
+            break;
+        }
+        memcpy(text + size, token, n);
+        size += n;
+    }
+    return size;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUtf8_Simd(void) {
+    UtxSimd best = utxUtf8SetSimd(SimdAuto);
+    TEST_ASSERT_EQUAL(SimdScalar, utxUtf8SetSimd(SimdScalar));
+    TEST_ASSERT_EQUAL(SimdScalar, utxUtf8Simd());
+    TEST_ASSERT_EQUAL(best, utxUtf8SetSimd(SimdAvx2 + 1));
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUtf8_KnownSequences(void) {
+    static const struct { const char_t *text; bool_t valid; } CASES[] = {
+        { "", TRUE },
+        { "abc", TRUE },
+        { "\xD8\xA7\xD8\xB1\xD8\xAF\xD9\x88", TRUE },
+        { "\xEF\xBB\xBF", TRUE },
+        { "\xF4\x8F\xBF\xBF", TRUE },
+        { "\x80", FALSE },
+        { "\xC0\xAF", FALSE },
+        { "\xC1\xBF", FALSE },
+        { "\xE0\x9F\xBF", FALSE },
+        { "\xED\xA0\x80", FALSE },
+        { "\xF0\x8F\xBF\xBF", FALSE },
+        { "\xF4\x90\x80\x80", FALSE },
+        { "\xF5\x80\x80\x80", FALSE },
+        { "\xFF", FALSE },
+        { "\xD9", FALSE },
+        { "\xE2\x82", FALSE },
+        { "\xD9\x84\x84", FALSE },
+    };
+
+    char_t text[96];
+    for (int32_t simd = SimdScalar; simd <= SimdAvx2; ++simd) {
+        utxUtf8SetSimd((UtxSimd)simd);
+        for (uint32_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+            /* pad so that the sequence also lands inside and across vectors */
+            for (uint32_t pad = 0; pad < 40; pad += 13) {
+                uint32_t n = (uint32_t)strlen(CASES[i].text);
+                memset(text, 'x', sizeof(text));
+                memcpy(text + pad, CASES[i].text, n);
+                UtxUtf8 state;
+                utxUtf8Init(&state);
+                bool_t valid = utxUtf8Validate(&state, text, pad + n) && utxUtf8Complete(&state);
+                TEST_ASSERT_EQUAL(CASES[i].valid, valid);
+                utxUtf8Init(&state);
+                valid = utxUtf8Validate(&state, text, sizeof(text)) && utxUtf8Complete(&state);
+                TEST_ASSERT_EQUAL(CASES[i].valid, valid);
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUtf8_RandomAgreement(void) {
+    const uint32_t CAPACITY = 4096;
+    char_t *text = heap_new_n(CAPACITY, char_t);
+    bmath_rand_seed(148);
+
+    for (uint32_t round = 0; round < 300; ++round) {
+        uint32_t size = randomText(text, (uint32_t)bmath_randi(0, (int32_t)CAPACITY));
+        /* corrupt every other round */
+        if (round % 2 == 1 && size > 0) {
+            text[bmath_randi(0, (int32_t)size - 1)] = (char_t)bmath_randi(0x80, 0xFF);
+        }
+
+        uint32_t lines, chars;
+        bool_t valid = referenceScan(text, size, &lines, &chars);
+
+        for (int32_t simd = SimdScalar; simd <= SimdAvx2; ++simd) {
+            utxUtf8SetSimd((UtxSimd)simd);
+            uint32_t l = 0, c = 0;
+            utxUtf8Count(text, size, &l, &c);
+            TEST_ASSERT_EQUAL(lines, l);
+            TEST_ASSERT_EQUAL(chars, c);
+
+            uint32_t split = size > 0 ? (uint32_t)bmath_randi(0, (int32_t)size) : 0;
+            bool_t v = splitScan(text, size, split, &l, &c);
+            TEST_ASSERT_EQUAL(valid, v);
+            if (valid) {
+                TEST_ASSERT_EQUAL(lines, l);
+                TEST_ASSERT_EQUAL(chars, c);
+            }
+        }
+    }
+
+    heap_delete_n(&text, CAPACITY, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_utxUtf8_Simd);
+    RUN_TEST(test_utxUtf8_KnownSequences);
+    RUN_TEST(test_utxUtf8_RandomAgreement);
+    return UNITY_END();
+}
+
+/*----------------------------------------------------------------------------*/
@@ -57,8 +57,8 @@ void test_utxCreate_New(void) {
     TEST_ASSERT_NOT_NULL(utx);
     TEST_ASSERT_NOT_NULL(utx->fileName);
     TEST_ASSERT_FALSE(str_empty(utx->fileName));
-    TEST_ASSERT_NOT_NULL(utx->contents);
-    TEST_ASSERT_TRUE(str_empty(utx->contents));
+    TEST_ASSERT_NOT_NULL(utx->buffer);
+    TEST_ASSERT_EQUAL(0, utxLength(utx));
     TEST_ASSERT_NULL(utx->fileFolder);
     TEST_ASSERT_FALSE(utx->isModified);
 
@@ -95,14 +95,16 @@ void test_utxCreateFrom_String(void) {
     UtxFile* utx = utxCreateFromString(testString);
 
     TEST_ASSERT_NOT_NULL(utx);
-    TEST_ASSERT_NOT_NULL(utx->contents);
-    TEST_ASSERT_FALSE(str_empty(utx->contents));
-    TEST_ASSERT_EQUAL(0, str_scmp(utx->contents, testString));
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_NOT_NULL(contents);
+    TEST_ASSERT_FALSE(str_empty(contents));
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, testString));
     TEST_ASSERT_NOT_NULL(utx->fileName);
     TEST_ASSERT_FALSE(str_empty(utx->fileName));
     TEST_ASSERT_NULL(utx->fileFolder);
     TEST_ASSERT_FALSE(utx->isModified);
 
+    str_destroy(&contents);
     str_destroy(&testString);
     utxDestroy(&utx);
 }
@@ -130,17 +132,21 @@ void test_utxSetContents_NewString(void) {
     String* testString10 = str_c(cs10);
 
     UtxFile* utx = utxCreateNew();
-    TEST_ASSERT_TRUE(str_empty(utx->contents));
+    TEST_ASSERT_EQUAL(0, utxLength(utx));
 
     utxSetContents(utx, testString5);
-    TEST_ASSERT_FALSE(str_empty(utx->contents));
-    TEST_ASSERT_EQUAL(0, str_scmp(utx->contents, testString5));
-    TEST_ASSERT_NOT_EQUAL(0, str_scmp(utx->contents, testString10));
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_FALSE(str_empty(contents));
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, testString5));
+    TEST_ASSERT_NOT_EQUAL(0, str_scmp(contents, testString10));
+    str_destroy(&contents);
 
     utxSetContents(utx, testString10);
-    TEST_ASSERT_FALSE(str_empty(utx->contents));
-    TEST_ASSERT_EQUAL(0, str_scmp(utx->contents, testString10));
-    TEST_ASSERT_NOT_EQUAL(0, str_scmp(utx->contents, testString5));
+    contents = utxGetContents(utx);
+    TEST_ASSERT_FALSE(str_empty(contents));
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, testString10));
+    TEST_ASSERT_NOT_EQUAL(0, str_scmp(contents, testString5));
+    str_destroy(&contents);
 
     str_destroy(&testString5);
     str_destroy(&testString10);
@@ -169,6 +175,212 @@ void test_utxContentLength(void) {
     utxDestroy(&utx1);
 }
 
+/*----------------------------------------------------------------------------*/
+void test_utxInsert(void) {
+    String *testString = str_c("ABCDEF");
+    UtxFile* utx = utxCreateFromString(testString);
+
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 3, "123", 3));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "<", 1));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, utxLength(utx), ">", 1));
+    TEST_ASSERT_EQUAL(11, utxLength(utx));
+
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, "<ABC123DEF>"));
+
+    TEST_ASSERT_EQUAL(RInvalidRange, utxInsert(utx, 12, "X", 1));
+    TEST_ASSERT_EQUAL(RInvalidContents, utxInsert(utx, 0, NULL, 1));
+    TEST_ASSERT_EQUAL(RInvalidUtxPointer, utxInsert(NULL, 0, "X", 1));
+
+    str_destroy(&contents);
+    str_destroy(&testString);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxDeleteReplace(void) {
+    String *testString = str_c("ABCDEFGHIJ");
+    UtxFile* utx = utxCreateFromString(testString);
+
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 2, 3));
+    TEST_ASSERT_EQUAL(ROkay, utxReplace(utx, 0, 2, "xyz", 3));
+    TEST_ASSERT_EQUAL(RInvalidRange, utxDelete(utx, 5, 10));
+
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, "xyzFGHIJ"));
+
+    String *range = utxGetRange(utx, 2, 3);
+    TEST_ASSERT_EQUAL(0, str_cmp(range, "zFG"));
+
+    str_destroy(&range);
+    str_destroy(&contents);
+    str_destroy(&testString);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxInsert_CharBoundary(void) {
+    /* "امر" - three 2-byte code points */
+    String *testString = str_c("\xD8\xA7\xD9\x85\xD8\xB1");
+    UtxFile* utx = utxCreateFromString(testString);
+
+    TEST_ASSERT_EQUAL(RInvalidRange, utxInsert(utx, 1, " ", 1));
+    TEST_ASSERT_EQUAL(RInvalidRange, utxDelete(utx, 2, 1));
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 2, " ", 1));
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 3, 2));
+    TEST_ASSERT_EQUAL(5, utxLength(utx));
+
+    str_destroy(&testString);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxLines(void) {
+    /* "ab\nامر\n\nc" */
+    String *testString = str_c("ab\n\xD8\xA7\xD9\x85\xD8\xB1\n\nc");
+    UtxFile* utx = utxCreateFromString(testString);
+    uint32_t line, column, offset, index;
+
+    TEST_ASSERT_EQUAL(4, utxLineCount(utx));
+
+    TEST_ASSERT_EQUAL(ROkay, utxOffsetToLine(utx, 7, &line, &column));
+    TEST_ASSERT_EQUAL(1, line);
+    TEST_ASSERT_EQUAL(4, column);
+
+    /* code point 5 is "ر" */
+    TEST_ASSERT_EQUAL(ROkay, utxCharToLine(utx, 5, &line, &column));
+    TEST_ASSERT_EQUAL(1, line);
+    TEST_ASSERT_EQUAL(2, column);
+
+    TEST_ASSERT_EQUAL(ROkay, utxLineToOffset(utx, 3, &offset));
+    TEST_ASSERT_EQUAL(11, offset);
+    TEST_ASSERT_EQUAL(ROkay, utxLineToChar(utx, 3, &index));
+    TEST_ASSERT_EQUAL(8, index);
+    TEST_ASSERT_EQUAL(RInvalidRange, utxLineToOffset(utx, 4, &offset));
+
+    /* edits keep the index current */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "\n\n", 2));
+    TEST_ASSERT_EQUAL(6, utxLineCount(utx));
+    TEST_ASSERT_EQUAL(ROkay, utxLineToOffset(utx, 5, &offset));
+    TEST_ASSERT_EQUAL(13, offset);
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 2, 10));
+    TEST_ASSERT_EQUAL(4, utxLineCount(utx));
+
+    str_destroy(&testString);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+static void assertContents(const UtxFile *utx, const char_t *expected) {
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL_STRING(expected, tc(contents));
+    str_destroy(&contents);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUndo_Typing(void) {
+    UtxFile* utx = utxCreateNew();
+    const char_t *typed = "hello world";
+    for (uint32_t i = 0; i < 11; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, i, typed + i, 1));
+    }
+    /* backspace twice joins into one group */
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 10, 1));
+    TEST_ASSERT_EQUAL(ROkay, utxDelete(utx, 9, 1));
+    assertContents(utx, "hello wor");
+
+    uint32_t offset = 0;
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, &offset));
+    assertContents(utx, "hello world");
+    TEST_ASSERT_EQUAL(11, offset);
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, &offset));
+    assertContents(utx, "hello ");
+    TEST_ASSERT_EQUAL(6, offset);
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, &offset));
+    assertContents(utx, "");
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+    TEST_ASSERT_EQUAL(RNoHistory, utxUndo(utx, &offset));
+
+    TEST_ASSERT_EQUAL(ROkay, utxRedo(utx, &offset));
+    assertContents(utx, "hello ");
+    TEST_ASSERT_EQUAL(6, offset);
+
+    /* a new edit drops what was undone */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 6, "there", 5));
+    TEST_ASSERT_FALSE(utxCanRedo(utx));
+    TEST_ASSERT_EQUAL(RNoHistory, utxRedo(utx, &offset));
+    TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+    assertContents(utx, "hello ");
+
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUndo_RandomEdits(void) {
+    const uint32_t STEPS = 400;
+    String **models = heap_new_n(STEPS + 1, String*);
+    UtxFile* utx = utxCreateNew();
+    bmath_rand_seed(8);
+
+    models[0] = utxGetContents(utx);
+    for (uint32_t i = 1; i <= STEPS; ++i) {
+        uint32_t length = utxLength(utx);
+        uint32_t offset = (uint32_t)bmath_randi(0, (int32_t)length);
+        uint32_t size = (uint32_t)bmath_randi(0, (int32_t)(length - offset < 8 ? length - offset : 8));
+        char_t text[8];
+        uint32_t n = (uint32_t)bmath_randi(size == 0 ? 1 : 0, 7);
+        for (uint32_t j = 0; j < n; ++j) {
+            text[j] = (char_t)bmath_randi('a', 'z');
+        }
+
+        utxUndoBreak(utx);
+        TEST_ASSERT_EQUAL(ROkay, utxReplace(utx, offset, size, text, n));
+        models[i] = utxGetContents(utx);
+    }
+
+    for (uint32_t i = STEPS; i > 0; --i) {
+        TEST_ASSERT_EQUAL(ROkay, utxUndo(utx, NULL));
+        assertContents(utx, tc(models[i - 1]));
+    }
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+
+    for (uint32_t i = 1; i <= STEPS; ++i) {
+        TEST_ASSERT_EQUAL(ROkay, utxRedo(utx, NULL));
+        assertContents(utx, tc(models[i]));
+    }
+    TEST_ASSERT_FALSE(utxCanRedo(utx));
+
+    for (uint32_t i = 0; i <= STEPS; ++i) {
+        str_destroy(&models[i]);
+    }
+    heap_delete_n(&models, STEPS + 1, String*);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxUndo_MemoryLimit(void) {
+    char_t line[1024];
+    memset(line, 'x', sizeof(line));
+
+    UtxFile* utx = utxCreateNew();
+    utxSetUndoLimit(utx, 4 * 65536);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        utxUndoBreak(utx);
+        TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, utxLength(utx), line, sizeof(line)));
+    }
+
+    /* only the most recent edits can still be undone */
+    uint32_t undone = 0;
+    while (utxUndo(utx, NULL) == ROkay) {
+        undone += 1;
+    }
+    TEST_ASSERT_GREATER_THAN_UINT32(100, undone);
+    TEST_ASSERT_LESS_THAN_UINT32(1000, undone);
+    TEST_ASSERT_EQUAL((1000 - undone) * sizeof(line), utxLength(utx));
+
+    utxDestroy(&utx);
+}
+
 /*----------------------------------------------------------------------------*/
 void test_utxDestruction(void) {
     UtxFile* utx = utxCreateNew();
@@ -226,13 +438,14 @@ void test_utxReadFileContents(void) {
 
     UtxFile* utx = utxCreateNew();
     TEST_ASSERT_NULL(utx->fileFolder);
-    TEST_ASSERT_TRUE(str_empty(utx->contents));
     TEST_ASSERT_EQUAL(0, utxLength(utx));
 
     Result result = utxReadContentsFromFile(utx, tc(filePath));
     TEST_ASSERT_EQUAL(ROkay, result);
 
-    TEST_ASSERT_EQUAL(0, str_cmp(utx->contents, cs10));
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, cs10));
+    str_destroy(&contents);
     
     ferror_t error;
     bfile_delete(tc(filePath), &error);
@@ -256,8 +469,9 @@ void test_utxCreateFromFile(void) {
 
     UtxFile* utx = utxCreateFromFile(tc(filePath));
     TEST_ASSERT_NOT_NULL(utx);
-    TEST_ASSERT_FALSE(str_empty(utx->contents));
-    TEST_ASSERT_EQUAL(0, str_scmp(utx->contents, testString10));
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_FALSE(str_empty(contents));
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, testString10));
     TEST_ASSERT_FALSE(utx->isModified);
 
     TEST_ASSERT_EQUAL(0, str_scmp(utx->fileName, fileName));
@@ -268,11 +482,292 @@ void test_utxCreateFromFile(void) {
     bfile_delete(tc(filePath), &error);
     TEST_ASSERT_EQUAL(ekFOK, error);
 
+    str_destroy(&contents);
+    str_destroy(&folder);
+    str_destroy(&fileName);
     str_destroy(&filePath);
     str_destroy(&testString10);
     utxDestroy(&utx);
 }
 
+/*----------------------------------------------------------------------------*/
+void test_utxReadEditWriteSameFile(void) {
+    String *testString = str_c("0123456789");
+    String *filePath = createUtf8File(testString);
+
+    UtxFile* utx = utxCreateFromFile(tc(filePath));
+    TEST_ASSERT_NOT_NULL(utx);
+    TEST_ASSERT_EQUAL(ROkay, utxReplace(utx, 2, 6, "-", 1));
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsToFile(utx, tc(filePath)));
+
+    UtxFile* reread = utxCreateFromFile(tc(filePath));
+    String *contents = utxGetContents(reread);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, "01-89"));
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+    TEST_ASSERT_EQUAL(ekFOK, error);
+
+    str_destroy(&contents);
+    str_destroy(&filePath);
+    str_destroy(&testString);
+    utxDestroy(&reread);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxLines_MappedFile(void) {
+    String *testString = str_c("one\ntwo\nthree");
+    String *filePath = createUtf8File(testString);
+
+    UtxFile* utx = utxCreateFromFile(tc(filePath));
+    TEST_ASSERT_NOT_NULL(utx);
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 4, "1\n", 2));
+    TEST_ASSERT_EQUAL(4, utxLineCount(utx));
+
+    uint32_t line, column;
+    TEST_ASSERT_EQUAL(ROkay, utxOffsetToLine(utx, 12, &line, &column));
+    TEST_ASSERT_EQUAL(3, line);
+    TEST_ASSERT_EQUAL(2, column);
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+
+    str_destroy(&filePath);
+    str_destroy(&testString);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+static String* createUrduText(uint32_t minSize) {
+    /* '#' then "امر بیل " repeated, so that FILE_BUFFER_SIZE boundaries split
+       the 2-byte code points */
+    static const char_t WORDS[] = "\xD8\xA7\xD9\x85\xD8\xB1 \xD8\xA8\xDB\x8C\xD9\x84 ";
+    const uint32_t n = sizeof(WORDS) - 1;
+    const uint32_t size = 1 + ((minSize + n - 1) / n) * n;
+    String *text = str_reserve(size);
+    char_t *s = tcc(text);
+    s[0] = '#';
+    for (uint32_t i = 1; i < size; ++i) {
+        s[i] = WORDS[(i - 1) % n];
+    }
+    s[size] = '\0';
+    return text;
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _progress_t Progress;
+struct _progress_t {
+    uint32_t calls;
+    uint32_t loaded;
+    uint32_t total;
+    uint32_t cancelAfter;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t onLoadProgress(Progress *progress, const uint32_t loaded, const uint32_t total) {
+    progress->calls += 1;
+    progress->loaded = loaded;
+    progress->total = total;
+    return progress->calls != progress->cancelAfter;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxLoad_Chunked(void) {
+    String *text = createUrduText(2 * FILE_BUFFER_SIZE + 1001);
+    const uint32_t SIZE = str_len(text);
+    String *filePath = createUtf8File(text);
+
+    Progress progress = { 0, 0, 0, 0 };
+    UtxFile* utx = utxCreateNew();
+    Result result = utxLoadContentsFromFile(utx, tc(filePath), (FPtr_utxProgress)onLoadProgress, &progress);
+    TEST_ASSERT_EQUAL(ROkay, result);
+    TEST_ASSERT_EQUAL(3, progress.calls);
+    TEST_ASSERT_EQUAL(SIZE, progress.loaded);
+    TEST_ASSERT_EQUAL(SIZE, progress.total);
+
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, text));
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+
+    str_destroy(&contents);
+    str_destroy(&filePath);
+    str_destroy(&text);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxLoad_Cancel(void) {
+    String *text = createUrduText(3 * FILE_BUFFER_SIZE);
+    String *filePath = createUtf8File(text);
+
+    Progress progress = { 0, 0, 0, 1 };
+    UtxFile* utx = utxCreateNew();
+    Result result = utxLoadContentsFromFile(utx, tc(filePath), (FPtr_utxProgress)onLoadProgress, &progress);
+    TEST_ASSERT_EQUAL(RCancelled, result);
+    TEST_ASSERT_EQUAL(1, progress.calls);
+    /* what was read before the cancel is dropped */
+    TEST_ASSERT_EQUAL_UINT32(0, utxLength(utx));
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+
+    str_destroy(&filePath);
+    str_destroy(&text);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxLoad_InvalidUtf8(void) {
+    /* overlong encoding of '/' and a truncated trailing sequence */
+    String *overlong = str_c("abc\xC0\xAF");
+    String *truncated = str_c("abc\xD8");
+    String *overlongPath = createUtf8File(overlong);
+    String *truncatedPath = createUtf8File(truncated);
+    String *valid = str_c("abc");
+    String *filePath = createUtf8File(valid);
+
+    /* a failed read or load leaves the open document, and its undo, alone */
+    UtxFile* utx = utxCreateNew();
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "kept", 4));
+    uint32_t generation = utxGeneration(utx);
+    TEST_ASSERT_EQUAL(RInvalidEncoding, utxLoadContentsFromFile(utx, tc(overlongPath), NULL, NULL));
+    TEST_ASSERT_EQUAL(RInvalidEncoding, utxLoadContentsFromFile(utx, tc(truncatedPath), NULL, NULL));
+    TEST_ASSERT_EQUAL(RFileError, utxLoadContentsFromFile(utx, "/nonexistent/kaatib.txt", NULL, NULL));
+    TEST_ASSERT_EQUAL(RInvalidEncoding, utxReadContentsFromFile(utx, tc(overlongPath)));
+    TEST_ASSERT_EQUAL(RInvalidEncoding, utxReadContentsFromFile(utx, tc(truncatedPath)));
+    assertContents(utx, "kept");
+    TEST_ASSERT_TRUE(utxCanUndo(utx));
+    TEST_ASSERT_EQUAL_UINT32(generation, utxGeneration(utx));
+
+    /* a good file replaces it all */
+    TEST_ASSERT_EQUAL(ROkay, utxReadContentsFromFile(utx, tc(filePath)));
+    assertContents(utx, "abc");
+    TEST_ASSERT_FALSE(utxCanUndo(utx));
+    TEST_ASSERT_NOT_EQUAL(generation, utxGeneration(utx));
+
+    ferror_t error;
+    bfile_delete(tc(overlongPath), &error);
+    bfile_delete(tc(truncatedPath), &error);
+    bfile_delete(tc(filePath), &error);
+
+    str_destroy(&filePath);
+    str_destroy(&valid);
+    str_destroy(&overlongPath);
+    str_destroy(&truncatedPath);
+    str_destroy(&overlong);
+    str_destroy(&truncated);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxWrite_ReplacesMappedFile(void) {
+    String *testString = str_c("original");
+    String *filePath = createUtf8File(testString);
+
+    /* the new contents replace the file as a whole; the text still mapped
+     * from the old one stays intact */
+    UtxFile* utx = utxCreateFromFile(tc(filePath));
+    UtxFile* other = utxCreateFromString(testString);
+    TEST_ASSERT_EQUAL(ROkay, utxReplace(other, 0, 8, "replaced", 8));
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsToFile(other, tc(filePath)));
+
+    String *contents = utxGetContents(utx);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, "original"));
+    str_destroy(&contents);
+
+    UtxFile* reread = utxCreateFromFile(tc(filePath));
+    contents = utxGetContents(reread);
+    TEST_ASSERT_EQUAL(0, str_cmp(contents, "replaced"));
+
+    TEST_ASSERT_EQUAL(RFileError, utxWriteContentsToFile(other, "/nonexistent/kaatib.txt"));
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+    TEST_ASSERT_EQUAL(ekFOK, error);
+
+    str_destroy(&contents);
+    str_destroy(&filePath);
+    str_destroy(&testString);
+    utxDestroy(&reread);
+    utxDestroy(&other);
+    utxDestroy(&utx);
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _saved_t Saved;
+struct _saved_t {
+    uint32_t calls;
+    Result result;
+};
+
+/*----------------------------------------------------------------------------*/
+static void onSaved(Saved *saved, const char_t *filePath, const Result result) {
+    unref(filePath);
+    saved->calls += 1;
+    saved->result = result;
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxWriteAsync(void) {
+    utx_start();
+
+    String *text = createUrduText(FILE_BUFFER_SIZE);
+    String *filePath = createTempFilename();
+    UtxFile* utx = utxCreateFromString(text);
+    Saved saved = { 0, ROkay };
+    Saved failed = { 0, ROkay };
+
+    /* the save sees the text at the time of the call, not later edits */
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsAsync(utx, tc(filePath), (FPtr_utxSaved)onSaved, &saved));
+    TEST_ASSERT_EQUAL(ROkay, utxReplace(utx, 0, utxLength(utx), "edited", 6));
+    TEST_ASSERT_EQUAL(ROkay, utxWriteContentsAsync(utx, "/nonexistent/kaatib.txt", (FPtr_utxSaved)onSaved, &failed));
+    utxDestroy(&utx);
+
+    utx_finish();
+    TEST_ASSERT_EQUAL(1, saved.calls);
+    TEST_ASSERT_EQUAL(ROkay, saved.result);
+    TEST_ASSERT_EQUAL(1, failed.calls);
+    TEST_ASSERT_EQUAL(RFileError, failed.result);
+
+    UtxFile* reread = utxCreateFromFile(tc(filePath));
+    String *contents = utxGetContents(reread);
+    TEST_ASSERT_EQUAL(0, str_scmp(contents, text));
+
+    ferror_t error;
+    bfile_delete(tc(filePath), &error);
+
+    str_destroy(&contents);
+    str_destroy(&filePath);
+    str_destroy(&text);
+    utxDestroy(&reread);
+}
+
+/*----------------------------------------------------------------------------*/
+void test_utxSaved_Generation(void) {
+    String *text = str_c("abc");
+    UtxFile* utx = utxCreateFromString(text);
+    uint32_t generation = utxGeneration(utx);
+
+    utxSaved(utx, generation, "/tmp/kaatib/saved.txt");
+    TEST_ASSERT_FALSE(utx->isModified);
+    TEST_ASSERT_EQUAL_STRING("/tmp/kaatib/", tc(utx->fileFolder));
+
+    /* an edit made while the save was queued keeps the document modified */
+    TEST_ASSERT_EQUAL(ROkay, utxInsert(utx, 0, "x", 1));
+    TEST_ASSERT_NOT_EQUAL(generation, utxGeneration(utx));
+    TEST_ASSERT_TRUE(utx->isModified);
+    utxSaved(utx, generation, "/tmp/kaatib/saved.txt");
+    TEST_ASSERT_TRUE(utx->isModified);
+    utxSaved(utx, utxGeneration(utx), "/tmp/kaatib/saved.txt");
+    TEST_ASSERT_FALSE(utx->isModified);
+
+    str_destroy(&text);
+    utxDestroy(&utx);
+}
+
 /*----------------------------------------------------------------------------*/
 int main(void) {
     UNITY_BEGIN();
@@ -288,10 +783,29 @@ int main(void) {
     
     RUN_TEST(test_utxContentLength);
 
+    RUN_TEST(test_utxInsert);
+    RUN_TEST(test_utxDeleteReplace);
+    RUN_TEST(test_utxInsert_CharBoundary);
+
+    RUN_TEST(test_utxLines);
+
+    RUN_TEST(test_utxUndo_Typing);
+    RUN_TEST(test_utxUndo_RandomEdits);
+    RUN_TEST(test_utxUndo_MemoryLimit);
+
     RUN_TEST(test_utxRead_UtxNull);
     RUN_TEST(test_utxRead_AllFilePathNull);
     RUN_TEST(test_utxReadFileContents);
     RUN_TEST(test_utxCreateFromFile);
+    RUN_TEST(test_utxReadEditWriteSameFile);
+    RUN_TEST(test_utxWrite_ReplacesMappedFile);
+    RUN_TEST(test_utxWriteAsync);
+    RUN_TEST(test_utxSaved_Generation);
+    RUN_TEST(test_utxLines_MappedFile);
+
+    RUN_TEST(test_utxLoad_Chunked);
+    RUN_TEST(test_utxLoad_Cancel);
+    RUN_TEST(test_utxLoad_InvalidUtf8);
     return UNITY_END();
 }
 
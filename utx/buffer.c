@@ -0,0 +1,1146 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Piece table document buffer.
+ *
+ * The text is a sequence of pieces, each pointing into an immutable memory
+ * block. Pieces are the nodes of an implicit treap keyed by byte offset, so
+ * locating, splitting and joining at any offset costs O(log n). Inserted text
+ * is appended to the current block and never moved afterwards; untouched text
+ * is never copied. Pieces are capped at PIECE_SIZE bytes so that per-piece
+ * work stays bounded whatever the document size.
+ *
+ * The original text may be a read-only file mapping owned by the buffer, in
+ * which case untouched text is served straight from the page cache.
+ *
+ * Blocks and the mapping live in a reference counted store, so a snapshot of
+ * the piece list can be written out on another thread while editing goes on.
+ *
+ * Each piece also carries its count of line feeds and code points, summed
+ * over its subtree, which makes line and character lookups O(log n) too. An
+ * edit only recounts the bytes it adds or the shorter half of a cut piece.
+ * A mapped original is either validated and counted in one pass when it is
+ * set, or, unvalidated, counted lazily on the first such lookup, so opening
+ * a file does not touch its pages.
+ */
+#include "buffer.h"
+#include "filemap.h"
+#include "utf8.h"
+#include <core/strings.h>
+#include <core/heap.h>
+#include <osbs/bmutex.h>
+
+/*----------------------------------------------------------------------------*/
+#define PIECE_SIZE 65536
+#define BLOCK_SIZE 65536
+
+/*----------------------------------------------------------------------------*/
+typedef struct _piece_t Piece;
+struct _piece_t {
+    Piece *left;
+    Piece *right;
+    const char_t *data;
+    uint32_t size;
+    uint32_t lines;
+    uint32_t chars;
+    uint32_t total;
+    uint32_t tlines;
+    uint32_t tchars;
+    uint32_t priority;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _block_t Block;
+struct _block_t {
+    Block *next;
+    uint32_t size;
+    uint32_t used;
+};
+
+/*----------------------------------------------------------------------------*/
+/* The memory pieces point into. Shared with snapshots, which may be read on
+ * the writer thread after the buffer has moved on, so it is reference
+ * counted. The mapping has its own count: a detached buffer no longer needs
+ * it, but a snapshot taken before the detach still does. */
+typedef struct _store_t Store;
+struct _store_t {
+    Mutex *mutex;
+    uint32_t refs;
+    uint32_t mapRefs;
+    Block *blocks;
+    UtxFileMap *origin;
+};
+
+/*----------------------------------------------------------------------------*/
+#define MAX_OBSERVERS 4
+
+/*----------------------------------------------------------------------------*/
+typedef struct _observer_t Observer;
+struct _observer_t {
+    FPtr_utxEdited func;
+    void *data;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _span_t Span;
+struct _span_t {
+    const char_t *data;
+    uint32_t size;
+    uint32_t start;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_snapshot_t {
+    Store *store;
+    bool_t mapped;
+    uint32_t length;
+    uint32_t nspans;
+    Span *spans;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_buffer_t {
+    Piece *root;
+    Store *store;
+    bool_t mapped;
+    bool_t indexed;
+    uint32_t npieces;
+    uint32_t seed;
+    Observer observers[MAX_OBSERVERS];
+    uint32_t nobservers;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_random(UtxBuffer *buffer) {
+    /* xorshift32, deterministic per buffer */
+    uint32_t x = buffer->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    buffer->seed = x;
+    return x;
+}
+
+/*----------------------------------------------------------------------------*/
+static char_t *i_block_data(Block *block) {
+    return (char_t*)(block + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static Block *i_block_new(uint32_t size) {
+    Block *block = (Block*)heap_malloc((uint32_t)sizeof(Block) + size, "UtxBlock");
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_blocks_destroy(Block **blocks) {
+    Block *block = *blocks;
+    while (block != NULL) {
+        Block *next = block->next;
+        heap_free((byte_t**)&block, (uint32_t)sizeof(Block) + block->size, "UtxBlock");
+        block = next;
+    }
+    *blocks = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+static Store *i_store_new(void) {
+    Store *store = heap_new0(Store);
+    store->mutex = bmutex_create();
+    store->refs = 1;
+    return store;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_store_retain(Store *store, bool_t mapped) {
+    bmutex_lock(store->mutex);
+    store->refs += 1;
+    store->mapRefs += mapped ? 1 : 0;
+    bmutex_unlock(store->mutex);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_store_release_map(Store *store) {
+    bmutex_lock(store->mutex);
+    store->mapRefs -= 1;
+    if (store->mapRefs == 0) {
+        utxFileMapClose(&store->origin);
+    }
+    bmutex_unlock(store->mutex);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_store_release(Store **store, bool_t mapped) {
+    if (mapped) {
+        i_store_release_map(*store);
+    }
+
+    bmutex_lock((*store)->mutex);
+    (*store)->refs -= 1;
+    bool_t last = (*store)->refs == 0;
+    bmutex_unlock((*store)->mutex);
+
+    if (last) {
+        i_blocks_destroy(&(*store)->blocks);
+        utxFileMapClose(&(*store)->origin);
+        bmutex_close(&(*store)->mutex);
+        heap_delete(store, Store);
+    }
+    *store = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies text into block memory. Small inserts share the current block, large
+ * ones get a block of their own pushed behind it, so the tail of the current
+ * block stays available for further typing. */
+static const char_t *i_store(UtxBuffer *buffer, const char_t *text, uint32_t size) {
+    Block *block = buffer->store->blocks;
+    if (block == NULL || block->size - block->used < size) {
+        Block *nblock = i_block_new(size > BLOCK_SIZE ? size : BLOCK_SIZE);
+        if (block != NULL && size > BLOCK_SIZE) {
+            nblock->next = block->next;
+            block->next = nblock;
+        } else {
+            nblock->next = block;
+            buffer->store->blocks = nblock;
+        }
+        block = nblock;
+    }
+
+    char_t *dest = i_block_data(block) + block->used;
+    memcpy(dest, text, size);
+    block->used += size;
+    return dest;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_total(const Piece *piece) {
+    return piece != NULL ? piece->total : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_tlines(const Piece *piece) {
+    return piece != NULL ? piece->tlines : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_tchars(const Piece *piece) {
+    return piece != NULL ? piece->tchars : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_update(Piece *piece) {
+    piece->total = piece->size + i_total(piece->left) + i_total(piece->right);
+    piece->tlines = piece->lines + i_tlines(piece->left) + i_tlines(piece->right);
+    piece->tchars = piece->chars + i_tchars(piece->left) + i_tchars(piece->right);
+}
+
+/*----------------------------------------------------------------------------*/
+static Piece *i_piece_new(UtxBuffer *buffer, const char_t *data, uint32_t size) {
+    Piece *piece = heap_new0(Piece);
+    piece->data = data;
+    piece->size = size;
+    if (buffer->indexed) {
+        utxUtf8Count(data, size, &piece->lines, &piece->chars);
+    }
+    piece->priority = i_random(buffer);
+    i_update(piece);
+    buffer->npieces += 1;
+    return piece;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_index(Piece *piece) {
+    if (piece == NULL) {
+        return;
+    }
+    i_index(piece->left);
+    i_index(piece->right);
+    utxUtf8Count(piece->data, piece->size, &piece->lines, &piece->chars);
+    i_update(piece);
+}
+
+/*----------------------------------------------------------------------------*/
+/* In-order, so the validator sees the pieces as one contiguous text. */
+static bool_t i_scan(Piece *piece, UtxUtf8 *state) {
+    if (piece == NULL) {
+        return TRUE;
+    }
+    if (!i_scan(piece->left, state)) {
+        return FALSE;
+    }
+    if (!utxUtf8Scan(state, piece->data, piece->size, &piece->lines, &piece->chars)) {
+        return FALSE;
+    }
+    if (!i_scan(piece->right, state)) {
+        return FALSE;
+    }
+    i_update(piece);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Lookups are logically const; counting a mapped original on first use only
+ * fills in cached totals. */
+static const Piece *i_indexed(const UtxBuffer *buffer) {
+    if (!buffer->indexed) {
+        UtxBuffer *mbuffer = (UtxBuffer*)buffer;
+        i_index(mbuffer->root);
+        mbuffer->indexed = TRUE;
+    }
+    return buffer->root;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_pieces_destroy(UtxBuffer *buffer, Piece **piece) {
+    if (*piece == NULL) {
+        return;
+    }
+    i_pieces_destroy(buffer, &(*piece)->left);
+    i_pieces_destroy(buffer, &(*piece)->right);
+    heap_delete(piece, Piece);
+    buffer->npieces -= 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static Piece *i_merge(Piece *left, Piece *right) {
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (left->priority >= right->priority) {
+        left->right = i_merge(left->right, right);
+        i_update(left);
+        return left;
+    } else {
+        right->left = i_merge(left, right->left);
+        i_update(right);
+        return right;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Splits the tree so that `left` holds the first `offset` bytes. A piece
+ * straddling the offset is cut in two without touching its text. */
+static void i_split(UtxBuffer *buffer, Piece *piece, uint32_t offset, Piece **left, Piece **right) {
+    if (piece == NULL) {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    uint32_t lsize = i_total(piece->left);
+    if (offset <= lsize) {
+        i_split(buffer, piece->left, offset, left, &piece->left);
+        i_update(piece);
+        *right = piece;
+    } else if (offset >= lsize + piece->size) {
+        i_split(buffer, piece->right, offset - lsize - piece->size, &piece->right, right);
+        i_update(piece);
+        *left = piece;
+    } else {
+        uint32_t cut = offset - lsize;
+        Piece *tail = heap_new0(Piece);
+        tail->data = piece->data + cut;
+        tail->size = piece->size - cut;
+        tail->priority = piece->priority;
+        buffer->npieces += 1;
+
+        /* recount only the shorter side of the cut */
+        if (buffer->indexed) {
+            if (cut <= tail->size) {
+                uint32_t lines, chars;
+                utxUtf8Count(piece->data, cut, &lines, &chars);
+                tail->lines = piece->lines - lines;
+                tail->chars = piece->chars - chars;
+                piece->lines = lines;
+                piece->chars = chars;
+            } else {
+                utxUtf8Count(tail->data, tail->size, &tail->lines, &tail->chars);
+                piece->lines -= tail->lines;
+                piece->chars -= tail->chars;
+            }
+        }
+
+        tail->right = piece->right;
+        piece->right = NULL;
+        piece->size = cut;
+        i_update(tail);
+        i_update(piece);
+        *left = piece;
+        *right = tail;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static Piece *i_pieces_new(UtxBuffer *buffer, const char_t *data, uint32_t size) {
+    Piece *root = NULL;
+    while (size > 0) {
+        /* cut on code point boundaries, so each piece holds whole characters */
+        uint32_t n = size > PIECE_SIZE ? utxUtf8Boundary(data, PIECE_SIZE) : size;
+        if (n == 0) {
+            n = PIECE_SIZE;
+        }
+        root = i_merge(root, i_piece_new(buffer, data, n));
+        data += n;
+        size -= n;
+    }
+    return root;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Typing appends to the tail of the current block; when the piece before the
+ * insertion point already ends there, it simply grows instead of adding a
+ * new piece. */
+static bool_t i_extend(UtxBuffer *buffer, Piece *left, const char_t *text, uint32_t size) {
+    Block *block = buffer->store->blocks;
+    if (left == NULL || block == NULL || block->size - block->used < size) {
+        return FALSE;
+    }
+
+    Piece *last = left;
+    while (last->right != NULL) {
+        last = last->right;
+    }
+    if (last->data + last->size != i_block_data(block) + block->used) {
+        return FALSE;
+    }
+    if (last->size + size > PIECE_SIZE) {
+        return FALSE;
+    }
+
+    uint32_t lines = 0, chars = 0;
+    if (buffer->indexed) {
+        utxUtf8Count(text, size, &lines, &chars);
+    }
+
+    i_store(buffer, text, size);
+    last->size += size;
+    last->lines += lines;
+    last->chars += chars;
+    for (Piece *piece = left; piece != NULL; piece = piece->right) {
+        piece->total += size;
+        piece->tlines += lines;
+        piece->tchars += chars;
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static const Piece *i_find(const Piece *piece, uint32_t *offset) {
+    while (piece != NULL) {
+        uint32_t lsize = i_total(piece->left);
+        if (*offset < lsize) {
+            piece = piece->left;
+        } else if (*offset < lsize + piece->size) {
+            *offset -= lsize;
+            return piece;
+        } else {
+            *offset -= lsize + piece->size;
+            piece = piece->right;
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_is_boundary(const UtxBuffer *buffer, uint32_t offset) {
+    const Piece *piece = i_find(buffer->root, &offset);
+    if (piece == NULL) {
+        return TRUE;
+    }
+    return ((byte_t)piece->data[offset] & 0xC0) != 0x80;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_rebase(Piece *piece, const char_t *from, uint32_t size, const char_t *to) {
+    if (piece == NULL) {
+        return;
+    }
+    if (piece->data >= from && piece->data < from + size) {
+        piece->data = to + (piece->data - from);
+    }
+    i_rebase(piece->left, from, size, to);
+    i_rebase(piece->right, from, size, to);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_clear(UtxBuffer *buffer) {
+    i_pieces_destroy(buffer, &buffer->root);
+    i_store_release(&buffer->store, buffer->mapped);
+    buffer->store = i_store_new();
+    buffer->mapped = FALSE;
+    buffer->indexed = TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_visit(const Piece *piece, uint32_t base, uint32_t from, uint32_t to, FPtr_utxChunk func, void *data) {
+    if (piece == NULL || from >= to) {
+        return TRUE;
+    }
+
+    uint32_t start = base + i_total(piece->left);
+    uint32_t end = start + piece->size;
+    if (from < start) {
+        if (!i_visit(piece->left, base, from, to, func, data)) {
+            return FALSE;
+        }
+    }
+    if (from < end && to > start) {
+        uint32_t s = from > start ? from : start;
+        uint32_t e = to < end ? to : end;
+        if (!func(data, piece->data + (s - start), e - s)) {
+            return FALSE;
+        }
+    }
+    if (to > end) {
+        return i_visit(piece->right, end, from, to, func, data);
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_edited(const UtxBuffer *buffer, uint32_t offset, uint32_t removed, uint32_t inserted) {
+    if (removed == 0 && inserted == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < buffer->nobservers; ++i) {
+        buffer->observers[i].func(buffer->observers[i].data, offset, removed, inserted);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+UtxBuffer* utxBufferCreate(void) {
+    UtxBuffer *buffer = heap_new0(UtxBuffer);
+    buffer->store = i_store_new();
+    buffer->indexed = TRUE;
+    buffer->seed = 0x9E3779B9;
+    return buffer;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxBufferDestroy(UtxBuffer** buffer) {
+    if (buffer == NULL || *buffer == NULL) {
+        return;
+    }
+
+    i_pieces_destroy(*buffer, &(*buffer)->root);
+    i_store_release(&(*buffer)->store, (*buffer)->mapped);
+    heap_delete(buffer, UtxBuffer);
+}
+
+/*----------------------------------------------------------------------------*/
+void utxBufferSetText(UtxBuffer* buffer, const char_t *text, uint32_t size) {
+    if (buffer == NULL) {
+        return;
+    }
+
+    uint32_t removed = i_total(buffer->root);
+    i_clear(buffer);
+    if (text != NULL && size > 0) {
+        const char_t *data = i_store(buffer, text, size);
+        buffer->root = i_pieces_new(buffer, data, size);
+    }
+    i_edited(buffer, 0, removed, i_total(buffer->root));
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxBufferSetMapped(UtxBuffer* buffer, UtxFileMap* map, bool_t validate) {
+    if (buffer == NULL) {
+        utxFileMapClose(&map);
+        return RInvalidContents;
+    }
+
+    uint32_t removed = i_total(buffer->root);
+    i_clear(buffer);
+    buffer->store->origin = map;
+    buffer->store->mapRefs = 1;
+    buffer->mapped = TRUE;
+    buffer->indexed = FALSE;
+    buffer->root = i_pieces_new(buffer, utxFileMapData(map), utxFileMapSize(map));
+    if (!validate) {
+        i_edited(buffer, 0, removed, i_total(buffer->root));
+        return ROkay;
+    }
+
+    /* validating touches every page anyway, so index in the same pass */
+    UtxUtf8 state;
+    utxUtf8Init(&state);
+    if (!i_scan(buffer->root, &state) || !utxUtf8Complete(&state)) {
+        i_clear(buffer);
+        i_edited(buffer, 0, removed, 0);
+        return RInvalidEncoding;
+    }
+
+    buffer->indexed = TRUE;
+    i_edited(buffer, 0, removed, i_total(buffer->root));
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Exchanges the text of two buffers; each keeps its own observers, and hears
+ * of the exchange as a replace of all its text. A file can be read into a
+ * spare buffer and only taken over once it has been read in full. */
+void utxBufferSwap(UtxBuffer* buffer, UtxBuffer* other) {
+    if (buffer == NULL || other == NULL || buffer == other) {
+        return;
+    }
+
+    UtxBuffer swap = *buffer;
+    uint32_t length = i_total(buffer->root);
+    uint32_t otherLength = i_total(other->root);
+    buffer->root = other->root;
+    buffer->store = other->store;
+    buffer->mapped = other->mapped;
+    buffer->indexed = other->indexed;
+    buffer->npieces = other->npieces;
+    buffer->seed = other->seed;
+    other->root = swap.root;
+    other->store = swap.store;
+    other->mapped = swap.mapped;
+    other->indexed = swap.indexed;
+    other->npieces = swap.npieces;
+    other->seed = swap.seed;
+    i_edited(buffer, 0, length, otherLength);
+    i_edited(other, 0, otherLength, length);
+}
+
+/*----------------------------------------------------------------------------*/
+const UtxFileMap* utxBufferOrigin(const UtxBuffer* buffer) {
+    return buffer != NULL && buffer->mapped ? buffer->store->origin : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Moves the mapped original text into owned memory and releases the mapping,
+ * so the underlying file can be rewritten or removed. Snapshots taken before
+ * keep the mapping open until they are destroyed. */
+void utxBufferDetach(UtxBuffer* buffer) {
+    if (buffer == NULL || !buffer->mapped) {
+        return;
+    }
+
+    Store *store = buffer->store;
+    const char_t *data = utxFileMapData(store->origin);
+    uint32_t size = utxFileMapSize(store->origin);
+    if (size > 0) {
+        Block *block = i_block_new(size);
+        memcpy(i_block_data(block), data, size);
+        block->used = size;
+        if (store->blocks != NULL) {
+            block->next = store->blocks->next;
+            store->blocks->next = block;
+        } else {
+            store->blocks = block;
+        }
+        i_rebase(buffer->root, data, size, i_block_data(block));
+    }
+    buffer->mapped = FALSE;
+    i_store_release_map(store);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferLength(const UtxBuffer* buffer) {
+    return buffer != NULL ? i_total(buffer->root) : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferPieces(const UtxBuffer* buffer) {
+    return buffer != NULL ? buffer->npieces : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxBufferInsert(UtxBuffer* buffer, uint32_t offset, const char_t *text, uint32_t size) {
+    return utxBufferReplace(buffer, offset, 0, text, size);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxBufferDelete(UtxBuffer* buffer, uint32_t offset, uint32_t size) {
+    return utxBufferReplace(buffer, offset, size, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* A range can be edited when it lies within the text and both its ends fall
+ * on code point boundaries. */
+Result utxBufferCheck(const UtxBuffer* buffer, uint32_t offset, uint32_t size) {
+    if (buffer == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    uint32_t length = i_total(buffer->root);
+    if (offset > length || size > length - offset) {
+        return RInvalidRange;
+    }
+    if (!i_is_boundary(buffer, offset) || !i_is_boundary(buffer, offset + size)) {
+        return RInvalidRange;
+    }
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxBufferReplace(UtxBuffer* buffer, uint32_t offset, uint32_t size, const char_t *text, uint32_t textSize) {
+    if (buffer == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (text == NULL && textSize > 0) {
+        return RInvalidContents;
+    }
+
+    Result result = utxBufferCheck(buffer, offset, size);
+    if (result != ROkay) {
+        return result;
+    }
+    if (size == 0 && textSize == 0) {
+        return ROkay;
+    }
+
+    Piece *left, *middle, *right;
+    i_split(buffer, buffer->root, offset, &left, &right);
+    if (size > 0) {
+        i_split(buffer, right, size, &middle, &right);
+        i_pieces_destroy(buffer, &middle);
+    }
+
+    if (textSize > 0 && !i_extend(buffer, left, text, textSize)) {
+        const char_t *data = i_store(buffer, text, textSize);
+        left = i_merge(left, i_pieces_new(buffer, data, textSize));
+    }
+
+    buffer->root = i_merge(left, right);
+    i_edited(buffer, offset, size, textSize);
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Ranges can be replaced together when each can be edited, they come in
+ * ascending order apart from one another, and the text replacing them all
+ * still fits. */
+Result utxBufferCheckRanges(const UtxBuffer* buffer, const UtxRange *ranges, uint32_t count, uint32_t textSize) {
+    if (buffer == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (ranges == NULL && count > 0) {
+        return RInvalidContents;
+    }
+
+    uint64_t removed = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i > 0 && ranges[i].offset < ranges[i - 1].offset + ranges[i - 1].size) {
+            return RInvalidRange;
+        }
+        Result result = utxBufferCheck(buffer, ranges[i].offset, ranges[i].size);
+        if (result != ROkay) {
+            return result;
+        }
+        removed += ranges[i].size;
+    }
+    if (i_total(buffer->root) - removed + (uint64_t)count * textSize > UINT32_MAX) {
+        return RInvalidRange;
+    }
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces each range, in ascending order and apart from one another, with
+ * the same text, in one walk over the pieces. The text is stored once and
+ * shared by every piece that holds it. Observers hear of one edit, from the
+ * first range to the end of the last. Nothing changes unless all the ranges
+ * pass utxBufferCheckRanges. */
+Result utxBufferReplaceRanges(UtxBuffer* buffer, const UtxRange *ranges, uint32_t count, const char_t *text, uint32_t textSize) {
+    if (buffer == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (text == NULL && textSize > 0) {
+        return RInvalidContents;
+    }
+
+    Result result = utxBufferCheckRanges(buffer, ranges, count, textSize);
+    if (result != ROkay) {
+        return result;
+    }
+
+    uint64_t removed = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        removed += ranges[i].size;
+    }
+    uint64_t inserted = (uint64_t)count * textSize;
+    if (removed == 0 && inserted == 0) {
+        return ROkay;
+    }
+
+    const char_t *data = textSize > 0 ? i_store(buffer, text, textSize) : NULL;
+    Piece *done = NULL, *rest = buffer->root;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        Piece *left, *middle;
+        i_split(buffer, rest, ranges[i].offset - pos, &left, &rest);
+        if (ranges[i].size > 0) {
+            i_split(buffer, rest, ranges[i].size, &middle, &rest);
+            i_pieces_destroy(buffer, &middle);
+        }
+        done = i_merge(done, left);
+        if (textSize > 0) {
+            done = i_merge(done, i_pieces_new(buffer, data, textSize));
+        }
+        pos = ranges[i].offset + ranges[i].size;
+    }
+
+    buffer->root = i_merge(done, rest);
+    uint32_t first = ranges[0].offset;
+    i_edited(buffer, first, pos - first, (uint32_t)(pos - first - removed + inserted));
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Calls `func` after every change to the text, with the range replaced and
+ * the size of what replaced it. FALSE if there are too many observers. */
+bool_t utxBufferAddObserver(UtxBuffer* buffer, FPtr_utxEdited func, void *data) {
+    if (buffer == NULL || func == NULL || buffer->nobservers == MAX_OBSERVERS) {
+        return FALSE;
+    }
+
+    buffer->observers[buffer->nobservers].func = func;
+    buffer->observers[buffer->nobservers].data = data;
+    buffer->nobservers += 1;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxBufferRemoveObserver(UtxBuffer* buffer, FPtr_utxEdited func, void *data) {
+    if (buffer == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < buffer->nobservers; ++i) {
+        if (buffer->observers[i].func == func && buffer->observers[i].data == data) {
+            buffer->nobservers -= 1;
+            memmove(buffer->observers + i, buffer->observers + i + 1, (buffer->nobservers - i) * sizeof(Observer));
+            return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _read_t ReadCtx;
+struct _read_t {
+    char_t *dest;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_read_chunk(ReadCtx *ctx, const char_t *chunk, const uint32_t size) {
+    memcpy(ctx->dest + ctx->size, chunk, size);
+    ctx->size += size;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferRead(const UtxBuffer* buffer, uint32_t offset, char_t *dest, uint32_t size) {
+    if (buffer == NULL || dest == NULL) {
+        return 0;
+    }
+
+    ReadCtx ctx = { dest, 0 };
+    utxBufferForEach(buffer, offset, size, (FPtr_utxChunk)i_read_chunk, &ctx);
+    return ctx.size;
+}
+
+/*----------------------------------------------------------------------------*/
+String* utxBufferString(const UtxBuffer* buffer, uint32_t offset, uint32_t size) {
+    uint32_t length = utxBufferLength(buffer);
+    if (offset > length) {
+        offset = length;
+    }
+    if (size > length - offset) {
+        size = length - offset;
+    }
+
+    String *str = str_reserve(size);
+    char_t *dest = tcc(str);
+    uint32_t n = utxBufferRead(buffer, offset, dest, size);
+    dest[n] = '\0';
+    return str;
+}
+
+/*----------------------------------------------------------------------------*/
+const char_t* utxBufferChunk(const UtxBuffer* buffer, uint32_t offset, uint32_t *size) {
+    const Piece *piece = buffer != NULL ? i_find(buffer->root, &offset) : NULL;
+    if (piece == NULL) {
+        if (size != NULL) {
+            *size = 0;
+        }
+        return NULL;
+    }
+
+    if (size != NULL) {
+        *size = piece->size - offset;
+    }
+    return piece->data + offset;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxBufferForEach(const UtxBuffer* buffer, uint32_t offset, uint32_t size, FPtr_utxChunk func, void *data) {
+    if (buffer == NULL || func == NULL) {
+        return FALSE;
+    }
+
+    uint32_t length = i_total(buffer->root);
+    if (offset >= length) {
+        return TRUE;
+    }
+    if (size > length - offset) {
+        size = length - offset;
+    }
+    return i_visit(buffer->root, 0, offset, offset + size, func, data);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_spans(const Piece *piece, Span *spans, uint32_t *n) {
+    if (piece == NULL) {
+        return;
+    }
+    i_spans(piece->left, spans, n);
+    spans[*n].data = piece->data;
+    spans[*n].size = piece->size;
+    spans[*n].start = *n > 0 ? spans[*n - 1].start + spans[*n - 1].size : 0;
+    *n += 1;
+    i_spans(piece->right, spans, n);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Captures the current text without copying it: block memory is never
+ * rewritten, so holding a reference to the store keeps the spans valid
+ * whatever the buffer does next. */
+UtxSnapshot* utxBufferSnapshot(const UtxBuffer* buffer) {
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    UtxSnapshot *snapshot = heap_new0(UtxSnapshot);
+    snapshot->store = buffer->store;
+    snapshot->mapped = buffer->mapped;
+    snapshot->length = i_total(buffer->root);
+    if (buffer->npieces > 0) {
+        snapshot->spans = heap_new_n(buffer->npieces, Span);
+        i_spans(buffer->root, snapshot->spans, &snapshot->nspans);
+    }
+    i_store_retain(snapshot->store, snapshot->mapped);
+    return snapshot;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSnapshotDestroy(UtxSnapshot** snapshot) {
+    if (snapshot == NULL || *snapshot == NULL) {
+        return;
+    }
+
+    if ((*snapshot)->spans != NULL) {
+        heap_delete_n(&(*snapshot)->spans, (*snapshot)->nspans, Span);
+    }
+    i_store_release(&(*snapshot)->store, (*snapshot)->mapped);
+    heap_delete(snapshot, UtxSnapshot);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxSnapshotLength(const UtxSnapshot* snapshot) {
+    return snapshot != NULL ? snapshot->length : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies out a range; returns the bytes copied. */
+uint32_t utxSnapshotRead(const UtxSnapshot* snapshot, uint32_t offset, char_t *dest, uint32_t size) {
+    if (snapshot == NULL || dest == NULL || offset >= snapshot->length) {
+        return 0;
+    }
+
+    /* the last span starting at or before the offset */
+    uint32_t lo = 0, hi = snapshot->nspans;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (snapshot->spans[mid].start <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = lo; i < snapshot->nspans && n < size; ++i) {
+        const Span *span = &snapshot->spans[i];
+        uint32_t from = offset + n - span->start;
+        uint32_t count = span->size - from < size - n ? span->size - from : size - n;
+        memcpy(dest + n, span->data + from, count);
+        n += count;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxSnapshotForEach(const UtxSnapshot* snapshot, FPtr_utxChunk func, void *data) {
+    if (snapshot == NULL || func == NULL) {
+        return FALSE;
+    }
+
+    for (uint32_t i = 0; i < snapshot->nspans; ++i) {
+        if (!func(data, snapshot->spans[i].data, snapshot->spans[i].size)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferLines(const UtxBuffer* buffer) {
+    if (buffer == NULL) {
+        return 0;
+    }
+    return i_tlines(i_indexed(buffer)) + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferChars(const UtxBuffer* buffer) {
+    if (buffer == NULL) {
+        return 0;
+    }
+    return i_tchars(i_indexed(buffer));
+}
+
+/*----------------------------------------------------------------------------*/
+/* Line feeds and code points in the first `offset` bytes. */
+static void i_prefix(const UtxBuffer *buffer, uint32_t offset, uint32_t *lines, uint32_t *chars) {
+    const Piece *piece = i_indexed(buffer);
+    uint32_t nlines = 0;
+    uint32_t nchars = 0;
+
+    while (piece != NULL) {
+        uint32_t lsize = i_total(piece->left);
+        if (offset < lsize) {
+            piece = piece->left;
+        } else if (offset <= lsize + piece->size) {
+            uint32_t l, c;
+            utxUtf8Count(piece->data, offset - lsize, &l, &c);
+            nlines += i_tlines(piece->left) + l;
+            nchars += i_tchars(piece->left) + c;
+            break;
+        } else {
+            nlines += i_tlines(piece->left) + piece->lines;
+            nchars += i_tchars(piece->left) + piece->chars;
+            offset -= lsize + piece->size;
+            piece = piece->right;
+        }
+    }
+
+    *lines = nlines;
+    *chars = nchars;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferLineOf(const UtxBuffer* buffer, uint32_t offset) {
+    if (buffer == NULL) {
+        return 0;
+    }
+
+    uint32_t lines, chars;
+    i_prefix(buffer, offset, &lines, &chars);
+    return lines;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferLineStart(const UtxBuffer* buffer, uint32_t line) {
+    if (buffer == NULL || line == 0) {
+        return 0;
+    }
+
+    const Piece *piece = i_indexed(buffer);
+    if (line > i_tlines(piece)) {
+        return i_total(piece);
+    }
+
+    /* the start of `line` follows its line-th line feed */
+    uint32_t base = 0;
+    while (piece != NULL) {
+        uint32_t llines = i_tlines(piece->left);
+        if (line <= llines) {
+            piece = piece->left;
+            continue;
+        }
+
+        line -= llines;
+        base += i_total(piece->left);
+        if (line <= piece->lines) {
+            const char_t *s = piece->data;
+            const char_t *end = s + piece->size;
+            for (; s < end; ++s) {
+                if (*s == '\n' && --line == 0) {
+                    return base + (uint32_t)(s - piece->data) + 1;
+                }
+            }
+        }
+
+        line -= piece->lines;
+        base += piece->size;
+        piece = piece->right;
+    }
+    return base;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferOffsetToChar(const UtxBuffer* buffer, uint32_t offset) {
+    if (buffer == NULL) {
+        return 0;
+    }
+
+    uint32_t lines, chars;
+    i_prefix(buffer, offset, &lines, &chars);
+    return chars;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxBufferCharToOffset(const UtxBuffer* buffer, uint32_t index) {
+    if (buffer == NULL) {
+        return 0;
+    }
+
+    const Piece *piece = i_indexed(buffer);
+    if (index >= i_tchars(piece)) {
+        return i_total(piece);
+    }
+
+    uint32_t base = 0;
+    while (piece != NULL) {
+        uint32_t lchars = i_tchars(piece->left);
+        if (index < lchars) {
+            piece = piece->left;
+            continue;
+        }
+
+        index -= lchars;
+        base += i_total(piece->left);
+        if (index < piece->chars) {
+            const byte_t *s = (const byte_t*)piece->data;
+            for (uint32_t i = 0; i < piece->size; ++i) {
+                if ((s[i] & 0xC0) != 0x80 && index-- == 0) {
+                    return base + i;
+                }
+            }
+        }
+
+        index -= piece->chars;
+        base += piece->size;
+        piece = piece->right;
+    }
+    return base;
+}
+
+/*----------------------------------------------------------------------------*/
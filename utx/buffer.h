@@ -0,0 +1,63 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_BUFFER_H__
+#define __UTX_BUFFER_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxBuffer* utxBufferCreate(void);
+_utx_api void utxBufferDestroy(UtxBuffer** buffer);
+
+_utx_api void utxBufferSetText(UtxBuffer* buffer, const char_t *text, uint32_t size);
+_utx_api Result utxBufferSetMapped(UtxBuffer* buffer, UtxFileMap* map, bool_t validate);
+_utx_api void utxBufferSwap(UtxBuffer* buffer, UtxBuffer* other);
+_utx_api const UtxFileMap* utxBufferOrigin(const UtxBuffer* buffer);
+_utx_api void utxBufferDetach(UtxBuffer* buffer);
+_utx_api uint32_t utxBufferLength(const UtxBuffer* buffer);
+_utx_api uint32_t utxBufferPieces(const UtxBuffer* buffer);
+
+_utx_api Result utxBufferCheck(const UtxBuffer* buffer, uint32_t offset, uint32_t size);
+_utx_api Result utxBufferInsert(UtxBuffer* buffer, uint32_t offset, const char_t *text, uint32_t size);
+_utx_api Result utxBufferDelete(UtxBuffer* buffer, uint32_t offset, uint32_t size);
+_utx_api Result utxBufferReplace(UtxBuffer* buffer, uint32_t offset, uint32_t size, const char_t *text, uint32_t textSize);
+_utx_api Result utxBufferCheckRanges(const UtxBuffer* buffer, const UtxRange *ranges, uint32_t count, uint32_t textSize);
+_utx_api Result utxBufferReplaceRanges(UtxBuffer* buffer, const UtxRange *ranges, uint32_t count, const char_t *text, uint32_t textSize);
+_utx_api bool_t utxBufferAddObserver(UtxBuffer* buffer, FPtr_utxEdited func, void *data);
+_utx_api void utxBufferRemoveObserver(UtxBuffer* buffer, FPtr_utxEdited func, void *data);
+
+_utx_api uint32_t utxBufferRead(const UtxBuffer* buffer, uint32_t offset, char_t *dest, uint32_t size);
+_utx_api String* utxBufferString(const UtxBuffer* buffer, uint32_t offset, uint32_t size);
+_utx_api const char_t* utxBufferChunk(const UtxBuffer* buffer, uint32_t offset, uint32_t *size);
+_utx_api bool_t utxBufferForEach(const UtxBuffer* buffer, uint32_t offset, uint32_t size, FPtr_utxChunk func, void *data);
+
+_utx_api UtxSnapshot* utxBufferSnapshot(const UtxBuffer* buffer);
+_utx_api void utxSnapshotDestroy(UtxSnapshot** snapshot);
+_utx_api uint32_t utxSnapshotLength(const UtxSnapshot* snapshot);
+_utx_api uint32_t utxSnapshotRead(const UtxSnapshot* snapshot, uint32_t offset, char_t *dest, uint32_t size);
+_utx_api bool_t utxSnapshotForEach(const UtxSnapshot* snapshot, FPtr_utxChunk func, void *data);
+
+_utx_api uint32_t utxBufferLines(const UtxBuffer* buffer);
+_utx_api uint32_t utxBufferChars(const UtxBuffer* buffer);
+_utx_api uint32_t utxBufferLineOf(const UtxBuffer* buffer, uint32_t offset);
+_utx_api uint32_t utxBufferLineStart(const UtxBuffer* buffer, uint32_t line);
+_utx_api uint32_t utxBufferOffsetToChar(const UtxBuffer* buffer, uint32_t offset);
+_utx_api uint32_t utxBufferCharToOffset(const UtxBuffer* buffer, uint32_t index);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_BUFFER_H__ */
+/*----------------------------------------------------------------------------*/
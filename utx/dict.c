@@ -0,0 +1,694 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Spelling dictionary.
+ *
+ * The words are stored as a minimal acyclic automaton (a DAWG) over code
+ * points: words that share a prefix share the path to it, and words that
+ * share a suffix share the states after it, which in a list of inflected
+ * forms is most of them.
+ *
+ * The builder takes the words in sorted order and minimizes as it goes
+ * (Daciuk et al., "Incremental construction of minimal acyclic finite-state
+ * automata"): only the path of the last word is open, and each state that
+ * falls off it is replaced by an equal state seen before, if there is one.
+ *
+ * The file is an array of 32 bit words, read in place from a mapping: a
+ * header, then each state as its edge count and final flag followed by its
+ * edges, (label, state offset), sorted by label. Opening costs a mapping and
+ * a header check; pages come in as lookups touch them.
+ *
+ * Suggestions walk the automaton with a row of the edit distance table per
+ * depth, pruning a branch once no row can come back under the limit. Edits
+ * are insertions, deletions, substitutions and swaps of neighbours, counted
+ * in characters.
+ */
+#include "dict.h"
+#include "buffer.h"
+#include "filemap.h"
+#include "saver.h"
+#include <core/heap.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------*/
+#define DICT_MAGIC 0x44585455
+#define DICT_VERSION 1
+#define DICT_HEADER 6
+#define DICT_MAX_WORD 64
+#define PENDING 0xFFFFFFFF
+
+/*----------------------------------------------------------------------------*/
+typedef struct _edge_t Edge;
+struct _edge_t {
+    uint32_t label;
+    uint32_t target;
+};
+
+/*----------------------------------------------------------------------------*/
+/* A closed state: its edges in the edge pool. */
+typedef struct _node_t Node;
+struct _node_t {
+    uint32_t first;
+    uint32_t count;
+    uint32_t hash;
+    bool_t final;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_dict_builder_t {
+    Node *nodes;
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+
+    Edge *edges;
+    uint32_t edgeCount;
+    uint32_t edgeCapacity;
+
+    /* closed states by content, holding node + 1 */
+    uint32_t *table;
+    uint32_t tableCapacity;
+
+    /* the open path: the edges of each state on it, back to back */
+    Edge *stack;
+    uint32_t stackCount;
+    uint32_t stackCapacity;
+    uint32_t start[DICT_MAX_WORD + 1];
+    bool_t final[DICT_MAX_WORD + 1];
+    uint32_t last[DICT_MAX_WORD];
+    uint32_t depth;
+
+    uint32_t words;
+    uint32_t root;
+    bool_t closed;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_dict_t {
+    UtxFileMap *map;
+    const uint32_t *data;
+    uint32_t size;
+    uint32_t words;
+    uint32_t states;
+    uint32_t root;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Code points of a UTF-8 word; 0 if it is not valid or too long. */
+static uint32_t i_decode(const char_t *word, uint32_t size, uint32_t *cps) {
+    const byte_t *s = (const byte_t*)word;
+    uint32_t n = 0;
+    uint32_t i = 0;
+    while (i < size) {
+        uint32_t c = s[i];
+        uint32_t k = c < 0x80 ? 0 : c >= 0xC2 && c < 0xE0 ? 1 : c >= 0xE0 && c < 0xF0 ? 2 : c >= 0xF0 && c < 0xF5 ? 3 : 4;
+        if (k == 4 || size - i <= k || n == DICT_MAX_WORD) {
+            return 0;
+        }
+        c &= k == 0 ? 0x7F : 0x3F >> k;
+        for (uint32_t j = 1; j <= k; ++j) {
+            if ((s[i + j] & 0xC0) != 0x80) {
+                return 0;
+            }
+            c = (c << 6) | (s[i + j] & 0x3F);
+        }
+        cps[n++] = c;
+        i += k + 1;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_encode(uint32_t c, char_t *out) {
+    if (c < 0x80) {
+        out[0] = (char_t)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        out[0] = (char_t)(0xC0 | (c >> 6));
+        out[1] = (char_t)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = (char_t)(0xE0 | (c >> 12));
+        out[1] = (char_t)(0x80 | ((c >> 6) & 0x3F));
+        out[2] = (char_t)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = (char_t)(0xF0 | (c >> 18));
+    out[1] = (char_t)(0x80 | ((c >> 12) & 0x3F));
+    out[2] = (char_t)(0x80 | ((c >> 6) & 0x3F));
+    out[3] = (char_t)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+/*----------------------------------------------------------------------------*/
+static void *i_grow(void *data, uint32_t *capacity, uint32_t needed, uint32_t item, const char_t *name) {
+    if (needed <= *capacity) {
+        return data;
+    }
+
+    uint32_t grown = *capacity > 0 ? *capacity * 2 : 1024;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    if (data == NULL) {
+        data = heap_malloc(grown * item, name);
+    } else {
+        data = heap_realloc((byte_t*)data, *capacity * item, grown * item, name);
+    }
+    *capacity = grown;
+    return data;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_hash(const Edge *edges, uint32_t count, bool_t final) {
+    uint32_t hash = final ? 0x9E3779B9 : 0x811C9DC5;
+    for (uint32_t i = 0; i < count; ++i) {
+        hash = (hash ^ edges[i].label) * 0x01000193;
+        hash = (hash ^ edges[i].target) * 0x01000193;
+    }
+    return hash;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_table_insert(uint32_t *table, uint32_t capacity, const Node *nodes, uint32_t id) {
+    uint32_t slot = nodes[id].hash & (capacity - 1);
+    while (table[slot] != 0) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    table[slot] = id + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_table_grow(UtxDictBuilder *builder) {
+    uint32_t capacity = builder->tableCapacity > 0 ? builder->tableCapacity * 2 : 4096;
+    uint32_t *table = heap_new_n0(capacity, uint32_t);
+    for (uint32_t id = 0; id < builder->nodeCount; ++id) {
+        i_table_insert(table, capacity, builder->nodes, id);
+    }
+    if (builder->table != NULL) {
+        heap_delete_n(&builder->table, builder->tableCapacity, uint32_t);
+    }
+    builder->table = table;
+    builder->tableCapacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Closes the deepest open state: it becomes an equal closed state if there
+ * is one, a new one otherwise, and its parent's last edge leads there. */
+static uint32_t i_close(UtxDictBuilder *builder) {
+    uint32_t depth = builder->depth;
+    const Edge *edges = builder->stack + builder->start[depth];
+    uint32_t count = builder->stackCount - builder->start[depth];
+    bool_t final = builder->final[depth];
+    uint32_t hash = i_hash(edges, count, final);
+
+    uint32_t id = PENDING;
+    uint32_t slot = hash & (builder->tableCapacity - 1);
+    while (builder->table[slot] != 0) {
+        const Node *node = &builder->nodes[builder->table[slot] - 1];
+        if (node->hash == hash && node->final == final && node->count == count
+            && memcmp(builder->edges + node->first, edges, count * sizeof(Edge)) == 0) {
+            id = builder->table[slot] - 1;
+            break;
+        }
+        slot = (slot + 1) & (builder->tableCapacity - 1);
+    }
+
+    if (id == PENDING) {
+        builder->nodes = (Node*)i_grow(builder->nodes, &builder->nodeCapacity, builder->nodeCount + 1, sizeof(Node), "UtxDictNodes");
+        builder->edges = (Edge*)i_grow(builder->edges, &builder->edgeCapacity, builder->edgeCount + count, sizeof(Edge), "UtxDictEdges");
+        id = builder->nodeCount++;
+        Node *node = &builder->nodes[id];
+        node->first = builder->edgeCount;
+        node->count = count;
+        node->hash = hash;
+        node->final = final;
+        if (count > 0) {
+            memcpy(builder->edges + builder->edgeCount, edges, count * sizeof(Edge));
+        }
+        builder->edgeCount += count;
+        builder->table[slot] = id + 1;
+        if (builder->nodeCount * 2 > builder->tableCapacity) {
+            i_table_grow(builder);
+        }
+    }
+
+    builder->stackCount = builder->start[depth];
+    if (depth > 0) {
+        builder->depth -= 1;
+        builder->stack[builder->stackCount - 1].target = id;
+    }
+    return id;
+}
+
+/*----------------------------------------------------------------------------*/
+UtxDictBuilder* utxDictBuilderCreate(void) {
+    UtxDictBuilder *builder = heap_new0(UtxDictBuilder);
+    builder->stack = (Edge*)i_grow(NULL, &builder->stackCapacity, 1, sizeof(Edge), "UtxDictStack");
+    i_table_grow(builder);
+    return builder;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxDictBuilderDestroy(UtxDictBuilder** builder) {
+    if (builder == NULL || *builder == NULL) {
+        return;
+    }
+
+    UtxDictBuilder *b = *builder;
+    if (b->nodes != NULL) {
+        heap_free((byte_t**)&b->nodes, b->nodeCapacity * (uint32_t)sizeof(Node), "UtxDictNodes");
+    }
+    if (b->edges != NULL) {
+        heap_free((byte_t**)&b->edges, b->edgeCapacity * (uint32_t)sizeof(Edge), "UtxDictEdges");
+    }
+    heap_free((byte_t**)&b->stack, b->stackCapacity * (uint32_t)sizeof(Edge), "UtxDictStack");
+    heap_delete_n(&b->table, b->tableCapacity, uint32_t);
+    heap_delete(builder, UtxDictBuilder);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Words come in byte order, which for UTF-8 is code point order; a repeat
+ * of the last word is ignored. */
+Result utxDictBuilderAdd(UtxDictBuilder* builder, const char_t *word, uint32_t size) {
+    uint32_t cps[DICT_MAX_WORD];
+    if (builder == NULL || builder->closed || word == NULL || size == 0) {
+        return RInvalidContents;
+    }
+
+    uint32_t n = i_decode(word, size, cps);
+    if (n == 0) {
+        return RInvalidEncoding;
+    }
+
+    uint32_t prefix = 0;
+    uint32_t length = builder->depth;
+    while (prefix < n && prefix < length && cps[prefix] == builder->last[prefix]) {
+        prefix += 1;
+    }
+    if (prefix == n && prefix == length && builder->words > 0) {
+        return ROkay;
+    }
+    if (builder->words > 0 && (prefix == n || (prefix < length && cps[prefix] < builder->last[prefix]))) {
+        return RInvalidContents;
+    }
+
+    while (builder->depth > prefix) {
+        i_close(builder);
+    }
+
+    for (uint32_t i = prefix; i < n; ++i) {
+        builder->stack = (Edge*)i_grow(builder->stack, &builder->stackCapacity, builder->stackCount + 1, sizeof(Edge), "UtxDictStack");
+        builder->stack[builder->stackCount].label = cps[i];
+        builder->stack[builder->stackCount].target = PENDING;
+        builder->stackCount += 1;
+        builder->start[i + 1] = builder->stackCount;
+        builder->final[i + 1] = FALSE;
+        builder->last[i] = cps[i];
+    }
+    builder->final[n] = TRUE;
+    builder->depth = n;
+    builder->words += 1;
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_finish(UtxDictBuilder *builder) {
+    if (!builder->closed) {
+        while (builder->depth > 0) {
+            i_close(builder);
+        }
+        builder->root = i_close(builder);
+        builder->closed = TRUE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* States in the automaton, once minimized. */
+uint32_t utxDictBuilderStates(UtxDictBuilder* builder) {
+    if (builder == NULL) {
+        return 0;
+    }
+    i_finish(builder);
+    return builder->nodeCount;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Closes the automaton and saves it; no words can be added after this. */
+Result utxDictBuilderWrite(UtxDictBuilder* builder, const char_t *filePath) {
+    if (builder == NULL) {
+        return RInvalidContents;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    i_finish(builder);
+
+    /* states are laid out in the order they were closed, children first */
+    uint32_t *offsets = heap_new_n(builder->nodeCount, uint32_t);
+    uint32_t size = DICT_HEADER;
+    for (uint32_t id = 0; id < builder->nodeCount; ++id) {
+        offsets[id] = size;
+        size += 1 + 2 * builder->nodes[id].count;
+    }
+
+    uint32_t *data = heap_new_n(size, uint32_t);
+    data[0] = DICT_MAGIC;
+    data[1] = DICT_VERSION;
+    data[2] = builder->words;
+    data[3] = builder->nodeCount;
+    data[4] = offsets[builder->root];
+    data[5] = size;
+    for (uint32_t id = 0; id < builder->nodeCount; ++id) {
+        const Node *node = &builder->nodes[id];
+        uint32_t *out = data + offsets[id];
+        out[0] = (node->count << 1) | (node->final ? 1 : 0);
+        for (uint32_t e = 0; e < node->count; ++e) {
+            const Edge *edge = &builder->edges[node->first + e];
+            out[1 + 2 * e] = edge->label;
+            out[2 + 2 * e] = offsets[edge->target];
+        }
+    }
+
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, (const char_t*)data, size * (uint32_t)sizeof(uint32_t));
+    UtxSnapshot *snapshot = utxBufferSnapshot(buffer);
+    Result result = utxSaveFile(snapshot, filePath);
+    utxSnapshotDestroy(&snapshot);
+    utxBufferDestroy(&buffer);
+
+    heap_delete_n(&data, size, uint32_t);
+    heap_delete_n(&offsets, builder->nodeCount, uint32_t);
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _line_t Line;
+struct _line_t {
+    const char_t *text;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+static int i_line_cmp(const void *a, const void *b) {
+    const Line *la = (const Line*)a;
+    const Line *lb = (const Line*)b;
+    uint32_t n = la->size < lb->size ? la->size : lb->size;
+    int cmp = memcmp(la->text, lb->text, n);
+    return cmp != 0 ? cmp : (la->size > lb->size) - (la->size < lb->size);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Builds a dictionary from a word list, one word per line, in any order.
+ * Lines that are not valid words are skipped. */
+Result utxDictCompile(const char_t *listPath, const char_t *dictPath, uint32_t *words) {
+    if (words != NULL) {
+        *words = 0;
+    }
+    if (listPath == NULL || dictPath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    UtxFileMap *map = utxFileMapOpen(listPath, NULL);
+    if (map == NULL) {
+        return RFileError;
+    }
+
+    const char_t *text = utxFileMapData(map);
+    uint32_t size = utxFileMapSize(map);
+    uint32_t count = 0, capacity = 0;
+    Line *lines = NULL;
+    for (uint32_t i = 0; i < size;) {
+        const char_t *end = (const char_t*)memchr(text + i, '\n', size - i);
+        uint32_t next = end != NULL ? (uint32_t)(end - text) + 1 : size;
+        uint32_t n = next - i - (end != NULL ? 1 : 0);
+        n -= n > 0 && text[i + n - 1] == '\r' ? 1 : 0;
+        if (n > 0) {
+            lines = (Line*)i_grow(lines, &capacity, count + 1, sizeof(Line), "UtxDictLines");
+            lines[count].text = text + i;
+            lines[count].size = n;
+            count += 1;
+        }
+        i = next;
+    }
+
+    if (count > 0) {
+        qsort(lines, count, sizeof(Line), i_line_cmp);
+    }
+
+    UtxDictBuilder *builder = utxDictBuilderCreate();
+    for (uint32_t i = 0; i < count; ++i) {
+        utxDictBuilderAdd(builder, lines[i].text, lines[i].size);
+    }
+    Result result = utxDictBuilderWrite(builder, dictPath);
+    if (words != NULL && result == ROkay) {
+        *words = builder->words;
+    }
+
+    utxDictBuilderDestroy(&builder);
+    if (lines != NULL) {
+        heap_free((byte_t**)&lines, capacity * (uint32_t)sizeof(Line), "UtxDictLines");
+    }
+    utxFileMapClose(&map);
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The number of edges out of `state`, 0 if they would run past the end of
+ * a damaged file. */
+static uint32_t i_edge_count(const UtxDict *dict, uint32_t state) {
+    if (state >= dict->size) {
+        return 0;
+    }
+
+    uint32_t count = dict->data[state] >> 1;
+    return count <= (dict->size - state - 1) / 2 ? count : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The state an edge from `state` labelled `label` leads to, 0 if none. A
+ * damaged file reads as having no such edge rather than out of bounds. */
+static uint32_t i_child(const UtxDict *dict, uint32_t state, uint32_t label) {
+    uint32_t count = i_edge_count(dict, state);
+
+    const uint32_t *edges = dict->data + state + 1;
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (edges[2 * mid] < label) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < count && edges[2 * lo] == label) {
+        uint32_t target = edges[2 * lo + 1];
+        return target >= DICT_HEADER && target < dict->size ? target : 0;
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+UtxDict* utxDictOpen(const char_t *filePath, ferror_t *error) {
+    UtxFileMap *map = utxFileMapOpen(filePath, error);
+    if (map == NULL) {
+        return NULL;
+    }
+
+    const uint32_t *data = (const uint32_t*)utxFileMapData(map);
+    uint32_t size = utxFileMapSize(map) / (uint32_t)sizeof(uint32_t);
+    if (size < DICT_HEADER + 1 || data[0] != DICT_MAGIC || data[1] != DICT_VERSION
+        || data[5] != size || data[4] < DICT_HEADER || data[4] >= size) {
+        utxFileMapClose(&map);
+        if (error != NULL) {
+            *error = ekFUNDEF;
+        }
+        return NULL;
+    }
+
+    UtxDict *dict = heap_new0(UtxDict);
+    dict->map = map;
+    dict->data = data;
+    dict->size = size;
+    dict->words = data[2];
+    dict->states = data[3];
+    dict->root = data[4];
+    return dict;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxDictClose(UtxDict** dict) {
+    if (dict == NULL || *dict == NULL) {
+        return;
+    }
+    utxFileMapClose(&(*dict)->map);
+    heap_delete(dict, UtxDict);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxDictWords(const UtxDict* dict) {
+    return dict != NULL ? dict->words : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxDictStates(const UtxDict* dict) {
+    return dict != NULL ? dict->states : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxDictContains(const UtxDict* dict, const char_t *word, uint32_t size) {
+    uint32_t cps[DICT_MAX_WORD];
+    if (dict == NULL || word == NULL) {
+        return FALSE;
+    }
+
+    uint32_t n = i_decode(word, size, cps);
+    if (n == 0) {
+        return FALSE;
+    }
+
+    uint32_t state = dict->root;
+    for (uint32_t i = 0; i < n && state != 0; ++i) {
+        state = i_child(dict, state, cps[i]);
+    }
+    return state != 0 && (dict->data[state] & 1) != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+typedef struct _walk_t Walk;
+struct _walk_t {
+    const UtxDict *dict;
+    const uint32_t *query;
+    uint32_t length;
+    uint32_t distance;
+    uint32_t *rows;
+    uint32_t path[DICT_MAX_WORD + 1];
+    FPtr_utxWord func;
+    void *data;
+    uint32_t calls;
+    bool_t stopped;
+};
+
+/*----------------------------------------------------------------------------*/
+static uint32_t *i_row(Walk *walk, uint32_t depth) {
+    return walk->rows + depth * (walk->length + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_min(const uint32_t *row, uint32_t n) {
+    uint32_t m = row[0];
+    for (uint32_t j = 1; j < n; ++j) {
+        m = row[j] < m ? row[j] : m;
+    }
+    return m;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_emit(Walk *walk, uint32_t depth) {
+    char_t word[DICT_MAX_WORD * 4];
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < depth; ++i) {
+        size += i_encode(walk->path[i], word + size);
+    }
+    walk->calls += 1;
+    if (!walk->func(walk->data, word, size, walk->distance)) {
+        walk->stopped = TRUE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Visits the words below `state` whose distance from the query is exactly
+ * the one asked for. */
+static void i_walk(Walk *walk, uint32_t state, uint32_t depth) {
+    const UtxDict *dict = walk->dict;
+    uint32_t m = walk->length;
+    uint32_t count = i_edge_count(dict, state);
+    if (depth >= DICT_MAX_WORD || depth >= m + walk->distance) {
+        return;
+    }
+
+    const uint32_t *edges = dict->data + state + 1;
+    const uint32_t *prev = i_row(walk, depth);
+    const uint32_t *before = depth > 0 ? i_row(walk, depth - 1) : NULL;
+    uint32_t *row = i_row(walk, depth + 1);
+    for (uint32_t e = 0; e < count && !walk->stopped; ++e) {
+        uint32_t c = edges[2 * e];
+        uint32_t target = edges[2 * e + 1];
+        if (target < DICT_HEADER || target >= dict->size) {
+            continue;
+        }
+
+        row[0] = depth + 1;
+        for (uint32_t j = 1; j <= m; ++j) {
+            uint32_t cost = prev[j - 1] + (walk->query[j - 1] != c ? 1 : 0);
+            uint32_t del = prev[j] + 1;
+            uint32_t ins = row[j - 1] + 1;
+            cost = del < cost ? del : cost;
+            cost = ins < cost ? ins : cost;
+            if (before != NULL && j > 1 && c == walk->query[j - 2] && walk->path[depth - 1] == walk->query[j - 1]) {
+                uint32_t swap = before[j - 2] + 1;
+                cost = swap < cost ? swap : cost;
+            }
+            row[j] = cost;
+        }
+
+        walk->path[depth] = c;
+        if ((dict->data[target] & 1) != 0 && row[m] == walk->distance) {
+            i_emit(walk, depth + 1);
+        }
+
+        /* a swap can still reach back one row, so both have to be over */
+        if (i_min(row, m + 1) <= walk->distance || i_min(prev, m + 1) < walk->distance) {
+            i_walk(walk, target, depth + 1);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Calls `func` with the words within `distance` edits of `word`, closest
+ * first, until it returns FALSE. Returns the number of calls. */
+uint32_t utxDictSuggest(const UtxDict* dict, const char_t *word, uint32_t size, uint32_t distance, FPtr_utxWord func, void *data) {
+    uint32_t query[DICT_MAX_WORD];
+    if (dict == NULL || word == NULL || func == NULL) {
+        return 0;
+    }
+
+    uint32_t m = i_decode(word, size, query);
+    if (m == 0) {
+        return 0;
+    }
+
+    Walk walk;
+    walk.dict = dict;
+    walk.query = query;
+    walk.length = m;
+    walk.func = func;
+    walk.data = data;
+    walk.calls = 0;
+    walk.stopped = FALSE;
+
+    uint32_t rowsSize = (DICT_MAX_WORD + 1) * (m + 1);
+    walk.rows = heap_new_n(rowsSize, uint32_t);
+    for (uint32_t j = 0; j <= m; ++j) {
+        walk.rows[j] = j;
+    }
+
+    for (uint32_t d = 0; d <= distance && !walk.stopped; ++d) {
+        walk.distance = d;
+        i_walk(&walk, dict->root, 0);
+    }
+
+    heap_delete_n(&walk.rows, rowsSize, uint32_t);
+    return walk.calls;
+}
+
+/*----------------------------------------------------------------------------*/
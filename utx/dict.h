@@ -0,0 +1,39 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_DICT_H__
+#define __UTX_DICT_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxDictBuilder* utxDictBuilderCreate(void);
+_utx_api void utxDictBuilderDestroy(UtxDictBuilder** builder);
+_utx_api Result utxDictBuilderAdd(UtxDictBuilder* builder, const char_t *word, uint32_t size);
+_utx_api uint32_t utxDictBuilderStates(UtxDictBuilder* builder);
+_utx_api Result utxDictBuilderWrite(UtxDictBuilder* builder, const char_t *filePath);
+_utx_api Result utxDictCompile(const char_t *listPath, const char_t *dictPath, uint32_t *words);
+
+_utx_api UtxDict* utxDictOpen(const char_t *filePath, ferror_t *error);
+_utx_api void utxDictClose(UtxDict** dict);
+_utx_api uint32_t utxDictWords(const UtxDict* dict);
+_utx_api uint32_t utxDictStates(const UtxDict* dict);
+_utx_api bool_t utxDictContains(const UtxDict* dict, const char_t *word, uint32_t size);
+_utx_api uint32_t utxDictSuggest(const UtxDict* dict, const char_t *word, uint32_t size, uint32_t distance, FPtr_utxWord func, void *data);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_DICT_H__ */
+/*----------------------------------------------------------------------------*/
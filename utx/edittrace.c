@@ -0,0 +1,462 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Edit traces: a recording of what was done to a document, to be replayed
+ * later against another build.
+ *
+ * A trace is attached to one UtxFile at a time. It starts with the profile
+ * and the text of the document, then utx adds an event for each edit, undo,
+ * redo, undo break and save; the editor adds caret moves. Bulk rewrites
+ * (transliterate, normalize) are kept as the one replace they make, with the
+ * text as it ended up. Replace all is kept as a group of rewrites, one per
+ * match, closed by an undo break.
+ *
+ * The file is a header (magic, version, event count, as 32 bit words) and
+ * then the events, each a kind byte, the microseconds since the one before
+ * and the kind's fields, all numbers as LEB128 varints. A keystroke takes
+ * five or six bytes, so a long typing session stays small.
+ *
+ * Replay runs the events through the utx API as fast as it can and reports
+ * how long each call took; caret moves are replayed as the line lookup an
+ * editor makes for the caret.
+ */
+#include "edittrace.h"
+#include "buffer.h"
+#include "history.h"
+#include "filemap.h"
+#include "saver.h"
+#include "utx.h"
+#include <core/heap.h>
+#include <core/strings.h>
+#include <osbs/btime.h>
+
+/*----------------------------------------------------------------------------*/
+#define TRACE_MAGIC 0x45585455
+#define TRACE_VERSION 1
+#define TRACE_HEADER 12
+
+/*----------------------------------------------------------------------------*/
+struct _utx_edit_trace_t {
+    /* recorded in memory, or opened from a file */
+    char_t *data;
+    uint32_t size;
+    uint32_t capacity;
+    UtxFileMap *map;
+    uint32_t events;
+
+    UtxFile *utx;
+    uint64_t start;
+    uint64_t last;
+};
+
+/*----------------------------------------------------------------------------*/
+static const char_t *i_bytes(const UtxEditTrace *trace, uint32_t *size) {
+    if (trace->map != NULL) {
+        *size = utxFileMapSize(trace->map);
+        return utxFileMapData(trace->map);
+    }
+    *size = trace->size;
+    return trace->data;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(UtxEditTrace *trace, uint32_t more) {
+    if (trace->size + more <= trace->capacity) {
+        return;
+    }
+
+    uint32_t grown = trace->capacity > 0 ? trace->capacity : 4096;
+    while (grown < trace->size + more) {
+        grown *= 2;
+    }
+    if (trace->data == NULL) {
+        trace->data = (char_t*)heap_malloc(grown, "UtxEditTrace");
+    } else {
+        trace->data = (char_t*)heap_realloc((byte_t*)trace->data, trace->capacity, grown, "UtxEditTrace");
+    }
+    trace->capacity = grown;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_put_word(char_t *out, uint32_t value) {
+    memcpy(out, &value, sizeof(uint32_t));
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_get_word(const char_t *in) {
+    uint32_t value;
+    memcpy(&value, in, sizeof(uint32_t));
+    return value;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_put_varint(UtxEditTrace *trace, uint64_t value) {
+    i_reserve(trace, 10);
+    while (value >= 0x80) {
+        trace->data[trace->size++] = (char_t)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    trace->data[trace->size++] = (char_t)value;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_get_varint(const char_t *data, uint32_t size, uint32_t *pos, uint32_t bits, uint64_t *value) {
+    uint64_t v = 0;
+    for (uint32_t shift = 0; shift < bits; shift += 7) {
+        if (*pos >= size) {
+            return FALSE;
+        }
+        byte_t b = (byte_t)data[(*pos)++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *value = v;
+            return bits == 64 || v <= 0xFFFFFFFF;
+        }
+    }
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_get_u32(const char_t *data, uint32_t size, uint32_t *pos, uint32_t *value) {
+    uint64_t v = 0;
+    if (!i_get_varint(data, size, pos, 32, &v)) {
+        return FALSE;
+    }
+    *value = (uint32_t)v;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_has_text(UtxEditKind kind) {
+    return kind == EditInsert || kind == EditReplace || kind == EditRewrite || kind == EditReset;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_has_offset(UtxEditKind kind) {
+    return kind != EditReset && kind != EditUndo && kind != EditRedo && kind != EditBreak && kind != EditSave && kind != EditGroup;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_has_removed(UtxEditKind kind) {
+    return kind == EditDelete || kind == EditReplace || kind == EditRewrite || kind == EditCursor;
+}
+
+/*----------------------------------------------------------------------------*/
+UtxEditTrace* utxEditTraceCreate(void) {
+    UtxEditTrace *trace = heap_new0(UtxEditTrace);
+    i_reserve(trace, TRACE_HEADER);
+    i_put_word(trace->data, TRACE_MAGIC);
+    i_put_word(trace->data + 4, TRACE_VERSION);
+    i_put_word(trace->data + 8, 0);
+    trace->size = TRACE_HEADER;
+    return trace;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Every event is checked here, so a replay never meets a broken one. */
+UtxEditTrace* utxEditTraceOpen(const char_t *filePath, ferror_t *error) {
+    UtxFileMap *map = utxFileMapOpen(filePath, error);
+    if (map == NULL) {
+        return NULL;
+    }
+
+    const char_t *data = utxFileMapData(map);
+    uint32_t size = utxFileMapSize(map);
+    bool_t valid = size >= TRACE_HEADER && i_get_word(data) == TRACE_MAGIC && i_get_word(data + 4) == TRACE_VERSION;
+
+    UtxEditTrace *trace = heap_new0(UtxEditTrace);
+    trace->map = map;
+    if (valid) {
+        UtxEditEvent event;
+        uint32_t pos = 0;
+        while (utxEditTraceNext(trace, &pos, &event)) {
+            trace->events += 1;
+        }
+        valid = pos == size && trace->events == i_get_word(data + 8);
+    }
+
+    if (!valid) {
+        utxEditTraceDestroy(&trace);
+        if (error != NULL) {
+            *error = ekFUNDEF;
+        }
+        return NULL;
+    }
+    return trace;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxEditTraceDestroy(UtxEditTrace** trace) {
+    if (trace == NULL || *trace == NULL) {
+        return;
+    }
+
+    utxEditTraceStop(*trace);
+    if ((*trace)->map != NULL) {
+        utxFileMapClose(&(*trace)->map);
+    }
+    if ((*trace)->data != NULL) {
+        heap_free((byte_t**)&(*trace)->data, (*trace)->capacity, "UtxEditTrace");
+    }
+    heap_delete(trace, UtxEditTrace);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxEditTraceWrite(const UtxEditTrace* trace, const char_t *filePath) {
+    if (trace == NULL) {
+        return RInvalidContents;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    uint32_t size = 0;
+    const char_t *data = i_bytes(trace, &size);
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, data, size);
+    UtxSnapshot *snapshot = utxBufferSnapshot(buffer);
+    Result result = utxSaveFile(snapshot, filePath);
+    utxSnapshotDestroy(&snapshot);
+    utxBufferDestroy(&buffer);
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Attaches the trace to `utx`, detaching it from any document before, and
+ * records the document as it is now. A trace keeps what it had: starting on
+ * another document, as when a file is opened, carries on the same session.
+ * Text edits are recorded only as utx makes them: kaatib's document view
+ * cannot be edited yet, so its traces hold caret moves, undo, redo and
+ * saves, but no typing. */
+Result utxEditTraceStart(UtxEditTrace* trace, UtxFile* utx) {
+    if (trace == NULL || trace->map != NULL) {
+        return RInvalidContents;
+    }
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    utxEditTraceStop(trace);
+    if (utx->trace != NULL) {
+        utxEditTraceStop(utx->trace);
+    }
+    if (trace->events == 0) {
+        trace->start = btime_now();
+    }
+
+    trace->utx = utx;
+    utx->trace = trace;
+
+    String *contents = utxGetContents(utx);
+    utxEditTraceAdd(trace, EditNormalize, (uint32_t)utx->normalize, 0, NULL, 0);
+    utxEditTraceAdd(trace, EditReset, 0, 0, tc(contents), str_len(contents));
+    str_destroy(&contents);
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxEditTraceStop(UtxEditTrace* trace) {
+    if (trace == NULL || trace->utx == NULL) {
+        return;
+    }
+    trace->utx->trace = NULL;
+    trace->utx = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Called by utx for each change it makes; fields a kind does not use are
+ * not stored. */
+void utxEditTraceAdd(UtxEditTrace* trace, UtxEditKind kind, uint32_t offset, uint32_t removed, const char_t *text, uint32_t size) {
+    if (trace == NULL || trace->map != NULL) {
+        return;
+    }
+
+    uint64_t now = btime_now() - trace->start;
+    uint64_t delta = now > trace->last ? now - trace->last : 0;
+    trace->last += delta;
+
+    i_reserve(trace, 1);
+    trace->data[trace->size++] = (char_t)kind;
+    i_put_varint(trace, delta);
+    if (i_has_offset(kind)) {
+        i_put_varint(trace, offset);
+    }
+    if (i_has_removed(kind)) {
+        i_put_varint(trace, removed);
+    }
+    if (i_has_text(kind)) {
+        i_put_varint(trace, size);
+        i_reserve(trace, size);
+        if (size > 0) {
+            memcpy(trace->data + trace->size, text, size);
+        }
+        trace->size += size;
+    }
+
+    trace->events += 1;
+    i_put_word(trace->data + 8, trace->events);
+}
+
+/*----------------------------------------------------------------------------*/
+/* For the editor: the caret and the other end of the selection. */
+void utxEditTraceCursor(UtxEditTrace* trace, uint32_t caret, uint32_t anchor) {
+    utxEditTraceAdd(trace, EditCursor, caret, anchor, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxEditTraceEvents(const UtxEditTrace* trace) {
+    return trace != NULL ? trace->events : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Decodes the event at `position`, 0 for the first, and moves past it.
+ * `event` carries the time from one call to the next; `text` points into
+ * the trace. FALSE at the end, or at an event that does not decode. */
+bool_t utxEditTraceNext(const UtxEditTrace* trace, uint32_t *position, UtxEditEvent *event) {
+    if (trace == NULL || position == NULL || event == NULL) {
+        return FALSE;
+    }
+
+    uint32_t size = 0;
+    const char_t *data = i_bytes(trace, &size);
+    uint32_t pos = *position;
+    if (pos < TRACE_HEADER) {
+        pos = TRACE_HEADER;
+        *position = pos;
+        event->time = 0;
+    }
+    if (pos >= size) {
+        return FALSE;
+    }
+
+    UtxEditKind kind = (UtxEditKind)(byte_t)data[pos++];
+    if (kind < EditInsert || kind > EditGroup) {
+        return FALSE;
+    }
+
+    uint64_t delta = 0;
+    event->kind = kind;
+    event->offset = 0;
+    event->removed = 0;
+    event->text = NULL;
+    event->size = 0;
+    if (!i_get_varint(data, size, &pos, 64, &delta)) {
+        return FALSE;
+    }
+    if (i_has_offset(kind) && !i_get_u32(data, size, &pos, &event->offset)) {
+        return FALSE;
+    }
+    if (i_has_removed(kind) && !i_get_u32(data, size, &pos, &event->removed)) {
+        return FALSE;
+    }
+    if (i_has_text(kind)) {
+        if (!i_get_u32(data, size, &pos, &event->size) || event->size > size - pos) {
+            return FALSE;
+        }
+        event->text = data + pos;
+        pos += event->size;
+    }
+
+    event->time += delta;
+    *position = pos;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Inside a group, rewrites join it rather than standing alone. */
+static Result i_replay(UtxFile *utx, const UtxEditEvent *event, const char_t *savePath, bool_t *grouped) {
+    switch (event->kind) {
+    case EditInsert:
+    case EditDelete:
+    case EditReplace:
+        return utxReplace(utx, event->offset, event->removed, event->text, event->size);
+
+    case EditRewrite: {
+        /* the text is as the rewrite left it, not to be normalized again */
+        UtxNormalize profile = utx->normalize;
+        utx->normalize = NormNone;
+        if (!*grouped) {
+            utxUndoBreak(utx);
+        }
+        Result result = utxReplace(utx, event->offset, event->removed, event->text, event->size);
+        if (!*grouped) {
+            utxUndoBreak(utx);
+        }
+        utx->normalize = profile;
+        return result;
+    }
+
+    case EditCursor: {
+        uint32_t line = 0, column = 0;
+        return utxOffsetToLine(utx, event->offset, &line, &column);
+    }
+
+    case EditUndo:
+        return utxUndo(utx, NULL);
+
+    case EditRedo:
+        return utxRedo(utx, NULL);
+
+    case EditBreak:
+        utxUndoBreak(utx);
+        *grouped = FALSE;
+        return ROkay;
+
+    case EditGroup:
+        utxHistoryGroup(utx->history);
+        *grouped = TRUE;
+        return ROkay;
+
+    case EditSave:
+        return savePath != NULL ? utxWriteContentsToFile(utx, savePath) : ROkay;
+
+    case EditReset: {
+        String *contents = str_cn(event->text, event->size);
+        Result result = utxSetContents(utx, contents);
+        str_destroy(&contents);
+        return result;
+    }
+
+    case EditNormalize:
+        utxSetNormalize(utx, (UtxNormalize)event->offset);
+        return ROkay;
+    }
+    return RInvalidContents;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Runs the trace against `utx`, as fast as it goes, and gives `func` each
+ * event with the microseconds its call took. Saves go to `savePath`, or are
+ * skipped without one. Stops at the first call that fails, which means the
+ * document no longer matches the one recorded. */
+Result utxEditTraceReplay(const UtxEditTrace* trace, UtxFile* utx, const char_t *savePath, FPtr_utxReplayed func, void *data) {
+    if (trace == NULL) {
+        return RInvalidContents;
+    }
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    UtxEditEvent event;
+    uint32_t position = 0;
+    Result result = ROkay;
+    bool_t grouped = FALSE;
+    while (result == ROkay && utxEditTraceNext(trace, &position, &event)) {
+        uint64_t start = btime_now();
+        result = i_replay(utx, &event, savePath, &grouped);
+        uint64_t elapsed = btime_now() - start;
+        if (func != NULL) {
+            func(data, &event, elapsed);
+        }
+    }
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,39 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_EDITTRACE_H__
+#define __UTX_EDITTRACE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxEditTrace* utxEditTraceCreate(void);
+_utx_api UtxEditTrace* utxEditTraceOpen(const char_t *filePath, ferror_t *error);
+_utx_api void utxEditTraceDestroy(UtxEditTrace** trace);
+_utx_api Result utxEditTraceWrite(const UtxEditTrace* trace, const char_t *filePath);
+
+_utx_api Result utxEditTraceStart(UtxEditTrace* trace, UtxFile* utx);
+_utx_api void utxEditTraceStop(UtxEditTrace* trace);
+_utx_api void utxEditTraceAdd(UtxEditTrace* trace, UtxEditKind kind, uint32_t offset, uint32_t removed, const char_t *text, uint32_t size);
+_utx_api void utxEditTraceCursor(UtxEditTrace* trace, uint32_t caret, uint32_t anchor);
+
+_utx_api uint32_t utxEditTraceEvents(const UtxEditTrace* trace);
+_utx_api bool_t utxEditTraceNext(const UtxEditTrace* trace, uint32_t *position, UtxEditEvent *event);
+_utx_api Result utxEditTraceReplay(const UtxEditTrace* trace, UtxFile* utx, const char_t *savePath, FPtr_utxReplayed func, void *data);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_EDITTRACE_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,180 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Read-only file mapping.
+ *
+ * The mapping serves as the original buffer of a document: pages are only
+ * brought in from the page cache when the text they hold is actually read.
+ */
+#include "filemap.h"
+#include <core/strings.h>
+#include <core/heap.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+struct _utx_filemap_t {
+    String *filePath;
+    const char_t *data;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+#if defined(_WIN32)
+
+static const char_t *i_map(const char_t *filePath, uint32_t *size, ferror_t *error) {
+    WCHAR wpath[MAX_PATH];
+    if (MultiByteToWideChar(CP_UTF8, 0, filePath, -1, wpath, MAX_PATH) == 0) {
+        *error = ekFNAME;
+        return NULL;
+    }
+
+    HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        *error = GetLastError() == ERROR_ACCESS_DENIED ? ekFNOACCESS : ekFNOFILE;
+        return NULL;
+    }
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart > 0xFFFFFFFE) {
+        CloseHandle(file);
+        *error = ekFBIG;
+        return NULL;
+    }
+
+    *size = (uint32_t)fsize.QuadPart;
+    *error = ekFOK;
+    if (*size == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        *error = ekFUNDEF;
+        return NULL;
+    }
+
+    const char_t *data = (const char_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL) {
+        *error = ekFUNDEF;
+    }
+    return data;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_unmap(const char_t *data, uint32_t size) {
+    unref(size);
+    UnmapViewOfFile(data);
+}
+
+#else
+
+/*----------------------------------------------------------------------------*/
+static const char_t *i_map(const char_t *filePath, uint32_t *size, ferror_t *error) {
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        *error = errno == EACCES ? ekFNOACCESS : ekFNOFILE;
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > 0xFFFFFFFE) {
+        close(fd);
+        *error = ekFBIG;
+        return NULL;
+    }
+
+    *size = (uint32_t)st.st_size;
+    *error = ekFOK;
+    if (*size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        *error = ekFUNDEF;
+        return NULL;
+    }
+
+    return (const char_t*)data;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_unmap(const char_t *data, uint32_t size) {
+    munmap((void*)data, size);
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+UtxFileMap* utxFileMapOpen(const char_t *filePath, ferror_t *error) {
+    ferror_t err = ekFNOPATH;
+    UtxFileMap *map = NULL;
+
+    if (filePath != NULL) {
+        uint32_t size = 0;
+        const char_t *data = i_map(filePath, &size, &err);
+        if (err == ekFOK) {
+            map = heap_new0(UtxFileMap);
+            map->filePath = str_c(filePath);
+            map->data = data;
+            map->size = size;
+        }
+    }
+
+    if (error != NULL) {
+        *error = err;
+    }
+    return map;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxFileMapClose(UtxFileMap** map) {
+    if (map == NULL || *map == NULL) {
+        return;
+    }
+
+    if ((*map)->data != NULL) {
+        i_unmap((*map)->data, (*map)->size);
+    }
+    str_destroy(&(*map)->filePath);
+    heap_delete(map, UtxFileMap);
+}
+
+/*----------------------------------------------------------------------------*/
+const char_t* utxFileMapData(const UtxFileMap* map) {
+    return map != NULL ? map->data : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxFileMapSize(const UtxFileMap* map) {
+    return map != NULL ? map->size : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+const char_t* utxFileMapPath(const UtxFileMap* map) {
+    return map != NULL ? tc(map->filePath) : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_FILEMAP_H__
+#define __UTX_FILEMAP_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxFileMap* utxFileMapOpen(const char_t *filePath, ferror_t *error);
+_utx_api void utxFileMapClose(UtxFileMap** map);
+
+_utx_api const char_t* utxFileMapData(const UtxFileMap* map);
+_utx_api uint32_t utxFileMapSize(const UtxFileMap* map);
+_utx_api const char_t* utxFileMapPath(const UtxFileMap* map);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_FILEMAP_H__ */
+/*----------------------------------------------------------------------------*/
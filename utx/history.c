@@ -0,0 +1,386 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Undo history.
+ *
+ * Every edit is logged as one record: its offset, the text it removed and the
+ * text it inserted. Records are bump allocated, back to back, in a chain of
+ * arena chunks, so logging costs a copy of the edited text and nothing more.
+ * Undoing a record replaces its inserted text with its removed text, redoing
+ * does the reverse, so both cost O(edit size).
+ *
+ * Records are gathered into groups that undo as one: typed text runs until
+ * a space or line break, and successive deletions at the same spot join too.
+ * Typing usually grows the last record in place. A bulk edit can also hold
+ * a group open, so that all its records undo together.
+ *
+ * A new edit after an undo drops the undone records by rolling the arena
+ * back. When the history outgrows its limit, the oldest chunks are released
+ * whole; a group cut in two by that can no longer be undone.
+ */
+#include "history.h"
+#include "buffer.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define CHUNK_SIZE 65536
+#define i_align(size) (((size) + 7) & ~(uint32_t)7)
+
+/*----------------------------------------------------------------------------*/
+typedef struct _chunk_t Chunk;
+struct _chunk_t {
+    Chunk *prev;
+    Chunk *next;
+    uint32_t size;
+    uint32_t used;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Followed by the removed text, then the inserted text. */
+typedef struct _record_t Record;
+struct _record_t {
+    Record *prev;
+    Record *next;
+    Chunk *chunk;
+    uint32_t group;
+    uint32_t offset;
+    uint32_t removed;
+    uint32_t inserted;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_history_t {
+    Chunk *first;
+    Chunk *last;
+    Record *head;
+    Record *top;
+    Record *tail;
+    uint32_t memory;
+    uint32_t limit;
+    uint32_t group;
+    uint32_t horizon;
+    bool_t open;
+    bool_t held;
+};
+
+/*----------------------------------------------------------------------------*/
+static byte_t *i_chunk_data(Chunk *chunk) {
+    return (byte_t*)(chunk + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static char_t *i_removed(Record *record) {
+    return (char_t*)(record + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static char_t *i_inserted(Record *record) {
+    return i_removed(record) + record->removed;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_record_size(uint32_t removed, uint32_t inserted) {
+    return i_align((uint32_t)sizeof(Record) + removed + inserted);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_chunk_free(UtxHistory *history, Chunk *chunk) {
+    uint32_t size = (uint32_t)sizeof(Chunk) + chunk->size;
+    history->memory -= size;
+    heap_free((byte_t**)&chunk, size, "UtxHistoryChunk");
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_chunks_free_after(UtxHistory *history, Chunk *chunk) {
+    Chunk *next = chunk != NULL ? chunk->next : history->first;
+    while (next != NULL) {
+        Chunk *c = next;
+        next = next->next;
+        i_chunk_free(history, c);
+    }
+
+    if (chunk != NULL) {
+        chunk->next = NULL;
+    } else {
+        history->first = NULL;
+    }
+    history->last = chunk;
+}
+
+/*----------------------------------------------------------------------------*/
+static Record *i_alloc(UtxHistory *history, uint32_t removed, uint32_t inserted) {
+    uint32_t size = i_record_size(removed, inserted);
+    Chunk *chunk = history->last;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        uint32_t csize = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+        chunk = (Chunk*)heap_malloc((uint32_t)sizeof(Chunk) + csize, "UtxHistoryChunk");
+        chunk->prev = history->last;
+        chunk->next = NULL;
+        chunk->size = csize;
+        chunk->used = 0;
+        if (history->last != NULL) {
+            history->last->next = chunk;
+        } else {
+            history->first = chunk;
+        }
+        history->last = chunk;
+        history->memory += (uint32_t)sizeof(Chunk) + csize;
+    }
+
+    Record *record = (Record*)(i_chunk_data(chunk) + chunk->used);
+    chunk->used += size;
+    record->prev = NULL;
+    record->next = NULL;
+    record->chunk = chunk;
+    record->removed = removed;
+    record->inserted = inserted;
+    return record;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Rolls the arena back to the end of the last applied record. */
+static void i_drop_redo(UtxHistory *history) {
+    Record *top = history->top;
+    if (top == history->tail) {
+        return;
+    }
+
+    if (top == NULL) {
+        i_chunks_free_after(history, NULL);
+        history->head = NULL;
+        history->tail = NULL;
+        return;
+    }
+
+    i_chunks_free_after(history, top->chunk);
+    top->chunk->used = (uint32_t)((byte_t*)top - i_chunk_data(top->chunk)) + i_record_size(top->removed, top->inserted);
+    top->next = NULL;
+    history->tail = top;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Releases whole chunks from the old end, never one still needed to undo the
+ * latest edit. */
+static void i_trim(UtxHistory *history) {
+    while (history->memory > history->limit && history->top != NULL && history->first != history->top->chunk) {
+        Chunk *chunk = history->first;
+        while (history->head->chunk == chunk) {
+            history->horizon = history->head->group;
+            history->head = history->head->next;
+        }
+        history->head->prev = NULL;
+        history->first = chunk->next;
+        history->first->prev = NULL;
+        i_chunk_free(history, chunk);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Appends typed text to the last record when it ends the arena. */
+static bool_t i_grow(UtxHistory *history, Record *record, const char_t *text, uint32_t size) {
+    Chunk *chunk = record->chunk;
+    uint32_t start = (uint32_t)((byte_t*)record - i_chunk_data(chunk));
+    uint32_t grown = i_record_size(record->removed, record->inserted + size);
+    if (chunk != history->last || start + grown > chunk->size) {
+        return FALSE;
+    }
+
+    memcpy(i_inserted(record) + record->inserted, text, size);
+    record->inserted += size;
+    chunk->used = start + grown;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_is_space(char_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*----------------------------------------------------------------------------*/
+UtxHistory* utxHistoryCreate(uint32_t limit) {
+    UtxHistory *history = heap_new0(UtxHistory);
+    history->limit = limit;
+    return history;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxHistoryDestroy(UtxHistory** history) {
+    if (history == NULL || *history == NULL) {
+        return;
+    }
+
+    utxHistoryClear(*history);
+    heap_delete(history, UtxHistory);
+}
+
+/*----------------------------------------------------------------------------*/
+void utxHistoryClear(UtxHistory* history) {
+    if (history == NULL) {
+        return;
+    }
+
+    i_chunks_free_after(history, NULL);
+    history->head = NULL;
+    history->top = NULL;
+    history->tail = NULL;
+    history->open = FALSE;
+    history->held = FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxHistorySetLimit(UtxHistory* history, uint32_t limit) {
+    if (history == NULL) {
+        return;
+    }
+
+    history->limit = limit;
+    i_trim(history);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxHistoryMemory(const UtxHistory* history) {
+    return history != NULL ? history->memory : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Logs an edit before it is made: the removed text is read from the buffer.
+ * The range must already be known to be valid. */
+void utxHistoryRecord(UtxHistory* history, const UtxBuffer* buffer, uint32_t offset, uint32_t removed, const char_t *text, uint32_t inserted) {
+    if (history == NULL || (removed == 0 && inserted == 0)) {
+        return;
+    }
+
+    i_drop_redo(history);
+
+    Record *last = history->tail;
+    bool_t typing = removed == 0;
+    bool_t erasing = inserted == 0;
+    bool_t join = FALSE;
+    if (history->held) {
+        /* a held group takes every record as it comes */
+        join = TRUE;
+        typing = FALSE;
+    } else if (history->open && last != NULL) {
+        if (typing) {
+            join = last->removed == 0 && offset == last->offset + last->inserted;
+        } else if (erasing) {
+            join = last->inserted == 0 && (offset + removed == last->offset || offset == last->offset);
+        }
+    }
+
+    /* a run of typing closes at a space or line break */
+    history->open = erasing || (typing && !i_is_space(text[inserted - 1]));
+
+    if (join && typing && i_grow(history, last, text, inserted)) {
+        i_trim(history);
+        return;
+    }
+
+    Record *record = i_alloc(history, removed, inserted);
+    if (!join) {
+        history->group += 1;
+    }
+    record->group = history->group;
+    record->offset = offset;
+    utxBufferRead(buffer, offset, i_removed(record), removed);
+    if (inserted > 0) {
+        memcpy(i_inserted(record), text, inserted);
+    }
+
+    record->prev = last;
+    if (last != NULL) {
+        last->next = record;
+    } else {
+        history->head = record;
+    }
+    history->tail = record;
+    history->top = record;
+    i_trim(history);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Ends the current group, e.g. when the caret moves away. */
+void utxHistoryBreak(UtxHistory* history) {
+    if (history != NULL) {
+        history->open = FALSE;
+        history->held = FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts a group that every record joins, whatever its kind, until the next
+ * break. */
+void utxHistoryGroup(UtxHistory* history) {
+    if (history != NULL) {
+        history->open = FALSE;
+        history->held = TRUE;
+        history->group += 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxHistoryCanUndo(const UtxHistory* history) {
+    return history != NULL && history->top != NULL && history->top->group > history->horizon;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxHistoryCanRedo(const UtxHistory* history) {
+    if (history == NULL) {
+        return FALSE;
+    }
+    return (history->top != NULL ? history->top->next : history->head) != NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Reverts the latest group; `offset` receives the caret position after it. */
+bool_t utxHistoryUndo(UtxHistory* history, UtxBuffer* buffer, uint32_t *offset) {
+    if (!utxHistoryCanUndo(history)) {
+        return FALSE;
+    }
+
+    Record *record = history->top;
+    uint32_t group = record->group;
+    while (record != NULL && record->group == group) {
+        utxBufferReplace(buffer, record->offset, record->inserted, i_removed(record), record->removed);
+        if (offset != NULL) {
+            *offset = record->offset + record->removed;
+        }
+        record = record->prev;
+    }
+
+    history->top = record;
+    history->open = FALSE;
+    history->held = FALSE;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxHistoryRedo(UtxHistory* history, UtxBuffer* buffer, uint32_t *offset) {
+    if (!utxHistoryCanRedo(history)) {
+        return FALSE;
+    }
+
+    Record *record = history->top != NULL ? history->top->next : history->head;
+    uint32_t group = record->group;
+    while (record != NULL && record->group == group) {
+        utxBufferReplace(buffer, record->offset, record->removed, i_inserted(record), record->inserted);
+        if (offset != NULL) {
+            *offset = record->offset + record->inserted;
+        }
+        history->top = record;
+        record = record->next;
+    }
+
+    history->open = FALSE;
+    history->held = FALSE;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,40 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_HISTORY_H__
+#define __UTX_HISTORY_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxHistory* utxHistoryCreate(uint32_t limit);
+_utx_api void utxHistoryDestroy(UtxHistory** history);
+_utx_api void utxHistoryClear(UtxHistory* history);
+_utx_api void utxHistorySetLimit(UtxHistory* history, uint32_t limit);
+_utx_api uint32_t utxHistoryMemory(const UtxHistory* history);
+
+_utx_api void utxHistoryRecord(UtxHistory* history, const UtxBuffer* buffer, uint32_t offset, uint32_t removed, const char_t *text, uint32_t inserted);
+_utx_api void utxHistoryBreak(UtxHistory* history);
+_utx_api void utxHistoryGroup(UtxHistory* history);
+
+_utx_api bool_t utxHistoryCanUndo(const UtxHistory* history);
+_utx_api bool_t utxHistoryCanRedo(const UtxHistory* history);
+_utx_api bool_t utxHistoryUndo(UtxHistory* history, UtxBuffer* buffer, uint32_t *offset);
+_utx_api bool_t utxHistoryRedo(UtxHistory* history, UtxBuffer* buffer, uint32_t *offset);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_HISTORY_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,106 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Streaming file loader.
+ *
+ * Reads a file in FILE_BUFFER_SIZE chunks, validating UTF-8 as it goes and
+ * appending each chunk to the buffer as soon as it is checked. A sequence cut
+ * by the chunk boundary is carried over to the next read, so the buffer only
+ * ever holds whole code points. After every chunk the progress callback sees
+ * the text loaded so far and may cancel the load.
+ */
+#include "loader.h"
+#include "buffer.h"
+#include "trace.h"
+#include "utf8.h"
+#include <core/heap.h>
+#include <osbs/bfile.h>
+#include <osbs/log.h>
+
+/*----------------------------------------------------------------------------*/
+Result utxLoadFile(UtxBuffer* buffer, const char_t *filePath, FPtr_utxProgress func, void *data) {
+    if (buffer == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    ferror_t error;
+    File *file = bfile_open(filePath, ekREAD, &error);
+    if (file == NULL) {
+        log_printf("utxLoad: Failed to open '%s' with error %d", filePath, error);
+        return RFileError;
+    }
+
+    file_type_t type;
+    uint64_t fileSize = 0;
+    Date date;
+    bfile_fstat(file, &type, &fileSize, &date, &error);
+    if (error != ekFOK || fileSize > 0xFFFFFFFE) {
+        log_printf("utxLoad: Failed to size '%s' with error %d", filePath, error);
+        bfile_close(&file);
+        return RFileError;
+    }
+
+    const uint32_t total = (uint32_t)fileSize;
+    byte_t *chunk = heap_malloc(FILE_BUFFER_SIZE, "UtxLoadChunk");
+    uint32_t carry = 0;
+    uint32_t loaded = 0;
+    Result result = ROkay;
+    UtxUtf8 state;
+
+    utxUtf8Init(&state);
+    utxBufferSetText(buffer, NULL, 0);
+
+    while (loaded < total) {
+        uint32_t rsize = 0;
+        bfile_read(file, chunk + carry, FILE_BUFFER_SIZE - carry, &rsize, &error);
+        if (rsize == 0) {
+            break;
+        }
+
+        if (!utxUtf8Validate(&state, (const char_t*)chunk + carry, rsize)) {
+            log_printf("utxLoad: Invalid UTF-8 in '%s' near byte %d", filePath, loaded);
+            result = RInvalidEncoding;
+            break;
+        }
+
+        uint32_t size = carry + rsize;
+        uint32_t boundary = utxUtf8Boundary((const char_t*)chunk, size);
+        utxBufferInsert(buffer, utxBufferLength(buffer), (const char_t*)chunk, boundary);
+        carry = size - boundary;
+        memmove(chunk, chunk + boundary, carry);
+        loaded += rsize;
+        UTX_TRACE_COUNTER("utxLoad bytes", loaded);
+
+        if (func != NULL && !func(data, loaded, total)) {
+            log_printf("utxLoad: Cancelled loading '%s' at %d of %d bytes", filePath, loaded, total);
+            result = RCancelled;
+            break;
+        }
+    }
+
+    if (result == ROkay) {
+        if (loaded != total) {
+            log_printf("utxLoad: Read %d of %d bytes of '%s'", loaded, total, filePath);
+            result = RFileError;
+        } else if (!utxUtf8Complete(&state)) {
+            log_printf("utxLoad: Truncated UTF-8 sequence at end of '%s'", filePath);
+            result = RInvalidEncoding;
+        }
+    }
+
+    heap_free(&chunk, FILE_BUFFER_SIZE, "UtxLoadChunk");
+    bfile_close(&file);
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,470 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Normalization.
+ *
+ * Pasted text mixes code points that look the same: the Arabic Yeh and Kaf
+ * (U+064A, U+0649, U+0643) for the Urdu Yeh and Keheh (U+06CC, U+06A9),
+ * Arabic-Indic digits for the Urdu ones, and hamza forms both precomposed
+ * and as a letter followed by U+0654. To search and spelling those are
+ * different words. A profile picks what is made the same:
+ *
+ *   NormNfc         canonical composition and mark order for Arabic script,
+ *                   e.g. ا + ٓ is آ, ۂ is ہ + ٔ composed, shadda before fatha
+ *                   is fatha before shadda. Other scripts are left alone.
+ *   NormFoldYeh     ي and ى become ی
+ *   NormFoldKaf     ك becomes ک
+ *   NormFoldHamza   ی + ٔ becomes ئ
+ *   NormFoldDigits  ٠ to ٩ become ۰ to ۹
+ *
+ * Text is worked on a cluster at a time, a letter and the marks after it.
+ * Every character that can change is two bytes after 0xD8, 0xD9 or 0xDB, so
+ * a vector at a time, each byte and the one after it are checked against
+ * those, and everything up to the first hit is copied as it is. Clean text,
+ * ASCII or Urdu, costs a scan and a copy; utxNormalizeClean tells when the
+ * copy can be skipped too. Normalized text is never longer.
+ */
+#include "normalize.h"
+#include "utf8.h"
+#include "simd.h"
+
+/*----------------------------------------------------------------------------*/
+#define MAX_MARKS 32
+
+/*----------------------------------------------------------------------------*/
+/* Decodes the character at `s`; a broken one reads as U+FFFD, one byte. */
+static uint32_t i_decode(const byte_t *s, uint32_t size, uint32_t *cp) {
+    uint32_t c = s[0];
+    uint32_t k = c < 0x80 ? 0 : c >= 0xC2 && c < 0xE0 ? 1 : c >= 0xE0 && c < 0xF0 ? 2 : c >= 0xF0 && c < 0xF5 ? 3 : 4;
+    *cp = 0xFFFD;
+    if (k == 4 || k >= size) {
+        return 1;
+    }
+
+    c &= k == 0 ? 0x7F : 0x3F >> k;
+    for (uint32_t j = 1; j <= k; ++j) {
+        if ((s[j] & 0xC0) != 0x80) {
+            return 1;
+        }
+        c = (c << 6) | (s[j] & 0x3F);
+    }
+    *cp = c;
+    return k + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_encode(uint32_t c, byte_t *out) {
+    if (c < 0x80) {
+        out[0] = (byte_t)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        out[0] = (byte_t)(0xC0 | (c >> 6));
+        out[1] = (byte_t)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = (byte_t)(0xE0 | (c >> 12));
+        out[1] = (byte_t)(0x80 | ((c >> 6) & 0x3F));
+        out[2] = (byte_t)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = (byte_t)(0xF0 | (c >> 18));
+    out[1] = (byte_t)(0x80 | ((c >> 12) & 0x3F));
+    out[2] = (byte_t)(0x80 | ((c >> 6) & 0x3F));
+    out[3] = (byte_t)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The canonical combining class of Arabic marks; 0 for anything else. */
+static byte_t i_ccc(uint32_t c) {
+    if (c >= 0x064B && c <= 0x0652) {
+        return (byte_t)(27 + c - 0x064B);
+    }
+    if (c >= 0x0653 && c <= 0x065F) {
+        return c == 0x0655 || c == 0x0656 || c == 0x065C || c == 0x065F ? 220 : 230;
+    }
+    if (c == 0x0670) {
+        return 35;
+    }
+    if (c >= 0x0610 && c <= 0x0617) {
+        return 230;
+    }
+    if (c >= 0x0618 && c <= 0x061A) {
+        return (byte_t)(30 + c - 0x0618);
+    }
+    if (c >= 0x06D6 && c <= 0x06ED) {
+        switch (c) {
+        case 0x06DD: case 0x06DE: case 0x06E5: case 0x06E6: case 0x06E9:
+            return 0;
+        case 0x06E3: case 0x06EA: case 0x06ED:
+            return 220;
+        default:
+            return 230;
+        }
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The letter `base` and `mark` make, or 0. */
+static uint32_t i_compose(UtxNormalize profile, uint32_t base, uint32_t mark) {
+    if (profile & NormNfc) {
+        if (base == 0x0627) {
+            switch (mark) {
+            case 0x0653:
+                return 0x0622;
+            case 0x0654:
+                return 0x0623;
+            case 0x0655:
+                return 0x0625;
+            default:
+                break;
+            }
+        } else if (mark == 0x0654) {
+            switch (base) {
+            case 0x0648:
+                return 0x0624;
+            case 0x064A:
+                return 0x0626;
+            case 0x06C1:
+                return 0x06C2;
+            case 0x06D2:
+                return 0x06D3;
+            case 0x06D5:
+                return 0x06C0;
+            default:
+                break;
+            }
+        }
+    }
+    if ((profile & NormFoldHamza) && base == 0x06CC && mark == 0x0654) {
+        return 0x0626;
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_fold(UtxNormalize profile, uint32_t c) {
+    if ((profile & NormFoldYeh) && (c == 0x064A || c == 0x0649)) {
+        return 0x06CC;
+    }
+    if ((profile & NormFoldKaf) && c == 0x0643) {
+        return 0x06A9;
+    }
+    if ((profile & NormFoldDigits) && c >= 0x0660 && c <= 0x0669) {
+        return c - 0x0660 + 0x06F0;
+    }
+    return c;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Composes the base with each mark that reaches it, no mark of the same or
+ * a higher class in between, and drops those marks; TRUE if any was. */
+static bool_t i_combine(UtxNormalize profile, uint32_t *base, uint32_t *marks, byte_t *classes, uint32_t *count) {
+    uint32_t kept = 0;
+    byte_t highest = 0;
+    bool_t any = FALSE;
+    for (uint32_t j = 0; j < *count; ++j) {
+        uint32_t composed = kept == 0 || highest < classes[j] ? i_compose(profile, *base, marks[j]) : 0;
+        if (composed != 0) {
+            *base = composed;
+            any = TRUE;
+        } else {
+            marks[kept] = marks[j];
+            classes[kept] = classes[j];
+            highest = classes[j] > highest ? classes[j] : highest;
+            kept += 1;
+        }
+    }
+    *count = kept;
+    return any;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Whether the two byte character may change: a mark, or a letter or a digit
+ * that folds. */
+static bool_t i_trigger(byte_t lead, byte_t trail) {
+    switch (lead) {
+    case 0xD8:
+        return trail >= 0x90 && trail <= 0x9A;
+    case 0xD9:
+        return trail == 0x83 || (trail >= 0x89 && trail <= 0xA9) || trail == 0xB0;
+    case 0xDB:
+        return trail >= 0x96 && trail <= 0xAD;
+    default:
+        return FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first character from `i` on that may change, or `n`. */
+static uint32_t i_next_scalar(const byte_t *s, uint32_t n, uint32_t i) {
+    for (; i + 1 < n; ++i) {
+        if (s[i] >= 0xD8 && i_trigger(s[i], s[i + 1])) {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if defined(UTX_X86)
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_SSE2
+static uint32_t i_next_sse2(const byte_t *s, uint32_t n, uint32_t i) {
+    const __m128i d8 = _mm_set1_epi8((char)0xD8);
+    const __m128i d9 = _mm_set1_epi8((char)0xD9);
+    const __m128i db = _mm_set1_epi8((char)0xDB);
+    const __m128i k83 = _mm_set1_epi8((char)0x83);
+    const __m128i kb0 = _mm_set1_epi8((char)0xB0);
+    const __m128i base8 = _mm_set1_epi8((char)0x90);
+    const __m128i span8 = _mm_set1_epi8(0x9A - 0x90);
+    const __m128i base9 = _mm_set1_epi8((char)0x89);
+    const __m128i span9 = _mm_set1_epi8(0xA9 - 0x89);
+    const __m128i baseb = _mm_set1_epi8((char)0x96);
+    const __m128i spanb = _mm_set1_epi8(0xAD - 0x96);
+    while (i + 17 <= n) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+        if (_mm_movemask_epi8(x) == 0) {
+            i += 16;
+            continue;
+        }
+
+        __m128i y = _mm_loadu_si128((const __m128i*)(s + i + 1));
+        __m128i z8 = _mm_sub_epi8(y, base8);
+        __m128i z9 = _mm_sub_epi8(y, base9);
+        __m128i zb = _mm_sub_epi8(y, baseb);
+        __m128i t8 = _mm_cmpeq_epi8(_mm_min_epu8(z8, span8), z8);
+        __m128i t9 = _mm_cmpeq_epi8(_mm_min_epu8(z9, span9), z9);
+        __m128i tb = _mm_cmpeq_epi8(_mm_min_epu8(zb, spanb), zb);
+        t9 = _mm_or_si128(t9, _mm_or_si128(_mm_cmpeq_epi8(y, k83), _mm_cmpeq_epi8(y, kb0)));
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(x, d9), t9);
+        m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(x, d8), t8));
+        m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(x, db), tb));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + utxCtz(mask);
+        }
+        i += 16;
+    }
+    return i_next_scalar(s, n, i);
+}
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_AVX2
+static uint32_t i_next_avx2(const byte_t *s, uint32_t n, uint32_t i) {
+    const __m256i d8 = _mm256_set1_epi8((char)0xD8);
+    const __m256i d9 = _mm256_set1_epi8((char)0xD9);
+    const __m256i db = _mm256_set1_epi8((char)0xDB);
+    const __m256i k83 = _mm256_set1_epi8((char)0x83);
+    const __m256i kb0 = _mm256_set1_epi8((char)0xB0);
+    const __m256i base8 = _mm256_set1_epi8((char)0x90);
+    const __m256i span8 = _mm256_set1_epi8(0x9A - 0x90);
+    const __m256i base9 = _mm256_set1_epi8((char)0x89);
+    const __m256i span9 = _mm256_set1_epi8(0xA9 - 0x89);
+    const __m256i baseb = _mm256_set1_epi8((char)0x96);
+    const __m256i spanb = _mm256_set1_epi8(0xAD - 0x96);
+    while (i + 33 <= n) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+        if (_mm256_movemask_epi8(x) == 0) {
+            i += 32;
+            continue;
+        }
+
+        __m256i y = _mm256_loadu_si256((const __m256i*)(s + i + 1));
+        __m256i z8 = _mm256_sub_epi8(y, base8);
+        __m256i z9 = _mm256_sub_epi8(y, base9);
+        __m256i zb = _mm256_sub_epi8(y, baseb);
+        __m256i t8 = _mm256_cmpeq_epi8(_mm256_min_epu8(z8, span8), z8);
+        __m256i t9 = _mm256_cmpeq_epi8(_mm256_min_epu8(z9, span9), z9);
+        __m256i tb = _mm256_cmpeq_epi8(_mm256_min_epu8(zb, spanb), zb);
+        t9 = _mm256_or_si256(t9, _mm256_or_si256(_mm256_cmpeq_epi8(y, k83), _mm256_cmpeq_epi8(y, kb0)));
+        __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(x, d9), t9);
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_cmpeq_epi8(x, d8), t8));
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_cmpeq_epi8(x, db), tb));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+        if (mask != 0) {
+            return i + utxCtz(mask);
+        }
+        i += 32;
+    }
+    return i_next_scalar(s, n, i);
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_next(const byte_t *s, uint32_t n, uint32_t i) {
+#if defined(UTX_X86)
+    switch (utxUtf8Simd()) {
+    case SimdAvx2:
+        return i_next_avx2(s, n, i);
+    case SimdSse2:
+        return i_next_sse2(s, n, i);
+    default:
+        break;
+    }
+#endif
+    return i_next_scalar(s, n, i);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Normalizes the cluster at `i`, into `out` at `w` when there is one, and
+ * returns where the cluster ends. Marks are read out before anything is
+ * written, so `out` may be the text itself. */
+static uint32_t i_cluster(UtxNormalize profile, const byte_t *s, uint32_t n, uint32_t i, byte_t *out, uint32_t *w, bool_t *changed) {
+    uint32_t marks[MAX_MARKS];
+    byte_t classes[MAX_MARKS];
+    uint32_t count = 0;
+    uint32_t start = i;
+    uint32_t base = 0, original = 0, size = 0;
+    uint32_t c = 0;
+    uint32_t len = i_decode(s + i, n - i, &c);
+    bool_t dirty = FALSE;
+
+    if (i_ccc(c) == 0) {
+        base = original = c;
+        size = len;
+        i += len;
+    }
+    while (i < n && count < MAX_MARKS) {
+        len = i_decode(s + i, n - i, &c);
+        byte_t k = i_ccc(c);
+        if (k == 0) {
+            break;
+        }
+        marks[count] = c;
+        classes[count] = k;
+        count += 1;
+        i += len;
+    }
+
+    /* canonical order is a stable sort on the class */
+    if (profile & NormNfc) {
+        for (uint32_t j = 1; j < count; ++j) {
+            for (uint32_t k = j; k > 0 && classes[k - 1] > classes[k]; --k) {
+                uint32_t mark = marks[k];
+                byte_t cls = classes[k];
+                marks[k] = marks[k - 1];
+                classes[k] = classes[k - 1];
+                marks[k - 1] = mark;
+                classes[k - 1] = cls;
+                dirty = TRUE;
+            }
+        }
+    }
+
+    /* compose first, so that ي + ٔ is ئ and not ی + ٔ */
+    if (size > 0) {
+        dirty = i_combine(profile, &base, marks, classes, &count) || dirty;
+        base = i_fold(profile, base);
+        dirty = i_combine(profile, &base, marks, classes, &count) || dirty;
+        dirty = dirty || base != original;
+    }
+
+    *changed = dirty;
+    if (out != NULL) {
+        if (!dirty) {
+            memmove(out + *w, s + start, i - start);
+            *w += i - start;
+        } else {
+            if (base != original) {
+                *w += i_encode(base, out + *w);
+            } else if (size > 0) {
+                memmove(out + *w, s + start, size);
+                *w += size;
+            }
+            for (uint32_t j = 0; j < count; ++j) {
+                *w += i_encode(marks[j], out + *w);
+            }
+        }
+    }
+    return i;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Goes from one character that may change to the next, copying what is in
+ * between; without `out`, stops at the first cluster that changes and
+ * returns where it starts. */
+static uint32_t i_run(UtxNormalize profile, const byte_t *s, uint32_t n, byte_t *out, uint32_t *w) {
+    uint32_t r = 0;
+    while (r < n) {
+        uint32_t t = i_next(s, n, r);
+        uint32_t start = t;
+        uint32_t c = 0;
+        bool_t changed = FALSE;
+        if (t == n) {
+            break;
+        }
+
+        /* a mark belongs to the letter before it, which cannot change alone */
+        i_decode(s + t, n - t, &c);
+        if (i_ccc(c) != 0 && t > r) {
+            start = t - 1;
+            while (start > r && (s[start] & 0xC0) == 0x80) {
+                start -= 1;
+            }
+        }
+
+        if (out != NULL) {
+            if (out + *w != s + r) {
+                memmove(out + *w, s + r, start - r);
+            }
+            *w += start - r;
+        }
+        r = i_cluster(profile, s, n, start, out, w, &changed);
+        if (out == NULL && changed) {
+            return start;
+        }
+    }
+
+    if (out == NULL) {
+        return n;
+    }
+    if (out + *w != s + r) {
+        memmove(out + *w, s + r, n - r);
+    }
+    *w += n - r;
+    return *w;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The size of the leading part of the text that the profile leaves as it
+ * is; `size` if it is all clean. */
+uint32_t utxNormalizeClean(UtxNormalize profile, const char_t *text, uint32_t size) {
+    if (text == NULL) {
+        return 0;
+    }
+    if (profile == NormNone) {
+        return size;
+    }
+    return i_run(profile, (const byte_t*)text, size, NULL, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Writes the normalized text to `out`, which may be `text` itself, and
+ * returns its size; that is never more than `size`. */
+uint32_t utxNormalizeText(UtxNormalize profile, const char_t *text, uint32_t size, char_t *out) {
+    uint32_t w = 0;
+    if (text == NULL || out == NULL) {
+        return 0;
+    }
+    if (profile == NormNone) {
+        if (out != text) {
+            memmove(out, text, size);
+        }
+        return size;
+    }
+    return i_run(profile, (const byte_t*)text, size, (byte_t*)out, &w);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,28 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_NORMALIZE_H__
+#define __UTX_NORMALIZE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api uint32_t utxNormalizeClean(UtxNormalize profile, const char_t *text, uint32_t size);
+_utx_api uint32_t utxNormalizeText(UtxNormalize profile, const char_t *text, uint32_t size, char_t *out);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_NORMALIZE_H__ */
+/*----------------------------------------------------------------------------*/
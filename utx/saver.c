@@ -0,0 +1,332 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Crash-safe saving.
+ *
+ * The text is written to a temporary file next to the target, flushed to
+ * disk, and then renamed over the target in one atomic step; on POSIX the
+ * folder is flushed too, so the rename itself survives a crash. At any moment
+ * the target holds either the old or the new contents, never a mix.
+ *
+ * utxSaveAsync queues a snapshot for a single writer thread, which saves in
+ * request order and reports each result through a callback. The callback runs
+ * on the writer thread. The thread only lives while there is work queued.
+ */
+#include "saver.h"
+#include "buffer.h"
+#include "trace.h"
+#include <core/strings.h>
+#include <core/heap.h>
+#include <osbs/bmutex.h>
+#include <osbs/bthread.h>
+#include <osbs/log.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <stdio.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+typedef struct _job_t Job;
+struct _job_t {
+    Job *next;
+    UtxSnapshot *snapshot;
+    String *filePath;
+    FPtr_utxSaved func;
+    void *data;
+};
+
+/*----------------------------------------------------------------------------*/
+static Mutex *i_MUTEX = NULL;
+static Thread *i_THREAD = NULL;
+static bool_t i_RUNNING = FALSE;
+static Job *i_HEAD = NULL;
+static Job *i_TAIL = NULL;
+static volatile uint32_t i_COUNTER = 0;
+
+/*----------------------------------------------------------------------------*/
+#if defined(_WIN32)
+
+typedef HANDLE TmpFile;
+#define TMP_NONE INVALID_HANDLE_VALUE
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_wide(const char_t *path, WCHAR *wpath) {
+    return MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAX_PATH) != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static TmpFile i_tmp_create(const char_t *tmpPath, const char_t *filePath) {
+    WCHAR wpath[MAX_PATH];
+    unref(filePath);
+    if (!i_wide(tmpPath, wpath)) {
+        return TMP_NONE;
+    }
+    return CreateFileW(wpath, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_tmp_write(TmpFile file, const char_t *data, uint32_t size) {
+    while (size > 0) {
+        DWORD written = 0;
+        if (!WriteFile(file, data, size, &written, NULL)) {
+            return FALSE;
+        }
+        data += written;
+        size -= written;
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_tmp_close(TmpFile file, bool_t flush) {
+    bool_t ok = !flush || FlushFileBuffers(file);
+    return CloseHandle(file) && ok;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_tmp_remove(const char_t *tmpPath) {
+    WCHAR wpath[MAX_PATH];
+    if (i_wide(tmpPath, wpath)) {
+        DeleteFileW(wpath);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write-through makes the rename durable before it returns. */
+static bool_t i_replace(const char_t *tmpPath, const char_t *filePath) {
+    WCHAR wtmp[MAX_PATH], wpath[MAX_PATH];
+    if (!i_wide(tmpPath, wtmp) || !i_wide(filePath, wpath)) {
+        return FALSE;
+    }
+    return MoveFileExW(wtmp, wpath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+
+#else
+
+typedef int TmpFile;
+#define TMP_NONE -1
+
+/*----------------------------------------------------------------------------*/
+static TmpFile i_tmp_create(const char_t *tmpPath, const char_t *filePath) {
+    /* keep the permissions of the file being replaced */
+    struct stat st;
+    mode_t mode = 0666;
+    if (stat(filePath, &st) == 0) {
+        mode = st.st_mode & 07777;
+    }
+    return open(tmpPath, O_WRONLY | O_CREAT | O_EXCL, mode);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_tmp_write(TmpFile file, const char_t *data, uint32_t size) {
+    while (size > 0) {
+        ssize_t written = write(file, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FALSE;
+        }
+        data += written;
+        size -= (uint32_t)written;
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_tmp_close(TmpFile file, bool_t flush) {
+    bool_t ok = !flush || fsync(file) == 0;
+    return close(file) == 0 && ok;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_tmp_remove(const char_t *tmpPath) {
+    unlink(tmpPath);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The rename lives in the folder's entries, so the folder is flushed too. */
+static bool_t i_replace(const char_t *tmpPath, const char_t *filePath) {
+    if (rename(tmpPath, filePath) != 0) {
+        return FALSE;
+    }
+
+    const char_t *slash = strrchr(filePath, '/');
+    String *folder = slash != NULL ? str_cn(filePath, (uint32_t)(slash - filePath) + 1) : str_c(".");
+    int fd = open(tc(folder), O_RDONLY);
+    str_destroy(&folder);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return TRUE;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_write_chunk(TmpFile *file, const char_t *chunk, const uint32_t size) {
+    return i_tmp_write(*file, chunk, size);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Saves run on the writer thread and on their callers' at once. */
+static uint32_t i_next_count(void) {
+#if defined(__GNUC__)
+    return __atomic_fetch_add(&i_COUNTER, 1, __ATOMIC_RELAXED);
+#elif defined(_MSC_VER)
+    return (uint32_t)InterlockedIncrement((volatile LONG*)&i_COUNTER) - 1;
+#else
+    return i_COUNTER++;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxSaveFile(const UtxSnapshot* snapshot, const char_t *filePath) {
+    if (snapshot == NULL) {
+        return RInvalidContents;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    UTX_TRACE_BEGIN("utxSaveFile");
+
+    /* unique per thread and call, so concurrent saves never share a file */
+    uint32_t id = bthread_current_id();
+    uint32_t n = i_next_count();
+    String *tmpPath = str_printf("%s~%u-%u.tmp", filePath, id, n);
+
+    TmpFile file = i_tmp_create(tc(tmpPath), filePath);
+    if (file == TMP_NONE) {
+        log_printf("utxSave: Failed to create '%s'", tc(tmpPath));
+        str_destroy(&tmpPath);
+        UTX_TRACE_END("utxSaveFile");
+        return RFileError;
+    }
+
+    bool_t ok = utxSnapshotForEach(snapshot, (FPtr_utxChunk)i_write_chunk, &file);
+    ok = i_tmp_close(file, ok) && ok;
+    ok = ok && i_replace(tc(tmpPath), filePath);
+    if (!ok) {
+        log_printf("utxSave: Failed to save '%s', the file is unchanged", filePath);
+        i_tmp_remove(tc(tmpPath));
+    }
+
+    str_destroy(&tmpPath);
+    UTX_TRACE_END("utxSaveFile");
+    return ok ? ROkay : RFileError;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_writer(void *unused) {
+    unref(unused);
+    for (;;) {
+        bmutex_lock(i_MUTEX);
+        Job *job = i_HEAD;
+        if (job == NULL) {
+            i_RUNNING = FALSE;
+            bmutex_unlock(i_MUTEX);
+            return 0;
+        }
+        i_HEAD = job->next;
+        if (i_HEAD == NULL) {
+            i_TAIL = NULL;
+        }
+        bmutex_unlock(i_MUTEX);
+
+        Result result = utxSaveFile(job->snapshot, tc(job->filePath));
+        /* release the text first: the callback may start another save */
+        utxSnapshotDestroy(&job->snapshot);
+        if (job->func != NULL) {
+            job->func(job->data, tc(job->filePath), result);
+        }
+
+        str_destroy(&job->filePath);
+        heap_delete(&job, Job);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSaverStart(void) {
+    if (i_MUTEX == NULL) {
+        i_MUTEX = bmutex_create();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Waits for every queued save to complete. */
+void utxSaverFinish(void) {
+    if (i_MUTEX == NULL) {
+        return;
+    }
+
+    if (i_THREAD != NULL) {
+        bool_t running = TRUE;
+        while (running) {
+            bmutex_lock(i_MUTEX);
+            running = i_RUNNING;
+            bmutex_unlock(i_MUTEX);
+            if (running) {
+                bthread_sleep(5);
+            }
+        }
+        bthread_wait(i_THREAD);
+        bthread_close(&i_THREAD);
+    }
+    bmutex_close(&i_MUTEX);
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSaveAsync(UtxSnapshot* snapshot, const char_t *filePath, FPtr_utxSaved func, void *data) {
+    if (snapshot == NULL || filePath == NULL || i_MUTEX == NULL) {
+        Result result = snapshot == NULL ? RInvalidContents : filePath == NULL ? RInvalidFilePath : RFileError;
+        utxSnapshotDestroy(&snapshot);
+        if (func != NULL) {
+            func(data, filePath, result);
+        }
+        return;
+    }
+
+    Job *job = heap_new0(Job);
+    job->snapshot = snapshot;
+    job->filePath = str_c(filePath);
+    job->func = func;
+    job->data = data;
+
+    bmutex_lock(i_MUTEX);
+    if (i_TAIL != NULL) {
+        i_TAIL->next = job;
+    } else {
+        i_HEAD = job;
+    }
+    i_TAIL = job;
+    bool_t start = !i_RUNNING;
+    i_RUNNING = TRUE;
+    bmutex_unlock(i_MUTEX);
+
+    if (start) {
+        /* the previous writer, if any, has drained the queue and is exiting */
+        if (i_THREAD != NULL) {
+            bthread_wait(i_THREAD);
+            bthread_close(&i_THREAD);
+        }
+        i_THREAD = bthread_create(i_writer, NULL, void);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,31 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_SAVER_H__
+#define __UTX_SAVER_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api void utxSaverStart(void);
+_utx_api void utxSaverFinish(void);
+
+_utx_api Result utxSaveFile(const UtxSnapshot* snapshot, const char_t *filePath);
+_utx_api void utxSaveAsync(UtxSnapshot* snapshot, const char_t *filePath, FPtr_utxSaved func, void *data);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_SAVER_H__ */
+/*----------------------------------------------------------------------------*/
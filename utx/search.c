@@ -0,0 +1,463 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Literal search over the buffer.
+ *
+ * Candidates are found a vector at a time by comparing two bytes of the
+ * pattern at once, its first and its last (Muła, "SIMD-friendly algorithms
+ * for substring searching"); in Urdu text the first byte alone is nearly
+ * always 0xD8 or 0xD9 and says little, the pair rules out most positions.
+ * Each candidate is then checked in full. The buffer is searched piece by
+ * piece; a match that spans two pieces is checked byte by byte.
+ *
+ * With SearchNoHarakat the harakat (U+064B-U+065F, U+0670) are taken out of
+ * the pattern and skipped in the text, after every letter. The length of a
+ * match then varies, so the byte pair is taken from the first letter alone;
+ * as that letter is often a common one, the prefilter also asks that it be
+ * followed by either the second letter or a haraka.
+ *
+ * A whole word search takes the matches that the tokenizer would see as
+ * words of their own: no letter of the same kind runs on at either end. A
+ * ZWNJ ends a word, and harakat after the last letter belong to it.
+ */
+#include "search.h"
+#include "buffer.h"
+#include "utf8.h"
+#include "simd.h"
+#include "token.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define ZWNJ_UTF8 "\xE2\x80\x8C"
+
+/*----------------------------------------------------------------------------*/
+/* Followed by the pattern. */
+struct _utx_search_t {
+    UtxSearchMode mode;
+    bool_t words;
+    uint32_t bytes;
+    uint32_t size;
+    uint32_t distance;
+    uint32_t follow;
+    uint32_t reach;
+    byte_t first;
+    byte_t second;
+    byte_t lead;
+    byte_t tail;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _cursor_t Cursor;
+struct _cursor_t {
+    const UtxBuffer *buffer;
+    const byte_t *data;
+    uint32_t start;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+static const byte_t *i_pattern(const UtxSearch *search) {
+    return (const byte_t*)(search + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_char_size(byte_t lead) {
+    return lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_haraka(int32_t b0, int32_t b1) {
+    return b0 == 0xD9 && ((b1 >= 0x8B && b1 <= 0x9F) || b1 == 0xB0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The byte at `offset`, or -1 past the end. */
+static int32_t i_byte(Cursor *cursor, uint32_t offset) {
+    if (offset - cursor->start >= cursor->size || cursor->data == NULL) {
+        cursor->data = (const byte_t*)utxBufferChunk(cursor->buffer, offset, &cursor->size);
+        cursor->start = offset;
+        if (cursor->data == NULL) {
+            cursor->size = 0;
+            return -1;
+        }
+    }
+    return cursor->data[offset - cursor->start];
+}
+
+/*----------------------------------------------------------------------------*/
+/* Returns the size of the match at `offset`, 0 if there is none. */
+static uint32_t i_verify(const UtxSearch *search, Cursor *cursor, uint32_t offset) {
+    const byte_t *pattern = i_pattern(search);
+    uint32_t size = search->size;
+
+    if (search->mode == SearchExact) {
+        i_byte(cursor, offset);
+        uint32_t avail = cursor->start + cursor->size - offset;
+        if (cursor->data != NULL && avail >= size) {
+            return memcmp(cursor->data + (offset - cursor->start), pattern, size) == 0 ? size : 0;
+        }
+        for (uint32_t i = 0; i < size; ++i) {
+            if (i_byte(cursor, offset + i) != pattern[i]) {
+                return 0;
+            }
+        }
+        return size;
+    }
+
+    uint32_t t = offset;
+    uint32_t j = 0;
+    while (j < size) {
+        uint32_t k = i_char_size(pattern[j]);
+        k = k < size - j ? k : size - j;
+        for (uint32_t q = 0; q < k; ++q) {
+            if (i_byte(cursor, t + q) != pattern[j + q]) {
+                return 0;
+            }
+        }
+        t += k;
+        j += k;
+        while (i_haraka(i_byte(cursor, t), i_byte(cursor, t + 1))) {
+            t += 2;
+        }
+    }
+    return t - offset;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Whether the first letter at `s` is followed by the second one or a haraka;
+ * only asked with SearchNoHarakat. A tail of 0 means a one byte letter. */
+static bool_t i_follows(const UtxSearch *search, const byte_t *s) {
+    byte_t a = s[search->follow];
+    byte_t b = s[search->follow + 1];
+    return (a == search->lead && (search->tail == 0 || b == search->tail)) || i_haraka(a, b);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Next position from `i` on that passes the prefilter, with all the bytes it
+ * reads inside the `n` bytes; `n` if there is none. */
+static uint32_t i_next_scalar(const UtxSearch *search, const byte_t *s, uint32_t n, uint32_t i) {
+    if (n <= search->reach) {
+        return n;
+    }
+
+    uint32_t end = n - search->reach;
+    while (i < end) {
+        const byte_t *found = (const byte_t*)memchr(s + i, search->first, end - i);
+        if (found == NULL) {
+            return n;
+        }
+        i = (uint32_t)(found - s);
+        if (s[i + search->distance] == search->second && (search->follow == 0 || i_follows(search, s + i))) {
+            return i;
+        }
+        i += 1;
+    }
+    return n;
+}
+
+#if defined(UTX_X86)
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_SSE2
+static uint32_t i_next_sse2(const UtxSearch *search, const byte_t *s, uint32_t n, uint32_t i) {
+    const __m128i first = _mm_set1_epi8((char)search->first);
+    const __m128i second = _mm_set1_epi8((char)search->second);
+    const __m128i lead = _mm_set1_epi8((char)search->lead);
+    const __m128i tail = _mm_set1_epi8((char)search->tail);
+    const __m128i d9 = _mm_set1_epi8((char)0xD9);
+    const __m128i b0 = _mm_set1_epi8((char)0xB0);
+    const __m128i base = _mm_set1_epi8((char)0x8B);
+    const __m128i span = _mm_set1_epi8(0x9F - 0x8B);
+    uint32_t d = search->distance;
+    uint32_t f = search->follow;
+    while (i + search->reach + 16 <= n) {
+        __m128i a = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(s + i)));
+        __m128i b = _mm_cmpeq_epi8(second, _mm_loadu_si128((const __m128i*)(s + i + d)));
+        __m128i m = _mm_and_si128(a, b);
+        if (f != 0) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(s + i + f));
+            __m128i y = _mm_loadu_si128((const __m128i*)(s + i + f + 1));
+            __m128i letter = _mm_cmpeq_epi8(lead, x);
+            if (search->tail != 0) {
+                letter = _mm_and_si128(letter, _mm_cmpeq_epi8(tail, y));
+            }
+            __m128i z = _mm_sub_epi8(y, base);
+            __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(z, span), z);
+            __m128i haraka = _mm_and_si128(_mm_cmpeq_epi8(d9, x), _mm_or_si128(low, _mm_cmpeq_epi8(b0, y)));
+            m = _mm_and_si128(m, _mm_or_si128(letter, haraka));
+        }
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + utxCtz(mask);
+        }
+        i += 16;
+    }
+    return i_next_scalar(search, s, n, i);
+}
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_AVX2
+static uint32_t i_next_avx2(const UtxSearch *search, const byte_t *s, uint32_t n, uint32_t i) {
+    const __m256i first = _mm256_set1_epi8((char)search->first);
+    const __m256i second = _mm256_set1_epi8((char)search->second);
+    const __m256i lead = _mm256_set1_epi8((char)search->lead);
+    const __m256i tail = _mm256_set1_epi8((char)search->tail);
+    const __m256i d9 = _mm256_set1_epi8((char)0xD9);
+    const __m256i b0 = _mm256_set1_epi8((char)0xB0);
+    const __m256i base = _mm256_set1_epi8((char)0x8B);
+    const __m256i span = _mm256_set1_epi8(0x9F - 0x8B);
+    uint32_t d = search->distance;
+    uint32_t f = search->follow;
+    while (i + search->reach + 32 <= n) {
+        __m256i a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(s + i)));
+        __m256i b = _mm256_cmpeq_epi8(second, _mm256_loadu_si256((const __m256i*)(s + i + d)));
+        __m256i m = _mm256_and_si256(a, b);
+        if (f != 0) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(s + i + f));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(s + i + f + 1));
+            __m256i letter = _mm256_cmpeq_epi8(lead, x);
+            if (search->tail != 0) {
+                letter = _mm256_and_si256(letter, _mm256_cmpeq_epi8(tail, y));
+            }
+            __m256i z = _mm256_sub_epi8(y, base);
+            __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(z, span), z);
+            __m256i haraka = _mm256_and_si256(_mm256_cmpeq_epi8(d9, x), _mm256_or_si256(low, _mm256_cmpeq_epi8(b0, y)));
+            m = _mm256_and_si256(m, _mm256_or_si256(letter, haraka));
+        }
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+        if (mask != 0) {
+            return i + utxCtz(mask);
+        }
+        i += 32;
+    }
+    return i_next_scalar(search, s, n, i);
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_next(const UtxSearch *search, const byte_t *s, uint32_t n, uint32_t i) {
+#if defined(UTX_X86)
+    switch (utxUtf8Simd()) {
+    case SimdAvx2:
+        return i_next_avx2(search, s, n, i);
+    case SimdSse2:
+        return i_next_sse2(search, s, n, i);
+    default:
+        break;
+    }
+#endif
+    return i_next_scalar(search, s, n, i);
+}
+
+/*----------------------------------------------------------------------------*/
+/* True when the text starts with a haraka. */
+bool_t utxIsHaraka(const char_t *text, uint32_t size) {
+    return text != NULL && size >= 2 && i_haraka((byte_t)text[0], (byte_t)text[1]);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Compiles a UTF-8 pattern; NULL if nothing is left to search for. A pattern
+ * that is not valid UTF-8 is refused too, as its matches would begin or end
+ * inside a character. */
+UtxSearch* utxSearchCreate(const char_t *pattern, uint32_t size, UtxSearchMode mode) {
+    if (pattern == NULL || size == 0) {
+        return NULL;
+    }
+
+    UtxUtf8 state;
+    utxUtf8Init(&state);
+    if (!utxUtf8Validate(&state, pattern, size) || !utxUtf8Complete(&state)) {
+        return NULL;
+    }
+
+    uint32_t bytes = (uint32_t)sizeof(UtxSearch) + size;
+    UtxSearch *search = (UtxSearch*)heap_malloc(bytes, "UtxSearch");
+    byte_t *dest = (byte_t*)(search + 1);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        if (mode == SearchNoHarakat && utxIsHaraka(pattern + i, size - i)) {
+            i += 1;
+            continue;
+        }
+        dest[n++] = (byte_t)pattern[i];
+    }
+
+    if (n == 0) {
+        heap_free((byte_t**)&search, bytes, "UtxSearch");
+        return NULL;
+    }
+
+    uint32_t distance = mode == SearchExact ? n - 1 : i_char_size(dest[0]) - 1;
+    search->mode = mode;
+    search->words = FALSE;
+    search->bytes = bytes;
+    search->size = n;
+    search->distance = distance < n ? distance : n - 1;
+    search->first = dest[0];
+    search->second = dest[search->distance];
+    search->follow = 0;
+    search->reach = search->distance;
+    search->lead = 0;
+    search->tail = 0;
+    if (mode == SearchNoHarakat && search->distance + 1 < n) {
+        uint32_t follow = search->distance + 1;
+        search->follow = follow;
+        search->reach = follow + 1;
+        search->lead = dest[follow];
+        search->tail = i_char_size(dest[follow]) > 1 && follow + 1 < n ? dest[follow + 1] : 0;
+    }
+    return search;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSearchDestroy(UtxSearch** search) {
+    if (search == NULL || *search == NULL) {
+        return;
+    }
+    heap_free((byte_t**)search, (*search)->bytes, "UtxSearch");
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSearchSetWholeWord(UtxSearch* search, bool_t words) {
+    if (search != NULL) {
+        search->words = words;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The kind of the character that ends before `offset`. */
+static UtxTokenKind i_kind_before(const UtxBuffer *buffer, uint32_t offset) {
+    char_t text[4];
+    uint32_t back = offset < 4 ? offset : 4;
+    uint32_t n = utxBufferRead(buffer, offset - back, text, back);
+    uint32_t j = n;
+    while (j > 0 && ((byte_t)text[j - 1] & 0xC0) == 0x80) {
+        j -= 1;
+    }
+    if (j == 0) {
+        return TokenSpace;
+    }
+    if (n - (j - 1) == 3 && memcmp(text + j - 1, ZWNJ_UTF8, 3) == 0) {
+        return TokenSpace;
+    }
+    return utxTokenChar(text + j - 1, n - (j - 1), NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The kind of the character at `offset`, past any harakat. */
+static UtxTokenKind i_kind_after(const UtxBuffer *buffer, uint32_t offset, bool_t skip) {
+    char_t text[4];
+    uint32_t n = utxBufferRead(buffer, offset, text, 4);
+    while (skip && utxIsHaraka(text, n)) {
+        offset += 2;
+        n = utxBufferRead(buffer, offset, text, 4);
+    }
+    if (n >= 3 && memcmp(text, ZWNJ_UTF8, 3) == 0) {
+        return TokenSpace;
+    }
+    return utxTokenChar(text, n, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_whole(const UtxBuffer *buffer, uint32_t offset, uint32_t size) {
+    char_t edge[4];
+    uint32_t n = utxBufferRead(buffer, offset, edge, size < 4 ? size : 4);
+    UtxTokenKind first = utxTokenChar(edge, n, NULL);
+    if (first != TokenPunct && i_kind_before(buffer, offset) == first) {
+        return FALSE;
+    }
+
+    uint32_t back = size < 4 ? size : 4;
+    n = utxBufferRead(buffer, offset + size - back, edge, back);
+    uint32_t j = n;
+    while (j > 0 && ((byte_t)edge[j - 1] & 0xC0) == 0x80) {
+        j -= 1;
+    }
+    UtxTokenKind last = j > 0 ? utxTokenChar(edge + j - 1, n - (j - 1), NULL) : TokenSpace;
+    return last == TokenPunct || i_kind_after(buffer, offset + size, last == TokenWord) != last;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_search(const UtxSearch* search, const UtxBuffer* buffer, uint32_t from, uint32_t *offset, uint32_t *size) {
+    Cursor cursor = { buffer, NULL, 0, 0 };
+    uint32_t length = utxBufferLength(buffer);
+    uint32_t pos = from;
+    while (pos < length) {
+        uint32_t n = 0;
+        const byte_t *chunk = (const byte_t*)utxBufferChunk(buffer, pos, &n);
+        if (chunk == NULL || n == 0) {
+            break;
+        }
+
+        uint32_t found = 0;
+        uint32_t i = i_next(search, chunk, n, 0);
+        while (i < n && found == 0) {
+            found = i_verify(search, &cursor, pos + i);
+            i = found == 0 ? i_next(search, chunk, n, i + 1) : i;
+        }
+
+        /* the prefilter would read past the piece for these */
+        if (found == 0) {
+            i = n > search->reach ? n - search->reach : 0;
+            for (; i < n && found == 0; ++i) {
+                if (chunk[i] == search->first) {
+                    found = i_verify(search, &cursor, pos + i);
+                }
+            }
+            i -= found != 0 ? 1 : 0;
+        }
+
+        if (found != 0) {
+            *offset = pos + i;
+            *size = found;
+            return TRUE;
+        }
+        pos += n;
+    }
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finds the first match that starts at or after `from`. */
+bool_t utxSearchNext(const UtxSearch* search, const UtxBuffer* buffer, uint32_t from, uint32_t *offset, uint32_t *size) {
+    uint32_t at = 0, found = 0;
+    if (search == NULL || buffer == NULL) {
+        return FALSE;
+    }
+
+    while (i_search(search, buffer, from, &at, &found)) {
+        if (!search->words || i_whole(buffer, at, found)) {
+            if (offset != NULL) {
+                *offset = at;
+            }
+            if (size != NULL) {
+                *size = found;
+            }
+            return TRUE;
+        }
+        from = at + 1;
+    }
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Matches that do not overlap, as replacing all of them would see them. */
+uint32_t utxSearchCount(const UtxSearch* search, const UtxBuffer* buffer) {
+    uint32_t count = 0;
+    uint32_t from = 0, offset = 0, size = 0;
+    while (utxSearchNext(search, buffer, from, &offset, &size)) {
+        count += 1;
+        from = offset + size;
+    }
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_SEARCH_H__
+#define __UTX_SEARCH_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxSearch* utxSearchCreate(const char_t *pattern, uint32_t size, UtxSearchMode mode);
+_utx_api void utxSearchDestroy(UtxSearch** search);
+_utx_api void utxSearchSetWholeWord(UtxSearch* search, bool_t words);
+_utx_api bool_t utxSearchNext(const UtxSearch* search, const UtxBuffer* buffer, uint32_t from, uint32_t *offset, uint32_t *size);
+_utx_api uint32_t utxSearchCount(const UtxSearch* search, const UtxBuffer* buffer);
+_utx_api bool_t utxIsHaraka(const char_t *text, uint32_t size);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_SEARCH_H__ */
+/*----------------------------------------------------------------------------*/
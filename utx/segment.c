@@ -0,0 +1,1012 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Grapheme and word boundaries (UAX #29).
+ *
+ * A caret steps over a letter and its harakat together, and a double click
+ * selects a word with its marks and joiners. Both kinds of boundary follow
+ * from two character properties, listed below as ranges of code points;
+ * unassigned code points are left out, so some ranges run over them. The
+ * word property is only listed where it does not follow from the grapheme
+ * one: marks are Extend to both.
+ *
+ * utx_start compiles the lists into a two-stage table, 128 code points to a
+ * block, with identical blocks stored once; a character's properties are
+ * then two loads. The rules are compiled too, into a transition table per
+ * kind of boundary, whose states carry what the rules need to know of the
+ * text before: whether an emoji precedes the joiner, how many regional
+ * indicators came in a row. Word rules WB6 and WB12 look one character
+ * ahead, past the punctuation in "can't" or "3.14"; that boundary is left
+ * pending until the next character settles it. The Hebrew quote rules
+ * (WB7a to WB7c) are left out.
+ *
+ * To find the boundaries around an offset the text is not read from the
+ * start of the paragraph: the scan goes back to the nearest point that is a
+ * boundary whatever comes before it, a base character for graphemes and a
+ * space or line break for words, and runs the rules forward from there.
+ */
+#include "segment.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define BLOCK_SHIFT 7
+#define BLOCK_SIZE (1 << BLOCK_SHIFT)
+#define BLOCKS (0x110000 >> BLOCK_SHIFT)
+#define MAX_PROPS 64
+#define HANGUL_FIRST 0xAC00
+#define HANGUL_LAST 0xD7A3
+
+/* a transition: the next state, and what it says of the boundary before
+ * the character */
+#define STATE_MASK 0x1F
+#define BREAK_HERE 0x20
+#define PENDING 0x40
+#define KEEP_PENDING 0x80
+
+/*----------------------------------------------------------------------------*/
+typedef enum _gcb_t {
+    G_OTHER, G_CR, G_LF, G_CONTROL, G_EXTEND, G_ZWJ, G_RI, G_PREPEND,
+    G_SPACING_MARK, G_L, G_V, G_T, G_LV, G_LVT, G_EXT_PICT,
+    G_COUNT
+} Gcb;
+
+/* states beyond the classes */
+#define G_EP_EXTEND (G_COUNT + 0)
+#define G_EP_ZWJ (G_COUNT + 1)
+#define G_RI_PAIR (G_COUNT + 2)
+#define G_START (G_COUNT + 3)
+#define G_STATES (G_COUNT + 4)
+
+/*----------------------------------------------------------------------------*/
+typedef enum _wb_t {
+    W_OTHER, W_CR, W_LF, W_NEWLINE, W_EXTEND, W_ZWJ, W_RI, W_FORMAT,
+    W_KATAKANA, W_HEBREW_LETTER, W_ALETTER, W_SINGLE_QUOTE, W_DOUBLE_QUOTE,
+    W_MID_NUM_LET, W_MID_LETTER, W_MID_NUM, W_NUMERIC, W_EXTEND_NUM_LET,
+    W_WSEG_SPACE, W_EXT_PICT,
+    W_COUNT
+} Wb;
+
+#define W_LETTER_MID (W_COUNT + 0)
+#define W_NUMBER_MID (W_COUNT + 1)
+#define W_RI_PAIR (W_COUNT + 2)
+#define W_START (W_COUNT + 3)
+#define W_STATES (W_COUNT + 4)
+
+/*----------------------------------------------------------------------------*/
+typedef struct _range_t Range;
+struct _range_t {
+    uint32_t first;
+    uint32_t last;
+    byte_t prop;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _props_t Props;
+struct _props_t {
+    byte_t grapheme;
+    byte_t word;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Grapheme_Cluster_Break, and Extended_Pictographic as G_EXT_PICT. Hangul
+ * syllables, LV or LVT by their position, are not listed. */
+static const Range GRAPHEME_RANGES[] = {
+    { 0x0000, 0x0009, G_CONTROL }, { 0x000A, 0x000A, G_LF }, { 0x000B, 0x000C, G_CONTROL },
+    { 0x000D, 0x000D, G_CR }, { 0x000E, 0x001F, G_CONTROL }, { 0x007F, 0x009F, G_CONTROL },
+    { 0x00A9, 0x00A9, G_EXT_PICT }, { 0x00AD, 0x00AD, G_CONTROL }, { 0x00AE, 0x00AE, G_EXT_PICT },
+    { 0x0300, 0x036F, G_EXTEND }, { 0x0483, 0x0489, G_EXTEND }, { 0x0591, 0x05BD, G_EXTEND },
+    { 0x05BF, 0x05BF, G_EXTEND }, { 0x05C1, 0x05C2, G_EXTEND }, { 0x05C4, 0x05C5, G_EXTEND },
+    { 0x05C7, 0x05C7, G_EXTEND }, { 0x0600, 0x0605, G_PREPEND }, { 0x0610, 0x061A, G_EXTEND },
+    { 0x061C, 0x061C, G_CONTROL }, { 0x064B, 0x065F, G_EXTEND }, { 0x0670, 0x0670, G_EXTEND },
+    { 0x06D6, 0x06DC, G_EXTEND }, { 0x06DD, 0x06DD, G_PREPEND }, { 0x06DF, 0x06E4, G_EXTEND },
+    { 0x06E7, 0x06E8, G_EXTEND }, { 0x06EA, 0x06ED, G_EXTEND }, { 0x070F, 0x070F, G_PREPEND },
+    { 0x0711, 0x0711, G_EXTEND }, { 0x0730, 0x074A, G_EXTEND }, { 0x07A6, 0x07B0, G_EXTEND },
+    { 0x07EB, 0x07F3, G_EXTEND }, { 0x07FD, 0x07FD, G_EXTEND }, { 0x0816, 0x0819, G_EXTEND },
+    { 0x081B, 0x0823, G_EXTEND }, { 0x0825, 0x0827, G_EXTEND }, { 0x0829, 0x082D, G_EXTEND },
+    { 0x0859, 0x085B, G_EXTEND }, { 0x0890, 0x0891, G_PREPEND }, { 0x0898, 0x089F, G_EXTEND },
+    { 0x08CA, 0x08E1, G_EXTEND }, { 0x08E2, 0x08E2, G_PREPEND }, { 0x08E3, 0x0902, G_EXTEND },
+    { 0x0903, 0x0903, G_SPACING_MARK }, { 0x093A, 0x093A, G_EXTEND },
+    { 0x093B, 0x093B, G_SPACING_MARK }, { 0x093C, 0x093C, G_EXTEND },
+    { 0x093E, 0x0940, G_SPACING_MARK }, { 0x0941, 0x0948, G_EXTEND },
+    { 0x0949, 0x094C, G_SPACING_MARK }, { 0x094D, 0x094D, G_EXTEND },
+    { 0x094E, 0x094F, G_SPACING_MARK }, { 0x0951, 0x0957, G_EXTEND }, { 0x0962, 0x0963, G_EXTEND },
+    { 0x0981, 0x0981, G_EXTEND }, { 0x0982, 0x0983, G_SPACING_MARK }, { 0x09BC, 0x09BC, G_EXTEND },
+    { 0x09BE, 0x09BE, G_EXTEND }, { 0x09BF, 0x09C0, G_SPACING_MARK }, { 0x09C1, 0x09C4, G_EXTEND },
+    { 0x09C7, 0x09CC, G_SPACING_MARK }, { 0x09CD, 0x09CD, G_EXTEND }, { 0x09D7, 0x09D7, G_EXTEND },
+    { 0x09E2, 0x09E3, G_EXTEND }, { 0x09FE, 0x0A02, G_EXTEND }, { 0x0A03, 0x0A03, G_SPACING_MARK },
+    { 0x0A3C, 0x0A3C, G_EXTEND }, { 0x0A3E, 0x0A40, G_SPACING_MARK }, { 0x0A41, 0x0A51, G_EXTEND },
+    { 0x0A70, 0x0A71, G_EXTEND }, { 0x0A75, 0x0A75, G_EXTEND }, { 0x0A81, 0x0A82, G_EXTEND },
+    { 0x0A83, 0x0A83, G_SPACING_MARK }, { 0x0ABC, 0x0ABC, G_EXTEND },
+    { 0x0ABE, 0x0AC0, G_SPACING_MARK }, { 0x0AC1, 0x0AC8, G_EXTEND },
+    { 0x0AC9, 0x0ACC, G_SPACING_MARK }, { 0x0ACD, 0x0ACD, G_EXTEND }, { 0x0AE2, 0x0AE3, G_EXTEND },
+    { 0x0AFA, 0x0B01, G_EXTEND }, { 0x0B02, 0x0B03, G_SPACING_MARK }, { 0x0B3C, 0x0B3C, G_EXTEND },
+    { 0x0B3E, 0x0B3F, G_EXTEND }, { 0x0B40, 0x0B40, G_SPACING_MARK }, { 0x0B41, 0x0B44, G_EXTEND },
+    { 0x0B47, 0x0B4C, G_SPACING_MARK }, { 0x0B4D, 0x0B57, G_EXTEND }, { 0x0B62, 0x0B63, G_EXTEND },
+    { 0x0B82, 0x0B82, G_EXTEND }, { 0x0BBE, 0x0BBE, G_EXTEND }, { 0x0BBF, 0x0BBF, G_SPACING_MARK },
+    { 0x0BC0, 0x0BC0, G_EXTEND }, { 0x0BC1, 0x0BCC, G_SPACING_MARK }, { 0x0BCD, 0x0BCD, G_EXTEND },
+    { 0x0BD7, 0x0BD7, G_EXTEND }, { 0x0C00, 0x0C00, G_EXTEND }, { 0x0C01, 0x0C03, G_SPACING_MARK },
+    { 0x0C04, 0x0C04, G_EXTEND }, { 0x0C3C, 0x0C3C, G_EXTEND }, { 0x0C3E, 0x0C40, G_EXTEND },
+    { 0x0C41, 0x0C44, G_SPACING_MARK }, { 0x0C46, 0x0C56, G_EXTEND }, { 0x0C62, 0x0C63, G_EXTEND },
+    { 0x0C81, 0x0C81, G_EXTEND }, { 0x0C82, 0x0C83, G_SPACING_MARK }, { 0x0CBC, 0x0CBC, G_EXTEND },
+    { 0x0CBE, 0x0CBE, G_SPACING_MARK }, { 0x0CBF, 0x0CBF, G_EXTEND },
+    { 0x0CC0, 0x0CC1, G_SPACING_MARK }, { 0x0CC2, 0x0CC2, G_EXTEND },
+    { 0x0CC3, 0x0CC4, G_SPACING_MARK }, { 0x0CC6, 0x0CC6, G_EXTEND },
+    { 0x0CC7, 0x0CCB, G_SPACING_MARK }, { 0x0CCC, 0x0CD6, G_EXTEND }, { 0x0CE2, 0x0CE3, G_EXTEND },
+    { 0x0D00, 0x0D01, G_EXTEND }, { 0x0D02, 0x0D03, G_SPACING_MARK }, { 0x0D3B, 0x0D3C, G_EXTEND },
+    { 0x0D3E, 0x0D3E, G_EXTEND }, { 0x0D3F, 0x0D40, G_SPACING_MARK }, { 0x0D41, 0x0D44, G_EXTEND },
+    { 0x0D46, 0x0D4C, G_SPACING_MARK }, { 0x0D4D, 0x0D4D, G_EXTEND }, { 0x0D4E, 0x0D4E, G_PREPEND },
+    { 0x0D57, 0x0D57, G_EXTEND }, { 0x0D62, 0x0D63, G_EXTEND }, { 0x0D81, 0x0D81, G_EXTEND },
+    { 0x0D82, 0x0D83, G_SPACING_MARK }, { 0x0DCA, 0x0DCF, G_EXTEND },
+    { 0x0DD0, 0x0DD1, G_SPACING_MARK }, { 0x0DD2, 0x0DD6, G_EXTEND },
+    { 0x0DD8, 0x0DDE, G_SPACING_MARK }, { 0x0DDF, 0x0DDF, G_EXTEND },
+    { 0x0DF2, 0x0DF3, G_SPACING_MARK }, { 0x0E31, 0x0E31, G_EXTEND },
+    { 0x0E33, 0x0E33, G_SPACING_MARK }, { 0x0E34, 0x0E3A, G_EXTEND }, { 0x0E47, 0x0E4E, G_EXTEND },
+    { 0x0EB1, 0x0EB1, G_EXTEND }, { 0x0EB3, 0x0EB3, G_SPACING_MARK }, { 0x0EB4, 0x0EBC, G_EXTEND },
+    { 0x0EC8, 0x0ECD, G_EXTEND }, { 0x0F18, 0x0F19, G_EXTEND }, { 0x0F35, 0x0F35, G_EXTEND },
+    { 0x0F37, 0x0F37, G_EXTEND }, { 0x0F39, 0x0F39, G_EXTEND }, { 0x0F3E, 0x0F3F, G_SPACING_MARK },
+    { 0x0F71, 0x0F7E, G_EXTEND }, { 0x0F7F, 0x0F7F, G_SPACING_MARK }, { 0x0F80, 0x0F84, G_EXTEND },
+    { 0x0F86, 0x0F87, G_EXTEND }, { 0x0F8D, 0x0FBC, G_EXTEND }, { 0x0FC6, 0x0FC6, G_EXTEND },
+    { 0x102D, 0x1030, G_EXTEND }, { 0x1031, 0x1031, G_SPACING_MARK }, { 0x1032, 0x1037, G_EXTEND },
+    { 0x1039, 0x103A, G_EXTEND }, { 0x103B, 0x103C, G_SPACING_MARK }, { 0x103D, 0x103E, G_EXTEND },
+    { 0x1056, 0x1057, G_SPACING_MARK }, { 0x1058, 0x1059, G_EXTEND }, { 0x105E, 0x1060, G_EXTEND },
+    { 0x1071, 0x1074, G_EXTEND }, { 0x1082, 0x1082, G_EXTEND }, { 0x1084, 0x1084, G_SPACING_MARK },
+    { 0x1085, 0x1086, G_EXTEND }, { 0x108D, 0x108D, G_EXTEND }, { 0x109D, 0x109D, G_EXTEND },
+    { 0x1100, 0x115F, G_L }, { 0x1160, 0x11A7, G_V }, { 0x11A8, 0x11FF, G_T },
+    { 0x135D, 0x135F, G_EXTEND }, { 0x1712, 0x1714, G_EXTEND }, { 0x1715, 0x1715, G_SPACING_MARK },
+    { 0x1732, 0x1733, G_EXTEND }, { 0x1734, 0x1734, G_SPACING_MARK }, { 0x1752, 0x1753, G_EXTEND },
+    { 0x1772, 0x1773, G_EXTEND }, { 0x17B4, 0x17B5, G_EXTEND }, { 0x17B6, 0x17B6, G_SPACING_MARK },
+    { 0x17B7, 0x17BD, G_EXTEND }, { 0x17BE, 0x17C5, G_SPACING_MARK }, { 0x17C6, 0x17C6, G_EXTEND },
+    { 0x17C7, 0x17C8, G_SPACING_MARK }, { 0x17C9, 0x17D3, G_EXTEND }, { 0x17DD, 0x17DD, G_EXTEND },
+    { 0x180B, 0x180D, G_EXTEND }, { 0x180E, 0x180E, G_CONTROL }, { 0x180F, 0x180F, G_EXTEND },
+    { 0x1885, 0x1886, G_EXTEND }, { 0x18A9, 0x18A9, G_EXTEND }, { 0x1920, 0x1922, G_EXTEND },
+    { 0x1923, 0x1926, G_SPACING_MARK }, { 0x1927, 0x1928, G_EXTEND },
+    { 0x1929, 0x1931, G_SPACING_MARK }, { 0x1932, 0x1932, G_EXTEND },
+    { 0x1933, 0x1938, G_SPACING_MARK }, { 0x1939, 0x193B, G_EXTEND }, { 0x1A17, 0x1A18, G_EXTEND },
+    { 0x1A19, 0x1A1A, G_SPACING_MARK }, { 0x1A1B, 0x1A1B, G_EXTEND },
+    { 0x1A55, 0x1A55, G_SPACING_MARK }, { 0x1A56, 0x1A56, G_EXTEND },
+    { 0x1A57, 0x1A57, G_SPACING_MARK }, { 0x1A58, 0x1A60, G_EXTEND }, { 0x1A62, 0x1A62, G_EXTEND },
+    { 0x1A65, 0x1A6C, G_EXTEND }, { 0x1A6D, 0x1A72, G_SPACING_MARK }, { 0x1A73, 0x1A7F, G_EXTEND },
+    { 0x1AB0, 0x1B03, G_EXTEND }, { 0x1B04, 0x1B04, G_SPACING_MARK }, { 0x1B34, 0x1B3A, G_EXTEND },
+    { 0x1B3B, 0x1B3B, G_SPACING_MARK }, { 0x1B3C, 0x1B3C, G_EXTEND },
+    { 0x1B3D, 0x1B41, G_SPACING_MARK }, { 0x1B42, 0x1B42, G_EXTEND },
+    { 0x1B43, 0x1B44, G_SPACING_MARK }, { 0x1B6B, 0x1B73, G_EXTEND }, { 0x1B80, 0x1B81, G_EXTEND },
+    { 0x1B82, 0x1B82, G_SPACING_MARK }, { 0x1BA1, 0x1BA1, G_SPACING_MARK },
+    { 0x1BA2, 0x1BA5, G_EXTEND }, { 0x1BA6, 0x1BA7, G_SPACING_MARK }, { 0x1BA8, 0x1BA9, G_EXTEND },
+    { 0x1BAA, 0x1BAA, G_SPACING_MARK }, { 0x1BAB, 0x1BAD, G_EXTEND }, { 0x1BE6, 0x1BE6, G_EXTEND },
+    { 0x1BE7, 0x1BE7, G_SPACING_MARK }, { 0x1BE8, 0x1BE9, G_EXTEND },
+    { 0x1BEA, 0x1BEC, G_SPACING_MARK }, { 0x1BED, 0x1BED, G_EXTEND },
+    { 0x1BEE, 0x1BEE, G_SPACING_MARK }, { 0x1BEF, 0x1BF1, G_EXTEND },
+    { 0x1BF2, 0x1BF3, G_SPACING_MARK }, { 0x1C24, 0x1C2B, G_SPACING_MARK },
+    { 0x1C2C, 0x1C33, G_EXTEND }, { 0x1C34, 0x1C35, G_SPACING_MARK }, { 0x1C36, 0x1C37, G_EXTEND },
+    { 0x1CD0, 0x1CD2, G_EXTEND }, { 0x1CD4, 0x1CE0, G_EXTEND }, { 0x1CE1, 0x1CE1, G_SPACING_MARK },
+    { 0x1CE2, 0x1CE8, G_EXTEND }, { 0x1CED, 0x1CED, G_EXTEND }, { 0x1CF4, 0x1CF4, G_EXTEND },
+    { 0x1CF7, 0x1CF7, G_SPACING_MARK }, { 0x1CF8, 0x1CF9, G_EXTEND }, { 0x1DC0, 0x1DFF, G_EXTEND },
+    { 0x200B, 0x200B, G_CONTROL }, { 0x200C, 0x200C, G_EXTEND }, { 0x200D, 0x200D, G_ZWJ },
+    { 0x200E, 0x200F, G_CONTROL }, { 0x2028, 0x202E, G_CONTROL }, { 0x203C, 0x203C, G_EXT_PICT },
+    { 0x2049, 0x2049, G_EXT_PICT }, { 0x2060, 0x206F, G_CONTROL }, { 0x20D0, 0x20F0, G_EXTEND },
+    { 0x2122, 0x2122, G_EXT_PICT }, { 0x2139, 0x2139, G_EXT_PICT }, { 0x2194, 0x2199, G_EXT_PICT },
+    { 0x21A9, 0x21AA, G_EXT_PICT }, { 0x231A, 0x231B, G_EXT_PICT }, { 0x2328, 0x2328, G_EXT_PICT },
+    { 0x2388, 0x2388, G_EXT_PICT }, { 0x23CF, 0x23CF, G_EXT_PICT }, { 0x23E9, 0x23F3, G_EXT_PICT },
+    { 0x23F8, 0x23FA, G_EXT_PICT }, { 0x24C2, 0x24C2, G_EXT_PICT }, { 0x25AA, 0x25AB, G_EXT_PICT },
+    { 0x25B6, 0x25B6, G_EXT_PICT }, { 0x25C0, 0x25C0, G_EXT_PICT }, { 0x25FB, 0x25FE, G_EXT_PICT },
+    { 0x2600, 0x2605, G_EXT_PICT }, { 0x2607, 0x2612, G_EXT_PICT }, { 0x2614, 0x2685, G_EXT_PICT },
+    { 0x2690, 0x2705, G_EXT_PICT }, { 0x2708, 0x2712, G_EXT_PICT }, { 0x2714, 0x2714, G_EXT_PICT },
+    { 0x2716, 0x2716, G_EXT_PICT }, { 0x271D, 0x271D, G_EXT_PICT }, { 0x2721, 0x2721, G_EXT_PICT },
+    { 0x2728, 0x2728, G_EXT_PICT }, { 0x2733, 0x2734, G_EXT_PICT }, { 0x2744, 0x2744, G_EXT_PICT },
+    { 0x2747, 0x2747, G_EXT_PICT }, { 0x274C, 0x274C, G_EXT_PICT }, { 0x274E, 0x274E, G_EXT_PICT },
+    { 0x2753, 0x2755, G_EXT_PICT }, { 0x2757, 0x2757, G_EXT_PICT }, { 0x2763, 0x2767, G_EXT_PICT },
+    { 0x2795, 0x2797, G_EXT_PICT }, { 0x27A1, 0x27A1, G_EXT_PICT }, { 0x27B0, 0x27B0, G_EXT_PICT },
+    { 0x27BF, 0x27BF, G_EXT_PICT }, { 0x2934, 0x2935, G_EXT_PICT }, { 0x2B05, 0x2B07, G_EXT_PICT },
+    { 0x2B1B, 0x2B1C, G_EXT_PICT }, { 0x2B50, 0x2B50, G_EXT_PICT }, { 0x2B55, 0x2B55, G_EXT_PICT },
+    { 0x2CEF, 0x2CF1, G_EXTEND }, { 0x2D7F, 0x2D7F, G_EXTEND }, { 0x2DE0, 0x2DFF, G_EXTEND },
+    { 0x302A, 0x302F, G_EXTEND }, { 0x3030, 0x3030, G_EXT_PICT }, { 0x303D, 0x303D, G_EXT_PICT },
+    { 0x3099, 0x309A, G_EXTEND }, { 0x3297, 0x3297, G_EXT_PICT }, { 0x3299, 0x3299, G_EXT_PICT },
+    { 0xA66F, 0xA672, G_EXTEND }, { 0xA674, 0xA67D, G_EXTEND }, { 0xA69E, 0xA69F, G_EXTEND },
+    { 0xA6F0, 0xA6F1, G_EXTEND }, { 0xA802, 0xA802, G_EXTEND }, { 0xA806, 0xA806, G_EXTEND },
+    { 0xA80B, 0xA80B, G_EXTEND }, { 0xA823, 0xA824, G_SPACING_MARK }, { 0xA825, 0xA826, G_EXTEND },
+    { 0xA827, 0xA827, G_SPACING_MARK }, { 0xA82C, 0xA82C, G_EXTEND },
+    { 0xA880, 0xA881, G_SPACING_MARK }, { 0xA8B4, 0xA8C3, G_SPACING_MARK },
+    { 0xA8C4, 0xA8C5, G_EXTEND }, { 0xA8E0, 0xA8F1, G_EXTEND }, { 0xA8FF, 0xA8FF, G_EXTEND },
+    { 0xA926, 0xA92D, G_EXTEND }, { 0xA947, 0xA951, G_EXTEND }, { 0xA952, 0xA953, G_SPACING_MARK },
+    { 0xA960, 0xA97C, G_L }, { 0xA980, 0xA982, G_EXTEND }, { 0xA983, 0xA983, G_SPACING_MARK },
+    { 0xA9B3, 0xA9B3, G_EXTEND }, { 0xA9B4, 0xA9B5, G_SPACING_MARK }, { 0xA9B6, 0xA9B9, G_EXTEND },
+    { 0xA9BA, 0xA9BB, G_SPACING_MARK }, { 0xA9BC, 0xA9BD, G_EXTEND },
+    { 0xA9BE, 0xA9C0, G_SPACING_MARK }, { 0xA9E5, 0xA9E5, G_EXTEND }, { 0xAA29, 0xAA2E, G_EXTEND },
+    { 0xAA2F, 0xAA30, G_SPACING_MARK }, { 0xAA31, 0xAA32, G_EXTEND },
+    { 0xAA33, 0xAA34, G_SPACING_MARK }, { 0xAA35, 0xAA36, G_EXTEND }, { 0xAA43, 0xAA43, G_EXTEND },
+    { 0xAA4C, 0xAA4C, G_EXTEND }, { 0xAA4D, 0xAA4D, G_SPACING_MARK }, { 0xAA7C, 0xAA7C, G_EXTEND },
+    { 0xAAB0, 0xAAB0, G_EXTEND }, { 0xAAB2, 0xAAB4, G_EXTEND }, { 0xAAB7, 0xAAB8, G_EXTEND },
+    { 0xAABE, 0xAABF, G_EXTEND }, { 0xAAC1, 0xAAC1, G_EXTEND }, { 0xAAEB, 0xAAEB, G_SPACING_MARK },
+    { 0xAAEC, 0xAAED, G_EXTEND }, { 0xAAEE, 0xAAEF, G_SPACING_MARK },
+    { 0xAAF5, 0xAAF5, G_SPACING_MARK }, { 0xAAF6, 0xAAF6, G_EXTEND },
+    { 0xABE3, 0xABE4, G_SPACING_MARK }, { 0xABE5, 0xABE5, G_EXTEND },
+    { 0xABE6, 0xABE7, G_SPACING_MARK }, { 0xABE8, 0xABE8, G_EXTEND },
+    { 0xABE9, 0xABEA, G_SPACING_MARK }, { 0xABEC, 0xABEC, G_SPACING_MARK },
+    { 0xABED, 0xABED, G_EXTEND }, { 0xD7B0, 0xD7C6, G_V }, { 0xD7CB, 0xD7FB, G_T },
+    { 0xFB1E, 0xFB1E, G_EXTEND }, { 0xFE00, 0xFE0F, G_EXTEND }, { 0xFE20, 0xFE2F, G_EXTEND },
+    { 0xFEFF, 0xFEFF, G_CONTROL }, { 0xFF9E, 0xFF9F, G_EXTEND }, { 0xFFF9, 0xFFFB, G_CONTROL },
+    { 0x101FD, 0x101FD, G_EXTEND }, { 0x102E0, 0x102E0, G_EXTEND }, { 0x10376, 0x1037A, G_EXTEND },
+    { 0x10A01, 0x10A0F, G_EXTEND }, { 0x10A38, 0x10A3F, G_EXTEND }, { 0x10AE5, 0x10AE6, G_EXTEND },
+    { 0x10D24, 0x10D27, G_EXTEND }, { 0x10EAB, 0x10EAC, G_EXTEND }, { 0x10F46, 0x10F50, G_EXTEND },
+    { 0x10F82, 0x10F85, G_EXTEND }, { 0x11000, 0x11000, G_SPACING_MARK },
+    { 0x11001, 0x11001, G_EXTEND }, { 0x11002, 0x11002, G_SPACING_MARK },
+    { 0x11038, 0x11046, G_EXTEND }, { 0x11070, 0x11070, G_EXTEND }, { 0x11073, 0x11074, G_EXTEND },
+    { 0x1107F, 0x11081, G_EXTEND }, { 0x11082, 0x11082, G_SPACING_MARK },
+    { 0x110B0, 0x110B2, G_SPACING_MARK }, { 0x110B3, 0x110B6, G_EXTEND },
+    { 0x110B7, 0x110B8, G_SPACING_MARK }, { 0x110B9, 0x110BA, G_EXTEND },
+    { 0x110BD, 0x110BD, G_PREPEND }, { 0x110C2, 0x110C2, G_EXTEND },
+    { 0x110CD, 0x110CD, G_PREPEND }, { 0x11100, 0x11102, G_EXTEND }, { 0x11127, 0x1112B, G_EXTEND },
+    { 0x1112C, 0x1112C, G_SPACING_MARK }, { 0x1112D, 0x11134, G_EXTEND },
+    { 0x11145, 0x11146, G_SPACING_MARK }, { 0x11173, 0x11173, G_EXTEND },
+    { 0x11180, 0x11181, G_EXTEND }, { 0x11182, 0x11182, G_SPACING_MARK },
+    { 0x111B3, 0x111B5, G_SPACING_MARK }, { 0x111B6, 0x111BE, G_EXTEND },
+    { 0x111BF, 0x111C0, G_SPACING_MARK }, { 0x111C2, 0x111C3, G_PREPEND },
+    { 0x111C9, 0x111CC, G_EXTEND }, { 0x111CE, 0x111CE, G_SPACING_MARK },
+    { 0x111CF, 0x111CF, G_EXTEND }, { 0x1122C, 0x1122E, G_SPACING_MARK },
+    { 0x1122F, 0x11231, G_EXTEND }, { 0x11232, 0x11233, G_SPACING_MARK },
+    { 0x11234, 0x11234, G_EXTEND }, { 0x11235, 0x11235, G_SPACING_MARK },
+    { 0x11236, 0x11237, G_EXTEND }, { 0x1123E, 0x1123E, G_EXTEND }, { 0x112DF, 0x112DF, G_EXTEND },
+    { 0x112E0, 0x112E2, G_SPACING_MARK }, { 0x112E3, 0x112EA, G_EXTEND },
+    { 0x11300, 0x11301, G_EXTEND }, { 0x11302, 0x11303, G_SPACING_MARK },
+    { 0x1133B, 0x1133C, G_EXTEND }, { 0x1133E, 0x1133E, G_EXTEND },
+    { 0x1133F, 0x1133F, G_SPACING_MARK }, { 0x11340, 0x11340, G_EXTEND },
+    { 0x11341, 0x1134D, G_SPACING_MARK }, { 0x11357, 0x11357, G_EXTEND },
+    { 0x11362, 0x11363, G_SPACING_MARK }, { 0x11366, 0x11374, G_EXTEND },
+    { 0x11435, 0x11437, G_SPACING_MARK }, { 0x11438, 0x1143F, G_EXTEND },
+    { 0x11440, 0x11441, G_SPACING_MARK }, { 0x11442, 0x11444, G_EXTEND },
+    { 0x11445, 0x11445, G_SPACING_MARK }, { 0x11446, 0x11446, G_EXTEND },
+    { 0x1145E, 0x1145E, G_EXTEND }, { 0x114B0, 0x114B0, G_EXTEND },
+    { 0x114B1, 0x114B2, G_SPACING_MARK }, { 0x114B3, 0x114B8, G_EXTEND },
+    { 0x114B9, 0x114B9, G_SPACING_MARK }, { 0x114BA, 0x114BA, G_EXTEND },
+    { 0x114BB, 0x114BC, G_SPACING_MARK }, { 0x114BD, 0x114BD, G_EXTEND },
+    { 0x114BE, 0x114BE, G_SPACING_MARK }, { 0x114BF, 0x114C0, G_EXTEND },
+    { 0x114C1, 0x114C1, G_SPACING_MARK }, { 0x114C2, 0x114C3, G_EXTEND },
+    { 0x115AF, 0x115AF, G_EXTEND }, { 0x115B0, 0x115B1, G_SPACING_MARK },
+    { 0x115B2, 0x115B5, G_EXTEND }, { 0x115B8, 0x115BB, G_SPACING_MARK },
+    { 0x115BC, 0x115BD, G_EXTEND }, { 0x115BE, 0x115BE, G_SPACING_MARK },
+    { 0x115BF, 0x115C0, G_EXTEND }, { 0x115DC, 0x115DD, G_EXTEND },
+    { 0x11630, 0x11632, G_SPACING_MARK }, { 0x11633, 0x1163A, G_EXTEND },
+    { 0x1163B, 0x1163C, G_SPACING_MARK }, { 0x1163D, 0x1163D, G_EXTEND },
+    { 0x1163E, 0x1163E, G_SPACING_MARK }, { 0x1163F, 0x11640, G_EXTEND },
+    { 0x116AB, 0x116AB, G_EXTEND }, { 0x116AC, 0x116AC, G_SPACING_MARK },
+    { 0x116AD, 0x116AD, G_EXTEND }, { 0x116AE, 0x116AF, G_SPACING_MARK },
+    { 0x116B0, 0x116B5, G_EXTEND }, { 0x116B6, 0x116B6, G_SPACING_MARK },
+    { 0x116B7, 0x116B7, G_EXTEND }, { 0x1171D, 0x1171F, G_EXTEND }, { 0x11722, 0x11725, G_EXTEND },
+    { 0x11726, 0x11726, G_SPACING_MARK }, { 0x11727, 0x1172B, G_EXTEND },
+    { 0x1182C, 0x1182E, G_SPACING_MARK }, { 0x1182F, 0x11837, G_EXTEND },
+    { 0x11838, 0x11838, G_SPACING_MARK }, { 0x11839, 0x1183A, G_EXTEND },
+    { 0x11930, 0x11930, G_EXTEND }, { 0x11931, 0x11938, G_SPACING_MARK },
+    { 0x1193B, 0x1193C, G_EXTEND }, { 0x1193D, 0x1193D, G_SPACING_MARK },
+    { 0x1193E, 0x1193E, G_EXTEND }, { 0x1193F, 0x1193F, G_PREPEND },
+    { 0x11940, 0x11940, G_SPACING_MARK }, { 0x11941, 0x11941, G_PREPEND },
+    { 0x11942, 0x11942, G_SPACING_MARK }, { 0x11943, 0x11943, G_EXTEND },
+    { 0x119D1, 0x119D3, G_SPACING_MARK }, { 0x119D4, 0x119DB, G_EXTEND },
+    { 0x119DC, 0x119DF, G_SPACING_MARK }, { 0x119E0, 0x119E0, G_EXTEND },
+    { 0x119E4, 0x119E4, G_SPACING_MARK }, { 0x11A01, 0x11A0A, G_EXTEND },
+    { 0x11A33, 0x11A38, G_EXTEND }, { 0x11A39, 0x11A39, G_SPACING_MARK },
+    { 0x11A3A, 0x11A3A, G_PREPEND }, { 0x11A3B, 0x11A3E, G_EXTEND }, { 0x11A47, 0x11A47, G_EXTEND },
+    { 0x11A51, 0x11A56, G_EXTEND }, { 0x11A57, 0x11A58, G_SPACING_MARK },
+    { 0x11A59, 0x11A5B, G_EXTEND }, { 0x11A84, 0x11A89, G_PREPEND }, { 0x11A8A, 0x11A96, G_EXTEND },
+    { 0x11A97, 0x11A97, G_SPACING_MARK }, { 0x11A98, 0x11A99, G_EXTEND },
+    { 0x11C2F, 0x11C2F, G_SPACING_MARK }, { 0x11C30, 0x11C3D, G_EXTEND },
+    { 0x11C3E, 0x11C3E, G_SPACING_MARK }, { 0x11C3F, 0x11C3F, G_EXTEND },
+    { 0x11C92, 0x11CA7, G_EXTEND }, { 0x11CA9, 0x11CA9, G_SPACING_MARK },
+    { 0x11CAA, 0x11CB0, G_EXTEND }, { 0x11CB1, 0x11CB1, G_SPACING_MARK },
+    { 0x11CB2, 0x11CB3, G_EXTEND }, { 0x11CB4, 0x11CB4, G_SPACING_MARK },
+    { 0x11CB5, 0x11CB6, G_EXTEND }, { 0x11D31, 0x11D45, G_EXTEND }, { 0x11D46, 0x11D46, G_PREPEND },
+    { 0x11D47, 0x11D47, G_EXTEND }, { 0x11D8A, 0x11D8E, G_SPACING_MARK },
+    { 0x11D90, 0x11D91, G_EXTEND }, { 0x11D93, 0x11D94, G_SPACING_MARK },
+    { 0x11D95, 0x11D95, G_EXTEND }, { 0x11D96, 0x11D96, G_SPACING_MARK },
+    { 0x11D97, 0x11D97, G_EXTEND }, { 0x11EF3, 0x11EF4, G_EXTEND },
+    { 0x11EF5, 0x11EF6, G_SPACING_MARK }, { 0x13430, 0x13438, G_CONTROL },
+    { 0x16AF0, 0x16AF4, G_EXTEND }, { 0x16B30, 0x16B36, G_EXTEND }, { 0x16F4F, 0x16F4F, G_EXTEND },
+    { 0x16F51, 0x16F87, G_SPACING_MARK }, { 0x16F8F, 0x16F92, G_EXTEND },
+    { 0x16FE4, 0x16FE4, G_EXTEND }, { 0x16FF0, 0x16FF1, G_SPACING_MARK },
+    { 0x1BC9D, 0x1BC9E, G_EXTEND }, { 0x1BCA0, 0x1BCA3, G_CONTROL }, { 0x1CF00, 0x1CF46, G_EXTEND },
+    { 0x1D165, 0x1D165, G_EXTEND }, { 0x1D166, 0x1D166, G_SPACING_MARK },
+    { 0x1D167, 0x1D169, G_EXTEND }, { 0x1D16D, 0x1D16D, G_SPACING_MARK },
+    { 0x1D16E, 0x1D172, G_EXTEND }, { 0x1D173, 0x1D17A, G_CONTROL }, { 0x1D17B, 0x1D182, G_EXTEND },
+    { 0x1D185, 0x1D18B, G_EXTEND }, { 0x1D1AA, 0x1D1AD, G_EXTEND }, { 0x1D242, 0x1D244, G_EXTEND },
+    { 0x1DA00, 0x1DA36, G_EXTEND }, { 0x1DA3B, 0x1DA6C, G_EXTEND }, { 0x1DA75, 0x1DA75, G_EXTEND },
+    { 0x1DA84, 0x1DA84, G_EXTEND }, { 0x1DA9B, 0x1DAAF, G_EXTEND }, { 0x1E000, 0x1E02A, G_EXTEND },
+    { 0x1E130, 0x1E136, G_EXTEND }, { 0x1E2AE, 0x1E2AE, G_EXTEND }, { 0x1E2EC, 0x1E2EF, G_EXTEND },
+    { 0x1E8D0, 0x1E8D6, G_EXTEND }, { 0x1E944, 0x1E94A, G_EXTEND },
+    { 0x1F000, 0x1F0F5, G_EXT_PICT }, { 0x1F10D, 0x1F10F, G_EXT_PICT },
+    { 0x1F12F, 0x1F12F, G_EXT_PICT }, { 0x1F16C, 0x1F171, G_EXT_PICT },
+    { 0x1F17E, 0x1F17F, G_EXT_PICT }, { 0x1F18E, 0x1F18E, G_EXT_PICT },
+    { 0x1F191, 0x1F19A, G_EXT_PICT }, { 0x1F1AD, 0x1F1AD, G_EXT_PICT }, { 0x1F1E6, 0x1F1FF, G_RI },
+    { 0x1F201, 0x1F202, G_EXT_PICT }, { 0x1F21A, 0x1F21A, G_EXT_PICT },
+    { 0x1F22F, 0x1F22F, G_EXT_PICT }, { 0x1F232, 0x1F23A, G_EXT_PICT },
+    { 0x1F250, 0x1F3FA, G_EXT_PICT }, { 0x1F3FB, 0x1F3FF, G_EXTEND },
+    { 0x1F400, 0x1F53D, G_EXT_PICT }, { 0x1F546, 0x1F64F, G_EXT_PICT },
+    { 0x1F680, 0x1F6FC, G_EXT_PICT }, { 0x1F7D5, 0x1F7F0, G_EXT_PICT },
+    { 0x1F8B0, 0x1F8B1, G_EXT_PICT }, { 0x1F90C, 0x1F93A, G_EXT_PICT },
+    { 0x1F93C, 0x1F945, G_EXT_PICT }, { 0x1F947, 0x1FAF6, G_EXT_PICT },
+    { 0xE0001, 0xE0001, G_CONTROL }, { 0xE0020, 0xE007F, G_EXTEND }, { 0xE0100, 0xE01EF, G_EXTEND },
+};
+
+/*----------------------------------------------------------------------------*/
+/* Word_Break, less what follows from the grapheme property. */
+static const Range WORD_RANGES[] = {
+    { 0x000B, 0x000C, W_NEWLINE }, { 0x0020, 0x0020, W_WSEG_SPACE },
+    { 0x0022, 0x0022, W_DOUBLE_QUOTE }, { 0x0027, 0x0027, W_SINGLE_QUOTE },
+    { 0x002C, 0x002C, W_MID_NUM }, { 0x002E, 0x002E, W_MID_NUM_LET }, { 0x0030, 0x0039, W_NUMERIC },
+    { 0x003A, 0x003A, W_MID_LETTER }, { 0x003B, 0x003B, W_MID_NUM }, { 0x0041, 0x005A, W_ALETTER },
+    { 0x005F, 0x005F, W_EXTEND_NUM_LET }, { 0x0061, 0x007A, W_ALETTER },
+    { 0x0085, 0x0085, W_NEWLINE }, { 0x00AA, 0x00AA, W_ALETTER }, { 0x00AD, 0x00AD, W_FORMAT },
+    { 0x00B5, 0x00B5, W_ALETTER }, { 0x00B7, 0x00B7, W_MID_LETTER }, { 0x00BA, 0x00BA, W_ALETTER },
+    { 0x00C0, 0x00D6, W_ALETTER }, { 0x00D8, 0x00F6, W_ALETTER }, { 0x00F8, 0x02C1, W_ALETTER },
+    { 0x02C6, 0x02D1, W_ALETTER }, { 0x02E0, 0x02E4, W_ALETTER }, { 0x02EC, 0x02EC, W_ALETTER },
+    { 0x02EE, 0x02EE, W_ALETTER }, { 0x0370, 0x0374, W_ALETTER }, { 0x0376, 0x037D, W_ALETTER },
+    { 0x037E, 0x037E, W_MID_NUM }, { 0x037F, 0x037F, W_ALETTER }, { 0x0386, 0x0386, W_ALETTER },
+    { 0x0387, 0x0387, W_MID_LETTER }, { 0x0388, 0x03F5, W_ALETTER }, { 0x03F7, 0x0481, W_ALETTER },
+    { 0x048A, 0x0559, W_ALETTER }, { 0x055F, 0x055F, W_MID_LETTER }, { 0x0560, 0x0588, W_ALETTER },
+    { 0x0589, 0x0589, W_MID_NUM }, { 0x05D0, 0x05F2, W_HEBREW_LETTER },
+    { 0x05F4, 0x05F4, W_MID_LETTER }, { 0x060C, 0x060D, W_MID_NUM }, { 0x061C, 0x061C, W_FORMAT },
+    { 0x0620, 0x064A, W_ALETTER }, { 0x0660, 0x0669, W_NUMERIC }, { 0x066B, 0x066B, W_NUMERIC },
+    { 0x066C, 0x066C, W_MID_NUM }, { 0x066E, 0x06D3, W_ALETTER }, { 0x06D5, 0x06D5, W_ALETTER },
+    { 0x06E5, 0x06E6, W_ALETTER }, { 0x06EE, 0x06EF, W_ALETTER }, { 0x06F0, 0x06F9, W_NUMERIC },
+    { 0x06FA, 0x06FC, W_ALETTER }, { 0x06FF, 0x06FF, W_ALETTER }, { 0x0710, 0x07B1, W_ALETTER },
+    { 0x07C0, 0x07C9, W_NUMERIC }, { 0x07CA, 0x07F5, W_ALETTER }, { 0x07F8, 0x07F8, W_MID_NUM },
+    { 0x07FA, 0x07FA, W_ALETTER }, { 0x0800, 0x0828, W_ALETTER }, { 0x0840, 0x0858, W_ALETTER },
+    { 0x0860, 0x0887, W_ALETTER }, { 0x0889, 0x088E, W_ALETTER }, { 0x08A0, 0x08C9, W_ALETTER },
+    { 0x0904, 0x0961, W_ALETTER }, { 0x0966, 0x096F, W_NUMERIC }, { 0x0971, 0x09E1, W_ALETTER },
+    { 0x09E6, 0x09EF, W_NUMERIC }, { 0x09F0, 0x09F1, W_ALETTER }, { 0x09FC, 0x09FC, W_ALETTER },
+    { 0x0A05, 0x0A5E, W_ALETTER }, { 0x0A66, 0x0A6F, W_NUMERIC }, { 0x0A72, 0x0A74, W_ALETTER },
+    { 0x0A85, 0x0AE1, W_ALETTER }, { 0x0AE6, 0x0AEF, W_NUMERIC }, { 0x0AF9, 0x0B61, W_ALETTER },
+    { 0x0B66, 0x0B6F, W_NUMERIC }, { 0x0B71, 0x0B71, W_ALETTER }, { 0x0B83, 0x0BD0, W_ALETTER },
+    { 0x0BE6, 0x0BEF, W_NUMERIC }, { 0x0C05, 0x0C61, W_ALETTER }, { 0x0C66, 0x0C6F, W_NUMERIC },
+    { 0x0C80, 0x0C80, W_ALETTER }, { 0x0C85, 0x0CE1, W_ALETTER }, { 0x0CE6, 0x0CEF, W_NUMERIC },
+    { 0x0CF1, 0x0D4E, W_ALETTER }, { 0x0D54, 0x0D56, W_ALETTER }, { 0x0D5F, 0x0D61, W_ALETTER },
+    { 0x0D66, 0x0D6F, W_NUMERIC }, { 0x0D7A, 0x0DC6, W_ALETTER }, { 0x0DE6, 0x0DEF, W_NUMERIC },
+    { 0x0E50, 0x0E59, W_NUMERIC }, { 0x0ED0, 0x0ED9, W_NUMERIC }, { 0x0F00, 0x0F00, W_ALETTER },
+    { 0x0F20, 0x0F29, W_NUMERIC }, { 0x0F40, 0x0F6C, W_ALETTER }, { 0x0F88, 0x0F8C, W_ALETTER },
+    { 0x1040, 0x1049, W_NUMERIC }, { 0x1090, 0x1099, W_NUMERIC }, { 0x10A0, 0x10FA, W_ALETTER },
+    { 0x10FC, 0x135A, W_ALETTER }, { 0x1380, 0x138F, W_ALETTER }, { 0x13A0, 0x13FD, W_ALETTER },
+    { 0x1401, 0x166C, W_ALETTER }, { 0x166F, 0x167F, W_ALETTER }, { 0x1680, 0x1680, W_WSEG_SPACE },
+    { 0x1681, 0x169A, W_ALETTER }, { 0x16A0, 0x16EA, W_ALETTER }, { 0x16EE, 0x1731, W_ALETTER },
+    { 0x1740, 0x1770, W_ALETTER }, { 0x17E0, 0x17E9, W_NUMERIC }, { 0x180E, 0x180E, W_FORMAT },
+    { 0x1810, 0x1819, W_NUMERIC }, { 0x1820, 0x191E, W_ALETTER }, { 0x1946, 0x194F, W_NUMERIC },
+    { 0x19D0, 0x19D9, W_NUMERIC }, { 0x1A00, 0x1A16, W_ALETTER }, { 0x1A80, 0x1A99, W_NUMERIC },
+    { 0x1B05, 0x1B4C, W_ALETTER }, { 0x1B50, 0x1B59, W_NUMERIC }, { 0x1B83, 0x1BAF, W_ALETTER },
+    { 0x1BB0, 0x1BB9, W_NUMERIC }, { 0x1BBA, 0x1BE5, W_ALETTER }, { 0x1C00, 0x1C23, W_ALETTER },
+    { 0x1C40, 0x1C49, W_NUMERIC }, { 0x1C4D, 0x1C4F, W_ALETTER }, { 0x1C50, 0x1C59, W_NUMERIC },
+    { 0x1C5A, 0x1C7D, W_ALETTER }, { 0x1C80, 0x1CBF, W_ALETTER }, { 0x1CE9, 0x1FBC, W_ALETTER },
+    { 0x1FBE, 0x1FBE, W_ALETTER }, { 0x1FC2, 0x1FCC, W_ALETTER }, { 0x1FD0, 0x1FDB, W_ALETTER },
+    { 0x1FE0, 0x1FEC, W_ALETTER }, { 0x1FF2, 0x1FFC, W_ALETTER }, { 0x2000, 0x2006, W_WSEG_SPACE },
+    { 0x2008, 0x200A, W_WSEG_SPACE }, { 0x200E, 0x200F, W_FORMAT },
+    { 0x2018, 0x2019, W_MID_NUM_LET }, { 0x2024, 0x2024, W_MID_NUM_LET },
+    { 0x2027, 0x2027, W_MID_LETTER }, { 0x2028, 0x2029, W_NEWLINE }, { 0x202A, 0x202E, W_FORMAT },
+    { 0x202F, 0x202F, W_EXTEND_NUM_LET }, { 0x203F, 0x2040, W_EXTEND_NUM_LET },
+    { 0x2044, 0x2044, W_MID_NUM }, { 0x2054, 0x2054, W_EXTEND_NUM_LET },
+    { 0x205F, 0x205F, W_WSEG_SPACE }, { 0x2060, 0x206F, W_FORMAT }, { 0x2071, 0x2071, W_ALETTER },
+    { 0x207F, 0x207F, W_ALETTER }, { 0x2090, 0x209C, W_ALETTER }, { 0x2102, 0x2102, W_ALETTER },
+    { 0x2107, 0x2107, W_ALETTER }, { 0x210A, 0x2113, W_ALETTER }, { 0x2115, 0x2115, W_ALETTER },
+    { 0x2119, 0x211D, W_ALETTER }, { 0x2124, 0x2124, W_ALETTER }, { 0x2126, 0x2126, W_ALETTER },
+    { 0x2128, 0x2128, W_ALETTER }, { 0x212A, 0x212D, W_ALETTER }, { 0x212F, 0x2139, W_ALETTER },
+    { 0x213C, 0x213F, W_ALETTER }, { 0x2145, 0x2149, W_ALETTER }, { 0x214E, 0x214E, W_ALETTER },
+    { 0x2160, 0x2188, W_ALETTER }, { 0x24B6, 0x24E9, W_ALETTER }, { 0x2C00, 0x2CE4, W_ALETTER },
+    { 0x2CEB, 0x2CF3, W_ALETTER }, { 0x2D00, 0x2D6F, W_ALETTER }, { 0x2D80, 0x2DDE, W_ALETTER },
+    { 0x2E2F, 0x2E2F, W_ALETTER }, { 0x3000, 0x3000, W_WSEG_SPACE }, { 0x3031, 0x3035, W_KATAKANA },
+    { 0x309B, 0x309C, W_KATAKANA }, { 0x30A0, 0x30FA, W_KATAKANA }, { 0x30FC, 0x30FF, W_KATAKANA },
+    { 0x3105, 0x318E, W_ALETTER }, { 0x31A0, 0x31BF, W_ALETTER }, { 0x31F0, 0x31FF, W_KATAKANA },
+    { 0x32D0, 0x32FE, W_KATAKANA }, { 0x3300, 0x3357, W_KATAKANA }, { 0xA000, 0xA48C, W_ALETTER },
+    { 0xA4D0, 0xA4FD, W_ALETTER }, { 0xA500, 0xA60C, W_ALETTER }, { 0xA610, 0xA61F, W_ALETTER },
+    { 0xA620, 0xA629, W_NUMERIC }, { 0xA62A, 0xA66E, W_ALETTER }, { 0xA67F, 0xA6EF, W_ALETTER },
+    { 0xA717, 0xA71F, W_ALETTER }, { 0xA722, 0xA788, W_ALETTER }, { 0xA78B, 0xA822, W_ALETTER },
+    { 0xA840, 0xA873, W_ALETTER }, { 0xA882, 0xA8B3, W_ALETTER }, { 0xA8D0, 0xA8D9, W_NUMERIC },
+    { 0xA8F2, 0xA8F7, W_ALETTER }, { 0xA8FB, 0xA8FB, W_ALETTER }, { 0xA8FD, 0xA8FE, W_ALETTER },
+    { 0xA900, 0xA909, W_NUMERIC }, { 0xA90A, 0xA925, W_ALETTER }, { 0xA930, 0xA946, W_ALETTER },
+    { 0xA960, 0xA9B2, W_ALETTER }, { 0xA9CF, 0xA9CF, W_ALETTER }, { 0xA9D0, 0xA9D9, W_NUMERIC },
+    { 0xA9F0, 0xA9F9, W_NUMERIC }, { 0xAA00, 0xAA4B, W_ALETTER }, { 0xAA50, 0xAA59, W_NUMERIC },
+    { 0xAAE0, 0xAAEA, W_ALETTER }, { 0xAAF2, 0xAB5A, W_ALETTER }, { 0xAB5C, 0xAB69, W_ALETTER },
+    { 0xAB70, 0xABE2, W_ALETTER }, { 0xABF0, 0xABF9, W_NUMERIC }, { 0xAC00, 0xD7FB, W_ALETTER },
+    { 0xFB00, 0xFB17, W_ALETTER }, { 0xFB1D, 0xFB28, W_HEBREW_LETTER },
+    { 0xFB2A, 0xFB4F, W_HEBREW_LETTER }, { 0xFB50, 0xFBB1, W_ALETTER },
+    { 0xFBD3, 0xFD3D, W_ALETTER }, { 0xFD50, 0xFDC7, W_ALETTER }, { 0xFDF0, 0xFDFB, W_ALETTER },
+    { 0xFE10, 0xFE10, W_MID_NUM }, { 0xFE13, 0xFE13, W_MID_LETTER }, { 0xFE14, 0xFE14, W_MID_NUM },
+    { 0xFE33, 0xFE34, W_EXTEND_NUM_LET }, { 0xFE4D, 0xFE4F, W_EXTEND_NUM_LET },
+    { 0xFE50, 0xFE50, W_MID_NUM }, { 0xFE52, 0xFE52, W_MID_NUM_LET }, { 0xFE54, 0xFE54, W_MID_NUM },
+    { 0xFE55, 0xFE55, W_MID_LETTER }, { 0xFE70, 0xFEFC, W_ALETTER }, { 0xFEFF, 0xFEFF, W_FORMAT },
+    { 0xFF07, 0xFF07, W_MID_NUM_LET }, { 0xFF0C, 0xFF0C, W_MID_NUM },
+    { 0xFF0E, 0xFF0E, W_MID_NUM_LET }, { 0xFF1A, 0xFF1A, W_MID_LETTER },
+    { 0xFF1B, 0xFF1B, W_MID_NUM }, { 0xFF21, 0xFF3A, W_ALETTER },
+    { 0xFF3F, 0xFF3F, W_EXTEND_NUM_LET }, { 0xFF41, 0xFF5A, W_ALETTER },
+    { 0xFF66, 0xFF9D, W_KATAKANA }, { 0xFFA0, 0xFFDC, W_ALETTER }, { 0xFFF9, 0xFFFB, W_FORMAT },
+    { 0x10000, 0x100FA, W_ALETTER }, { 0x10140, 0x10174, W_ALETTER },
+    { 0x10280, 0x102D0, W_ALETTER }, { 0x10300, 0x1031F, W_ALETTER },
+    { 0x1032D, 0x1039D, W_ALETTER }, { 0x103A0, 0x103CF, W_ALETTER },
+    { 0x103D1, 0x1049D, W_ALETTER }, { 0x104A0, 0x104A9, W_NUMERIC },
+    { 0x104B0, 0x10563, W_ALETTER }, { 0x10570, 0x10855, W_ALETTER },
+    { 0x10860, 0x10876, W_ALETTER }, { 0x10880, 0x1089E, W_ALETTER },
+    { 0x108E0, 0x108F5, W_ALETTER }, { 0x10900, 0x10915, W_ALETTER },
+    { 0x10920, 0x10939, W_ALETTER }, { 0x10980, 0x109B7, W_ALETTER },
+    { 0x109BE, 0x109BF, W_ALETTER }, { 0x10A00, 0x10A35, W_ALETTER },
+    { 0x10A60, 0x10A7C, W_ALETTER }, { 0x10A80, 0x10A9C, W_ALETTER },
+    { 0x10AC0, 0x10AC7, W_ALETTER }, { 0x10AC9, 0x10AE4, W_ALETTER },
+    { 0x10B00, 0x10B35, W_ALETTER }, { 0x10B40, 0x10B55, W_ALETTER },
+    { 0x10B60, 0x10B72, W_ALETTER }, { 0x10B80, 0x10B91, W_ALETTER },
+    { 0x10C00, 0x10CF2, W_ALETTER }, { 0x10D00, 0x10D23, W_ALETTER },
+    { 0x10D30, 0x10D39, W_NUMERIC }, { 0x10E80, 0x10EA9, W_ALETTER },
+    { 0x10EB0, 0x10F1C, W_ALETTER }, { 0x10F27, 0x10F45, W_ALETTER },
+    { 0x10F70, 0x10F81, W_ALETTER }, { 0x10FB0, 0x10FC4, W_ALETTER },
+    { 0x10FE0, 0x11037, W_ALETTER }, { 0x11066, 0x1106F, W_NUMERIC },
+    { 0x11071, 0x110AF, W_ALETTER }, { 0x110D0, 0x110E8, W_ALETTER },
+    { 0x110F0, 0x110F9, W_NUMERIC }, { 0x11103, 0x11126, W_ALETTER },
+    { 0x11136, 0x1113F, W_NUMERIC }, { 0x11144, 0x11172, W_ALETTER },
+    { 0x11176, 0x111C4, W_ALETTER }, { 0x111D0, 0x111D9, W_NUMERIC },
+    { 0x111DA, 0x111DA, W_ALETTER }, { 0x111DC, 0x111DC, W_ALETTER },
+    { 0x11200, 0x1122B, W_ALETTER }, { 0x11280, 0x112A8, W_ALETTER },
+    { 0x112B0, 0x112DE, W_ALETTER }, { 0x112F0, 0x112F9, W_NUMERIC },
+    { 0x11305, 0x1144A, W_ALETTER }, { 0x11450, 0x11459, W_NUMERIC },
+    { 0x1145F, 0x114C5, W_ALETTER }, { 0x114C7, 0x114C7, W_ALETTER },
+    { 0x114D0, 0x114D9, W_NUMERIC }, { 0x11580, 0x115AE, W_ALETTER },
+    { 0x115D8, 0x1162F, W_ALETTER }, { 0x11644, 0x11644, W_ALETTER },
+    { 0x11650, 0x11659, W_NUMERIC }, { 0x11680, 0x116B8, W_ALETTER },
+    { 0x116C0, 0x116C9, W_NUMERIC }, { 0x11730, 0x11739, W_NUMERIC },
+    { 0x11800, 0x1182B, W_ALETTER }, { 0x118A0, 0x118DF, W_ALETTER },
+    { 0x118E0, 0x118E9, W_NUMERIC }, { 0x118FF, 0x11941, W_ALETTER },
+    { 0x11950, 0x11959, W_NUMERIC }, { 0x119A0, 0x119E1, W_ALETTER },
+    { 0x119E3, 0x11A3A, W_ALETTER }, { 0x11A50, 0x11A89, W_ALETTER },
+    { 0x11A9D, 0x11A9D, W_ALETTER }, { 0x11AB0, 0x11C40, W_ALETTER },
+    { 0x11C50, 0x11C59, W_NUMERIC }, { 0x11C72, 0x11D46, W_ALETTER },
+    { 0x11D50, 0x11D59, W_NUMERIC }, { 0x11D60, 0x11D98, W_ALETTER },
+    { 0x11DA0, 0x11DA9, W_NUMERIC }, { 0x11EE0, 0x11EF2, W_ALETTER },
+    { 0x11FB0, 0x11FB0, W_ALETTER }, { 0x12000, 0x1246E, W_ALETTER },
+    { 0x12480, 0x12FF0, W_ALETTER }, { 0x13000, 0x1342E, W_ALETTER },
+    { 0x13430, 0x13438, W_FORMAT }, { 0x14400, 0x16A5E, W_ALETTER },
+    { 0x16A60, 0x16A69, W_NUMERIC }, { 0x16A70, 0x16ABE, W_ALETTER },
+    { 0x16AC0, 0x16AC9, W_NUMERIC }, { 0x16AD0, 0x16AED, W_ALETTER },
+    { 0x16B00, 0x16B2F, W_ALETTER }, { 0x16B40, 0x16B43, W_ALETTER },
+    { 0x16B50, 0x16B59, W_NUMERIC }, { 0x16B63, 0x16E7F, W_ALETTER },
+    { 0x16F00, 0x16FE1, W_ALETTER }, { 0x16FE3, 0x18D08, W_ALETTER },
+    { 0x1AFF0, 0x1B000, W_KATAKANA }, { 0x1B001, 0x1B152, W_ALETTER },
+    { 0x1B164, 0x1B167, W_KATAKANA }, { 0x1B170, 0x1BC99, W_ALETTER },
+    { 0x1BCA0, 0x1BCA3, W_FORMAT }, { 0x1D173, 0x1D17A, W_FORMAT }, { 0x1D400, 0x1D6C0, W_ALETTER },
+    { 0x1D6C2, 0x1D6DA, W_ALETTER }, { 0x1D6DC, 0x1D6FA, W_ALETTER },
+    { 0x1D6FC, 0x1D714, W_ALETTER }, { 0x1D716, 0x1D734, W_ALETTER },
+    { 0x1D736, 0x1D74E, W_ALETTER }, { 0x1D750, 0x1D76E, W_ALETTER },
+    { 0x1D770, 0x1D788, W_ALETTER }, { 0x1D78A, 0x1D7A8, W_ALETTER },
+    { 0x1D7AA, 0x1D7C2, W_ALETTER }, { 0x1D7C4, 0x1D7CB, W_ALETTER },
+    { 0x1D7CE, 0x1D7FF, W_NUMERIC }, { 0x1DF00, 0x1E13D, W_ALETTER },
+    { 0x1E140, 0x1E149, W_NUMERIC }, { 0x1E14E, 0x1E14E, W_ALETTER },
+    { 0x1E290, 0x1E2EB, W_ALETTER }, { 0x1E2F0, 0x1E2F9, W_NUMERIC },
+    { 0x1E7E0, 0x1E8C4, W_ALETTER }, { 0x1E900, 0x1E94B, W_ALETTER },
+    { 0x1E950, 0x1E959, W_NUMERIC }, { 0x1EE00, 0x1EEBB, W_ALETTER },
+    { 0x1FBF0, 0x1FBF9, W_NUMERIC }, { 0xE0001, 0xE0001, W_FORMAT },
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_STARTED = FALSE;
+static uint16_t *i_STAGE1 = NULL;
+static byte_t *i_STAGE2 = NULL;
+static uint32_t i_CAPACITY = 0;
+static Props i_PROPS[MAX_PROPS];
+static uint32_t i_NPROPS = 0;
+static byte_t i_GRAPHEME[G_STATES][G_COUNT];
+static byte_t i_WORD[W_STATES][W_COUNT];
+
+/*----------------------------------------------------------------------------*/
+/* Decodes the character at `s`; a broken one reads as U+FFFD, one byte. */
+static uint32_t i_decode(const byte_t *s, uint32_t size, uint32_t *cp) {
+    uint32_t c = s[0];
+    uint32_t k = c < 0x80 ? 0 : c >= 0xC2 && c < 0xE0 ? 1 : c >= 0xE0 && c < 0xF0 ? 2 : c >= 0xF0 && c < 0xF5 ? 3 : 4;
+    *cp = 0xFFFD;
+    if (k == 4 || k >= size) {
+        return 1;
+    }
+
+    c &= k == 0 ? 0x7F : 0x3F >> k;
+    for (uint32_t j = 1; j <= k; ++j) {
+        if ((s[j] & 0xC0) != 0x80) {
+            return 1;
+        }
+        c = (c << 6) | (s[j] & 0x3F);
+    }
+    *cp = c;
+    return k + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The start of the character before `pos`. */
+static uint32_t i_back(const byte_t *text, uint32_t pos) {
+    uint32_t start = pos - 1;
+    while (start > 0 && pos - start < 4 && (text[start] & 0xC0) == 0x80) {
+        start -= 1;
+    }
+    return start;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The start of the character `offset` falls in, or `size`. */
+static uint32_t i_align(const byte_t *text, uint32_t size, uint32_t offset) {
+    if (offset >= size) {
+        return size;
+    }
+    for (uint32_t i = 0; i < 3 && offset > 0 && (text[offset] & 0xC0) == 0x80; ++i) {
+        offset -= 1;
+    }
+    return offset;
+}
+
+/*----------------------------------------------------------------------------*/
+static Props i_props(uint32_t cp) {
+    if (!i_STARTED || cp >= 0x110000) {
+        return i_PROPS[0];
+    }
+    return i_PROPS[i_STAGE2[(uint32_t)i_STAGE1[cp >> BLOCK_SHIFT] * BLOCK_SIZE + (cp & (BLOCK_SIZE - 1))]];
+}
+
+/*----------------------------------------------------------------------------*/
+static Props i_at(const byte_t *text, uint32_t size, uint32_t pos) {
+    uint32_t cp = 0;
+    i_decode(text + pos, size - pos, &cp);
+    return i_props(cp);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The property of `cp` in a sorted list of ranges, walked by `cursor` as the
+ * code points go up. */
+static byte_t i_range(const Range *ranges, uint32_t count, uint32_t *cursor, uint32_t cp) {
+    while (*cursor < count && ranges[*cursor].last < cp) {
+        *cursor += 1;
+    }
+    return *cursor < count && ranges[*cursor].first <= cp ? ranges[*cursor].prop : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static Wb i_word_of(Gcb grapheme, Wb word) {
+    switch (grapheme) {
+    case G_CR: return W_CR;
+    case G_LF: return W_LF;
+    case G_ZWJ: return W_ZWJ;
+    case G_RI: return W_RI;
+    case G_EXTEND:
+    case G_SPACING_MARK: return W_EXTEND;
+    default: break;
+    }
+    return word == W_OTHER && grapheme == G_EXT_PICT ? W_EXT_PICT : word;
+}
+
+/*----------------------------------------------------------------------------*/
+static byte_t i_prop_index(Gcb grapheme, Wb word) {
+    for (uint32_t i = 0; i < i_NPROPS; ++i) {
+        if (i_PROPS[i].grapheme == grapheme && i_PROPS[i].word == word) {
+            return (byte_t)i;
+        }
+    }
+
+    if (i_NPROPS == MAX_PROPS) {
+        return 0;
+    }
+    i_PROPS[i_NPROPS].grapheme = (byte_t)grapheme;
+    i_PROPS[i_NPROPS].word = (byte_t)word;
+    i_NPROPS += 1;
+    return (byte_t)(i_NPROPS - 1);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_block_hash(const byte_t *block) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+        h = (h ^ block[i]) * 16777619u;
+    }
+    return h;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_compile_props(void) {
+    uint32_t ngraphemes = sizeof(GRAPHEME_RANGES) / sizeof(Range);
+    uint32_t nwords = sizeof(WORD_RANGES) / sizeof(Range);
+    uint32_t g = 0, w = 0;
+    uint32_t blocks = 0;
+    uint32_t *hashes = heap_new_n(BLOCKS, uint32_t);
+    byte_t block[BLOCK_SIZE];
+
+    i_NPROPS = 0;
+    i_prop_index(G_OTHER, W_OTHER);
+    i_STAGE1 = heap_new_n(BLOCKS, uint16_t);
+    i_CAPACITY = 64;
+    i_STAGE2 = heap_new_n(i_CAPACITY * BLOCK_SIZE, byte_t);
+
+    for (uint32_t b = 0; b < BLOCKS; ++b) {
+        for (uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+            uint32_t cp = b * BLOCK_SIZE + i;
+            Gcb grapheme = (Gcb)i_range(GRAPHEME_RANGES, ngraphemes, &g, cp);
+            Wb word = (Wb)i_range(WORD_RANGES, nwords, &w, cp);
+            if (cp >= HANGUL_FIRST && cp <= HANGUL_LAST) {
+                grapheme = (cp - HANGUL_FIRST) % 28 == 0 ? G_LV : G_LVT;
+            }
+            block[i] = i_prop_index(grapheme, i_word_of(grapheme, word));
+        }
+
+        /* most blocks repeat the one before: the rest of a script, or
+         * unassigned planes */
+        uint32_t hash = i_block_hash(block);
+        uint32_t found = blocks;
+        for (uint32_t k = blocks; k-- > 0;) {
+            if (hashes[k] == hash && memcmp(i_STAGE2 + k * BLOCK_SIZE, block, BLOCK_SIZE) == 0) {
+                found = k;
+                break;
+            }
+        }
+
+        if (found == blocks) {
+            if (blocks == i_CAPACITY) {
+                byte_t *stage2 = heap_new_n(i_CAPACITY * 2 * BLOCK_SIZE, byte_t);
+                memcpy(stage2, i_STAGE2, i_CAPACITY * BLOCK_SIZE);
+                heap_delete_n(&i_STAGE2, i_CAPACITY * BLOCK_SIZE, byte_t);
+                i_STAGE2 = stage2;
+                i_CAPACITY *= 2;
+            }
+            memcpy(i_STAGE2 + blocks * BLOCK_SIZE, block, BLOCK_SIZE);
+            hashes[blocks] = hash;
+            blocks += 1;
+        }
+        i_STAGE1[b] = (uint16_t)found;
+    }
+
+    heap_delete_n(&hashes, BLOCKS, uint32_t);
+}
+
+/*----------------------------------------------------------------------------*/
+/* GB3 to GB13, from a state to a character of class `c`. */
+static bool_t i_grapheme_split(uint32_t state, Gcb c) {
+    uint32_t prev = state == G_EP_EXTEND ? G_EXTEND : state == G_EP_ZWJ ? G_ZWJ : state == G_RI_PAIR ? G_RI : state;
+    if (state == G_START) {
+        return TRUE;
+    }
+    if (prev == G_CR && c == G_LF) {
+        return FALSE;
+    }
+    if (prev == G_CONTROL || prev == G_CR || prev == G_LF || c == G_CONTROL || c == G_CR || c == G_LF) {
+        return TRUE;
+    }
+    if (prev == G_L && (c == G_L || c == G_V || c == G_LV || c == G_LVT)) {
+        return FALSE;
+    }
+    if ((prev == G_LV || prev == G_V) && (c == G_V || c == G_T)) {
+        return FALSE;
+    }
+    if ((prev == G_LVT || prev == G_T) && c == G_T) {
+        return FALSE;
+    }
+    if (c == G_EXTEND || c == G_ZWJ || c == G_SPACING_MARK || prev == G_PREPEND) {
+        return FALSE;
+    }
+    if (state == G_EP_ZWJ && c == G_EXT_PICT) {
+        return FALSE;
+    }
+    return !(state == G_RI && c == G_RI);
+}
+
+/*----------------------------------------------------------------------------*/
+static byte_t i_grapheme_step(uint32_t state, Gcb c) {
+    uint32_t next = c;
+    bool_t pictographic = state == G_EXT_PICT || state == G_EP_EXTEND;
+    if (pictographic && c == G_EXTEND) {
+        next = G_EP_EXTEND;
+    } else if (pictographic && c == G_ZWJ) {
+        next = G_EP_ZWJ;
+    } else if (state == G_RI && c == G_RI) {
+        next = G_RI_PAIR;
+    }
+    return (byte_t)(next | (i_grapheme_split(state, c) ? BREAK_HERE : 0));
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_letter(uint32_t c) {
+    return c == W_ALETTER || c == W_HEBREW_LETTER;
+}
+
+/*----------------------------------------------------------------------------*/
+/* WB3 to WB16, less the two that look at raw neighbours (WB3c, WB3d), which
+ * the scan applies itself. Extend, Format and ZWJ leave the state as it is
+ * (WB4), a pending boundary included. */
+static byte_t i_word_step(uint32_t state, Wb c) {
+    if (state == W_START) {
+        return (byte_t)(c | BREAK_HERE);
+    }
+    if (state == W_CR && c == W_LF) {
+        return W_LF;
+    }
+    if (state == W_CR || state == W_LF || state == W_NEWLINE || c == W_CR || c == W_LF || c == W_NEWLINE) {
+        return (byte_t)(c | BREAK_HERE);
+    }
+    if (c == W_EXTEND || c == W_FORMAT || c == W_ZWJ) {
+        return (byte_t)state;
+    }
+    if (state == W_LETTER_MID) {
+        return (byte_t)(i_letter(c) ? c | KEEP_PENDING : c | BREAK_HERE);
+    }
+    if (state == W_NUMBER_MID) {
+        return (byte_t)(c == W_NUMERIC ? c | KEEP_PENDING : c | BREAK_HERE);
+    }
+    if (i_letter(state)) {
+        if (i_letter(c) || c == W_NUMERIC || c == W_EXTEND_NUM_LET) {
+            return (byte_t)c;
+        }
+        if (c == W_MID_LETTER || c == W_MID_NUM_LET || c == W_SINGLE_QUOTE) {
+            return W_LETTER_MID | PENDING;
+        }
+    }
+    if (state == W_NUMERIC) {
+        if (c == W_NUMERIC || i_letter(c) || c == W_EXTEND_NUM_LET) {
+            return (byte_t)c;
+        }
+        if (c == W_MID_NUM || c == W_MID_NUM_LET || c == W_SINGLE_QUOTE) {
+            return W_NUMBER_MID | PENDING;
+        }
+    }
+    if (state == W_KATAKANA && (c == W_KATAKANA || c == W_EXTEND_NUM_LET)) {
+        return (byte_t)c;
+    }
+    if (state == W_EXTEND_NUM_LET && (i_letter(c) || c == W_NUMERIC || c == W_KATAKANA || c == W_EXTEND_NUM_LET)) {
+        return (byte_t)c;
+    }
+    if (state == W_RI && c == W_RI) {
+        return W_RI_PAIR;
+    }
+    return (byte_t)(c | BREAK_HERE);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_compile_rules(void) {
+    for (uint32_t s = 0; s < G_STATES; ++s) {
+        for (uint32_t c = 0; c < G_COUNT; ++c) {
+            i_GRAPHEME[s][c] = i_grapheme_step(s, (Gcb)c);
+        }
+    }
+    for (uint32_t s = 0; s < W_STATES; ++s) {
+        for (uint32_t c = 0; c < W_COUNT; ++c) {
+            i_WORD[s][c] = i_word_step(s, (Wb)c);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The nearest point at or before `offset` that is a grapheme boundary
+ * whatever precedes it: one the rules break at from the class before alone,
+ * so not between regional indicators or after a joiner. */
+static uint32_t i_grapheme_safe(const byte_t *text, uint32_t size, uint32_t offset) {
+    uint32_t pos = i_align(text, size, offset);
+    if (pos == size && pos > 0) {
+        pos = i_back(text, pos);
+    }
+
+    while (pos > 0) {
+        uint32_t before = i_back(text, pos);
+        Gcb a = (Gcb)i_at(text, size, before).grapheme;
+        Gcb b = (Gcb)i_at(text, size, pos).grapheme;
+        if ((i_GRAPHEME[a][b] & BREAK_HERE) && a != G_ZWJ) {
+            return pos;
+        }
+        pos = before;
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Runs the grapheme rules from the boundary `from`: returns the last
+ * boundary at or before `offset` and leaves the first after it in `end`. */
+static uint32_t i_graphemes(const byte_t *text, uint32_t size, uint32_t from, uint32_t offset, uint32_t *end) {
+    uint32_t state = G_START;
+    uint32_t start = from;
+    uint32_t pos = from;
+    while (pos < size) {
+        uint32_t cp = 0;
+        uint32_t n = i_decode(text + pos, size - pos, &cp);
+        byte_t step = i_GRAPHEME[state][i_props(cp).grapheme];
+        if (step & BREAK_HERE) {
+            if (pos > offset) {
+                *end = pos;
+                return start;
+            }
+            start = pos;
+        }
+        state = step & STATE_MASK;
+        pos += n;
+    }
+
+    *end = size;
+    return start;
+}
+
+/*----------------------------------------------------------------------------*/
+/* As for graphemes; for words such a point follows a space or a line
+ * break. */
+static uint32_t i_word_safe(const byte_t *text, uint32_t size, uint32_t offset) {
+    uint32_t pos = i_align(text, size, offset);
+    if (pos == size && pos > 0) {
+        pos = i_back(text, pos);
+    }
+
+    while (pos > 0) {
+        uint32_t before = i_back(text, pos);
+        Wb a = (Wb)i_at(text, size, before).word;
+        Wb b = (Wb)i_at(text, size, pos).word;
+        if ((a == W_CR || a == W_LF || a == W_NEWLINE) && !(a == W_CR && b == W_LF)) {
+            return pos;
+        }
+        if (a == W_WSEG_SPACE && b != W_WSEG_SPACE && b != W_EXTEND && b != W_FORMAT && b != W_ZWJ) {
+            return pos;
+        }
+        pos = before;
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Runs the word rules from the boundary `from`, like i_graphemes. A pending
+ * boundary is settled by the next character that is not Extend, Format or
+ * ZWJ, or by the end of the text. */
+static uint32_t i_words(const byte_t *text, uint32_t size, uint32_t from, uint32_t offset, uint32_t *end) {
+    uint32_t state = W_START;
+    uint32_t raw = W_START;
+    uint32_t start = from;
+    uint32_t pending = UINT32_MAX;
+    uint32_t pos = from;
+    while (pos < size) {
+        uint32_t cp = 0;
+        uint32_t n = i_decode(text + pos, size - pos, &cp);
+        Wb c = (Wb)i_props(cp).word;
+        byte_t step = i_WORD[state][c];
+        if ((raw == W_ZWJ && c == W_EXT_PICT) || (raw == W_WSEG_SPACE && c == W_WSEG_SPACE)) {
+            step &= (byte_t)~BREAK_HERE;
+        }
+
+        if (pending != UINT32_MAX && c != W_EXTEND && c != W_FORMAT && c != W_ZWJ) {
+            if (!(step & KEEP_PENDING)) {
+                if (pending > offset) {
+                    *end = pending;
+                    return start;
+                }
+                start = pending;
+            }
+            pending = UINT32_MAX;
+        }
+
+        if (step & PENDING) {
+            pending = pos;
+        } else if (step & BREAK_HERE) {
+            if (pos > offset) {
+                *end = pos;
+                return start;
+            }
+            start = pos;
+        }
+        state = step & STATE_MASK;
+        raw = c;
+        pos += n;
+    }
+
+    if (pending != UINT32_MAX) {
+        if (pending > offset) {
+            *end = pending;
+            return start;
+        }
+        start = pending;
+    }
+    *end = size;
+    return start;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSegmentStart(void) {
+    if (i_STARTED) {
+        return;
+    }
+    i_compile_props();
+    i_compile_rules();
+    i_STARTED = TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxSegmentFinish(void) {
+    if (!i_STARTED) {
+        return;
+    }
+    heap_delete_n(&i_STAGE1, BLOCKS, uint16_t);
+    heap_delete_n(&i_STAGE2, i_CAPACITY * BLOCK_SIZE, byte_t);
+    i_CAPACITY = 0;
+    i_STARTED = FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first grapheme boundary after `offset`, or `size`. Before utx_start
+ * every character is a grapheme of its own. */
+uint32_t utxGraphemeNext(const char_t *text, uint32_t size, uint32_t offset) {
+    if (text == NULL || offset >= size) {
+        return size;
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t end = size;
+    i_graphemes(bytes, size, i_grapheme_safe(bytes, size, offset), offset, &end);
+    return end;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The last grapheme boundary before `offset`, or 0. */
+uint32_t utxGraphemePrev(const char_t *text, uint32_t size, uint32_t offset) {
+    if (text == NULL || offset == 0) {
+        return 0;
+    }
+    if (offset > size) {
+        offset = size;
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t end = size;
+    return i_graphemes(bytes, size, i_grapheme_safe(bytes, size, offset - 1), offset - 1, &end);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first word boundary after `offset`, or `size`. Spaces and punctuation
+ * between words are segments too, see utxWordAt. */
+uint32_t utxWordNext(const char_t *text, uint32_t size, uint32_t offset) {
+    if (text == NULL || offset >= size) {
+        return size;
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t end = size;
+    i_words(bytes, size, i_word_safe(bytes, size, offset), offset, &end);
+    return end;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The last word boundary before `offset`, or 0. */
+uint32_t utxWordPrev(const char_t *text, uint32_t size, uint32_t offset) {
+    if (text == NULL || offset == 0) {
+        return 0;
+    }
+    if (offset > size) {
+        offset = size;
+    }
+
+    const byte_t *bytes = (const byte_t*)text;
+    uint32_t end = size;
+    return i_words(bytes, size, i_word_safe(bytes, size, offset - 1), offset - 1, &end);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The segment `offset` is in, the one before it at the end of the text:
+ * what a double click selects. Returns whether it is a word, of letters or
+ * digits, rather than spaces or punctuation. */
+bool_t utxWordAt(const char_t *text, uint32_t size, uint32_t offset, uint32_t *start, uint32_t *end) {
+    uint32_t s = 0, e = 0;
+    bool_t word = FALSE;
+    if (text != NULL && size > 0) {
+        const byte_t *bytes = (const byte_t*)text;
+        if (offset >= size) {
+            offset = size - 1;
+        }
+
+        s = i_words(bytes, size, i_word_safe(bytes, size, offset), offset, &e);
+        uint32_t pos = s;
+        while (pos < e && !word) {
+            uint32_t cp = 0;
+            pos += i_decode(bytes + pos, size - pos, &cp);
+            Wb c = (Wb)i_props(cp).word;
+            word = i_letter(c) || c == W_NUMERIC || c == W_KATAKANA || c == W_EXTEND_NUM_LET;
+        }
+    }
+
+    if (start != NULL) {
+        *start = s;
+    }
+    if (end != NULL) {
+        *end = e;
+    }
+    return word;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,34 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_SEGMENT_H__
+#define __UTX_SEGMENT_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api void utxSegmentStart(void);
+_utx_api void utxSegmentFinish(void);
+
+_utx_api uint32_t utxGraphemeNext(const char_t *text, uint32_t size, uint32_t offset);
+_utx_api uint32_t utxGraphemePrev(const char_t *text, uint32_t size, uint32_t offset);
+_utx_api uint32_t utxWordNext(const char_t *text, uint32_t size, uint32_t offset);
+_utx_api uint32_t utxWordPrev(const char_t *text, uint32_t size, uint32_t offset);
+_utx_api bool_t utxWordAt(const char_t *text, uint32_t size, uint32_t offset, uint32_t *start, uint32_t *end);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_SEGMENT_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,56 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Private: what the SIMD paths need. The level in use is utxUtf8Simd().
+ */
+#ifndef __UTX_SIMD_H__
+#define __UTX_SIMD_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define UTX_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined(__GNUC__)
+    #define UTX_TARGET_SSE2 __attribute__((target("sse2")))
+    #define UTX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define UTX_TARGET_SSE2
+    #define UTX_TARGET_AVX2
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Index of the lowest set bit; `x` is not zero. */
+static __inline uint32_t utxCtz(uint32_t x) {
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (uint32_t)index;
+#else
+    uint32_t n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n += 1;
+    }
+    return n;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_SIMD_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,573 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Background spell checking.
+ *
+ * A UtxSpell watches one UtxFile and keeps the misspelled words in it as a
+ * sorted set of spans. Every edit drops the spans it touches, moves those
+ * after it, and marks the edited range dirty; nothing is checked then.
+ *
+ * utxSpellCheck hands the dirty ranges and a snapshot of the text to a worker
+ * thread running at low priority. The worker widens each range to the words
+ * it touches and looks them up a slice at a time, so a check of the whole
+ * text can be cancelled between slices. utxSpellUpdate, called from the
+ * owner's thread, e.g. on a timer, takes the results in: edits made while
+ * the worker ran are replayed over them first, so they land where the words
+ * are now, and whatever those edits touched is left dirty for the next round.
+ *
+ * Words come from the tokenizer. A run of Urdu letters is spelled right if
+ * it is a known word, or known words written without the space between them
+ * that Urdu leaves out after a letter that does not join, or with a ZWNJ.
+ * Latin words and numbers are not checked.
+ */
+#include "spell.h"
+#include "buffer.h"
+#include "dict.h"
+#include "token.h"
+#include <core/heap.h>
+#include <osbs/bmutex.h>
+#include <osbs/bthread.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#elif defined(__APPLE__)
+    #include <pthread.h>
+    #include <sys/qos.h>
+#elif defined(__linux__)
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+#define SLICE_SIZE 65536
+
+/*----------------------------------------------------------------------------*/
+typedef struct _range_t Range;
+struct _range_t {
+    uint32_t start;
+    uint32_t end;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _ranges_t Ranges;
+struct _ranges_t {
+    Range *items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _edit_t Edit;
+struct _edit_t {
+    uint32_t offset;
+    uint32_t removed;
+    uint32_t inserted;
+};
+
+/*----------------------------------------------------------------------------*/
+/* What the worker owns; only `cancel` and `done` are shared, under the mutex. */
+typedef struct _job_t Job;
+struct _job_t {
+    const UtxDict *dict;
+    UtxSnapshot *snapshot;
+    Mutex *mutex;
+    Ranges dirty;
+    Ranges checked;
+    Ranges found;
+    char_t *window;
+    bool_t cancel;
+    bool_t done;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_spell_t {
+    const UtxDict *dict;
+    UtxFile *utx;
+    Ranges spans;
+    Ranges dirty;
+    Edit *edits;
+    uint32_t nedits;
+    uint32_t cedits;
+    Job *job;
+    Thread *thread;
+    Mutex *mutex;
+};
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(Ranges *ranges, uint32_t count) {
+    if (count <= ranges->capacity) {
+        return;
+    }
+
+    uint32_t capacity = ranges->capacity > 0 ? ranges->capacity * 2 : 16;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    if (ranges->items == NULL) {
+        ranges->items = (Range*)heap_malloc(capacity * (uint32_t)sizeof(Range), "UtxSpellRanges");
+    } else {
+        ranges->items = (Range*)heap_realloc((byte_t*)ranges->items, ranges->capacity * (uint32_t)sizeof(Range), capacity * (uint32_t)sizeof(Range), "UtxSpellRanges");
+    }
+    ranges->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_free(Ranges *ranges) {
+    if (ranges->items != NULL) {
+        heap_free((byte_t**)&ranges->items, ranges->capacity * (uint32_t)sizeof(Range), "UtxSpellRanges");
+    }
+    ranges->count = 0;
+    ranges->capacity = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_push(Ranges *ranges, uint32_t start, uint32_t end) {
+    i_reserve(ranges, ranges->count + 1);
+    ranges->items[ranges->count].start = start;
+    ranges->items[ranges->count].end = end;
+    ranges->count += 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first range ending at or after `offset`. */
+static uint32_t i_lower(const Ranges *ranges, uint32_t offset) {
+    uint32_t lo = 0, hi = ranges->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (ranges->items[mid].end < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Adds [start, end] to a set of closed ranges, joining those it meets. */
+static void i_add(Ranges *ranges, uint32_t start, uint32_t end) {
+    uint32_t i = i_lower(ranges, start);
+    uint32_t j = i;
+    while (j < ranges->count && ranges->items[j].start <= end) {
+        start = ranges->items[j].start < start ? ranges->items[j].start : start;
+        end = ranges->items[j].end > end ? ranges->items[j].end : end;
+        j += 1;
+    }
+
+    if (j == i) {
+        i_reserve(ranges, ranges->count + 1);
+        memmove(ranges->items + i + 1, ranges->items + i, (ranges->count - i) * sizeof(Range));
+        ranges->count += 1;
+    } else {
+        memmove(ranges->items + i + 1, ranges->items + j, (ranges->count - j) * sizeof(Range));
+        ranges->count -= j - i - 1;
+    }
+    ranges->items[i].start = start;
+    ranges->items[i].end = end;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Where an offset is after the edit; one inside it goes to either end. */
+static uint32_t i_map(const Edit *edit, uint32_t offset, bool_t high) {
+    if (offset < edit->offset) {
+        return offset;
+    }
+    if (offset > edit->offset + edit->removed) {
+        return offset - edit->removed + edit->inserted;
+    }
+    return high ? edit->offset + edit->inserted : edit->offset;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stretches ranges over the edit; the caller marks the edit itself. */
+static void i_edit_ranges(Ranges *ranges, const Edit *edit) {
+    for (uint32_t i = 0; i < ranges->count; ++i) {
+        ranges->items[i].start = i_map(edit, ranges->items[i].start, FALSE);
+        ranges->items[i].end = i_map(edit, ranges->items[i].end, TRUE);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Drops the spans the edit touches, even at an end: text typed against a
+ * word changes the word. */
+static void i_edit_spans(Ranges *spans, const Edit *edit) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < spans->count; ++i) {
+        Range span = spans->items[i];
+        if (span.end < edit->offset) {
+            spans->items[n++] = span;
+        } else if (span.start > edit->offset + edit->removed) {
+            span.start = span.start - edit->removed + edit->inserted;
+            span.end = span.end - edit->removed + edit->inserted;
+            spans->items[n++] = span;
+        }
+    }
+    spans->count = n;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_background(void) {
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_cancelled(Job *job) {
+    bmutex_lock(job->mutex);
+    bool_t cancel = job->cancel;
+    bmutex_unlock(job->mutex);
+    return cancel;
+}
+
+/*----------------------------------------------------------------------------*/
+/* A slice of the window: words starting up to `limit` are checked whole. */
+typedef struct _scan_t Scan;
+struct _scan_t {
+    Job *job;
+    uint32_t base;
+    uint32_t limit;
+    uint32_t stop;
+};
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_scan(Scan *scan, const UtxToken *token) {
+    uint32_t offset = scan->base + token->offset;
+    if (offset > scan->limit) {
+        scan->stop = token->offset;
+        return FALSE;
+    }
+
+    /* a run that outgrows the window is no word; it is flagged in pieces */
+    if (token->kind == TokenWord && !utxTokenSplit(scan->job->dict, scan->job->window + token->offset, token->size, NULL, NULL)) {
+        i_push(&scan->job->found, offset, offset + token->size);
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Checks the words that touch [start, end], a slice at a time. */
+static bool_t i_check(Job *job, uint32_t start, uint32_t end, uint32_t length) {
+    start = start < length ? start : length;
+    end = end < length ? end : length;
+
+    /* back to the start of the word the range begins in */
+    uint32_t back = start < MAX_WORD_SIZE ? start : MAX_WORD_SIZE;
+    uint32_t n = utxSnapshotRead(job->snapshot, start - back, job->window, back);
+    while (n > 0) {
+        uint32_t j = n - 1;
+        while (j > 0 && ((byte_t)job->window[j] & 0xC0) == 0x80) {
+            j -= 1;
+        }
+        if (utxTokenChar(job->window + j, n - j, NULL) != TokenWord) {
+            break;
+        }
+        n = j;
+    }
+    start -= back - n;
+
+    /* a word the previous range reached into is already done */
+    if (job->checked.count > 0 && job->checked.items[job->checked.count - 1].end > start) {
+        start = job->checked.items[job->checked.count - 1].end;
+        if (start > end) {
+            return TRUE;
+        }
+    }
+
+    uint32_t pos = start;
+    while (pos <= end && pos < length) {
+        if (i_cancelled(job)) {
+            return FALSE;
+        }
+
+        Scan scan;
+        scan.job = job;
+        scan.base = pos;
+        scan.limit = end - pos > SLICE_SIZE ? pos + SLICE_SIZE : end;
+        n = utxSnapshotRead(job->snapshot, pos, job->window, scan.limit - pos + MAX_WORD_SIZE);
+        scan.stop = n;
+        utxTokenize(job->window, n, NULL, (FPtr_utxToken)i_scan, &scan);
+        pos += scan.stop;
+    }
+
+    i_add(&job->checked, start, pos > end ? pos : end);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_worker(Job *job) {
+    i_background();
+    uint32_t length = utxSnapshotLength(job->snapshot);
+    for (uint32_t i = 0; i < job->dirty.count; ++i) {
+        if (!i_check(job, job->dirty.items[i].start, job->dirty.items[i].end, length)) {
+            break;
+        }
+    }
+
+    bmutex_lock(job->mutex);
+    job->done = TRUE;
+    bmutex_unlock(job->mutex);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_job_destroy(Job **job) {
+    utxSnapshotDestroy(&(*job)->snapshot);
+    i_free(&(*job)->dirty);
+    i_free(&(*job)->checked);
+    i_free(&(*job)->found);
+    heap_delete_n(&(*job)->window, SLICE_SIZE + MAX_WORD_SIZE, char_t);
+    heap_delete(job, Job);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces the spans in the checked ranges with those found there. */
+static bool_t i_merge(UtxSpell *spell, Job *job) {
+    for (uint32_t i = 0; i < spell->nedits; ++i) {
+        i_edit_ranges(&job->checked, &spell->edits[i]);
+        i_edit_spans(&job->found, &spell->edits[i]);
+    }
+
+    Ranges merged = {NULL, 0, 0};
+    const Ranges *checked = &job->checked;
+    const Ranges *found = &job->found;
+    uint32_t k = 0, f = 0;
+    uint32_t dropped = 0;
+    i_reserve(&merged, spell->spans.count + found->count);
+    for (uint32_t i = 0; i < spell->spans.count; ++i) {
+        Range span = spell->spans.items[i];
+        while (k < checked->count && checked->items[k].end <= span.start) {
+            k += 1;
+        }
+        if (k < checked->count && checked->items[k].start < span.end) {
+            dropped += 1;
+            continue;
+        }
+        while (f < found->count && found->items[f].start < span.start) {
+            merged.items[merged.count++] = found->items[f++];
+        }
+        merged.items[merged.count++] = span;
+    }
+    while (f < found->count) {
+        merged.items[merged.count++] = found->items[f++];
+    }
+
+    i_free(&spell->spans);
+    spell->spans = merged;
+    return dropped > 0 || found->count > 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_finish(UtxSpell *spell) {
+    bthread_wait(spell->thread);
+    bthread_close(&spell->thread);
+    bool_t changed = i_merge(spell, spell->job);
+    i_job_destroy(&spell->job);
+    spell->nedits = 0;
+    return changed;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stops the worker and throws its results away. */
+static void i_cancel(UtxSpell *spell) {
+    if (spell->job == NULL) {
+        return;
+    }
+
+    bmutex_lock(spell->mutex);
+    spell->job->cancel = TRUE;
+    bmutex_unlock(spell->mutex);
+    bthread_wait(spell->thread);
+    bthread_close(&spell->thread);
+    i_job_destroy(&spell->job);
+    spell->nedits = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_edited(UtxSpell *spell, const uint32_t offset, const uint32_t removed, const uint32_t inserted) {
+    utxSpellEdited(spell, offset, removed, inserted);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The dictionary is shared with the worker and must outlive the checker. */
+UtxSpell* utxSpellCreate(const UtxDict* dict) {
+    if (dict == NULL) {
+        return NULL;
+    }
+
+    UtxSpell *spell = heap_new0(UtxSpell);
+    spell->dict = dict;
+    spell->mutex = bmutex_create();
+    return spell;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Cancels a check in progress; must go before the UtxFile it watches. */
+void utxSpellDestroy(UtxSpell** spell) {
+    if (spell == NULL || *spell == NULL) {
+        return;
+    }
+
+    UtxSpell *s = *spell;
+    utxSpellWatch(s, NULL);
+    i_free(&s->spans);
+    i_free(&s->dirty);
+    if (s->edits != NULL) {
+        heap_delete_n(&s->edits, s->cedits, Edit);
+    }
+    bmutex_close(&s->mutex);
+    heap_delete(spell, UtxSpell);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Follows the edits to `utx` from now on; all of its text is dirty. NULL
+ * stops watching. */
+void utxSpellWatch(UtxSpell* spell, UtxFile* utx) {
+    if (spell == NULL) {
+        return;
+    }
+
+    i_cancel(spell);
+    if (spell->utx != NULL) {
+        utxBufferRemoveObserver(spell->utx->buffer, (FPtr_utxEdited)i_edited, spell);
+    }
+    spell->utx = utx;
+    spell->spans.count = 0;
+    spell->dirty.count = 0;
+    if (utx != NULL) {
+        utxBufferAddObserver(utx->buffer, (FPtr_utxEdited)i_edited, spell);
+        i_add(&spell->dirty, 0, utxBufferLength(utx->buffer));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Called for every edit to the watched text, from the owner's thread. */
+void utxSpellEdited(UtxSpell* spell, uint32_t offset, uint32_t removed, uint32_t inserted) {
+    if (spell == NULL) {
+        return;
+    }
+
+    Edit edit = {offset, removed, inserted};
+    i_edit_spans(&spell->spans, &edit);
+    i_edit_ranges(&spell->dirty, &edit);
+    i_add(&spell->dirty, offset, offset + inserted);
+
+    /* the worker's results are in offsets from before these */
+    if (spell->job != NULL) {
+        if (spell->nedits == spell->cedits) {
+            uint32_t capacity = spell->cedits > 0 ? spell->cedits * 2 : 64;
+            Edit *edits = heap_new_n(capacity, Edit);
+            if (spell->edits != NULL) {
+                memcpy(edits, spell->edits, spell->nedits * sizeof(Edit));
+                heap_delete_n(&spell->edits, spell->cedits, Edit);
+            }
+            spell->edits = edits;
+            spell->cedits = capacity;
+        }
+        spell->edits[spell->nedits++] = edit;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts checking the dirty ranges on the worker; FALSE if there are none or
+ * a check is still running. */
+bool_t utxSpellCheck(UtxSpell* spell) {
+    if (spell == NULL || spell->utx == NULL || spell->job != NULL || spell->dirty.count == 0) {
+        return FALSE;
+    }
+
+    Job *job = heap_new0(Job);
+    job->dict = spell->dict;
+    job->snapshot = utxBufferSnapshot(spell->utx->buffer);
+    job->mutex = spell->mutex;
+    job->dirty = spell->dirty;
+    job->window = heap_new_n(SLICE_SIZE + MAX_WORD_SIZE, char_t);
+    spell->dirty.items = NULL;
+    spell->dirty.count = 0;
+    spell->dirty.capacity = 0;
+    spell->nedits = 0;
+    spell->job = job;
+    spell->thread = bthread_create(i_worker, job, Job);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Takes in the results of a finished check; TRUE if the spans changed. */
+bool_t utxSpellUpdate(UtxSpell* spell) {
+    if (spell == NULL || spell->job == NULL) {
+        return FALSE;
+    }
+
+    bmutex_lock(spell->mutex);
+    bool_t done = spell->job->done;
+    bmutex_unlock(spell->mutex);
+    return done ? i_finish(spell) : FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Like utxSpellUpdate, but blocks until the check in progress completes. */
+bool_t utxSpellWait(UtxSpell* spell) {
+    if (spell == NULL || spell->job == NULL) {
+        return FALSE;
+    }
+    return i_finish(spell);
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxSpellBusy(const UtxSpell* spell) {
+    return spell != NULL && spell->job != NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The number of ranges edited since the last check started. */
+uint32_t utxSpellDirty(const UtxSpell* spell) {
+    return spell != NULL ? spell->dirty.count : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxSpellCount(const UtxSpell* spell) {
+    return spell != NULL ? spell->spans.count : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Fills `spans` with (offset, size) pairs of the misspelled words that overlap
+ * [from, to), at most `max` of them; returns how many. */
+uint32_t utxSpellQuery(const UtxSpell* spell, uint32_t from, uint32_t to, uint32_t *spans, uint32_t max) {
+    if (spell == NULL || spans == NULL) {
+        return 0;
+    }
+
+    uint32_t n = 0;
+    uint32_t i = i_lower(&spell->spans, from + 1);
+    while (i < spell->spans.count && spell->spans.items[i].start < to && n < max) {
+        spans[2 * n] = spell->spans.items[i].start;
+        spans[2 * n + 1] = spell->spans.items[i].end - spell->spans.items[i].start;
+        n += 1;
+        i += 1;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Checks one word the way the worker does. */
+bool_t utxSpellWord(const UtxDict* dict, const char_t *word, uint32_t size) {
+    if (dict == NULL || word == NULL) {
+        return FALSE;
+    }
+    return utxTokenSplit(dict, word, size, NULL, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
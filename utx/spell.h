@@ -0,0 +1,40 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_SPELL_H__
+#define __UTX_SPELL_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxSpell* utxSpellCreate(const UtxDict* dict);
+_utx_api void utxSpellDestroy(UtxSpell** spell);
+_utx_api void utxSpellWatch(UtxSpell* spell, UtxFile* utx);
+_utx_api void utxSpellEdited(UtxSpell* spell, uint32_t offset, uint32_t removed, uint32_t inserted);
+
+_utx_api bool_t utxSpellCheck(UtxSpell* spell);
+_utx_api bool_t utxSpellUpdate(UtxSpell* spell);
+_utx_api bool_t utxSpellWait(UtxSpell* spell);
+_utx_api bool_t utxSpellBusy(const UtxSpell* spell);
+_utx_api uint32_t utxSpellDirty(const UtxSpell* spell);
+
+_utx_api uint32_t utxSpellCount(const UtxSpell* spell);
+_utx_api uint32_t utxSpellQuery(const UtxSpell* spell, uint32_t from, uint32_t to, uint32_t *spans, uint32_t max);
+_utx_api bool_t utxSpellWord(const UtxDict* dict, const char_t *word, uint32_t size);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_SPELL_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,819 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Tokenizer.
+ *
+ * Text is split into tokens: Urdu words, Latin words, numbers and single
+ * punctuation marks, each an offset and a size into the text, which is never
+ * copied. Spaces separate tokens and are not tokens themselves.
+ *
+ * An Urdu word is a run of Arabic script letters with their harakat, tatweel
+ * and joiners. Spacing in Urdu is irregular: after a letter that does not
+ * join the next one (ا د ر و ے ...) the space is often left out, as the words
+ * look apart anyway, or a ZWNJ stands in for it. Given a dictionary, a run it
+ * does not know is split at those points into the fewest words it does know;
+ * without one, or when no split works, the run is a single token.
+ *
+ * A UtxTokens keeps the tokens of a UtxFile per paragraph, with offsets from
+ * the paragraph start, so an edit invalidates only the paragraphs it touches
+ * and moving the rest costs nothing. Invalid paragraphs are tokenized when
+ * asked for. utxTokensUpdate does all of them at once: the text is cut into
+ * parts at paragraph breaks, and the parts are handed out to a thread per
+ * core, each filling its own paragraphs from a snapshot.
+ */
+#include "token.h"
+#include "buffer.h"
+#include "dict.h"
+#include <core/heap.h>
+#include <osbs/bmutex.h>
+#include <osbs/bthread.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+/*----------------------------------------------------------------------------*/
+#define ZWNJ 0x200C
+#define ZWJ 0x200D
+#define PART_SIZE 262144
+#define MAX_SEGMENTS (MAX_WORD_SIZE / 2 + 2)
+
+/*----------------------------------------------------------------------------*/
+/* A point a word may split at: where the key, and the text before and after
+ * it, are cut. */
+typedef struct _cut_t Cut;
+struct _cut_t {
+    uint32_t key;
+    uint32_t end;
+    uint32_t start;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _paragraph_t Paragraph;
+struct _paragraph_t {
+    UtxToken *tokens;
+    uint32_t count;
+    uint32_t words;
+    bool_t valid;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Paragraphs from `line` on, between two paragraph breaks. */
+typedef struct _part_t Part;
+struct _part_t {
+    uint32_t line;
+    uint32_t start;
+    uint32_t end;
+    uint32_t lines;
+    uint32_t words;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _list_t List;
+struct _list_t {
+    UtxToken *items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _batch_t Batch;
+struct _batch_t {
+    const UtxDict *dict;
+    UtxSnapshot *snapshot;
+    Paragraph *paragraphs;
+    Part *parts;
+    uint32_t nparts;
+    uint32_t next;
+    Mutex *mutex;
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_tokens_t {
+    const UtxDict *dict;
+    UtxFile *utx;
+    Paragraph *paragraphs;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t words;
+    uint32_t pending;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Decodes the character at `s`; a broken one reads as U+FFFD, one byte. */
+static uint32_t i_decode(const byte_t *s, uint32_t size, uint32_t *cp) {
+    uint32_t c = s[0];
+    uint32_t k = c < 0x80 ? 0 : c >= 0xC2 && c < 0xE0 ? 1 : c >= 0xE0 && c < 0xF0 ? 2 : c >= 0xF0 && c < 0xF5 ? 3 : 4;
+    *cp = 0xFFFD;
+    if (k == 4 || k >= size) {
+        return 1;
+    }
+
+    c &= k == 0 ? 0x7F : 0x3F >> k;
+    for (uint32_t j = 1; j <= k; ++j) {
+        if ((s[j] & 0xC0) != 0x80) {
+            return 1;
+        }
+        c = (c << 6) | (s[j] & 0x3F);
+    }
+    *cp = c;
+    return k + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Harakat, tatweel and joiners: part of a word, not of its spelling. */
+static bool_t i_mark(uint32_t c) {
+    return (c >= 0x064B && c <= 0x065F) || c == 0x0640 || c == 0x0670 || c == ZWNJ || c == ZWJ;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_letter(uint32_t c) {
+    return (c >= 0x0621 && c <= 0x063A)
+        || (c >= 0x0641 && c <= 0x064A)
+        || (c >= 0x066E && c <= 0x06D3 && c != 0x0670)
+        || c == 0x06D5
+        || (c >= 0x06EE && c <= 0x06EF)
+        || (c >= 0x06FA && c <= 0x06FC)
+        || c == 0x06FF;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Letters that never join the one after them. */
+static bool_t i_nonjoining(uint32_t c) {
+    switch (c) {
+    case 0x0621: case 0x0622: case 0x0623: case 0x0624: case 0x0625:
+    case 0x0627: case 0x0629: case 0x062F: case 0x0630: case 0x0631:
+    case 0x0632: case 0x0648: case 0x0671: case 0x0688: case 0x0691:
+    case 0x0698: case 0x06C3: case 0x06D2: case 0x06D3:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static UtxTokenKind i_kind(uint32_t c) {
+    if (c < 0x80) {
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            return TokenSpace;
+        }
+        if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') {
+            return TokenLatin;
+        }
+        return c >= '0' && c <= '9' ? TokenNumber : TokenPunct;
+    }
+
+    if (i_letter(c) || i_mark(c)) {
+        return TokenWord;
+    }
+    if ((c >= 0x0660 && c <= 0x0669) || (c >= 0x06F0 && c <= 0x06F9)) {
+        return TokenNumber;
+    }
+    if (c == 0x00A0 || (c >= 0x2000 && c <= 0x200B) || c == 0x2028 || c == 0x2029 || c == 0x202F || c == 0x205F || c == 0x3000 || c == 0xFEFF) {
+        return TokenSpace;
+    }
+    if (c >= 0x00C0 && c <= 0x024F && c != 0x00D7 && c != 0x00F7) {
+        return TokenLatin;
+    }
+    return TokenPunct;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Separators that stay inside a number when a digit follows them. */
+static bool_t i_separator(uint32_t c) {
+    return c == '.' || c == ',' || c == 0x066B || c == 0x066C;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finds the known words a run of Urdu letters is made of, as (start, end)
+ * pairs in `bounds`; FALSE if it is not made of them. */
+static bool_t i_split(const UtxDict *dict, const byte_t *word, uint32_t size, uint32_t *bounds, uint32_t *count) {
+    char_t key[MAX_WORD_SIZE];
+    Cut cuts[MAX_WORD_SIZE + 2];
+    byte_t best[MAX_WORD_SIZE + 2];
+    uint16_t from[MAX_WORD_SIZE + 2];
+    uint32_t ncuts = 1;
+    uint32_t n = 0;
+    uint32_t i = 0;
+
+    *count = 0;
+    if (size > MAX_WORD_SIZE) {
+        return FALSE;
+    }
+
+    cuts[0].key = 0;
+    cuts[0].end = 0;
+    cuts[0].start = 0;
+    while (i < size) {
+        uint32_t c;
+        uint32_t len = i_decode(word + i, size - i, &c);
+        Cut *last = &cuts[ncuts - 1];
+        if (c == ZWNJ) {
+            if (n > last->key) {
+                cuts[ncuts].key = n;
+                cuts[ncuts].end = i;
+                cuts[ncuts].start = i + len;
+                ncuts += 1;
+            } else {
+                last->start = i + len;
+            }
+        } else if (i_mark(c)) {
+            /* the marks after a letter stay with it */
+            if (n == last->key && ncuts > 1) {
+                if (last->end == last->start) {
+                    last->end = i + len;
+                }
+                last->start = i + len;
+            }
+        } else {
+            memcpy(key + n, word + i, len);
+            n += len;
+            if (i_nonjoining(c)) {
+                cuts[ncuts].key = n;
+                cuts[ncuts].end = i + len;
+                cuts[ncuts].start = i + len;
+                ncuts += 1;
+            }
+        }
+        i += len;
+    }
+
+    if (n == 0) {
+        return TRUE;
+    }
+    if (utxDictContains(dict, key, n)) {
+        bounds[0] = 0;
+        bounds[1] = size;
+        *count = 1;
+        return TRUE;
+    }
+
+    if (cuts[ncuts - 1].key < n) {
+        cuts[ncuts].key = n;
+        cuts[ncuts].end = size;
+        cuts[ncuts].start = size;
+        ncuts += 1;
+    }
+
+    /* best[j]: the fewest known words the key up to cut j splits into */
+    uint32_t m = ncuts - 1;
+    best[0] = 0;
+    for (uint32_t j = 1; j <= m; ++j) {
+        best[j] = 0xFF;
+        for (uint32_t k = 0; k < j; ++k) {
+            if (best[k] + 1 < best[j] && (k > 0 || j < m) && utxDictContains(dict, key + cuts[k].key, cuts[j].key - cuts[k].key)) {
+                best[j] = (byte_t)(best[k] + 1);
+                from[j] = (uint16_t)k;
+            }
+        }
+    }
+    if (best[m] == 0xFF) {
+        return FALSE;
+    }
+
+    uint32_t j = m;
+    for (uint32_t s = best[m]; s-- > 0;) {
+        uint32_t k = from[j];
+        bounds[2 * s] = k == 0 ? 0 : cuts[k].start;
+        bounds[2 * s + 1] = j == m ? size : cuts[j].end;
+        j = k;
+    }
+    *count = best[m];
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_emit(FPtr_utxToken func, void *data, uint32_t offset, uint32_t size, UtxTokenKind kind, uint32_t *count) {
+    *count += 1;
+    if (func == NULL) {
+        return TRUE;
+    }
+
+    UtxToken token;
+    token.offset = offset;
+    token.size = size;
+    token.kind = kind;
+    return func(data, &token);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The kind of the character at `text`, and its size in `length`. */
+UtxTokenKind utxTokenChar(const char_t *text, uint32_t size, uint32_t *length) {
+    uint32_t c = 0;
+    uint32_t len = text != NULL && size > 0 ? i_decode((const byte_t*)text, size, &c) : 0;
+    if (length != NULL) {
+        *length = len;
+    }
+    return len > 0 ? i_kind(c) : TokenSpace;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Calls `func` for each token, with offsets into `text`, until it returns
+ * FALSE; returns the number of tokens. `dict` may be NULL. */
+uint32_t utxTokenize(const char_t *text, uint32_t size, const UtxDict* dict, FPtr_utxToken func, void *data) {
+    const byte_t *s = (const byte_t*)text;
+    uint32_t count = 0;
+    uint32_t i = 0;
+    if (text == NULL) {
+        return 0;
+    }
+
+    while (i < size) {
+        uint32_t c = s[i];
+        uint32_t len = c < 0x80 ? 1 : i_decode(s + i, size - i, &c);
+        UtxTokenKind kind = i_kind(c);
+        uint32_t start = i;
+        i += len;
+        if (kind == TokenSpace) {
+            continue;
+        }
+
+        if (kind == TokenWord) {
+            bool_t letters = i_letter(c);
+            while (i < size) {
+                len = i_decode(s + i, size - i, &c);
+                if (i_kind(c) != TokenWord) {
+                    break;
+                }
+                letters = letters || i_letter(c);
+                i += len;
+            }
+
+            /* stray marks with no letter to carry them */
+            if (!letters) {
+                kind = TokenPunct;
+            }
+
+            uint32_t bounds[2 * MAX_SEGMENTS];
+            uint32_t n = 0;
+            if (letters && dict != NULL && i_split(dict, s + start, i - start, bounds, &n) && n > 1) {
+                for (uint32_t k = 0; k < n; ++k) {
+                    if (!i_emit(func, data, start + bounds[2 * k], bounds[2 * k + 1] - bounds[2 * k], TokenWord, &count)) {
+                        return count;
+                    }
+                }
+                continue;
+            }
+        } else if (kind == TokenLatin) {
+            while (i < size) {
+                len = i_decode(s + i, size - i, &c);
+                if (i_kind(c) != TokenLatin && !(c >= '0' && c <= '9')) {
+                    break;
+                }
+                i += len;
+            }
+        } else if (kind == TokenNumber) {
+            while (i < size) {
+                len = i_decode(s + i, size - i, &c);
+                if (i_kind(c) != TokenNumber) {
+                    uint32_t d = 0;
+                    if (!i_separator(c) || i + len >= size) {
+                        break;
+                    }
+                    i_decode(s + i + len, size - i - len, &d);
+                    if (i_kind(d) != TokenNumber) {
+                        break;
+                    }
+                }
+                i += len;
+            }
+        }
+
+        if (!i_emit(func, data, start, i - start, kind, &count)) {
+            return count;
+        }
+    }
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Splits a run of Urdu letters into the known words it is made of, calling
+ * `func` for each; FALSE, and no calls, if it is not made of them. */
+bool_t utxTokenSplit(const UtxDict* dict, const char_t *word, uint32_t size, FPtr_utxToken func, void *data) {
+    uint32_t bounds[2 * MAX_SEGMENTS];
+    uint32_t n = 0;
+    uint32_t count = 0;
+    if (dict == NULL || word == NULL || !i_split(dict, (const byte_t*)word, size, bounds, &n)) {
+        return FALSE;
+    }
+
+    for (uint32_t k = 0; k < n; ++k) {
+        if (!i_emit(func, data, bounds[2 * k], bounds[2 * k + 1] - bounds[2 * k], TokenWord, &count)) {
+            break;
+        }
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_collect(List *list, const UtxToken *token) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity > 0 ? list->capacity * 2 : 256;
+        UtxToken *items = heap_new_n(capacity, UtxToken);
+        if (list->items != NULL) {
+            memcpy(items, list->items, list->count * sizeof(UtxToken));
+            heap_delete_n(&list->items, list->capacity, UtxToken);
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *token;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_paragraph_clear(Paragraph *paragraph) {
+    if (paragraph->tokens != NULL) {
+        heap_delete_n(&paragraph->tokens, paragraph->count, UtxToken);
+    }
+    paragraph->count = 0;
+    paragraph->words = 0;
+    paragraph->valid = FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_paragraph_set(Paragraph *paragraph, const List *list) {
+    paragraph->tokens = list->count > 0 ? heap_new_n(list->count, UtxToken) : NULL;
+    paragraph->count = list->count;
+    paragraph->words = 0;
+    paragraph->valid = TRUE;
+    for (uint32_t i = 0; i < list->count; ++i) {
+        paragraph->tokens[i] = list->items[i];
+        paragraph->words += list->items[i].kind != TokenPunct ? 1 : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_part(Batch *batch, Part *part, char_t **text, uint32_t *capacity, List *list) {
+    uint32_t size = part->end - part->start;
+    if (*text == NULL || size > *capacity) {
+        if (*text != NULL) {
+            heap_delete_n(text, *capacity, char_t);
+        }
+        *capacity = size > 4096 ? size : 4096;
+        *text = heap_new_n(*capacity, char_t);
+    }
+
+    utxSnapshotRead(batch->snapshot, part->start, *text, size);
+    uint32_t line = part->line;
+    uint32_t pos = 0;
+    for (;;) {
+        const char_t *br = size > pos ? (const char_t*)memchr(*text + pos, '\n', size - pos) : NULL;
+        uint32_t end = br != NULL ? (uint32_t)(br - *text) : size;
+        Paragraph *paragraph = &batch->paragraphs[line];
+        list->count = 0;
+        utxTokenize(*text + pos, end - pos, batch->dict, (FPtr_utxToken)i_collect, list);
+        i_paragraph_set(paragraph, list);
+        part->lines += 1;
+        part->words += paragraph->words;
+        if (br == NULL) {
+            break;
+        }
+        pos = end + 1;
+        line += 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_worker(Batch *batch) {
+    char_t *text = NULL;
+    uint32_t capacity = 0;
+    List list = { NULL, 0, 0 };
+    for (;;) {
+        bmutex_lock(batch->mutex);
+        uint32_t next = batch->next++;
+        bmutex_unlock(batch->mutex);
+        if (next >= batch->nparts) {
+            break;
+        }
+        i_part(batch, &batch->parts[next], &text, &capacity, &list);
+    }
+
+    if (text != NULL) {
+        heap_delete_n(&text, capacity, char_t);
+    }
+    if (list.items != NULL) {
+        heap_delete_n(&list.items, list.capacity, UtxToken);
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_cores(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* The first line feed in [from, to), or `to`. */
+static uint32_t i_break(const UtxBuffer *buffer, uint32_t from, uint32_t to) {
+    while (from < to) {
+        uint32_t n = 0;
+        const char_t *chunk = utxBufferChunk(buffer, from, &n);
+        if (chunk == NULL || n == 0) {
+            break;
+        }
+        n = n < to - from ? n : to - from;
+        const char_t *br = (const char_t*)memchr(chunk, '\n', n);
+        if (br != NULL) {
+            return from + (uint32_t)(br - chunk);
+        }
+        from += n;
+    }
+    return to;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_part_add(Part **parts, uint32_t *count, uint32_t *capacity, uint32_t line, uint32_t start, uint32_t end) {
+    if (*count == *capacity) {
+        uint32_t grown = *capacity > 0 ? *capacity * 2 : 16;
+        Part *items = heap_new_n(grown, Part);
+        if (*parts != NULL) {
+            memcpy(items, *parts, *count * sizeof(Part));
+            heap_delete_n(parts, *capacity, Part);
+        }
+        *parts = items;
+        *capacity = grown;
+    }
+
+    Part *part = &(*parts)[*count];
+    part->line = line;
+    part->start = start;
+    part->end = end;
+    part->lines = 0;
+    part->words = 0;
+    *count += 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Tokenizes the invalid paragraphs among lines [first, last]. */
+static void i_update(UtxTokens *tokens, uint32_t first, uint32_t last, uint32_t threads) {
+    const UtxBuffer *buffer = tokens->utx->buffer;
+    uint32_t length = utxBufferLength(buffer);
+    uint32_t nthreads = threads > 0 ? threads : i_cores();
+    Part *parts = NULL;
+    uint32_t nparts = 0, cparts = 0;
+
+    /* a part per run of invalid paragraphs; long runs are cut at breaks */
+    uint32_t line = first;
+    while (line <= last) {
+        if (tokens->paragraphs[line].valid) {
+            line += 1;
+            continue;
+        }
+
+        uint32_t end = line;
+        while (end < last && !tokens->paragraphs[end + 1].valid) {
+            end += 1;
+        }
+        uint32_t pos = utxBufferLineStart(buffer, line);
+        uint32_t stop = end + 1 < tokens->count ? utxBufferLineStart(buffer, end + 1) - 1 : length;
+        uint32_t at = line;
+        while (nthreads > 1 && stop - pos > PART_SIZE) {
+            uint32_t br = i_break(buffer, pos + PART_SIZE, stop);
+            if (br == stop) {
+                break;
+            }
+            i_part_add(&parts, &nparts, &cparts, at, pos, br);
+            pos = br + 1;
+            at = utxBufferLineOf(buffer, pos);
+        }
+        i_part_add(&parts, &nparts, &cparts, at, pos, stop);
+        line = end + 1;
+    }
+
+    if (nparts == 0) {
+        return;
+    }
+
+    Batch batch;
+    batch.dict = tokens->dict;
+    batch.snapshot = utxBufferSnapshot(buffer);
+    batch.paragraphs = tokens->paragraphs;
+    batch.parts = parts;
+    batch.nparts = nparts;
+    batch.next = 0;
+    batch.mutex = bmutex_create();
+
+    /* the calling thread takes parts too */
+    nthreads = nthreads < nparts ? nthreads : nparts;
+    Thread **workers = nthreads > 1 ? heap_new_n(nthreads - 1, Thread*) : NULL;
+    for (uint32_t i = 0; i + 1 < nthreads; ++i) {
+        workers[i] = bthread_create(i_worker, &batch, Batch);
+    }
+    i_worker(&batch);
+    for (uint32_t i = 0; i + 1 < nthreads; ++i) {
+        bthread_wait(workers[i]);
+        bthread_close(&workers[i]);
+    }
+
+    for (uint32_t i = 0; i < nparts; ++i) {
+        tokens->words += parts[i].words;
+        tokens->pending -= parts[i].lines;
+    }
+
+    if (workers != NULL) {
+        heap_delete_n(&workers, nthreads - 1, Thread*);
+    }
+    bmutex_close(&batch.mutex);
+    utxSnapshotDestroy(&batch.snapshot);
+    heap_delete_n(&parts, cparts, Part);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_reserve(UtxTokens *tokens, uint32_t count) {
+    if (count <= tokens->capacity) {
+        return;
+    }
+
+    uint32_t capacity = tokens->capacity > 0 ? tokens->capacity * 2 : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    Paragraph *paragraphs = heap_new_n(capacity, Paragraph);
+    if (tokens->paragraphs != NULL) {
+        memcpy(paragraphs, tokens->paragraphs, tokens->count * sizeof(Paragraph));
+        heap_delete_n(&tokens->paragraphs, tokens->capacity, Paragraph);
+    }
+    tokens->paragraphs = paragraphs;
+    tokens->capacity = capacity;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_drop(UtxTokens *tokens, Paragraph *paragraph) {
+    if (paragraph->valid) {
+        tokens->words -= paragraph->words;
+    } else {
+        tokens->pending -= 1;
+    }
+    i_paragraph_clear(paragraph);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces the paragraphs the edit touched with invalid ones. */
+static void i_edited(UtxTokens *tokens, const uint32_t offset, const uint32_t removed, const uint32_t inserted) {
+    const UtxBuffer *buffer = tokens->utx->buffer;
+    uint32_t lines = utxBufferLines(buffer);
+    uint32_t first = utxBufferLineOf(buffer, offset);
+    uint32_t last = utxBufferLineOf(buffer, offset + inserted);
+    /* as many breaks were removed as the line count went down, plus added */
+    uint32_t old = last + tokens->count - lines;
+    unref(removed);
+
+    for (uint32_t i = first; i <= old; ++i) {
+        i_drop(tokens, &tokens->paragraphs[i]);
+    }
+
+    i_reserve(tokens, lines);
+    memmove(tokens->paragraphs + last + 1, tokens->paragraphs + old + 1, (tokens->count - old - 1) * sizeof(Paragraph));
+    memset(tokens->paragraphs + first, 0, (last - first + 1) * sizeof(Paragraph));
+    tokens->pending += last - first + 1;
+    tokens->count = lines;
+}
+
+/*----------------------------------------------------------------------------*/
+/* `dict` may be NULL, and then words are never split. */
+UtxTokens* utxTokensCreate(const UtxDict* dict) {
+    UtxTokens *tokens = heap_new0(UtxTokens);
+    tokens->dict = dict;
+    return tokens;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxTokensDestroy(UtxTokens** tokens) {
+    if (tokens == NULL || *tokens == NULL) {
+        return;
+    }
+
+    utxTokensWatch(*tokens, NULL);
+    if ((*tokens)->paragraphs != NULL) {
+        heap_delete_n(&(*tokens)->paragraphs, (*tokens)->capacity, Paragraph);
+    }
+    heap_delete(tokens, UtxTokens);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Follows the edits to `utx` from now on, with every paragraph invalid; NULL
+ * stops watching. */
+void utxTokensWatch(UtxTokens* tokens, UtxFile* utx) {
+    if (tokens == NULL) {
+        return;
+    }
+
+    if (tokens->utx != NULL) {
+        utxBufferRemoveObserver(tokens->utx->buffer, (FPtr_utxEdited)i_edited, tokens);
+    }
+    for (uint32_t i = 0; i < tokens->count; ++i) {
+        i_paragraph_clear(&tokens->paragraphs[i]);
+    }
+    tokens->utx = utx;
+    tokens->count = 0;
+    tokens->words = 0;
+    tokens->pending = 0;
+
+    if (utx != NULL) {
+        uint32_t lines = utxBufferLines(utx->buffer);
+        utxBufferAddObserver(utx->buffer, (FPtr_utxEdited)i_edited, tokens);
+        i_reserve(tokens, lines);
+        memset(tokens->paragraphs, 0, lines * sizeof(Paragraph));
+        tokens->count = lines;
+        tokens->pending = lines;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Tokenizes every invalid paragraph on up to `threads` threads, 0 for one
+ * per core. */
+void utxTokensUpdate(UtxTokens* tokens, uint32_t threads) {
+    if (tokens != NULL && tokens->utx != NULL && tokens->pending > 0) {
+        i_update(tokens, 0, tokens->count - 1, threads);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The number of paragraphs waiting to be tokenized. */
+uint32_t utxTokensPending(const UtxTokens* tokens) {
+    return tokens != NULL ? tokens->pending : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Urdu words, Latin words and numbers in the whole text. */
+uint32_t utxTokensWords(UtxTokens* tokens) {
+    utxTokensUpdate(tokens, 0);
+    return tokens != NULL ? tokens->words : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies out the tokens of a line, at most `max`, with offsets into the
+ * text; returns how many. */
+uint32_t utxTokensLine(UtxTokens* tokens, uint32_t line, UtxToken *out, uint32_t max) {
+    if (tokens == NULL || tokens->utx == NULL || out == NULL || line >= tokens->count) {
+        return 0;
+    }
+
+    Paragraph *paragraph = &tokens->paragraphs[line];
+    if (!paragraph->valid) {
+        i_update(tokens, line, line, 1);
+    }
+
+    uint32_t base = utxBufferLineStart(tokens->utx->buffer, line);
+    uint32_t n = paragraph->count < max ? paragraph->count : max;
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = paragraph->tokens[i];
+        out[i].offset += base;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The token that covers `offset`, e.g. the word under the caret. */
+bool_t utxTokensAt(UtxTokens* tokens, uint32_t offset, UtxToken *token) {
+    if (tokens == NULL || tokens->utx == NULL || offset >= utxBufferLength(tokens->utx->buffer)) {
+        return FALSE;
+    }
+
+    uint32_t line = utxBufferLineOf(tokens->utx->buffer, offset);
+    Paragraph *paragraph = &tokens->paragraphs[line];
+    if (!paragraph->valid) {
+        i_update(tokens, line, line, 1);
+    }
+
+    /* the last token starting at or before the offset */
+    uint32_t base = utxBufferLineStart(tokens->utx->buffer, line);
+    uint32_t lo = 0, hi = paragraph->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (base + paragraph->tokens[mid].offset <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0 || base + paragraph->tokens[lo - 1].offset + paragraph->tokens[lo - 1].size <= offset) {
+        return FALSE;
+    }
+
+    if (token != NULL) {
+        *token = paragraph->tokens[lo - 1];
+        token->offset += base;
+    }
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
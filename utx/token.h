@@ -0,0 +1,38 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_TOKEN_H__
+#define __UTX_TOKEN_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api UtxTokenKind utxTokenChar(const char_t *text, uint32_t size, uint32_t *length);
+_utx_api uint32_t utxTokenize(const char_t *text, uint32_t size, const UtxDict* dict, FPtr_utxToken func, void *data);
+_utx_api bool_t utxTokenSplit(const UtxDict* dict, const char_t *word, uint32_t size, FPtr_utxToken func, void *data);
+
+_utx_api UtxTokens* utxTokensCreate(const UtxDict* dict);
+_utx_api void utxTokensDestroy(UtxTokens** tokens);
+_utx_api void utxTokensWatch(UtxTokens* tokens, UtxFile* utx);
+_utx_api void utxTokensUpdate(UtxTokens* tokens, uint32_t threads);
+_utx_api uint32_t utxTokensPending(const UtxTokens* tokens);
+_utx_api uint32_t utxTokensWords(UtxTokens* tokens);
+_utx_api uint32_t utxTokensLine(UtxTokens* tokens, uint32_t line, UtxToken *out, uint32_t max);
+_utx_api bool_t utxTokensAt(UtxTokens* tokens, uint32_t offset, UtxToken *token);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_TOKEN_H__ */
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,311 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Trace events, in a ring per thread.
+ *
+ * An event is a fixed 32 bytes: time, name pointer, value and kind. Each
+ * thread writes only to its own ring, found through a thread local, so
+ * recording takes no lock: the event goes into its slot and then the count
+ * of events written is published with a release store. The lock is taken
+ * once per thread, to add its ring to the list, and by readers.
+ *
+ * A full ring overwrites its oldest events. A reader copies what it sees
+ * between two reads of the count and keeps only the slots the writer could
+ * not have reached in between.
+ *
+ * utxTraceWrite exports the Chrome trace event format (JSON), which
+ * chrome://tracing and Perfetto open: B and E for spans, C for counters,
+ * with the thread id of the thread that recorded them.
+ */
+#include "trace.h"
+#include "buffer.h"
+#include "saver.h"
+#include <core/heap.h>
+#include <osbs/bmutex.h>
+#include <osbs/bthread.h>
+#include <osbs/btime.h>
+#include <stdio.h>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define TRACE_THREAD __declspec(thread)
+#else
+    #define TRACE_THREAD __thread
+#endif
+
+/*----------------------------------------------------------------------------*/
+#define TRACE_RING_EVENTS 16384
+
+/*----------------------------------------------------------------------------*/
+typedef struct _trace_event_t TraceEvent;
+struct _trace_event_t {
+    uint64_t time;
+    const char_t *name;
+    int64_t value;
+    uint32_t kind;
+    uint32_t thread;
+};
+
+typedef struct _trace_ring_t TraceRing;
+struct _trace_ring_t {
+    TraceEvent events[TRACE_RING_EVENTS];
+    /* written by the owner thread only; read by anyone */
+    volatile uint64_t head;
+    /* where readers start; moved by utxTraceClear */
+    uint64_t tail;
+    uint32_t thread;
+    TraceRing *next;
+};
+
+/*----------------------------------------------------------------------------*/
+static Mutex *i_MUTEX = NULL;
+static TraceRing *i_RINGS = NULL;
+static uint32_t i_GENERATION = 0;
+
+/* rings from before utxTraceFinish are gone; the generation tells */
+static TRACE_THREAD TraceRing *i_RING = NULL;
+static TRACE_THREAD uint32_t i_RING_GENERATION = 0;
+
+/*----------------------------------------------------------------------------*/
+static __inline void i_publish(volatile uint64_t *head, uint64_t value) {
+#if defined(__GNUC__)
+    __atomic_store_n(head, value, __ATOMIC_RELEASE);
+#elif defined(_MSC_VER)
+    _InterlockedExchange64((volatile __int64*)head, (__int64)value);
+#else
+    *head = value;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+static __inline uint64_t i_observe(volatile uint64_t *head) {
+#if defined(__GNUC__)
+    return __atomic_load_n(head, __ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER)
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)head, 0, 0);
+#else
+    return *head;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+void utxTraceStart(void) {
+    if (i_MUTEX == NULL) {
+        i_MUTEX = bmutex_create();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Frees every ring. No thread may be recording by now. */
+void utxTraceFinish(void) {
+    if (i_MUTEX == NULL) {
+        return;
+    }
+
+    bmutex_lock(i_MUTEX);
+    while (i_RINGS != NULL) {
+        TraceRing *next = i_RINGS->next;
+        heap_delete(&i_RINGS, TraceRing);
+        i_RINGS = next;
+    }
+    i_GENERATION += 1;
+    bmutex_unlock(i_MUTEX);
+    bmutex_close(&i_MUTEX);
+}
+
+/*----------------------------------------------------------------------------*/
+static TraceRing *i_ring(void) {
+    if (i_RING != NULL && i_RING_GENERATION == i_GENERATION) {
+        return i_RING;
+    }
+
+    TraceRing *ring = heap_new0(TraceRing);
+    ring->thread = bthread_current_id();
+    bmutex_lock(i_MUTEX);
+    ring->next = i_RINGS;
+    i_RINGS = ring;
+    i_RING_GENERATION = i_GENERATION;
+    bmutex_unlock(i_MUTEX);
+    i_RING = ring;
+    return ring;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Through the UTX_TRACE_ macros. Dropped before utx_start. */
+void utxTraceEvent(UtxTraceKind kind, const char_t *name, int64_t value) {
+    if (i_MUTEX == NULL) {
+        return;
+    }
+
+    TraceRing *ring = i_ring();
+    uint64_t head = ring->head;
+    TraceEvent *event = &ring->events[head % TRACE_RING_EVENTS];
+    event->time = btime_now();
+    event->name = name;
+    event->value = value;
+    event->kind = (uint32_t)kind;
+    event->thread = ring->thread;
+    i_publish(&ring->head, head + 1);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies the events of a ring that are still whole; `out` has room for a
+ * full ring. */
+static uint32_t i_collect(TraceRing *ring, TraceEvent *out) {
+    uint64_t head = i_observe(&ring->head);
+    uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+    first = first > ring->tail ? first : ring->tail;
+    for (uint64_t i = first; i < head; ++i) {
+        out[i - first] = ring->events[i % TRACE_RING_EVENTS];
+    }
+
+    /* the writer may have lapped the first slots while they were copied */
+    uint64_t after = i_observe(&ring->head);
+    uint64_t safe = after >= TRACE_RING_EVENTS ? after - TRACE_RING_EVENTS + 1 : 0;
+    if (safe <= first) {
+        return (uint32_t)(head - first);
+    }
+    if (safe >= head) {
+        return 0;
+    }
+    memmove(out, out + (safe - first), (size_t)(head - safe) * sizeof(TraceEvent));
+    return (uint32_t)(head - safe);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Events held now, over all threads. */
+uint32_t utxTraceCount(void) {
+    uint32_t count = 0;
+    if (i_MUTEX == NULL) {
+        return 0;
+    }
+
+    bmutex_lock(i_MUTEX);
+    for (TraceRing *ring = i_RINGS; ring != NULL; ring = ring->next) {
+        uint64_t head = i_observe(&ring->head);
+        uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        first = first > ring->tail ? first : ring->tail;
+        count += (uint32_t)(head - first);
+    }
+    bmutex_unlock(i_MUTEX);
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Forgets the events recorded so far; the rings stay. */
+void utxTraceClear(void) {
+    if (i_MUTEX == NULL) {
+        return;
+    }
+
+    bmutex_lock(i_MUTEX);
+    for (TraceRing *ring = i_RINGS; ring != NULL; ring = ring->next) {
+        ring->tail = i_observe(&ring->head);
+    }
+    bmutex_unlock(i_MUTEX);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_append(char_t **out, uint32_t *size, uint32_t *capacity, const char_t *text, uint32_t n) {
+    if (*size + n > *capacity) {
+        uint32_t grown = *capacity > 0 ? *capacity : 65536;
+        while (grown < *size + n) {
+            grown *= 2;
+        }
+        if (*out == NULL) {
+            *out = (char_t*)heap_malloc(grown, "UtxTrace");
+        } else {
+            *out = (char_t*)heap_realloc((byte_t*)*out, *capacity, grown, "UtxTrace");
+        }
+        *capacity = grown;
+    }
+    memcpy(*out + *size, text, n);
+    *size += n;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_event_json(const TraceEvent *event, char_t *line, uint32_t size) {
+    static const char_t PHASES[] = { 'B', 'E', 'C' };
+
+    /* names are literals from the code, escaped all the same */
+    char_t name[128];
+    uint32_t n = 0;
+    for (const char_t *c = event->name; *c != '\0' && n + 2 < sizeof(name); ++c) {
+        if (*c == '"' || *c == '\\') {
+            name[n++] = '\\';
+        }
+        name[n++] = (byte_t)*c < 0x20 ? ' ' : *c;
+    }
+    name[n] = '\0';
+
+    int len = 0;
+    if (event->kind == TraceCounter) {
+        len = snprintf(line, size,
+            "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%llu,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}",
+            name, (unsigned long long)event->time, event->thread, (long long)event->value);
+    } else {
+        len = snprintf(line, size,
+            "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u}",
+            name, PHASES[event->kind], (unsigned long long)event->time, event->thread);
+    }
+    return len > 0 && (uint32_t)len < size ? (uint32_t)len : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Writes the events held now as a Chrome trace; `events`, when given,
+ * receives how many. The rings are not cleared. */
+Result utxTraceWrite(const char_t *filePath, uint32_t *events) {
+    if (events != NULL) {
+        *events = 0;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    char_t *out = NULL;
+    uint32_t size = 0, capacity = 0, count = 0;
+    i_append(&out, &size, &capacity, "{\"traceEvents\":[", 16);
+
+    if (i_MUTEX != NULL) {
+        TraceEvent *copy = heap_new_n(TRACE_RING_EVENTS, TraceEvent);
+        bmutex_lock(i_MUTEX);
+        for (TraceRing *ring = i_RINGS; ring != NULL; ring = ring->next) {
+            uint32_t n = i_collect(ring, copy);
+            for (uint32_t i = 0; i < n; ++i) {
+                char_t line[256];
+                uint32_t len = i_event_json(&copy[i], line, sizeof(line));
+                if (len > 0) {
+                    i_append(&out, &size, &capacity, count > 0 ? ",\n" : "\n", count > 0 ? 2 : 1);
+                    i_append(&out, &size, &capacity, line, len);
+                    count += 1;
+                }
+            }
+        }
+        bmutex_unlock(i_MUTEX);
+        heap_delete_n(&copy, TRACE_RING_EVENTS, TraceEvent);
+    }
+    i_append(&out, &size, &capacity, "\n]}\n", 4);
+
+    /* saving may record events of its own, so the lock is let go first */
+    UtxBuffer *buffer = utxBufferCreate();
+    utxBufferSetText(buffer, out, size);
+    heap_free((byte_t**)&out, capacity, "UtxTrace");
+    UtxSnapshot *snapshot = utxBufferSnapshot(buffer);
+    Result result = utxSaveFile(snapshot, filePath);
+    utxSnapshotDestroy(&snapshot);
+    utxBufferDestroy(&buffer);
+
+    if (events != NULL && result == ROkay) {
+        *events = count;
+    }
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,50 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Spans and counters for the Chrome trace viewer. The macros record only in
+ * a build with UTX_TRACE defined (the UTX_TRACE CMake option); otherwise
+ * they compile to nothing. `name` must be a string literal: events keep the
+ * pointer, not a copy.
+ */
+#ifndef __UTX_TRACE_H__
+#define __UTX_TRACE_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+#if defined(UTX_TRACE)
+    #define UTX_TRACE_BEGIN(name) utxTraceEvent(TraceBegin, name, 0)
+    #define UTX_TRACE_END(name) utxTraceEvent(TraceEnd, name, 0)
+    #define UTX_TRACE_COUNTER(name, value) utxTraceEvent(TraceCounter, name, (int64_t)(value))
+#else
+    #define UTX_TRACE_BEGIN(name) ((void)0)
+    #define UTX_TRACE_END(name) ((void)0)
+    #define UTX_TRACE_COUNTER(name, value) ((void)0)
+#endif
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api void utxTraceStart(void);
+_utx_api void utxTraceFinish(void);
+
+_utx_api void utxTraceEvent(UtxTraceKind kind, const char_t *name, int64_t value);
+_utx_api uint32_t utxTraceCount(void);
+_utx_api void utxTraceClear(void);
+_utx_api Result utxTraceWrite(const char_t *filePath, uint32_t *events);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_TRACE_H__ */
+/*----------------------------------------------------------------------------*/
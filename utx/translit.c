@@ -0,0 +1,526 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Roman <-> Urdu transliteration.
+ *
+ * Each direction is a table of rules, text to replace and its replacement.
+ * utx_start compiles both into an automaton over byte classes: a trie of the
+ * rules' source text, one row of transitions per node. Text is converted in
+ * a single forward pass, taking at each position the longest rule that
+ * matches there; a byte no rule starts with is copied as it is.
+ *
+ * A UtxTranslit converts a stream: it holds back the bytes that may still
+ * grow into a longer rule, never more than the longest rule, so each byte
+ * fed costs a bounded amount of work. That keeps typing live, e.g. "k" shows
+ * as ک through utxTranslitPreview until an "h" turns it into خ.
+ */
+#include "translit.h"
+#include <core/heap.h>
+
+/*----------------------------------------------------------------------------*/
+#define TRANSLIT_DEPTH 16
+#define TRANSLIT_SLOT 8
+#define DEAD 0
+#define ROOT 1
+
+/*----------------------------------------------------------------------------*/
+typedef struct _rule_t Rule;
+struct _rule_t {
+    const char_t *from;
+    const char_t *to;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef struct _table_t Table;
+struct _table_t {
+    uint32_t count;
+    uint32_t *next;
+    byte_t *lengths;
+    char_t *slots;
+    uint32_t capacity;
+    uint32_t states;
+    uint32_t classes;
+    uint32_t depth;
+    uint32_t ratio;
+    byte_t cls[256];
+};
+
+/*----------------------------------------------------------------------------*/
+struct _utx_translit_t {
+    const Table *table;
+    uint32_t state;
+    uint32_t count;
+    uint32_t matched;
+    int32_t rule;
+    byte_t pending[TRANSLIT_DEPTH];
+};
+
+/*----------------------------------------------------------------------------*/
+/* Aspirates are spelled with "h" and doachashmee heh, rarer letters with a
+ * capital or a doubled letter. */
+static const Rule ROMAN_URDU[] = {
+    { "a",                   "\xD8\xA7"             },   /* alef */
+    { "aa",                  "\xD8\xA7"             },   /* alef */
+    { "A",                   "\xD8\xA2"             },   /* alef with madda above */
+    { "b",                   "\xD8\xA8"             },   /* beh */
+    { "bh",                  "\xD8\xA8\xDA\xBE"     },   /* beh heh doachashmee */
+    { "p",                   "\xD9\xBE"             },   /* peh */
+    { "ph",                  "\xD9\xBE\xDA\xBE"     },   /* peh heh doachashmee */
+    { "t",                   "\xD8\xAA"             },   /* teh */
+    { "th",                  "\xD8\xAA\xDA\xBE"     },   /* teh heh doachashmee */
+    { "T",                   "\xD9\xB9"             },   /* tteh */
+    { "Th",                  "\xD9\xB9\xDA\xBE"     },   /* tteh heh doachashmee */
+    { "Tt",                  "\xD8\xB7"             },   /* tah */
+    { "X",                   "\xD8\xAB"             },   /* theh */
+    { "j",                   "\xD8\xAC"             },   /* jeem */
+    { "jh",                  "\xD8\xAC\xDA\xBE"     },   /* jeem heh doachashmee */
+    { "ch",                  "\xDA\x86"             },   /* tcheh */
+    { "chh",                 "\xDA\x86\xDA\xBE"     },   /* tcheh heh doachashmee */
+    { "H",                   "\xD8\xAD"             },   /* hah */
+    { "kh",                  "\xD8\xAE"             },   /* khah */
+    { "d",                   "\xD8\xAF"             },   /* dal */
+    { "dh",                  "\xD8\xAF\xDA\xBE"     },   /* dal heh doachashmee */
+    { "D",                   "\xDA\x88"             },   /* ddal */
+    { "Dh",                  "\xDA\x88\xDA\xBE"     },   /* ddal heh doachashmee */
+    { "zz",                  "\xD8\xB0"             },   /* thal */
+    { "r",                   "\xD8\xB1"             },   /* reh */
+    { "R",                   "\xDA\x91"             },   /* rreh */
+    { "Rh",                  "\xDA\x91\xDA\xBE"     },   /* rreh heh doachashmee */
+    { "z",                   "\xD8\xB2"             },   /* zain */
+    { "zh",                  "\xDA\x98"             },   /* jeh */
+    { "s",                   "\xD8\xB3"             },   /* seen */
+    { "sh",                  "\xD8\xB4"             },   /* sheen */
+    { "S",                   "\xD8\xB5"             },   /* sad */
+    { "Z",                   "\xD8\xB6"             },   /* dad */
+    { "Zz",                  "\xD8\xB8"             },   /* zah */
+    { "`",                   "\xD8\xB9"             },   /* ain */
+    { "gh",                  "\xD8\xBA"             },   /* ghain */
+    { "f",                   "\xD9\x81"             },   /* feh */
+    { "q",                   "\xD9\x82"             },   /* qaf */
+    { "k",                   "\xDA\xA9"             },   /* keheh */
+    { "Kh",                  "\xDA\xA9\xDA\xBE"     },   /* keheh heh doachashmee */
+    { "g",                   "\xDA\xAF"             },   /* gaf */
+    { "Gh",                  "\xDA\xAF\xDA\xBE"     },   /* gaf heh doachashmee */
+    { "l",                   "\xD9\x84"             },   /* lam */
+    { "m",                   "\xD9\x85"             },   /* meem */
+    { "n",                   "\xD9\x86"             },   /* noon */
+    { "N",                   "\xDA\xBA"             },   /* noon ghunna */
+    { "w",                   "\xD9\x88"             },   /* waw */
+    { "v",                   "\xD9\x88"             },   /* waw */
+    { "o",                   "\xD9\x88"             },   /* waw */
+    { "oo",                  "\xD9\x88"             },   /* waw */
+    { "u",                   "\xD9\x88"             },   /* waw */
+    { "h",                   "\xDB\x81"             },   /* heh goal */
+    { "y",                   "\xDB\x8C"             },   /* farsi yeh */
+    { "i",                   "\xDB\x8C"             },   /* farsi yeh */
+    { "ee",                  "\xDB\x8C"             },   /* farsi yeh */
+    { "e",                   "\xDB\x92"             },   /* yeh barree */
+    { "'",                   "\xD8\xA1"             },   /* hamza */
+    { "Y",                   "\xD8\xA6"             },   /* yeh with hamza above */
+    { ".",                   "\xDB\x94"             },   /* full stop */
+    { ",",                   "\xD8\x8C"             },   /* comma */
+    { "?",                   "\xD8\x9F"             },   /* question mark */
+    { ";",                   "\xD8\x9B"             },   /* semicolon */
+    { "0",                   "\xDB\xB0"             },   /* extended arabic-indic digit zero */
+    { "1",                   "\xDB\xB1"             },   /* extended arabic-indic digit one */
+    { "2",                   "\xDB\xB2"             },   /* extended arabic-indic digit two */
+    { "3",                   "\xDB\xB3"             },   /* extended arabic-indic digit three */
+    { "4",                   "\xDB\xB4"             },   /* extended arabic-indic digit four */
+    { "5",                   "\xDB\xB5"             },   /* extended arabic-indic digit five */
+    { "6",                   "\xDB\xB6"             },   /* extended arabic-indic digit six */
+    { "7",                   "\xDB\xB7"             },   /* extended arabic-indic digit seven */
+    { "8",                   "\xDB\xB8"             },   /* extended arabic-indic digit eight */
+    { "9",                   "\xDB\xB9"             },   /* extended arabic-indic digit nine */
+};
+
+static const Rule URDU_ROMAN[] = {
+    { "\xD8\xA7",            "a"                    },   /* alef */
+    { "\xD8\xA2",            "aa"                   },   /* alef with madda above */
+    { "\xD8\xA8",            "b"                    },   /* beh */
+    { "\xD8\xA8\xDA\xBE",    "bh"                   },   /* beh heh doachashmee */
+    { "\xD9\xBE",            "p"                    },   /* peh */
+    { "\xD9\xBE\xDA\xBE",    "ph"                   },   /* peh heh doachashmee */
+    { "\xD8\xAA",            "t"                    },   /* teh */
+    { "\xD8\xAA\xDA\xBE",    "th"                   },   /* teh heh doachashmee */
+    { "\xD9\xB9",            "T"                    },   /* tteh */
+    { "\xD9\xB9\xDA\xBE",    "Th"                   },   /* tteh heh doachashmee */
+    { "\xD8\xAB",            "s"                    },   /* theh */
+    { "\xD8\xAC",            "j"                    },   /* jeem */
+    { "\xD8\xAC\xDA\xBE",    "jh"                   },   /* jeem heh doachashmee */
+    { "\xDA\x86",            "ch"                   },   /* tcheh */
+    { "\xDA\x86\xDA\xBE",    "chh"                  },   /* tcheh heh doachashmee */
+    { "\xD8\xAD",            "h"                    },   /* hah */
+    { "\xD8\xAE",            "kh"                   },   /* khah */
+    { "\xD8\xAF",            "d"                    },   /* dal */
+    { "\xD8\xAF\xDA\xBE",    "dh"                   },   /* dal heh doachashmee */
+    { "\xDA\x88",            "D"                    },   /* ddal */
+    { "\xDA\x88\xDA\xBE",    "Dh"                   },   /* ddal heh doachashmee */
+    { "\xD8\xB0",            "z"                    },   /* thal */
+    { "\xD8\xB1",            "r"                    },   /* reh */
+    { "\xDA\x91",            "R"                    },   /* rreh */
+    { "\xDA\x91\xDA\xBE",    "Rh"                   },   /* rreh heh doachashmee */
+    { "\xD8\xB2",            "z"                    },   /* zain */
+    { "\xDA\x98",            "zh"                   },   /* jeh */
+    { "\xD8\xB3",            "s"                    },   /* seen */
+    { "\xD8\xB4",            "sh"                   },   /* sheen */
+    { "\xD8\xB5",            "s"                    },   /* sad */
+    { "\xD8\xB6",            "z"                    },   /* dad */
+    { "\xD8\xB7",            "t"                    },   /* tah */
+    { "\xD8\xB8",            "z"                    },   /* zah */
+    { "\xD8\xB9",            "`"                    },   /* ain */
+    { "\xD8\xBA",            "gh"                   },   /* ghain */
+    { "\xD9\x81",            "f"                    },   /* feh */
+    { "\xD9\x82",            "q"                    },   /* qaf */
+    { "\xDA\xA9",            "k"                    },   /* keheh */
+    { "\xDA\xA9\xDA\xBE",    "kh"                   },   /* keheh heh doachashmee */
+    { "\xD9\x83",            "k"                    },   /* kaf */
+    { "\xDA\xAF",            "g"                    },   /* gaf */
+    { "\xDA\xAF\xDA\xBE",    "gh"                   },   /* gaf heh doachashmee */
+    { "\xD9\x84",            "l"                    },   /* lam */
+    { "\xD9\x85",            "m"                    },   /* meem */
+    { "\xD9\x86",            "n"                    },   /* noon */
+    { "\xDA\xBA",            "n"                    },   /* noon ghunna */
+    { "\xD9\x88",            "o"                    },   /* waw */
+    { "\xD8\xA4",            "o"                    },   /* waw with hamza above */
+    { "\xDB\x81",            "h"                    },   /* heh goal */
+    { "\xDA\xBE",            "h"                    },   /* heh doachashmee */
+    { "\xD9\x87",            "h"                    },   /* heh */
+    { "\xDB\x83",            "t"                    },   /* teh marbuta goal */
+    { "\xD8\xA9",            "t"                    },   /* teh marbuta */
+    { "\xD8\xA1",            "'"                    },   /* hamza */
+    { "\xDB\x8C",            "i"                    },   /* farsi yeh */
+    { "\xD9\x8A",            "i"                    },   /* yeh */
+    { "\xD9\x89",            "i"                    },   /* alef maksura */
+    { "\xD8\xA6",            "'"                    },   /* yeh with hamza above */
+    { "\xDB\x92",            "e"                    },   /* yeh barree */
+    { "\xDB\x93",            "e"                    },   /* yeh barree with hamza above */
+    { "\xD9\x8E",            "a"                    },   /* fatha */
+    { "\xD9\x90",            "i"                    },   /* kasra */
+    { "\xD9\x8F",            "u"                    },   /* damma */
+    { "\xD9\x91",            ""                     },   /* shadda */
+    { "\xD9\x92",            ""                     },   /* sukun */
+    { "\xD9\xB0",            "a"                    },   /* superscript alef */
+    { "\xDB\x94",            "."                    },   /* full stop */
+    { "\xD8\x8C",            ","                    },   /* comma */
+    { "\xD8\x9F",            "?"                    },   /* question mark */
+    { "\xD8\x9B",            ";"                    },   /* semicolon */
+    { "\xDB\xB0",            "0"                    },   /* extended arabic-indic digit zero */
+    { "\xDB\xB1",            "1"                    },   /* extended arabic-indic digit one */
+    { "\xDB\xB2",            "2"                    },   /* extended arabic-indic digit two */
+    { "\xDB\xB3",            "3"                    },   /* extended arabic-indic digit three */
+    { "\xDB\xB4",            "4"                    },   /* extended arabic-indic digit four */
+    { "\xDB\xB5",            "5"                    },   /* extended arabic-indic digit five */
+    { "\xDB\xB6",            "6"                    },   /* extended arabic-indic digit six */
+    { "\xDB\xB7",            "7"                    },   /* extended arabic-indic digit seven */
+    { "\xDB\xB8",            "8"                    },   /* extended arabic-indic digit eight */
+    { "\xDB\xB9",            "9"                    },   /* extended arabic-indic digit nine */
+    { "\xD9\xA0",            "0"                    },   /* arabic-indic digit zero */
+    { "\xD9\xA1",            "1"                    },   /* arabic-indic digit one */
+    { "\xD9\xA2",            "2"                    },   /* arabic-indic digit two */
+    { "\xD9\xA3",            "3"                    },   /* arabic-indic digit three */
+    { "\xD9\xA4",            "4"                    },   /* arabic-indic digit four */
+    { "\xD9\xA5",            "5"                    },   /* arabic-indic digit five */
+    { "\xD9\xA6",            "6"                    },   /* arabic-indic digit six */
+    { "\xD9\xA7",            "7"                    },   /* arabic-indic digit seven */
+    { "\xD9\xA8",            "8"                    },   /* arabic-indic digit eight */
+    { "\xD9\xA9",            "9"                    },   /* arabic-indic digit nine */
+};
+
+/*----------------------------------------------------------------------------*/
+static Table i_TABLES[2];
+static bool_t i_STARTED = FALSE;
+
+/*----------------------------------------------------------------------------*/
+/* A transition holds the state it leads to in its low half and, in its high
+ * half, one more than the rule that state completes, so walking the text
+ * never looks anywhere else. */
+static uint32_t i_step(const Table *table, uint32_t state, byte_t b) {
+    return table->next[state * table->classes + table->cls[b]];
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_state(uint32_t step) {
+    return step & 0xFFFF;
+}
+
+/*----------------------------------------------------------------------------*/
+static int32_t i_rule(uint32_t step) {
+    return (int32_t)(step >> 16) - 1;
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_compile(Table *table, const Rule *rules, uint32_t count) {
+    uint32_t bytes = 0;
+    table->count = count;
+    table->classes = 1;
+    table->depth = 1;
+    table->ratio = 1;
+    memset(table->cls, 0, sizeof(table->cls));
+
+    for (uint32_t r = 0; r < count; ++r) {
+        uint32_t size = (uint32_t)strlen(rules[r].from);
+        uint32_t to = (uint32_t)strlen(rules[r].to);
+        for (uint32_t i = 0; i < size; ++i) {
+            byte_t b = (byte_t)rules[r].from[i];
+            if (table->cls[b] == 0) {
+                table->cls[b] = (byte_t)table->classes++;
+            }
+        }
+        bytes += size;
+        table->depth = size > table->depth ? size : table->depth;
+        table->ratio = (to + size - 1) / size > table->ratio ? (to + size - 1) / size : table->ratio;
+    }
+
+    /* a state per byte of rule text at most, besides the dead and root ones */
+    uint32_t capacity = bytes + 2;
+    uint32_t cells = capacity * table->classes;
+    uint32_t *accept = heap_new_n0(capacity, uint32_t);
+    table->capacity = capacity;
+    table->next = heap_new_n0(cells, uint32_t);
+    table->lengths = heap_new_n(count, byte_t);
+    table->slots = heap_new_n0(count * TRANSLIT_SLOT, char_t);
+
+    table->states = 2;
+    for (uint32_t r = 0; r < count; ++r) {
+        const byte_t *from = (const byte_t*)rules[r].from;
+        uint32_t state = ROOT;
+        for (; *from != 0; ++from) {
+            uint32_t *next = &table->next[state * table->classes + table->cls[*from]];
+            if (*next == DEAD) {
+                *next = table->states++;
+            }
+            state = *next;
+        }
+        /* the first of two rules for the same text wins */
+        if (accept[state] == 0) {
+            accept[state] = r + 1;
+        }
+        table->lengths[r] = (byte_t)strlen(rules[r].to);
+        memcpy(table->slots + r * TRANSLIT_SLOT, rules[r].to, table->lengths[r]);
+    }
+
+    for (uint32_t c = 0; c < cells; ++c) {
+        table->next[c] |= accept[table->next[c]] << 16;
+    }
+    heap_delete_n(&accept, capacity, uint32_t);
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_release(Table *table) {
+    heap_delete_n(&table->next, table->capacity * table->classes, uint32_t);
+    heap_delete_n(&table->lengths, table->count, byte_t);
+    heap_delete_n(&table->slots, table->count * TRANSLIT_SLOT, char_t);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copies a whole slot, whatever the length; utxTranslitBound leaves room. */
+static uint32_t i_emit(const Table *table, int32_t rule, char_t *out) {
+    memcpy(out, table->slots + rule * TRANSLIT_SLOT, TRANSLIT_SLOT);
+    return table->lengths[rule];
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_feed(UtxTranslit *translit, byte_t b, char_t *out);
+
+/*----------------------------------------------------------------------------*/
+/* Writes out the longest rule matched by the held bytes, or the first byte if
+ * there is none, and runs the bytes after it through again. */
+static uint32_t i_resolve(UtxTranslit *translit, char_t *out) {
+    byte_t rest[TRANSLIT_DEPTH];
+    uint32_t n = 0;
+    uint32_t used = 1;
+    if (translit->rule >= 0) {
+        n = i_emit(translit->table, translit->rule, out);
+        used = translit->matched;
+    } else {
+        out[n++] = (char_t)translit->pending[0];
+    }
+
+    uint32_t left = translit->count - used;
+    memcpy(rest, translit->pending + used, left);
+    translit->state = ROOT;
+    translit->count = 0;
+    translit->rule = -1;
+    for (uint32_t i = 0; i < left; ++i) {
+        n += i_feed(translit, rest[i], out + n);
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_feed(UtxTranslit *translit, byte_t b, char_t *out) {
+    const Table *table = translit->table;
+    uint32_t n = 0;
+    for (;;) {
+        uint32_t step = i_step(table, translit->state, b);
+        if (step != DEAD) {
+            translit->state = i_state(step);
+            translit->pending[translit->count++] = b;
+            if (i_rule(step) >= 0) {
+                translit->rule = i_rule(step);
+                translit->matched = translit->count;
+            }
+            return n;
+        }
+
+        if (translit->count == 0) {
+            out[n++] = (char_t)b;
+            return n;
+        }
+        n += i_resolve(translit, out + n);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void utxTranslitStart(void) {
+    if (i_STARTED) {
+        return;
+    }
+    i_compile(&i_TABLES[TranslitRomanToUrdu], ROMAN_URDU, sizeof(ROMAN_URDU) / sizeof(Rule));
+    i_compile(&i_TABLES[TranslitUrduToRoman], URDU_ROMAN, sizeof(URDU_ROMAN) / sizeof(Rule));
+    i_STARTED = TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxTranslitFinish(void) {
+    if (!i_STARTED) {
+        return;
+    }
+    i_release(&i_TABLES[TranslitRomanToUrdu]);
+    i_release(&i_TABLES[TranslitUrduToRoman]);
+    i_STARTED = FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* NULL until utx_start has compiled the tables. */
+UtxTranslit* utxTranslitCreate(UtxTranslitDir dir) {
+    if (!i_STARTED || (dir != TranslitRomanToUrdu && dir != TranslitUrduToRoman)) {
+        return NULL;
+    }
+
+    UtxTranslit *translit = heap_new0(UtxTranslit);
+    translit->table = &i_TABLES[dir];
+    translit->state = ROOT;
+    translit->rule = -1;
+    return translit;
+}
+
+/*----------------------------------------------------------------------------*/
+void utxTranslitDestroy(UtxTranslit** translit) {
+    if (translit == NULL || *translit == NULL) {
+        return;
+    }
+    heap_delete(translit, UtxTranslit);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Drops the held bytes, e.g. when the caret moves. */
+void utxTranslitReset(UtxTranslit* translit) {
+    if (translit != NULL) {
+        translit->state = ROOT;
+        translit->count = 0;
+        translit->rule = -1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* The most bytes converting `size` bytes can write, held bytes included. */
+uint32_t utxTranslitBound(UtxTranslitDir dir, uint32_t size) {
+    if (!i_STARTED || (dir != TranslitRomanToUrdu && dir != TranslitUrduToRoman)) {
+        return 0;
+    }
+    return (size + i_TABLES[dir].depth) * i_TABLES[dir].ratio + TRANSLIT_SLOT;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Converts what it can and holds back the rest; `out` must have room for
+ * utxTranslitBound bytes. Returns the bytes written. */
+uint32_t utxTranslitFeed(UtxTranslit* translit, const char_t *text, uint32_t size, char_t *out) {
+    uint32_t n = 0;
+    if (translit == NULL || text == NULL || out == NULL) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        n += i_feed(translit, (byte_t)text[i], out + n);
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Converts the held bytes as if the text ended there; `out` must have room
+ * for utxTranslitBound(dir, 0) bytes. */
+uint32_t utxTranslitFlush(UtxTranslit* translit, char_t *out) {
+    uint32_t n = 0;
+    if (translit == NULL || out == NULL) {
+        return 0;
+    }
+    while (translit->count > 0) {
+        n += i_resolve(translit, out + n);
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* What a flush would write, without holding fewer bytes. */
+uint32_t utxTranslitPreview(const UtxTranslit* translit, char_t *out) {
+    if (translit == NULL) {
+        return 0;
+    }
+    UtxTranslit copy = *translit;
+    return utxTranslitFlush(&copy, out);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxTranslitPending(const UtxTranslit* translit) {
+    return translit != NULL ? translit->count : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Converts a whole text in one go; `out` must have room for
+ * utxTranslitBound bytes. Returns the bytes written. */
+uint32_t utxTranslitText(UtxTranslitDir dir, const char_t *text, uint32_t size, char_t *out) {
+    if (!i_STARTED || (dir != TranslitRomanToUrdu && dir != TranslitUrduToRoman) || text == NULL || out == NULL) {
+        return 0;
+    }
+
+    const Table *table = &i_TABLES[dir];
+    const byte_t *s = (const byte_t*)text;
+    uint32_t i = 0, n = 0;
+    while (i < size) {
+        uint32_t step = i_step(table, ROOT, s[i]);
+        if (step == DEAD) {
+            out[n++] = (char_t)s[i++];
+            continue;
+        }
+
+        int32_t rule = i_rule(step);
+        uint32_t matched = 1;
+        for (uint32_t j = i + 1; j < size; ++j) {
+            step = i_step(table, i_state(step), s[j]);
+            if (step == DEAD) {
+                break;
+            }
+            if (i_rule(step) >= 0) {
+                rule = i_rule(step);
+                matched = j - i + 1;
+            }
+        }
+
+        if (rule >= 0) {
+            n += i_emit(table, rule, out + n);
+        } else {
+            out[n++] = (char_t)s[i];
+        }
+        i += matched;
+    }
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_TRANSLIT_H__
+#define __UTX_TRANSLIT_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api void utxTranslitStart(void);
+_utx_api void utxTranslitFinish(void);
+
+_utx_api UtxTranslit* utxTranslitCreate(UtxTranslitDir dir);
+_utx_api void utxTranslitDestroy(UtxTranslit** translit);
+_utx_api void utxTranslitReset(UtxTranslit* translit);
+_utx_api uint32_t utxTranslitBound(UtxTranslitDir dir, uint32_t size);
+_utx_api uint32_t utxTranslitFeed(UtxTranslit* translit, const char_t *text, uint32_t size, char_t *out);
+_utx_api uint32_t utxTranslitFlush(UtxTranslit* translit, char_t *out);
+_utx_api uint32_t utxTranslitPreview(const UtxTranslit* translit, char_t *out);
+_utx_api uint32_t utxTranslitPending(const UtxTranslit* translit);
+_utx_api uint32_t utxTranslitText(UtxTranslitDir dir, const char_t *text, uint32_t size, char_t *out);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_TRANSLIT_H__ */
+/*----------------------------------------------------------------------------*/
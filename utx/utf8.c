@@ -0,0 +1,400 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+/*
+ * Streaming UTF-8 validation.
+ *
+ * The validator state survives between calls, so a sequence split across two
+ * chunks of a file is checked exactly as if the chunks were contiguous.
+ *
+ * utxUtf8Scan validates, counts code points and counts line feeds in a
+ * single pass. On x86 it is vectorised and picks the best path at run time:
+ *  - AVX2: 32 bytes per step, validated with the three-nibble lookup method
+ *    of Keiser & Lemire ("Validating UTF-8 in less than one instruction per
+ *    byte", 2021). Counting uses compares and popcounts.
+ *  - SSE2: 16 bytes per step. Counts are vectorised; ASCII blocks skip
+ *    validation and other blocks go through the scalar state machine.
+ *  - Scalar: the portable state machine, used elsewhere and for tails.
+ */
+#include "utf8.h"
+#include "simd.h"
+
+/*----------------------------------------------------------------------------*/
+static UtxSimd i_SIMD = SimdAuto;
+
+/*----------------------------------------------------------------------------*/
+void utxUtf8Init(UtxUtf8* state) {
+    state->need = 0;
+    state->lo = 0x80;
+    state->hi = 0xBF;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_validate(UtxUtf8 *state, const byte_t *s, uint32_t size) {
+    uint32_t need = state->need;
+    byte_t lo = state->lo;
+    byte_t hi = state->hi;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        byte_t c = s[i];
+        if (need == 0) {
+            if (c < 0x80) {
+                continue;
+            }
+
+            lo = 0x80;
+            hi = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF) {
+                need = 1;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                need = 2;
+                if (c == 0xE0) {
+                    lo = 0xA0;
+                } else if (c == 0xED) {
+                    hi = 0x9F;
+                }
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                need = 3;
+                if (c == 0xF0) {
+                    lo = 0x90;
+                } else if (c == 0xF4) {
+                    hi = 0x8F;
+                }
+            } else {
+                return FALSE;
+            }
+        } else {
+            if (c < lo || c > hi) {
+                return FALSE;
+            }
+            lo = 0x80;
+            hi = 0xBF;
+            need -= 1;
+        }
+    }
+
+    state->need = need;
+    state->lo = lo;
+    state->hi = hi;
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool_t i_scan_scalar(UtxUtf8 *state, const byte_t *s, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    uint32_t nlines = 0;
+    uint32_t nchars = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        nlines += s[i] == '\n';
+        nchars += (s[i] & 0xC0) != 0x80;
+    }
+    *lines += nlines;
+    *chars += nchars;
+    return state != NULL ? i_validate(state, s, size) : TRUE;
+}
+
+#if defined(UTX_X86)
+
+/*----------------------------------------------------------------------------*/
+static uint32_t i_popcount(uint32_t x) {
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return (x * 0x01010101) >> 24;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_SSE2
+static bool_t i_scan_sse2(UtxUtf8 *state, const byte_t *s, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cont = _mm_set1_epi8(-65);  /* 0xBF, last continuation */
+    uint32_t nlines = 0;
+    uint32_t nchars = 0;
+    uint32_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        nlines += i_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+        nchars += i_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, cont)));
+        if (state != NULL && (state->need != 0 || _mm_movemask_epi8(v) != 0)) {
+            if (!i_validate(state, s + i, 16)) {
+                return FALSE;
+            }
+        }
+    }
+
+    *lines += nlines;
+    *chars += nchars;
+    return i_scan_scalar(state, s + i, size - i, lines, chars);
+}
+
+/*----------------------------------------------------------------------------*/
+#define U8_TOO_SHORT        (1 << 0)
+#define U8_TOO_LONG         (1 << 1)
+#define U8_OVERLONG_3       (1 << 2)
+#define U8_TOO_LARGE        (1 << 3)
+#define U8_SURROGATE        (1 << 4)
+#define U8_OVERLONG_2       (1 << 5)
+#define U8_TOO_LARGE_1000   (1 << 6)
+#define U8_OVERLONG_4       (1 << 6)
+#define U8_TWO_CONTS        (1 << 7)
+#define U8_CARRY            (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)\
+    _mm256_setr_epi8(\
+        (char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h),\
+        (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p),\
+        (char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h),\
+        (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p))
+
+/*----------------------------------------------------------------------------*/
+/* Error bits for each byte of `input`, given the 32 bytes before it. */
+UTX_TARGET_AVX2
+static __m256i i_check_avx2(const __m256i input, const __m256i prev_input) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i byte_1_high_table = U8_TABLE(
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+        U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+        U8_TOO_SHORT | U8_OVERLONG_2,
+        U8_TOO_SHORT,
+        U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+        U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+    const __m256i byte_1_low_table = U8_TABLE(
+        U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+        U8_CARRY | U8_OVERLONG_2,
+        U8_CARRY,
+        U8_CARRY,
+        U8_CARRY | U8_TOO_LARGE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000);
+    const __m256i byte_2_high_table = U8_TABLE(
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 16 - 1);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 16 - 2);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 16 - 3);
+
+    __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    /* third and fourth bytes of 3- and 4-byte sequences must be continuations */
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Non-zero where the block ends inside a sequence. */
+UTX_TARGET_AVX2
+static __m256i i_incomplete_avx2(const __m256i input) {
+    const __m256i max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+/*----------------------------------------------------------------------------*/
+UTX_TARGET_AVX2
+static bool_t i_scan_avx2(UtxUtf8 *state, const byte_t *s, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cont = _mm256_set1_epi8(-65);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    uint32_t i = 0;
+
+    /* finish a sequence left open by the previous call */
+    if (state != NULL && state->need != 0) {
+        i = state->need < size ? state->need : size;
+        if (!i_scan_scalar(state, s, i, lines, chars)) {
+            return FALSE;
+        }
+    }
+
+    const uint32_t start = i;
+    uint32_t nlines = 0;
+    uint32_t nchars = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        nlines += i_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf)));
+        nchars += i_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, cont)));
+        if (state != NULL) {
+            if (_mm256_movemask_epi8(v) == 0) {
+                error = _mm256_or_si256(error, incomplete);
+                incomplete = _mm256_setzero_si256();
+            } else {
+                error = _mm256_or_si256(error, i_check_avx2(v, prev));
+                incomplete = i_incomplete_avx2(v);
+            }
+            prev = v;
+        }
+    }
+
+    if (state != NULL && i > start) {
+        if (!_mm256_testz_si256(error, error)) {
+            return FALSE;
+        }
+
+        /* hand a sequence cut by the last block back to the scalar tail */
+        uint32_t boundary = start + utxUtf8Boundary((const char_t*)s + start, i - start);
+        if (boundary < i) {
+            nchars -= 1;
+            i = boundary;
+        }
+    }
+
+    *lines += nlines;
+    *chars += nchars;
+    return i_scan_scalar(state, s + i, size - i, lines, chars);
+}
+
+/*----------------------------------------------------------------------------*/
+static UtxSimd i_detect(void) {
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdSse2;
+    }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int nids = info[0];
+    __cpuid(info, 1);
+    bool_t sse2 = (info[3] >> 26) & 1;
+    bool_t osxsave = (info[2] >> 27) & 1;
+    bool_t avx = (info[2] >> 28) & 1;
+    if (nids >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] >> 5) & 1) {
+            return SimdAvx2;
+        }
+    }
+    if (sse2) {
+        return SimdSse2;
+    }
+#endif
+    return SimdScalar;
+}
+
+#else
+
+/*----------------------------------------------------------------------------*/
+static UtxSimd i_detect(void) {
+    return SimdScalar;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+UtxSimd utxUtf8Simd(void) {
+    if (i_SIMD == SimdAuto) {
+        i_SIMD = i_detect();
+    }
+    return i_SIMD;
+}
+
+/*----------------------------------------------------------------------------*/
+UtxSimd utxUtf8SetSimd(UtxSimd simd) {
+    UtxSimd available = i_detect();
+    i_SIMD = simd == SimdAuto || simd > available ? available : simd;
+    return i_SIMD;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxUtf8Scan(UtxUtf8* state, const char_t *data, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    const byte_t *s = (const byte_t*)data;
+    uint32_t nlines = 0;
+    uint32_t nchars = 0;
+    bool_t valid;
+
+    switch (utxUtf8Simd()) {
+#if defined(UTX_X86)
+    case SimdAvx2:
+        valid = i_scan_avx2(state, s, size, &nlines, &nchars);
+        break;
+    case SimdSse2:
+        valid = i_scan_sse2(state, s, size, &nlines, &nchars);
+        break;
+#endif
+    default:
+        valid = i_scan_scalar(state, s, size, &nlines, &nchars);
+        break;
+    }
+
+    if (lines != NULL) {
+        *lines = nlines;
+    }
+    if (chars != NULL) {
+        *chars = nchars;
+    }
+    return valid;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxUtf8Validate(UtxUtf8* state, const char_t *data, uint32_t size) {
+    return utxUtf8Scan(state, data, size, NULL, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+void utxUtf8Count(const char_t *data, uint32_t size, uint32_t *lines, uint32_t *chars) {
+    utxUtf8Scan(NULL, data, size, lines, chars);
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxUtf8Complete(const UtxUtf8* state) {
+    return state->need == 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxUtf8Boundary(const char_t *data, uint32_t size) {
+    const byte_t *s = (const byte_t*)data;
+    uint32_t i = size;
+    uint32_t back = 0;
+
+    /* walk back over at most three continuation bytes to the last lead */
+    while (i > 0 && back < 4) {
+        i -= 1;
+        back += 1;
+        byte_t c = s[i];
+        if ((c & 0xC0) != 0x80) {
+            uint32_t len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+            return len > back ? i : size;
+        }
+    }
+    return size;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,35 @@
+/*******************************************************************************
+* Copyright (c) 2024. All rights reserved.
+*
+* This work is licensed under the Creative Commons Attribution 4.0 
+* International License. To view a copy of this license,
+* visit # http://creativecommons.org/licenses/by/4.0/.
+*
+* Author: roximn <roximn148@gmail.com>
+*******************************************************************************/
+#ifndef __UTX_UTF8_H__
+#define __UTX_UTF8_H__
+/*----------------------------------------------------------------------------*/
+
+#include "utx.hxx"
+
+/*----------------------------------------------------------------------------*/
+__EXTERN_C
+/*----------------------------------------------------------------------------*/
+
+_utx_api void utxUtf8Init(UtxUtf8* state);
+_utx_api bool_t utxUtf8Validate(UtxUtf8* state, const char_t *data, uint32_t size);
+_utx_api bool_t utxUtf8Scan(UtxUtf8* state, const char_t *data, uint32_t size, uint32_t *lines, uint32_t *chars);
+_utx_api void utxUtf8Count(const char_t *data, uint32_t size, uint32_t *lines, uint32_t *chars);
+_utx_api bool_t utxUtf8Complete(const UtxUtf8* state);
+_utx_api uint32_t utxUtf8Boundary(const char_t *data, uint32_t size);
+
+_utx_api UtxSimd utxUtf8Simd(void);
+_utx_api UtxSimd utxUtf8SetSimd(UtxSimd simd);
+
+/*----------------------------------------------------------------------------*/
+__END_C
+
+/*----------------------------------------------------------------------------*/
+# endif /* __UTX_UTF8_H__ */
+/*----------------------------------------------------------------------------*/
@@ -8,9 +8,19 @@
 * Author: roximn <roximn148@gmail.com>
 *******************************************************************************/
 #include "utx.h"
+#include "buffer.h"
+#include "edittrace.h"
+#include "filemap.h"
+#include "loader.h"
+#include "history.h"
+#include "normalize.h"
+#include "saver.h"
+#include "search.h"
+#include "segment.h"
+#include "trace.h"
+#include "translit.h"
 #include <core/strings.h>
 #include <core/heap.h>
-#include <core/hfile.h>
 #include <osbs/bfile.h>
 #include <osbs/log.h>
 
@@ -18,10 +28,20 @@
 static uint64_t counter = 1;
 
 /*----------------------------------------------------------------------------*/
-void utx_start(void) {}
+void utx_start(void) {
+    utxTraceStart();
+    utxSaverStart();
+    utxTranslitStart();
+    utxSegmentStart();
+}
 
 /*----------------------------------------------------------------------------*/
-void utx_finish(void) {}
+void utx_finish(void) {
+    utxSaverFinish();
+    utxTranslitFinish();
+    utxSegmentFinish();
+    utxTraceFinish();
+}
 
 /*----------------------------------------------------------------------------*/
 UtxFile* utxCreateNew(void) {
@@ -29,7 +49,8 @@ UtxFile* utxCreateNew(void) {
 
     utx->fileName = str_printf("Untitle%d.txt", counter);
     counter += 1;
-    utx->contents = str_c("");
+    utx->buffer = utxBufferCreate();
+    utx->history = utxHistoryCreate(UNDO_MEMORY_LIMIT);
     utx->fileFolder = NULL;
     utx->isModified = FALSE;
 
@@ -57,11 +78,28 @@ UtxFile* utxCreateFromFile(const char_t *filePath) {
         return NULL;
     }
 
+    UTX_TRACE_BEGIN("utxCreateFromFile");
     UtxFile *utx = utxCreateNew();
     Result result = utxReadContentsFromFile(utx, filePath);
     if (result != ROkay) {
         log_printf("utxCreate: Failed to read file [%s]", filePath);
         utxDestroy(&utx);
+        UTX_TRACE_END("utxCreateFromFile");
+        return NULL;
+    }
+
+    utxSetFilePath(utx, filePath);
+    UTX_TRACE_END("utxCreateFromFile");
+    return utx;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxSetFilePath(UtxFile* utx, const char_t *filePath) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
     }
 
     String *folder, *fileName;
@@ -73,9 +111,7 @@ UtxFile* utxCreateFromFile(const char_t *filePath) {
     str_destroy(&fileName);
 
     utx->isModified = FALSE;
-
-    log_printf("utxCreateFromFile: Created from '%s'", filePath);
-    return utx;
+    return ROkay;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -86,8 +122,10 @@ void utxDestroy(UtxFile** utx) {
 
     UtxFile *u = *utx;
 
+    utxEditTraceStop(u->trace);
     str_destroy(&u->fileName);
-    str_destroy(&u->contents);
+    utxBufferDestroy(&u->buffer);
+    utxHistoryDestroy(&u->history);
     if (u->fileFolder != NULL) {
         str_destroy(&u->fileFolder);
     }
@@ -104,12 +142,148 @@ void utxDump(const UtxFile* utx) {
     log_printf("utxDump: fileName: '%s'", tc(utx->fileName));
     log_printf("utxDump: fileFolder: '%s'", utx->fileFolder != NULL ? tc(utx->fileName) : "NULL");
 
-    log_printf("utxDump: contents: %d bytes, %d chars", str_len(utx->contents), str_nchars(utx->contents));
+    log_printf("utxDump: contents: %d bytes, %d chars, %d lines, %d pieces",
+        utxBufferLength(utx->buffer),
+        utxBufferChars(utx->buffer),
+        utxBufferLines(utx->buffer),
+        utxBufferPieces(utx->buffer));
+    log_printf("utxDump: history: %d bytes", utxHistoryMemory(utx->history));
     log_printf("utxDump: isModified: %s", utx->isModified ? "TRUE" : "FALSE");
 
     return;
 }
 
+/*----------------------------------------------------------------------------*/
+static void i_modified(UtxFile *utx) {
+    utx->generation += 1;
+    if (utx->fileFolder != NULL) {
+        utx->isModified = TRUE;
+    } else {
+        utx->isModified = FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* New contents reach a trace whole; edits after them are replayed on top. */
+static void i_trace_reset(UtxFile *utx) {
+    if (utx->trace != NULL) {
+        String *contents = utxGetContents(utx);
+        utxEditTraceAdd(utx->trace, EditReset, 0, 0, tc(contents), str_len(contents));
+        str_destroy(&contents);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void i_append(char_t **out, uint32_t *size, uint32_t *capacity, uint32_t more) {
+    if (*size + more <= *capacity) {
+        return;
+    }
+
+    uint32_t grown = *capacity > 0 ? *capacity : 4096;
+    while (grown < *size + more) {
+        grown *= 2;
+    }
+    if (*out == NULL) {
+        *out = (char_t*)heap_malloc(grown, "UtxRewrite");
+    } else {
+        *out = (char_t*)heap_realloc((byte_t*)*out, *capacity, grown, "UtxRewrite");
+    }
+    *capacity = grown;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The window ends before its last ASCII byte, where no cluster runs across;
+ * a window with none grows until it has one. */
+static uint32_t i_window(const UtxBuffer *buffer, uint32_t pos, uint32_t end, char_t **window, uint32_t *capacity) {
+    uint32_t want = FILE_BUFFER_SIZE;
+    for (;;) {
+        uint32_t size = 0;
+        uint32_t n = end - pos < want ? end - pos : want;
+        i_append(window, &size, capacity, n);
+        n = utxBufferRead(buffer, pos, *window, n);
+        if (pos + n == end) {
+            return n;
+        }
+
+        uint32_t cut = n;
+        while (cut > 0 && (byte_t)(*window)[cut - 1] >= 0x80) {
+            cut -= 1;
+        }
+        if (cut > 1) {
+            return cut - 1;
+        }
+        want *= 2;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Normalizes a range a window at a time. Everything from the first change
+ * to the last is replaced at once, so it also undoes as one step; clean
+ * text costs a read of each window and nothing more. */
+static Result i_normalize(UtxFile *utx, UtxNormalize profile, uint32_t offset, uint32_t size, bool_t record, uint32_t *normalized) {
+    char_t *window = NULL, *out = NULL;
+    uint32_t wcapacity = 0, outSize = 0, capacity = 0;
+    uint32_t first = 0, last = 0;
+    uint32_t pos = offset, end = offset + size;
+    Result result = ROkay;
+
+    if (normalized != NULL) {
+        *normalized = size;
+    }
+    if (profile == NormNone) {
+        return ROkay;
+    }
+
+    while (pos < end) {
+        uint32_t n = i_window(utx->buffer, pos, end, &window, &wcapacity);
+        uint32_t clean = utxNormalizeClean(profile, window, n);
+        if (clean < n) {
+            if (out == NULL) {
+                first = pos + clean;
+            } else {
+                i_append(&out, &outSize, &capacity, pos + clean - last);
+                outSize += utxBufferRead(utx->buffer, last, out + outSize, pos + clean - last);
+            }
+
+            i_append(&out, &outSize, &capacity, n - clean);
+            uint32_t m = utxNormalizeText(profile, window + clean, n - clean, out + outSize);
+
+            /* leave out what is the same at the end of the window */
+            uint32_t k = 0;
+            while (k < m && k < n - clean && window[n - 1 - k] == out[outSize + m - 1 - k]) {
+                k += 1;
+            }
+            while (k > 0 && ((byte_t)out[outSize + m - k] & 0xC0) == 0x80) {
+                k -= 1;
+            }
+            outSize += m - k;
+            last = pos + n - k;
+        }
+        pos += n;
+    }
+
+    if (out != NULL) {
+        if (record) {
+            utxHistoryBreak(utx->history);
+            utxHistoryRecord(utx->history, utx->buffer, first, last - first, out, outSize);
+            utxHistoryBreak(utx->history);
+            utxEditTraceAdd(utx->trace, EditRewrite, first, last - first, out, outSize);
+        }
+        result = utxBufferReplace(utx->buffer, first, last - first, out, outSize);
+        if (record) {
+            i_modified(utx);
+        }
+        if (normalized != NULL) {
+            *normalized = size - (last - first) + outSize;
+        }
+        heap_free((byte_t**)&out, capacity, "UtxRewrite");
+    }
+    if (window != NULL) {
+        heap_free((byte_t**)&window, wcapacity, "UtxRewrite");
+    }
+    return result;
+}
+
 /*----------------------------------------------------------------------------*/
 Result utxSetContents(UtxFile* utx, const String* contents) {
     if (utx == NULL) {
@@ -118,30 +292,377 @@ Result utxSetContents(UtxFile* utx, const String* contents) {
     if (contents == NULL) {
         return RInvalidContents;
     }
-    if (contents == utx->contents) {
+    
+    UTX_TRACE_BEGIN("utxSetContents");
+    utxBufferSetText(utx->buffer, tc(contents), str_len(contents));
+    utxHistoryClear(utx->history);
+    i_normalize(utx, utx->normalize, 0, utxBufferLength(utx->buffer), FALSE, NULL);
+    i_modified(utx);
+    i_trace_reset(utx);
+    UTX_TRACE_END("utxSetContents");
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+String* utxGetContents(const UtxFile* utx) {
+    if (utx == NULL) {
+        return NULL;
+    }
+    return utxBufferString(utx->buffer, 0, utxBufferLength(utx->buffer));
+}
+
+/*----------------------------------------------------------------------------*/
+String* utxGetRange(const UtxFile* utx, uint32_t offset, uint32_t size) {
+    if (utx == NULL) {
+        return NULL;
+    }
+    return utxBufferString(utx->buffer, offset, size);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxLength(const UtxFile* utx) {
+    if (utx == NULL) {
+        return 0;
+    }
+    return utxBufferLength(utx->buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxInsert(UtxFile* utx, uint32_t offset, const char_t *text, uint32_t size) {
+    return utxReplace(utx, offset, 0, text, size);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxDelete(UtxFile* utx, uint32_t offset, uint32_t size) {
+    return utxReplace(utx, offset, size, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxReplace(UtxFile* utx, uint32_t offset, uint32_t size, const char_t *text, uint32_t textSize) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    if (text == NULL && textSize > 0) {
+        return RInvalidContents;
+    }
+
+    Result result = utxBufferCheck(utx->buffer, offset, size);
+    if (result != ROkay) {
+        return result;
+    }
+
+    /* traced as typed; replay normalizes it the same way */
+    utxEditTraceAdd(utx->trace, size == 0 ? EditInsert : (textSize == 0 ? EditDelete : EditReplace), offset, size, text, textSize);
+
+    /* the new text alone; what is around it is left as it is */
+    char_t *normal = NULL;
+    uint32_t normalSize = textSize;
+    if (textSize > 0 && utxNormalizeClean(utx->normalize, text, textSize) < textSize) {
+        normal = (char_t*)heap_malloc(normalSize, "UtxNormalize");
+        textSize = utxNormalizeText(utx->normalize, text, textSize, normal);
+        text = normal;
+    }
+
+    utxHistoryRecord(utx->history, utx->buffer, offset, size, text, textSize);
+    result = utxBufferReplace(utx->buffer, offset, size, text, textSize);
+    i_modified(utx);
+    if (normal != NULL) {
+        heap_free((byte_t**)&normal, normalSize, "UtxNormalize");
+    }
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxFind(const UtxFile* utx, const UtxSearch* search, uint32_t from, uint32_t *offset, uint32_t *size) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (search == NULL) {
         return RInvalidContents;
     }
-    
-    str_upd(&utx->contents, tc(contents));
-    if (utx->fileFolder != NULL) {
-        utx->isModified = TRUE;
-    } else {
-        utx->isModified = FALSE;
+    return utxSearchNext(search, utx->buffer, from, offset, size) ? ROkay : RNotFound;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replaces the matches in a single pass over the buffer. Each match is kept
+ * in the history on its own, last first, so every record's offset holds in
+ * the text as it is when it is undone or redone; they undo as one step. */
+Result utxReplaceAll(UtxFile* utx, const UtxSearch* search, const char_t *text, uint32_t size, uint32_t *count) {
+    if (count != NULL) {
+        *count = 0;
     }
-    if (utx->fileFolder != NULL) {
-        utx->isModified = TRUE;
-    } else {
-        utx->isModified = FALSE;
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (search == NULL || (text == NULL && size > 0)) {
+        return RInvalidContents;
+    }
+
+    UtxRange *ranges = NULL;
+    uint32_t matches = 0, capacity = 0, from = 0;
+    uint32_t offset = 0, msize = 0;
+    while (utxSearchNext(search, utx->buffer, from, &offset, &msize)) {
+        if (matches == capacity) {
+            uint32_t grown = capacity > 0 ? capacity * 2 : 64;
+            if (ranges == NULL) {
+                ranges = (UtxRange*)heap_malloc(grown * sizeof(UtxRange), "UtxRanges");
+            } else {
+                ranges = (UtxRange*)heap_realloc((byte_t*)ranges, capacity * sizeof(UtxRange), grown * sizeof(UtxRange), "UtxRanges");
+            }
+            capacity = grown;
+        }
+        ranges[matches].offset = offset;
+        ranges[matches].size = msize;
+        from = offset + msize;
+        matches += 1;
+    }
+
+    if (matches == 0) {
+        return RNotFound;
+    }
+
+    /* nothing is recorded for matches the buffer would refuse */
+    Result result = utxBufferCheckRanges(utx->buffer, ranges, matches, size);
+    if (result != ROkay) {
+        heap_free((byte_t**)&ranges, capacity * sizeof(UtxRange), "UtxRanges");
+        return result;
+    }
+
+    utxHistoryGroup(utx->history);
+    utxEditTraceAdd(utx->trace, EditGroup, 0, 0, NULL, 0);
+    for (uint32_t i = matches; i > 0; --i) {
+        utxHistoryRecord(utx->history, utx->buffer, ranges[i - 1].offset, ranges[i - 1].size, text, size);
+        utxEditTraceAdd(utx->trace, EditRewrite, ranges[i - 1].offset, ranges[i - 1].size, text, size);
+    }
+    utxHistoryBreak(utx->history);
+    utxEditTraceAdd(utx->trace, EditBreak, 0, 0, NULL, 0);
+
+    result = utxBufferReplaceRanges(utx->buffer, ranges, matches, text, size);
+    heap_free((byte_t**)&ranges, capacity * sizeof(UtxRange), "UtxRanges");
+    if (result == ROkay) {
+        i_modified(utx);
+        if (count != NULL) {
+            *count = matches;
+        }
+    }
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Converts a range piece by piece and replaces it in one step; `converted`
+ * receives the size of the new text. */
+Result utxTransliterate(UtxFile* utx, UtxTranslitDir dir, uint32_t offset, uint32_t size, uint32_t *converted) {
+    if (converted != NULL) {
+        *converted = 0;
+    }
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    Result result = utxBufferCheck(utx->buffer, offset, size);
+    if (result != ROkay) {
+        return result;
+    }
+
+    UtxTranslit *translit = utxTranslitCreate(dir);
+    if (translit == NULL) {
+        return RInvalidContents;
+    }
+
+    char_t *out = NULL;
+    uint32_t outSize = 0, capacity = 0;
+    uint32_t pos = offset;
+    while (pos < offset + size) {
+        uint32_t n = 0;
+        const char_t *chunk = utxBufferChunk(utx->buffer, pos, &n);
+        if (chunk == NULL || n == 0) {
+            break;
+        }
+        n = n < offset + size - pos ? n : offset + size - pos;
+        i_append(&out, &outSize, &capacity, utxTranslitBound(dir, n));
+        outSize += utxTranslitFeed(translit, chunk, n, out + outSize);
+        pos += n;
+    }
+    i_append(&out, &outSize, &capacity, utxTranslitBound(dir, 0));
+    outSize += utxTranslitFlush(translit, out + outSize);
+    utxTranslitDestroy(&translit);
+
+    utxHistoryBreak(utx->history);
+    utxHistoryRecord(utx->history, utx->buffer, offset, size, out, outSize);
+    utxHistoryBreak(utx->history);
+    utxEditTraceAdd(utx->trace, EditRewrite, offset, size, out, outSize);
+    result = utxBufferReplace(utx->buffer, offset, size, out, outSize);
+    i_modified(utx);
+    if (out != NULL) {
+        heap_free((byte_t**)&out, capacity, "UtxRewrite");
+    }
+    if (converted != NULL) {
+        *converted = outSize;
+    }
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Normalizes a range in one step; `normalized` receives its new size. */
+Result utxNormalize(UtxFile* utx, UtxNormalize profile, uint32_t offset, uint32_t size, uint32_t *normalized) {
+    if (normalized != NULL) {
+        *normalized = 0;
+    }
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    Result result = utxBufferCheck(utx->buffer, offset, size);
+    if (result != ROkay) {
+        return result;
     }
+
+    return i_normalize(utx, profile, offset, size, TRUE, normalized);
+}
+
+/*----------------------------------------------------------------------------*/
+/* From now on, text put in by utxReplace or read from a file is normalized
+ * with `profile`; text already in is left for utxNormalize. */
+void utxSetNormalize(UtxFile* utx, UtxNormalize profile) {
+    if (utx != NULL && utx->normalize != profile) {
+        utx->normalize = profile;
+        utxEditTraceAdd(utx->trace, EditNormalize, (uint32_t)profile, 0, NULL, 0);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* `offset`, when given, receives the caret position after the change. */
+Result utxUndo(UtxFile* utx, uint32_t *offset) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (!utxHistoryUndo(utx->history, utx->buffer, offset)) {
+        return RNoHistory;
+    }
+    utxEditTraceAdd(utx->trace, EditUndo, 0, 0, NULL, 0);
+
+    i_modified(utx);
     return ROkay;
 }
 
 /*----------------------------------------------------------------------------*/
-uint32_t utxLength(const UtxFile* utx) {
+Result utxRedo(UtxFile* utx, uint32_t *offset) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (!utxHistoryRedo(utx->history, utx->buffer, offset)) {
+        return RNoHistory;
+    }
+    utxEditTraceAdd(utx->trace, EditRedo, 0, 0, NULL, 0);
+
+    i_modified(utx);
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxCanUndo(const UtxFile* utx) {
+    return utx != NULL && utxHistoryCanUndo(utx->history);
+}
+
+/*----------------------------------------------------------------------------*/
+bool_t utxCanRedo(const UtxFile* utx) {
+    return utx != NULL && utxHistoryCanRedo(utx->history);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Starts a new undo group with the next edit. */
+void utxUndoBreak(UtxFile* utx) {
+    if (utx != NULL) {
+        utxHistoryBreak(utx->history);
+        utxEditTraceAdd(utx->trace, EditBreak, 0, 0, NULL, 0);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Oldest history is discarded once it needs more than `limit` bytes. */
+void utxSetUndoLimit(UtxFile* utx, uint32_t limit) {
+    if (utx != NULL) {
+        utxHistorySetLimit(utx->history, limit);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t utxLineCount(const UtxFile* utx) {
     if (utx == NULL) {
         return 0;
     }
-    return str_len(utx->contents);
+    return utxBufferLines(utx->buffer);
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxOffsetToLine(const UtxFile* utx, uint32_t offset, uint32_t *line, uint32_t *column) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (offset > utxBufferLength(utx->buffer)) {
+        return RInvalidRange;
+    }
+
+    uint32_t l = utxBufferLineOf(utx->buffer, offset);
+    if (line != NULL) {
+        *line = l;
+    }
+    if (column != NULL) {
+        *column = offset - utxBufferLineStart(utx->buffer, l);
+    }
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxCharToLine(const UtxFile* utx, uint32_t index, uint32_t *line, uint32_t *column) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (index > utxBufferChars(utx->buffer)) {
+        return RInvalidRange;
+    }
+
+    uint32_t offset = utxBufferCharToOffset(utx->buffer, index);
+    uint32_t l = utxBufferLineOf(utx->buffer, offset);
+    if (line != NULL) {
+        *line = l;
+    }
+    if (column != NULL) {
+        uint32_t start = utxBufferLineStart(utx->buffer, l);
+        *column = index - utxBufferOffsetToChar(utx->buffer, start);
+    }
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxLineToOffset(const UtxFile* utx, uint32_t line, uint32_t *offset) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (line >= utxBufferLines(utx->buffer)) {
+        return RInvalidRange;
+    }
+
+    if (offset != NULL) {
+        *offset = utxBufferLineStart(utx->buffer, line);
+    }
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+Result utxLineToChar(const UtxFile* utx, uint32_t line, uint32_t *index) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (line >= utxBufferLines(utx->buffer)) {
+        return RInvalidRange;
+    }
+
+    if (index != NULL) {
+        *index = utxBufferOffsetToChar(utx->buffer, utxBufferLineStart(utx->buffer, line));
+    }
+    return ROkay;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -150,24 +671,63 @@ Result utxReadContentsFromFile(UtxFile* utx, const char_t *filePath) {
         return RInvalidUtxPointer;
     }
 
+    UTX_TRACE_BEGIN("utxRead");
     ferror_t error;
-    String *contents = hfile_string(filePath, &error);
+    UtxFileMap *map = utxFileMapOpen(filePath, &error);
     if (error != ekFOK) {
         log_printf(
             "utxRead: Failed to read contents of '%s' with error %d",
             filePath,
             error
         );
+        UTX_TRACE_END("utxRead");
         return RFileError;
     }
 
-    str_upd(&(utx->contents), tc(contents));
-    str_destroy(&contents);
-    
-    log_printf("utxRead: Successfully read contents of '%s'", filePath);
+    /* the document is left as it was unless the whole file is good */
+    UtxBuffer *buffer = utxBufferCreate();
+    if (utxBufferSetMapped(buffer, map, TRUE) != ROkay) {
+        log_printf("utxRead: Invalid UTF-8 in '%s'", filePath);
+        utxBufferDestroy(&buffer);
+        UTX_TRACE_END("utxRead");
+        return RInvalidEncoding;
+    }
+
+    utxHistoryClear(utx->history);
+    utxBufferSwap(utx->buffer, buffer);
+    utxBufferDestroy(&buffer);
+
+    i_normalize(utx, utx->normalize, 0, utxBufferLength(utx->buffer), FALSE, NULL);
+    utx->generation += 1;
+    i_trace_reset(utx);
+    UTX_TRACE_COUNTER("utxRead bytes", utxBufferLength(utx->buffer));
+    UTX_TRACE_END("utxRead");
     return ROkay;
 }
 
+/*----------------------------------------------------------------------------*/
+Result utxLoadContentsFromFile(UtxFile* utx, const char_t *filePath, FPtr_utxProgress func, void *data) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+
+    UTX_TRACE_BEGIN("utxLoad");
+    UtxBuffer *buffer = utxBufferCreate();
+    Result result = utxLoadFile(buffer, filePath, func, data);
+    if (result == ROkay) {
+        utxHistoryClear(utx->history);
+        utxBufferSwap(utx->buffer, buffer);
+        UTX_TRACE_BEGIN("utxNormalize");
+        i_normalize(utx, utx->normalize, 0, utxBufferLength(utx->buffer), FALSE, NULL);
+        UTX_TRACE_END("utxNormalize");
+        utx->generation += 1;
+        i_trace_reset(utx);
+    }
+    utxBufferDestroy(&buffer);
+    UTX_TRACE_END("utxLoad");
+    return result;
+}
+
 /*----------------------------------------------------------------------------*/
 Result utxRead(UtxFile* utx, const char_t *filePath) {
     if (utx == NULL) {
@@ -209,30 +769,82 @@ Result utxRead(UtxFile* utx, const char_t *filePath) {
     return result;
 }
 
+/*----------------------------------------------------------------------------*/
+/* A mapped view pins its file on Windows, so the text must move out of the
+ * mapping before the file can be replaced. POSIX keeps the old file alive
+ * for as long as it is mapped. */
+static void i_unpin(UtxFile *utx) {
+#if defined(_WIN32)
+    utxBufferDetach(utx->buffer);
+#else
+    unref(utx);
+#endif
+}
+
 /*----------------------------------------------------------------------------*/
 Result utxWriteContentsToFile(UtxFile* utx, const char_t *filePath) {
     if (utx == NULL) {
         return RInvalidUtxPointer;
     }
 
-    ferror_t error;
-    hfile_from_string(filePath, utx->contents, &error);
-    if (error != ekFOK) {
+    UTX_TRACE_BEGIN("utxWrite");
+    i_unpin(utx);
+    UtxSnapshot *snapshot = utxBufferSnapshot(utx->buffer);
+    Result result = utxSaveFile(snapshot, filePath);
+    utxSnapshotDestroy(&snapshot);
+    UTX_TRACE_END("utxWrite");
+
+    if (result != ROkay) {
         log_printf(
-            "utxRead: Failed to write to '%s' with error %d",
+            "utxWrite: Failed to write to '%s' with error %d",
             filePath,
-            error
+            result
         );
-        return RFileError;
+        return result;
     }
 
-    log_printf(
-        "utxRead: Successfully wrote to '%s'",
-        filePath
-    );
+    utxEditTraceAdd(utx->trace, EditSave, 0, 0, NULL, 0);
     return ROkay;
 }
 
+/*----------------------------------------------------------------------------*/
+/* The text is captured as it is now; later edits do not reach the file. */
+Result utxWriteContentsAsync(UtxFile* utx, const char_t *filePath, FPtr_utxSaved func, void *data) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (filePath == NULL) {
+        return RInvalidFilePath;
+    }
+
+    i_unpin(utx);
+    utxSaveAsync(utxBufferSnapshot(utx->buffer), filePath, func, data);
+    utxEditTraceAdd(utx->trace, EditSave, 0, 0, NULL, 0);
+    return ROkay;
+}
+
+/*----------------------------------------------------------------------------*/
+static String *i_write_folder(const UtxFile *utx, const char_t *fileFolder) {
+    if (fileFolder != NULL) {
+        return str_c(fileFolder);
+    }
+    if (utx->fileFolder != NULL) {
+        return str_copy(utx->fileFolder);
+    }
+
+    const uint32_t PATH_SIZE = 512;
+    String *sFileFolder = str_reserve(PATH_SIZE);
+    uint32_t sz = bfile_dir_work(tcc(sFileFolder), PATH_SIZE);
+    if (sz > PATH_SIZE) {
+        str_destroy(&sFileFolder);
+        log_printf("utxWrite: Working directory path string exceeds string buffer size of %d", PATH_SIZE);
+        return NULL;
+    }
+    str_cat_c(tcc(sFileFolder), PATH_SIZE, "/");
+    log_printf("utxWrite: using working directory '%s'", tc(sFileFolder));
+    return sFileFolder;
+}
+
 /*----------------------------------------------------------------------------*/
 Result utxWrite(UtxFile* utx, const char_t *fileFolder) {
     if (utx == NULL) {
@@ -242,23 +854,9 @@ Result utxWrite(UtxFile* utx, const char_t *fileFolder) {
         return RInvalidFilePath;
     }
 
-    String *sFileFolder = NULL;
-    if (fileFolder != NULL) {
-        sFileFolder = str_c(fileFolder);
-    } else if (utx->fileFolder != NULL) {
-        sFileFolder = str_copy(utx->fileFolder);
-    } else {
-        const uint32_t PATH_SIZE = 512;
-        sFileFolder = str_reserve(PATH_SIZE);
-
-        uint32_t sz = bfile_dir_work(tcc(sFileFolder), PATH_SIZE);
-        if (sz > PATH_SIZE) {
-            str_destroy(&sFileFolder);
-            log_printf("utxWrite: Working directory path string exceeds string buffer size of %d", PATH_SIZE);
-            return RInvalidFilePath;
-        }
-        str_cat_c(tcc(sFileFolder), PATH_SIZE, "/");
-        log_printf("utxWrite: using working directory '%s'", tc(sFileFolder));
+    String *sFileFolder = i_write_folder(utx, fileFolder);
+    if (sFileFolder == NULL) {
+        return RInvalidFilePath;
     }
 
     String *sFilePath = str_cpath("%s%s", tc(sFileFolder), tc(utx->fileName));
@@ -266,13 +864,61 @@ Result utxWrite(UtxFile* utx, const char_t *fileFolder) {
     if (result == ROkay) {
         utx->isModified = FALSE;
         str_upd(&(utx->fileFolder), tc(sFileFolder));
-    } else {
-        str_destroy(&sFilePath);
     }
 
+    str_destroy(&sFilePath);
     str_destroy(&sFileFolder);
     
     return result;
 }
 
 /*----------------------------------------------------------------------------*/
+/* Saves on the writer thread. The document stays modified and keeps its
+ * folder: `func` reports the outcome, on the writer thread, and the caller
+ * passes it on to utxSaved from its own thread. */
+Result utxWriteAsync(UtxFile* utx, const char_t *fileFolder, FPtr_utxSaved func, void *data) {
+    if (utx == NULL) {
+        return RInvalidUtxPointer;
+    }
+    if (str_empty(utx->fileName)) {
+        return RInvalidFilePath;
+    }
+
+    String *sFileFolder = i_write_folder(utx, fileFolder);
+    if (sFileFolder == NULL) {
+        return RInvalidFilePath;
+    }
+
+    String *sFilePath = str_cpath("%s%s", tc(sFileFolder), tc(utx->fileName));
+    Result result = utxWriteContentsAsync(utx, tc(sFilePath), func, data);
+    str_destroy(&sFilePath);
+    str_destroy(&sFileFolder);
+    return result;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Edited, loaded or replaced contents get a new generation; a save queued
+ * at one generation only leaves the document unmodified at the same one. */
+uint32_t utxGeneration(const UtxFile* utx) {
+    return utx != NULL ? utx->generation : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Records a background save of the text at `generation` to `filePath` that
+ * succeeded. Must be called from the thread that edits the document. */
+void utxSaved(UtxFile* utx, uint32_t generation, const char_t *filePath) {
+    if (utx == NULL || filePath == NULL) {
+        return;
+    }
+
+    String *folder, *fileName;
+    str_split_pathname(filePath, &folder, &fileName);
+    str_cat(&folder, "/");
+    str_upd(&utx->fileFolder, tc(folder));
+    str_destroy(&folder);
+    str_destroy(&fileName);
+
+    utx->isModified = generation != utx->generation;
+}
+
+/*----------------------------------------------------------------------------*/
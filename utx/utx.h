@@ -24,15 +24,46 @@ _utx_api UtxFile* utxCreateNew(void);
 _utx_api UtxFile* utxCreateFromString(const String* contents);
 _utx_api UtxFile* utxCreateFromFile(const char_t *filePath);
 _utx_api void utxDestroy(UtxFile** utx);
+_utx_api Result utxSetFilePath(UtxFile* utx, const char_t *filePath);
 _utx_api void utxDump(const UtxFile* utx);
 
 _utx_api Result utxSetContents(UtxFile* utx, const String* contents);
+_utx_api String* utxGetContents(const UtxFile* utx);
+_utx_api String* utxGetRange(const UtxFile* utx, uint32_t offset, uint32_t size);
 _utx_api uint32_t utxLength(const UtxFile* utx);
 
+_utx_api Result utxInsert(UtxFile* utx, uint32_t offset, const char_t *text, uint32_t size);
+_utx_api Result utxDelete(UtxFile* utx, uint32_t offset, uint32_t size);
+_utx_api Result utxReplace(UtxFile* utx, uint32_t offset, uint32_t size, const char_t *text, uint32_t textSize);
+
+_utx_api Result utxFind(const UtxFile* utx, const UtxSearch* search, uint32_t from, uint32_t *offset, uint32_t *size);
+_utx_api Result utxReplaceAll(UtxFile* utx, const UtxSearch* search, const char_t *text, uint32_t size, uint32_t *count);
+_utx_api Result utxTransliterate(UtxFile* utx, UtxTranslitDir dir, uint32_t offset, uint32_t size, uint32_t *converted);
+_utx_api Result utxNormalize(UtxFile* utx, UtxNormalize profile, uint32_t offset, uint32_t size, uint32_t *normalized);
+_utx_api void utxSetNormalize(UtxFile* utx, UtxNormalize profile);
+
+_utx_api Result utxUndo(UtxFile* utx, uint32_t *offset);
+_utx_api Result utxRedo(UtxFile* utx, uint32_t *offset);
+_utx_api bool_t utxCanUndo(const UtxFile* utx);
+_utx_api bool_t utxCanRedo(const UtxFile* utx);
+_utx_api void utxUndoBreak(UtxFile* utx);
+_utx_api void utxSetUndoLimit(UtxFile* utx, uint32_t limit);
+
+_utx_api uint32_t utxLineCount(const UtxFile* utx);
+_utx_api Result utxOffsetToLine(const UtxFile* utx, uint32_t offset, uint32_t *line, uint32_t *column);
+_utx_api Result utxCharToLine(const UtxFile* utx, uint32_t index, uint32_t *line, uint32_t *column);
+_utx_api Result utxLineToOffset(const UtxFile* utx, uint32_t line, uint32_t *offset);
+_utx_api Result utxLineToChar(const UtxFile* utx, uint32_t line, uint32_t *index);
+
 _utx_api Result utxReadContentsFromFile(UtxFile* utx, const char_t *filePath);
+_utx_api Result utxLoadContentsFromFile(UtxFile* utx, const char_t *filePath, FPtr_utxProgress func, void *data);
 _utx_api Result utxRead(UtxFile* utx, const char_t *filePath);
 _utx_api Result utxWriteContentsToFile(UtxFile* utx, const char_t *filePath);
 _utx_api Result utxWrite(UtxFile* utx, const char_t *filePath);
+_utx_api Result utxWriteContentsAsync(UtxFile* utx, const char_t *filePath, FPtr_utxSaved func, void *data);
+_utx_api Result utxWriteAsync(UtxFile* utx, const char_t *fileFolder, FPtr_utxSaved func, void *data);
+_utx_api uint32_t utxGeneration(const UtxFile* utx);
+_utx_api void utxSaved(UtxFile* utx, uint32_t generation, const char_t *filePath);
 
 /*----------------------------------------------------------------------------*/
 __END_C
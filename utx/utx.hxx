@@ -13,17 +13,49 @@
 #include "utx.def"
 #include <core/core.hxx>
 
+/*----------------------------------------------------------------------------*/
+typedef struct _utx_buffer_t UtxBuffer;
+typedef struct _utx_filemap_t UtxFileMap;
+typedef struct _utx_snapshot_t UtxSnapshot;
+typedef struct _utx_history_t UtxHistory;
+typedef struct _utx_search_t UtxSearch;
+typedef struct _utx_translit_t UtxTranslit;
+typedef struct _utx_dict_builder_t UtxDictBuilder;
+typedef struct _utx_dict_t UtxDict;
+typedef struct _utx_spell_t UtxSpell;
+typedef struct _utx_tokens_t UtxTokens;
+typedef struct _utx_edit_trace_t UtxEditTrace;
+
+/*----------------------------------------------------------------------------*/
+/* Flags; NormUrdu is the usual profile for Urdu text. */
+typedef enum norm_t UtxNormalize;
+enum norm_t {
+    NormNone = 0,
+    NormNfc = 1,
+    NormFoldYeh = 2,
+    NormFoldKaf = 4,
+    NormFoldHamza = 8,
+    NormFoldDigits = 16,
+    NormUrdu = 31,
+};
+
 /*----------------------------------------------------------------------------*/
 typedef struct _utx_file UtxFile;
 struct _utx_file {
     /* String* filePath; */
     String* fileFolder;
     String* fileName;
-    String* contents;
+    UtxBuffer* buffer;
+    UtxHistory* history;
+    UtxNormalize normalize;
+    UtxEditTrace* trace;
+    uint32_t generation;
     bool_t isModified;
 };
 
 #define FILE_BUFFER_SIZE 1048576
+#define UNDO_MEMORY_LIMIT 67108864
+#define MAX_WORD_SIZE 256
 
 /*----------------------------------------------------------------------------*/
 typedef enum result_t Result;
@@ -33,8 +65,112 @@ enum result_t {
     RInvalidContents,
     RInvalidFilePath,
     RFileError,
+    RInvalidRange,
+    RInvalidEncoding,
+    RCancelled,
+    RNoHistory,
+    RNotFound,
 };
 
+/*----------------------------------------------------------------------------*/
+typedef struct _utx_utf8_t UtxUtf8;
+struct _utx_utf8_t {
+    uint32_t need;
+    byte_t lo;
+    byte_t hi;
+};
+
+typedef enum simd_t UtxSimd;
+enum simd_t {
+    SimdAuto = -1,
+    SimdScalar = 0,
+    SimdSse2,
+    SimdAvx2,
+};
+
+/*----------------------------------------------------------------------------*/
+typedef enum search_t UtxSearchMode;
+enum search_t {
+    SearchExact = 0,
+    SearchNoHarakat,
+};
+
+/*----------------------------------------------------------------------------*/
+typedef enum translit_t UtxTranslitDir;
+enum translit_t {
+    TranslitRomanToUrdu = 0,
+    TranslitUrduToRoman,
+};
+
+/*----------------------------------------------------------------------------*/
+typedef enum token_t UtxTokenKind;
+enum token_t {
+    TokenSpace = 0,
+    TokenWord,
+    TokenLatin,
+    TokenNumber,
+    TokenPunct,
+};
+
+typedef struct _utx_range_t UtxRange;
+struct _utx_range_t {
+    uint32_t offset;
+    uint32_t size;
+};
+
+typedef struct _utx_token_t UtxToken;
+struct _utx_token_t {
+    uint32_t offset;
+    uint32_t size;
+    UtxTokenKind kind;
+};
+
+/*----------------------------------------------------------------------------*/
+/* For EditCursor, `offset` is the caret and `removed` the selection anchor;
+ * for EditNormalize, `offset` is the profile. */
+typedef enum edit_t UtxEditKind;
+enum edit_t {
+    EditInsert = 1,
+    EditDelete,
+    EditReplace,
+    EditRewrite,
+    EditCursor,
+    EditUndo,
+    EditRedo,
+    EditBreak,
+    EditSave,
+    EditReset,
+    EditNormalize,
+    EditGroup,
+};
+
+typedef struct _utx_edit_event_t UtxEditEvent;
+struct _utx_edit_event_t {
+    UtxEditKind kind;
+    uint64_t time;
+    uint32_t offset;
+    uint32_t removed;
+    const char_t *text;
+    uint32_t size;
+};
+
+/*----------------------------------------------------------------------------*/
+typedef enum trace_t UtxTraceKind;
+enum trace_t {
+    TraceBegin = 0,
+    TraceEnd,
+    TraceCounter,
+};
+
+/*----------------------------------------------------------------------------*/
+typedef bool_t (*FPtr_utxChunk)(void *data, const char_t *chunk, const uint32_t size);
+typedef bool_t (*FPtr_utxProgress)(void *data, const uint32_t loaded, const uint32_t total);
+typedef void (*FPtr_utxSaved)(void *data, const char_t *filePath, const Result result);
+typedef void (*FPtr_utxEdited)(void *data, const uint32_t offset, const uint32_t removed, const uint32_t inserted);
+typedef bool_t (*FPtr_utxToken)(void *data, const UtxToken *token);
+typedef bool_t (*FPtr_utxWord)(void *data, const char_t *word, const uint32_t size, const uint32_t distance);
+typedef void (*FPtr_utxReplayed)(void *data, const UtxEditEvent *event, const uint64_t elapsed);
+
 /*----------------------------------------------------------------------------*/
 #endif /* __UTX_HXX__ */
 /*----------------------------------------------------------------------------*/